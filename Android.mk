@@ -44,12 +44,16 @@ LOCAL_STATIC_LIBRARIES := $(aidl_static_libraries)
 
 LOCAL_SRC_FILES := \
     aidl.cpp \
+    aidl_arena.cpp \
     aidl_language.cpp \
     aidl_language_l.ll \
     aidl_language_y.yy \
     ast_cpp.cpp \
     ast_java.cpp \
     code_writer.cpp \
+    compilation_context.cpp \
+    dispatch_profile.cpp \
+    generate_common.cpp \
     generate_cpp.cpp \
     generate_java.cpp \
     generate_java_binder.cpp \
@@ -57,9 +61,11 @@ LOCAL_SRC_FILES := \
     line_reader.cpp \
     io_delegate.cpp \
     options.cpp \
+    semantic_hash.cpp \
     type_cpp.cpp \
     type_java.cpp \
     type_namespace.cpp \
+    wire_size.cpp \
 
 include $(BUILD_HOST_STATIC_LIBRARY)
 
@@ -86,6 +92,29 @@ LOCAL_SRC_FILES := main_cpp.cpp
 LOCAL_STATIC_LIBRARIES := libaidl-common $(aidl_static_libraries)
 include $(BUILD_HOST_EXECUTABLE)
 
+# Runtime support for C++ clients generated with aidl-cpp --async
+aidl_async_src_files := \
+    async_executor.cpp \
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := libaidl-async
+LOCAL_MODULE_HOST_OS := darwin linux
+LOCAL_CFLAGS := $(aidl_cflags)
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/include
+LOCAL_SRC_FILES := $(aidl_async_src_files)
+LOCAL_STATIC_LIBRARIES := libbase
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := libaidl-async
+LOCAL_CFLAGS := $(aidl_cflags)
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/include
+LOCAL_SRC_FILES := $(aidl_async_src_files)
+LOCAL_STATIC_LIBRARIES := libbase
+include $(BUILD_STATIC_LIBRARY)
+
 # Unit tests
 include $(CLEAR_VARS)
 LOCAL_MODULE := aidl_unittests
@@ -95,14 +124,18 @@ LOCAL_CFLAGS := $(aidl_cflags) -g -DUNIT_TEST
 # Tragically, the code is riddled with unused parameters.
 LOCAL_CLANG_CFLAGS := -Wno-unused-parameter
 LOCAL_SRC_FILES := \
+    aidl_arena_unittest.cpp \
     aidl_unittest.cpp \
     ast_cpp_unittest.cpp \
+    async_executor_unittest.cpp \
     ast_java_unittest.cpp \
+    compilation_context_unittest.cpp \
     generate_cpp_unittest.cpp \
     io_delegate_unittest.cpp \
     options_unittest.cpp \
     tests/end_to_end_tests.cpp \
     tests/fake_io_delegate.cpp \
+    tests/fake_transport.cpp \
     tests/main.cpp \
     tests/test_data_example_interface.cpp \
     tests/test_data_ping_responder.cpp \
@@ -112,6 +145,7 @@ LOCAL_SRC_FILES := \
 
 LOCAL_STATIC_LIBRARIES := \
     libaidl-common \
+    libaidl-async \
     $(aidl_static_libraries) \
     libgmock_host \
     libgtest_host \
@@ -119,6 +153,41 @@ LOCAL_STATIC_LIBRARIES := \
 LOCAL_LDLIBS_linux := -lrt
 include $(BUILD_HOST_NATIVE_TEST)
 
+# The co_await support for generated clients needs a C++20 compiler, so its
+# tests are built separately from the rest.
+include $(CLEAR_VARS)
+LOCAL_MODULE := aidl_coroutine_unittests
+LOCAL_MODULE_HOST_OS := darwin linux
+
+LOCAL_CFLAGS := $(aidl_cflags) -g -DUNIT_TEST
+LOCAL_CPPFLAGS := -std=c++2a
+LOCAL_SRC_FILES := \
+    status_awaitable_unittest.cpp \
+    tests/fake_transport.cpp \
+    tests/main.cpp \
+
+LOCAL_STATIC_LIBRARIES := \
+    libaidl-async \
+    libbase \
+    libgtest_host \
+
+include $(BUILD_HOST_NATIVE_TEST)
+
+# Measures how long the C++ aidl-cpp generates takes to compile, e.g.
+#   aidl_codegen_benchmark --stubs=system/tools/aidl/tests/benchmark_stubs
+include $(CLEAR_VARS)
+LOCAL_MODULE := aidl_codegen_benchmark
+LOCAL_MODULE_HOST_OS := linux
+
+LOCAL_CFLAGS := $(aidl_cflags)
+LOCAL_SRC_FILES := \
+    tests/aidl_codegen_benchmark.cpp \
+    tests/fake_io_delegate.cpp \
+    tests/test_util.cpp \
+
+LOCAL_STATIC_LIBRARIES := libaidl-common $(aidl_static_libraries)
+include $(BUILD_HOST_EXECUTABLE)
+
 #
 # Everything below here is used for integration testing of generated AIDL code.
 #
@@ -133,6 +202,10 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := libaidl-integration-test
 LOCAL_MODULE_CLASS := SHARED_LIBRARIES
 LOCAL_CFLAGS := $(aidl_integration_test_cflags)
+# For aidl/packed_arrays.h and aidl/compressed_payload.h, which the generated
+# headers include.
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/include
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/include
 LOCAL_SHARED_LIBRARIES := $(aidl_integration_test_shared_libs)
 LOCAL_AIDL_INCLUDES := \
     system/tools/aidl/tests/ \
@@ -180,6 +253,13 @@ include $(BUILD_EXECUTABLE)
 # compatibility introduces java dependencies.
 ifndef BRILLO
 
+# Runtime support for Java generated from interfaces that use @packed or
+# @compressed.
+include $(CLEAR_VARS)
+LOCAL_MODULE := aidl-java-runtime
+LOCAL_SRC_FILES := $(call all-java-files-under, java)
+include $(BUILD_STATIC_JAVA_LIBRARY)
+
 include $(CLEAR_VARS)
 LOCAL_PACKAGE_NAME := aidl_test_services
 # Turn off Java optimization tools to speed up our test iterations.
@@ -193,6 +273,7 @@ LOCAL_SRC_FILES := \
     tests/android/aidl/tests/INamedCallback.aidl \
     tests/java_app/src/android/aidl/tests/SimpleParcelable.java \
     tests/java_app/src/android/aidl/tests/TestServiceClient.java
+LOCAL_STATIC_JAVA_LIBRARIES := aidl-java-runtime
 LOCAL_AIDL_INCLUDES := \
     system/tools/aidl/tests/ \
     frameworks/native/aidl/binder
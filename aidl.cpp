@@ -16,6 +16,7 @@
 
 #include "aidl.h"
 
+#include <algorithm>
 #include <fcntl.h>
 #include <iostream>
 #include <map>
@@ -35,6 +36,7 @@
 #include <android-base/strings.h>
 
 #include "aidl_language.h"
+#include "dispatch_profile.h"
 #include "generate_cpp.h"
 #include "generate_java.h"
 #include "import_resolver.h"
@@ -44,6 +46,7 @@
 #include "type_cpp.h"
 #include "type_java.h"
 #include "type_namespace.h"
+#include "wire_size.h"
 
 #ifndef O_BINARY
 #  define O_BINARY  0
@@ -125,9 +128,9 @@ bool check_filename(const std::string& filename,
     }
 
     if (!valid) {
-        fprintf(stderr, "%s:%d interface %s should be declared in a file"
-                " called %s.\n",
-                filename.c_str(), line, name.c_str(), expected.c_str());
+        cerr << filename << ":" << line << " interface " << name
+             << " should be declared in a file called " << expected << "."
+             << endl;
     }
 
     return valid;
@@ -201,6 +204,31 @@ int check_types(const string& filename,
         err = 1;
     }
 
+    if (m->IsBatchable() && !oneway) {
+        cerr << filename << ":" << m->GetLine()
+            << " method '" << m->GetName() << "' must be oneway to be"
+            << " @batchable" << endl;
+        err = 1;
+    }
+
+    // Batches go out as the last call transaction, and proxies of interfaces
+    // with batchable methods gain a flushBatch() method.
+    if (c->HasBatchableMethods()) {
+      if (m->GetId() == kMaxUserSetMethodId) {
+        cerr << filename << ":" << m->GetLine()
+            << " method '" << m->GetName() << "' cannot have id "
+            << kMaxUserSetMethodId << ", which is reserved for batches"
+            << endl;
+        err = 1;
+      }
+      if (m->GetName() == "flushBatch") {
+        cerr << filename << ":" << m->GetLine()
+            << " method 'flushBatch' clashes with the one generated for"
+            << " @batchable methods" << endl;
+        err = 1;
+      }
+    }
+
     int index = 1;
     for (const auto& arg : m->GetArguments()) {
       if (!types->MaybeAddContainerType(arg->GetType())) {
@@ -227,13 +255,13 @@ int check_types(const string& filename,
     auto it = method_names.find(m->GetName());
     // prevent duplicate methods
     if (it == method_names.end()) {
-      method_names[m->GetName()] = m.get();
+      method_names[m->GetName()] = m;
     } else {
       if (m->HasId()) {
         cerr << filename << ":" << m->GetLine()
              << " redefining method " << m->GetName() << endl;
         m->SetDeduplicate(true);
-        method_names[m->GetName()] = m.get();
+        method_names[m->GetName()] = m;
       } else {
         cerr << filename << ":" << m->GetLine()
              << " attempt to redefine method " << m->GetName() << "," << endl
@@ -246,6 +274,87 @@ int check_types(const string& filename,
   return err;
 }
 
+// Rejects methods whose parcels can never fit in the binder transaction
+// buffer, whatever their arguments.
+int check_wire_sizes(const string& filename, const AidlInterface& interface) {
+  int err = 0;
+  for (const AidlMethod* m : interface.GetMethods()) {
+    const MethodWireSize size = GetMethodWireSize(interface, *m);
+    const bool oneway = interface.IsOneway() || m->IsOneway();
+    // Oneway transactions may only use half of the buffer.
+    const size_t limit = (oneway) ? kBinderTransactionBufferSize / 2
+                                  : kBinderTransactionBufferSize;
+    if (size.request.min > limit || size.reply.min > limit) {
+      cerr << filename << ":" << m->GetLine()
+           << " method " << m->GetName() << " needs at least "
+           << std::max(size.request.min, size.reply.min)
+           << " bytes per transaction, but binder allows only " << limit
+           << endl;
+      err = 1;
+    }
+  }
+  return err;
+}
+
+// Fields of a @FixedSize parcelable must be laid out the same in a C++
+// struct as in the parcel, which pads every value to 4 bytes.  Only 4 and 8
+// byte primitives are, since Java writes boolean, byte and char as ints.
+bool is_fixed_size_field(const AidlVariableDeclaration& field) {
+  const AidlType& type = field.GetType();
+  if (type.IsArray() || type.IsNullable()) {
+    return false;
+  }
+  for (const char* name : {"int", "long", "float", "double"}) {
+    if (type.GetName() == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int check_fields(const string& filename,
+                 const AidlStructuredParcelable& parcelable,
+                 TypeNamespace* types) {
+  int err = 0;
+
+  set<string> field_names;
+  for (AidlVariableDeclaration* field : parcelable.GetFields()) {
+    if (!types->MaybeAddContainerType(field->GetType())) {
+      err = 1;
+    }
+
+    const ValidatableType* field_type =
+        types->GetFieldType(*field, filename);
+    if (!field_type) {
+      err = 1;
+    }
+
+    field->GetMutableType()->SetLanguageType(field_type);
+
+    if (parcelable.IsFixedSize() && !is_fixed_size_field(*field)) {
+      cerr << filename << ":" << field->GetLine()
+           << " @FixedSize parcelable " << parcelable.GetName()
+           << " can only hold int, long, float and double fields, but "
+           << field->GetName() << " is " << field->GetType().ToString()
+           << endl;
+      err = 1;
+    }
+
+    if (!field_names.insert(field->GetName()).second) {
+      cerr << filename << ":" << field->GetLine()
+           << " redefining field " << field->GetName() << endl;
+      err = 1;
+    }
+  }
+  if (parcelable.IsFixedSize() && parcelable.GetFields().empty()) {
+    cerr << filename << ":" << parcelable.GetLine()
+         << " @FixedSize parcelable " << parcelable.GetName()
+         << " has no fields" << endl;
+    err = 1;
+  }
+  return err;
+}
+
 void write_common_dep_file(const string& output_file,
                            const vector<string>& aidl_sources,
                            CodeWriter* writer) {
@@ -288,12 +397,9 @@ bool write_java_dep_file(const JavaOptions& options,
 }
 
 bool write_cpp_dep_file(const CppOptions& options,
-                        const AidlInterface& interface,
+                        const vector<string>& headers,
                         const vector<unique_ptr<AidlImport>>& imports,
                         const IoDelegate& io_delegate) {
-  using ::android::aidl::cpp::HeaderFile;
-  using ::android::aidl::cpp::ClassNames;
-
   string dep_file_name = options.DependencyFilePath();
   if (dep_file_name.empty()) {
     return true;  // nothing to do
@@ -311,14 +417,6 @@ bool write_cpp_dep_file(const CppOptions& options,
     }
   }
 
-  vector<string> headers;
-  for (ClassNames c : {ClassNames::CLIENT,
-                       ClassNames::SERVER,
-                       ClassNames::INTERFACE}) {
-    headers.push_back(options.OutputHeaderDir() + '/' +
-                      HeaderFile(interface, c, false /* use_os_sep */));
-  }
-
   write_common_dep_file(options.OutputCppFilePath(), source_aidl, writer.get());
   writer->Write("\n");
 
@@ -330,9 +428,8 @@ bool write_cpp_dep_file(const CppOptions& options,
 }
 
 string generate_outputFileName(const JavaOptions& options,
-                               const AidlInterface& interface) {
-    string name = interface.GetName();
-    string package = interface.GetPackage();
+                               const string& name,
+                               const string& package) {
     string result;
 
     // create the path to the destination folder based on the
@@ -359,7 +456,7 @@ string generate_outputFileName(const JavaOptions& options,
 }
 
 int check_and_assign_method_ids(const char * filename,
-                                const std::vector<std::unique_ptr<AidlMethod>>& items) {
+                                const std::vector<AidlMethod*>& items) {
     // Check whether there are any methods with manually assigned id's and any that are not.
     // Either all method id's must be manually assigned or all of them must not.
     // Also, check for duplicates of user set id's and that the id's are within the proper bounds.
@@ -372,20 +469,20 @@ int check_and_assign_method_ids(const char * filename,
             // Ensure that the user set id is not duplicated.
             if (usedIds.find(item->GetId()) != usedIds.end()) {
                 // We found a duplicate id, so throw an error.
-                fprintf(stderr,
-                        "%s:%d Found duplicate method id (%d) for method: %s\n",
-                        filename, item->GetLine(),
-                        item->GetId(), item->GetName().c_str());
+                cerr << filename << ":" << item->GetLine()
+                     << " Found duplicate method id (" << item->GetId()
+                     << ") for method: " << item->GetName() << endl;
                 return 1;
             }
             // Ensure that the user set id is within the appropriate limits
             if (item->GetId() < kMinUserSetMethodId ||
                     item->GetId() > kMaxUserSetMethodId) {
-                fprintf(stderr, "%s:%d Found out of bounds id (%d) for method: %s\n",
-                        filename, item->GetLine(),
-                        item->GetId(), item->GetName().c_str());
-                fprintf(stderr, "    Value for id must be between %d and %d inclusive.\n",
-                        kMinUserSetMethodId, kMaxUserSetMethodId);
+                cerr << filename << ":" << item->GetLine()
+                     << " Found out of bounds id (" << item->GetId()
+                     << ") for method: " << item->GetName() << endl;
+                cerr << "    Value for id must be between "
+                     << kMinUserSetMethodId << " and " << kMaxUserSetMethodId
+                     << " inclusive." << endl;
                 return 1;
             }
             usedIds.insert(item->GetId());
@@ -393,9 +490,8 @@ int check_and_assign_method_ids(const char * filename,
             hasUnassignedIds = true;
         }
         if (hasAssignedIds && hasUnassignedIds) {
-            fprintf(stderr,
-                    "%s: You must either assign id's to all methods or to none of them.\n",
-                    filename);
+            cerr << filename << ": You must either assign id's to all "
+                 << "methods or to none of them." << endl;
             return 1;
         }
     }
@@ -488,11 +584,12 @@ bool parse_preprocessed_file(const IoDelegate& io_delegate,
     }
 
     if (decl == "parcelable") {
-      AidlParcelable doc(new AidlQualifiedName(class_name, ""),
+      AidlArena arena;
+      AidlParcelable doc(arena.New<AidlQualifiedName>(class_name, ""),
                          lineno, package);
       types->AddParcelableType(doc, filename);
     } else if (decl == "interface") {
-      auto temp = new std::vector<std::unique_ptr<AidlMember>>();
+      auto temp = new std::vector<AidlMember*>();
       AidlInterface doc(class_name, lineno, "", false, temp, package);
       types->AddBinderType(doc, filename);
     } else {
@@ -515,10 +612,14 @@ AidlError load_and_validate_aidl(
     const IoDelegate& io_delegate,
     TypeNamespace* types,
     std::unique_ptr<AidlInterface>* returned_interface,
-    std::vector<std::unique_ptr<AidlImport>>* returned_imports) {
+    std::vector<std::unique_ptr<AidlImport>>* returned_imports,
+    LoadCache* cache,
+    std::unique_ptr<AidlStructuredParcelable>* returned_parcelable) {
   AidlError err = AidlError::OK;
 
-  std::map<AidlImport*,std::unique_ptr<AidlDocument>> docs;
+  // Documents are owned by |owned_docs| or by |cache|.
+  std::map<AidlImport*,const AidlDocument*> docs;
+  vector<unique_ptr<AidlDocument>> owned_docs;
 
   // import the preprocessed file
   for (const string& s : preprocessed_files) {
@@ -539,18 +640,26 @@ AidlError load_and_validate_aidl(
   AidlDocument* parsed_doc = p.GetDocument();
 
   unique_ptr<AidlInterface> interface(parsed_doc->ReleaseInterface());
+  unique_ptr<AidlStructuredParcelable> parcelable;
+  if (!interface && returned_parcelable) {
+    parcelable.reset(parsed_doc->ReleaseStructuredParcelable());
+  }
 
-  if (!interface) {
+  if (!interface && !parcelable) {
     LOG(ERROR) << "refusing to generate code from aidl file defining "
                   "parcelable";
     return AidlError::FOUND_PARCELABLE;
   }
 
-  if (!check_filename(input_file_name.c_str(), interface->GetPackage(),
-                      interface->GetName(), interface->GetLine()) ||
-      !types->IsValidPackage(interface->GetPackage())) {
-    LOG(ERROR) << "Invalid package declaration '" << interface->GetPackage()
-               << "'";
+  const string package =
+      (interface) ? interface->GetPackage() : parcelable->GetPackage();
+  const string name =
+      (interface) ? interface->GetName() : parcelable->GetName();
+  const unsigned line =
+      (interface) ? interface->GetLine() : parcelable->GetLine();
+  if (!check_filename(input_file_name.c_str(), package, name, line) ||
+      !types->IsValidPackage(package)) {
+    LOG(ERROR) << "Invalid package declaration '" << package << "'";
     return AidlError::BAD_PACKAGE;
   }
 
@@ -573,30 +682,62 @@ AidlError load_and_validate_aidl(
     }
     import->SetFilename(import_path);
 
-    Parser p{io_delegate};
-    if (!p.ParseFile(import->GetFilename())) {
-      cerr << "error while parsing import for class "
-           << import->GetNeededClass() << endl;
-      err = AidlError::BAD_IMPORT;
-      continue;
+    const AidlDocument* document = nullptr;
+    unique_ptr<string> contents;
+    if (cache) {
+      contents = io_delegate.GetFileContents(import_path);
+      auto it = cache->parsed_imports.find(import_path);
+      if (contents && it != cache->parsed_imports.end() &&
+          it->second.contents == *contents) {
+        document = it->second.document.get();
+      }
+    }
+
+    if (!document) {
+      // Only the declarations of an import are needed to register its types.
+      // With a cache, the contents read above are parsed rather than read
+      // again.
+      Parser p{io_delegate};
+      const bool parsed_ok =
+          (contents) ? p.ParseDeclarations(import->GetFilename(), *contents)
+                     : p.ParseDeclarations(import->GetFilename());
+      if (!parsed_ok) {
+        cerr << "error while parsing import for class "
+             << import->GetNeededClass() << endl;
+        err = AidlError::BAD_IMPORT;
+        continue;
+      }
+
+      unique_ptr<AidlDocument> parsed(p.ReleaseDocument());
+      document = parsed.get();
+      if (cache && contents) {
+        LoadCache::ParsedImport& entry = cache->parsed_imports[import_path];
+        entry.contents = std::move(*contents);
+        entry.document = std::move(parsed);
+      } else {
+        owned_docs.push_back(std::move(parsed));
+      }
     }
 
-    std::unique_ptr<AidlDocument> document(p.ReleaseDocument());
-    if (!check_filenames(import->GetFilename(), document.get()))
+    if (!check_filenames(import->GetFilename(), document))
       err = AidlError::BAD_IMPORT;
-    docs[import.get()] = std::move(document);
+    docs[import.get()] = document;
   }
   if (err != AidlError::OK) {
     return err;
   }
 
   // gather the types that have been declared
-  if (!types->AddBinderType(*interface.get(), input_file_name)) {
+  if (interface) {
+    if (!types->AddBinderType(*interface.get(), input_file_name)) {
+      err = AidlError::BAD_TYPE;
+    }
+
+    interface->SetLanguageType(types->GetInterfaceType(*interface));
+  } else if (!types->AddParcelableType(*parcelable.get(), input_file_name)) {
     err = AidlError::BAD_TYPE;
   }
 
-  interface->SetLanguageType(types->GetInterfaceType(*interface));
-
   for (const auto& import : p.GetImports()) {
     // If we skipped an unresolved import above (see comment there) we'll have
     // an empty bucket here.
@@ -605,7 +746,7 @@ AidlError load_and_validate_aidl(
       continue;
     }
 
-    if (!gather_types(import->GetFilename(), import_itr->second.get(), types)) {
+    if (!gather_types(import->GetFilename(), import_itr->second, types)) {
       err = AidlError::BAD_TYPE;
     }
   }
@@ -615,6 +756,19 @@ AidlError load_and_validate_aidl(
   }
 
 
+  if (parcelable) {
+    // check the field types to make sure we've imported them
+    if (check_fields(input_file_name, *parcelable, types) != 0) {
+      return AidlError::BAD_TYPE;
+    }
+
+    *returned_parcelable = std::move(parcelable);
+    if (returned_imports)
+      p.ReleaseImports(returned_imports);
+
+    return AidlError::OK;
+  }
+
   // assign method ids and validate.
   if (check_and_assign_method_ids(input_file_name.c_str(),
                                   interface->GetMethods()) != 0) {
@@ -626,6 +780,10 @@ AidlError load_and_validate_aidl(
     return AidlError::BAD_TYPE;
   }
 
+  if (check_wire_sizes(input_file_name, *interface) != 0) {
+    return AidlError::BAD_TYPE;
+  }
+
   if (returned_interface)
     *returned_interface = std::move(interface);
 
@@ -639,7 +797,11 @@ AidlError load_and_validate_aidl(
 
 int compile_aidl_to_cpp(const CppOptions& options,
                         const IoDelegate& io_delegate) {
+  using ::android::aidl::cpp::HeaderFile;
+  using ::android::aidl::cpp::ClassNames;
+
   unique_ptr<AidlInterface> interface;
+  unique_ptr<AidlStructuredParcelable> parcelable;
   std::vector<std::unique_ptr<AidlImport>> imports;
   unique_ptr<cpp::TypeNamespace> types(new cpp::TypeNamespace());
   types->Init();
@@ -650,21 +812,55 @@ int compile_aidl_to_cpp(const CppOptions& options,
       io_delegate,
       types.get(),
       &interface,
-      &imports);
+      &imports,
+      nullptr,  // no cache
+      &parcelable);
   if (err != AidlError::OK) {
     return 1;
   }
 
-  if (!write_cpp_dep_file(options, *interface, imports, io_delegate)) {
+  if (parcelable) {
+    const vector<string> headers{options.OutputHeaderDir() + '/' +
+                                 HeaderFile(*parcelable,
+                                            false /* use_os_sep */)};
+    if (!write_cpp_dep_file(options, headers, imports, io_delegate)) {
+      return 1;
+    }
+    return (cpp::GenerateCppParcel(options, *types, *parcelable,
+                                   io_delegate)) ? 0 : 1;
+  }
+
+  vector<string> headers;
+  for (ClassNames c : {ClassNames::CLIENT,
+                       ClassNames::SERVER,
+                       ClassNames::INTERFACE,
+                       ClassNames::FORWARD}) {
+    headers.push_back(options.OutputHeaderDir() + '/' +
+                      HeaderFile(*interface, c, false /* use_os_sep */));
+  }
+  if (!write_cpp_dep_file(options, headers, imports, io_delegate)) {
     return 1;
   }
 
-  return (cpp::GenerateCpp(options, *types, *interface, io_delegate)) ? 0 : 1;
+  if (!options.SizeReportPath().empty() &&
+      !WriteSizeReport(*interface, options.SizeReportPath(), io_delegate)) {
+    return 1;
+  }
+
+  DispatchProfile profile;
+  if (!options.DispatchProfilePath().empty() &&
+      !profile.Load(options.DispatchProfilePath(), io_delegate)) {
+    return 1;
+  }
+
+  return (cpp::GenerateCpp(options, *types, *interface, io_delegate,
+                           &profile)) ? 0 : 1;
 }
 
 int compile_aidl_to_java(const JavaOptions& options,
                          const IoDelegate& io_delegate) {
   unique_ptr<AidlInterface> interface;
+  unique_ptr<AidlStructuredParcelable> parcelable;
   std::vector<std::unique_ptr<AidlImport>> imports;
   unique_ptr<java::JavaTypeNamespace> types(new java::JavaTypeNamespace());
   types->Init();
@@ -675,7 +871,9 @@ int compile_aidl_to_java(const JavaOptions& options,
       io_delegate,
       types.get(),
       &interface,
-      &imports);
+      &imports,
+      nullptr,  // no cache
+      &parcelable);
   if (aidl_err == AidlError::FOUND_PARCELABLE && !options.fail_on_parcelable_) {
     // We aborted code generation because this file contains parcelables.
     // However, we were not told to complain if we find parcelables.
@@ -691,7 +889,11 @@ int compile_aidl_to_java(const JavaOptions& options,
   string output_file_name = options.output_file_name_;
   // if needed, generate the output file name from the base folder
   if (output_file_name.empty() && !options.output_base_folder_.empty()) {
-    output_file_name = generate_outputFileName(options, *interface);
+    output_file_name = (interface)
+        ? generate_outputFileName(options, interface->GetName(),
+                                  interface->GetPackage())
+        : generate_outputFileName(options, parcelable->GetName(),
+                                  parcelable->GetPackage());
   }
 
   // make sure the folders of the output file all exists
@@ -703,13 +905,32 @@ int compile_aidl_to_java(const JavaOptions& options,
     return 1;
   }
 
+  if (parcelable) {
+    return generate_java_parcel(output_file_name,
+                                options.input_file_name_.c_str(),
+                                parcelable.get(), types.get(), io_delegate);
+  }
+
   unsigned int flags = 0;
   if (options.generate_no_op_methods_) {
     flags |= GENERATE_NO_OP_CLASS;
   }
+  if (options.generate_traces_) {
+    flags |= GENERATE_TRACES;
+  }
+  if (options.generate_compact_) {
+    flags |= GENERATE_COMPACT;
+  }
+
+  DispatchProfile profile;
+  if (!options.dispatch_profile_file_name_.empty() &&
+      !profile.Load(options.dispatch_profile_file_name_, io_delegate)) {
+    return 1;
+  }
 
   return generate_java(output_file_name, options.input_file_name_.c_str(),
-                       interface.get(), types.get(), io_delegate, flags);
+                       interface.get(), types.get(), io_delegate, flags,
+                       &profile);
 }
 
 bool preprocess_aidl(const JavaOptions& options,
@@ -719,7 +940,7 @@ bool preprocess_aidl(const JavaOptions& options,
 
   for (const auto& file : options.files_to_preprocess_) {
     Parser p{io_delegate};
-    if (!p.ParseFile(file))
+    if (!p.ParseDeclarations(file))
       return false;
     AidlDocument* doc = p.GetDocument();
     string line;
@@ -18,6 +18,7 @@
 #define AIDL_AIDL_H_
 
 #include <limits>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -53,6 +54,24 @@ bool preprocess_aidl(const JavaOptions& options,
 
 namespace internals {
 
+// State that load_and_validate_aidl() may reuse between calls.  Imports are
+// parsed once and then served from here until their contents change.
+// Import paths are resolved on every call, since a file that appears in an
+// earlier import directory must take precedence over the one cached.
+struct LoadCache {
+  struct ParsedImport {
+    std::string contents;
+    std::unique_ptr<AidlDocument> document;
+  };
+  // Parsed import documents, keyed by file path.  An entry is only reused
+  // while the file contents are unchanged.
+  std::map<std::string, ParsedImport> parsed_imports;
+};
+
+// Loads |input_file_name| and validates it against |types|.  Files that
+// declare a structured parcelable rather than an interface are only accepted
+// when |returned_parcelable| is given; it is set in place of
+// |returned_interface|.
 AidlError load_and_validate_aidl(
     const std::vector<std::string> preprocessed_files,
     const std::vector<std::string> import_paths,
@@ -60,7 +79,9 @@ AidlError load_and_validate_aidl(
     const IoDelegate& io_delegate,
     TypeNamespace* types,
     std::unique_ptr<AidlInterface>* returned_interface,
-    std::vector<std::unique_ptr<AidlImport>>* returned_imports);
+    std::vector<std::unique_ptr<AidlImport>>* returned_imports,
+    LoadCache* cache = nullptr,
+    std::unique_ptr<AidlStructuredParcelable>* returned_parcelable = nullptr);
 
 bool parse_preprocessed_file(const IoDelegate& io_delegate,
                              const std::string& filename, TypeNamespace* types);
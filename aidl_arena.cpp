@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "aidl_arena.h"
+
+#include <cstdint>
+
+namespace {
+
+// Most .aidl files fit their whole AST in a couple of blocks this size.
+const size_t kBlockSize = 8192;
+
+}  // namespace
+
+AidlArena::~AidlArena() {
+  for (auto it = finalizers_.rbegin(); it != finalizers_.rend(); ++it) {
+    it->destroy(it->object);
+  }
+}
+
+void* AidlArena::Allocate(size_t size, size_t alignment) {
+  size_t padding = 0;
+  if (cursor_ != nullptr) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(cursor_);
+    padding = (alignment - address % alignment) % alignment;
+  }
+
+  if (cursor_ == nullptr || padding + size > remaining_) {
+    // Requests that would waste most of a block get a block of their own,
+    // and the current block stays open for the small nodes that follow.
+    const size_t block_size = size + alignment;
+    if (block_size > kBlockSize / 4) {
+      blocks_.emplace_back(new char[block_size]);
+      uintptr_t address = reinterpret_cast<uintptr_t>(blocks_.back().get());
+      bytes_allocated_ += size;
+      return blocks_.back().get() +
+             (alignment - address % alignment) % alignment;
+    }
+
+    blocks_.emplace_back(new char[kBlockSize]);
+    cursor_ = blocks_.back().get();
+    remaining_ = kBlockSize;
+    uintptr_t address = reinterpret_cast<uintptr_t>(cursor_);
+    padding = (alignment - address % alignment) % alignment;
+  }
+
+  char* result = cursor_ + padding;
+  cursor_ = result + size;
+  remaining_ -= padding + size;
+  bytes_allocated_ += size;
+  return result;
+}
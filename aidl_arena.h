@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_AIDL_ARENA_H_
+#define AIDL_AIDL_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <android-base/macros.h>
+
+// Bump allocator for the nodes built while parsing a single file.
+// Objects allocated here are never freed individually; they are destroyed
+// in reverse order of construction when the arena itself is destroyed.
+class AidlArena {
+ public:
+  AidlArena() = default;
+  ~AidlArena();
+
+  // Returns |size| bytes aligned to |alignment|, valid for the lifetime of
+  // the arena.
+  void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  // Constructs a T in the arena.  The arena owns the result.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    void* storage = Allocate(sizeof(T), alignof(T));
+    T* object = new (storage) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      finalizers_.push_back({&Destroy<T>, object});
+    }
+    return object;
+  }
+
+  // Total number of bytes handed out by Allocate().
+  size_t BytesAllocated() const { return bytes_allocated_; }
+
+ private:
+  struct Finalizer {
+    void (*destroy)(void*);
+    void* object;
+  };
+
+  template <typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::vector<Finalizer> finalizers_;
+  char* cursor_ = nullptr;
+  size_t remaining_ = 0;
+  size_t bytes_allocated_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AidlArena);
+};
+
+#endif // AIDL_AIDL_ARENA_H_
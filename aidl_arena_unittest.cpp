@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aidl_arena.h"
+#include "aidl_language.h"
+#include "tests/fake_io_delegate.h"
+
+using android::aidl::test::FakeIoDelegate;
+using std::string;
+using std::vector;
+
+namespace {
+
+class Tracked {
+ public:
+  Tracked(vector<int>* destroyed, int id) : destroyed_(destroyed), id_(id) {}
+  ~Tracked() { destroyed_->push_back(id_); }
+
+ private:
+  vector<int>* destroyed_;
+  int id_;
+};
+
+}  // namespace
+
+TEST(AidlArenaTest, DestroysObjectsInReverseOrder) {
+  vector<int> destroyed;
+  {
+    AidlArena arena;
+    arena.New<Tracked>(&destroyed, 1);
+    arena.New<Tracked>(&destroyed, 2);
+    arena.New<Tracked>(&destroyed, 3);
+    EXPECT_TRUE(destroyed.empty());
+  }
+  EXPECT_EQ((vector<int>{3, 2, 1}), destroyed);
+}
+
+TEST(AidlArenaTest, AlignsAllocations) {
+  AidlArena arena;
+  arena.Allocate(1, 1);
+  void* aligned = arena.Allocate(sizeof(double), alignof(double));
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned) % alignof(double));
+  // Large requests are served from their own block.
+  char* big = static_cast<char*>(arena.Allocate(1 << 16, 1));
+  big[(1 << 16) - 1] = 'x';
+  EXPECT_EQ(1u + sizeof(double) + (1 << 16), arena.BytesAllocated());
+}
+
+TEST(AidlArenaTest, InterfaceOutlivesParser) {
+  FakeIoDelegate io_delegate;
+  io_delegate.SetFileContents(
+      "p/IFoo.aidl",
+      "package p; interface IFoo { /** doc */ void f(in String s); }");
+  std::unique_ptr<AidlInterface> interface;
+  {
+    Parser p{io_delegate};
+    ASSERT_TRUE(p.ParseFile("p/IFoo.aidl"));
+    interface.reset(p.GetDocument()->ReleaseInterface());
+  }
+  ASSERT_EQ(1u, interface->GetMethods().size());
+  const AidlMethod* method = interface->GetMethods()[0];
+  EXPECT_EQ("f", method->GetName());
+  EXPECT_EQ("/** doc */", method->GetComments());
+  ASSERT_EQ(1u, method->GetArguments().size());
+  EXPECT_EQ("String", method->GetArguments()[0]->GetType().GetName());
+}
@@ -1,5 +1,7 @@
 #include "aidl_language.h"
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,14 +30,18 @@ using std::unique_ptr;
 
 void yylex_init(void **);
 void yylex_destroy(void *);
+void yyset_extra(Parser*, void *);
 void yyset_in(FILE *f, void *);
 int yyparse(Parser*);
 YY_BUFFER_STATE yy_scan_buffer(char *, size_t, void *);
 void yy_delete_buffer(YY_BUFFER_STATE, void *);
 
-AidlToken::AidlToken(const std::string& text, const std::string& comments)
+AidlToken::AidlToken(const char* text, size_t text_length,
+                     const char* comments, size_t comments_length)
     : text_(text),
-      comments_(comments) {}
+      text_length_(text_length),
+      comments_(comments),
+      comments_length_(comments_length) {}
 
 AidlType::AidlType(const std::string& name, unsigned line,
                    const std::string& comments, bool is_array)
@@ -87,12 +93,23 @@ string AidlArgument::ToString() const {
   return ret;
 }
 
+AidlVariableDeclaration::AidlVariableDeclaration(AidlType* type,
+                                                 std::string name,
+                                                 unsigned line)
+    : type_(type),
+      name_(name),
+      line_(line) {}
+
+string AidlVariableDeclaration::ToString() const {
+  return type_->ToString() + " " + name_;
+}
+
 AidlConstant::AidlConstant(std::string name, int32_t value)
     : name_(name),
       value_(value) {}
 
 AidlMethod::AidlMethod(bool oneway, AidlType* type, std::string name,
-                       std::vector<std::unique_ptr<AidlArgument>>* args,
+                       std::vector<AidlArgument*>* args,
                        unsigned line, const std::string& comments, int id)
     : oneway_(oneway),
       comments_(comments),
@@ -103,22 +120,24 @@ AidlMethod::AidlMethod(bool oneway, AidlType* type, std::string name,
       id_(id) {
   has_id_ = true;
   delete args;
-  for (const unique_ptr<AidlArgument>& a : arguments_) {
-    if (a->IsIn()) { in_arguments_.push_back(a.get()); }
-    if (a->IsOut()) { out_arguments_.push_back(a.get()); }
+  for (const AidlArgument* a : arguments_) {
+    if (a->IsIn()) { in_arguments_.push_back(a); }
+    if (a->IsOut()) { out_arguments_.push_back(a); }
   }
 }
 
 AidlMethod::AidlMethod(bool oneway, AidlType* type, std::string name,
-                       std::vector<std::unique_ptr<AidlArgument>>* args,
+                       std::vector<AidlArgument*>* args,
                        unsigned line, const std::string& comments)
     : AidlMethod(oneway, type, name, args, line, comments, 0) {
   has_id_ = false;
 }
 
 Parser::Parser(const IoDelegate& io_delegate)
-    : io_delegate_(io_delegate) {
+    : io_delegate_(io_delegate),
+      arena_(std::make_shared<AidlArena>()) {
   yylex_init(&scanner_);
+  yyset_extra(this, scanner_);
 }
 
 AidlParcelable::AidlParcelable(AidlQualifiedName* name, unsigned line,
@@ -145,24 +164,42 @@ std::string AidlParcelable::GetCanonicalName() const {
   return GetPackage() + "." + GetName();
 }
 
+AidlStructuredParcelable::AidlStructuredParcelable(
+    AidlQualifiedName* name, unsigned line,
+    const std::vector<std::string>& package,
+    std::vector<AidlVariableDeclaration*>* fields,
+    bool fixed_size)
+    : AidlParcelable(name, line, package),
+      fields_(std::move(*fields)),
+      fixed_size_(fixed_size) {
+  delete fields;
+}
+
+std::string AidlStructuredParcelable::GetCppHeader() const {
+  string header = Join(GetSplitPackage(), '/');
+  if (!header.empty()) {
+    header += '/';
+  }
+  return header + GetName() + ".h";
+}
+
 AidlInterface::AidlInterface(const std::string& name, unsigned line,
                              const std::string& comments, bool oneway,
-                             std::vector<std::unique_ptr<AidlMember>>* members,
+                             std::vector<AidlMember*>* members,
                              const std::vector<std::string>& package)
     : name_(name),
       comments_(comments),
       line_(line),
       oneway_(oneway),
       package_(package) {
-  for (auto& member : *members) {
-    AidlMember* local = member.release();
-    AidlMethod* method = local->AsMethod();
-    AidlConstant* constant = local->AsConstant();
+  for (AidlMember* member : *members) {
+    AidlMethod* method = member->AsMethod();
+    AidlConstant* constant = member->AsConstant();
 
     if (method) {
-      methods_.emplace_back(method);
+      methods_.push_back(method);
     } else if (constant) {
-      constants_.emplace_back(constant);
+      constants_.push_back(constant);
     } else {
       LOG(FATAL) << "Member is neither method nor constant!";
     }
@@ -182,9 +219,39 @@ std::string AidlInterface::GetCanonicalName() const {
   return GetPackage() + "." + GetName();
 }
 
+bool AidlInterface::HasBatchableMethods() const {
+  for (const AidlMethod* method : methods_) {
+    if (method->IsBatchable()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 AidlDocument::AidlDocument(AidlInterface* interface)
     : interface_(interface) {}
 
+AidlStructuredParcelable* AidlDocument::ReleaseStructuredParcelable() {
+  if (parcelables_.size() != 1 ||
+      parcelables_[0]->AsStructuredParcelable() == nullptr) {
+    return nullptr;
+  }
+  AidlStructuredParcelable* parcelable =
+      parcelables_[0].release()->AsStructuredParcelable();
+  parcelables_.clear();
+  return parcelable;
+}
+
+void AidlDocument::SetArena(const std::shared_ptr<AidlArena>& arena) {
+  arena_ = arena;
+  if (interface_) {
+    interface_->SetArena(arena);
+  }
+  for (const auto& parcelable : parcelables_) {
+    parcelable->SetArena(arena);
+  }
+}
+
 AidlQualifiedName::AidlQualifiedName(std::string term,
                                      std::string comments)
     : terms_({term}),
@@ -212,11 +279,24 @@ AidlImport::AidlImport(const std::string& from,
 Parser::~Parser() {
   if (raw_buffer_) {
     yy_delete_buffer(buffer_, scanner_);
-    raw_buffer_.reset();
+    raw_buffer_ = nullptr;
   }
   yylex_destroy(scanner_);
 }
 
+void Parser::Reset(const string& filename) {
+  if (raw_buffer_) {
+    yy_delete_buffer(buffer_, scanner_);
+    raw_buffer_ = nullptr;
+  }
+  filename_ = filename;
+  package_ = nullptr;
+  error_ = 0;
+  document_.reset();
+  // A document from a previous parse keeps its own arena alive.
+  arena_ = std::make_shared<AidlArena>();
+}
+
 bool Parser::ParseFile(const string& filename) {
   // Make sure we can read the file first, before trashing previous state.
   unique_ptr<string> new_buffer = io_delegate_.GetFileContents(filename);
@@ -224,23 +304,21 @@ bool Parser::ParseFile(const string& filename) {
     LOG(ERROR) << "Error while opening file for parsing: '" << filename << "'";
     return false;
   }
+  return ParseContents(filename, *new_buffer);
+}
 
-  // Throw away old parsing state if we have any.
-  if (raw_buffer_) {
-    yy_delete_buffer(buffer_, scanner_);
-    raw_buffer_.reset();
-  }
+bool Parser::ParseContents(const string& filename, const string& contents) {
+  Reset(filename);
 
-  raw_buffer_ = std::move(new_buffer);
   // We're going to scan this buffer in place, and yacc demands we put two
   // nulls at the end.
-  raw_buffer_->append(2u, '\0');
-  filename_ = filename;
-  package_.reset();
-  error_ = 0;
-  document_.reset();
+  const size_t length = contents.length() + 2u;
+  raw_buffer_ = static_cast<char*>(arena_->Allocate(length, 1));
+  memcpy(raw_buffer_, contents.data(), contents.length());
+  raw_buffer_[length - 2] = '\0';
+  raw_buffer_[length - 1] = '\0';
 
-  buffer_ = yy_scan_buffer(&(*raw_buffer_)[0], raw_buffer_->length(), scanner_);
+  buffer_ = yy_scan_buffer(raw_buffer_, length, scanner_);
 
   if (yy::parser(this).parse() != 0 || error_ != 0) {
     return false;}
@@ -252,6 +330,298 @@ bool Parser::ParseFile(const string& filename) {
   return false;
 }
 
+namespace {
+
+// Reads just enough of an .aidl file to find its package, imports and
+// declarations, following the grammar of the full parser.  Scan() returns
+// false for anything it does not expect, leaving the errors to the full
+// parser.
+class DeclarationScanner {
+ public:
+  struct Name {
+    std::vector<string> terms;
+    unsigned line = 0;
+  };
+  struct Parcelable {
+    Name name;
+    string cpp_header;  // With its quotes, like the C_STR token.
+  };
+
+  explicit DeclarationScanner(const string& text) : text_(text) {}
+
+  bool Scan();
+
+  std::vector<string> package_;
+  std::vector<Name> imports_;
+  bool has_interface_ = false;
+  bool oneway_ = false;
+  Name interface_;
+  std::vector<Parcelable> parcelables_;
+
+ private:
+  enum Kind { END, WORD, STRING, PUNCTUATION, UNKNOWN };
+
+  // Moves to the next token, skipping whitespace and comments.
+  void Advance();
+  bool SkipSpaceAndComments();
+  bool SkipString();
+  // Skips to just past the '}' matching the current '{'.
+  bool SkipBlock();
+
+  bool Accept(Kind kind, const char* text);
+  bool ReadIdentifier(string* identifier);
+  bool ReadQualifiedName(Name* name);
+
+  const string& text_;
+  size_t pos_ = 0;
+  unsigned line_ = 1;
+
+  Kind kind_ = UNKNOWN;
+  string token_;
+  unsigned token_line_ = 1;
+
+  DISALLOW_COPY_AND_ASSIGN(DeclarationScanner);
+};
+
+bool DeclarationScanner::SkipSpaceAndComments() {
+  while (pos_ < text_.size()) {
+    const char c = text_[pos_];
+    if (c == '\n') {
+      ++line_;
+      ++pos_;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+      ++pos_;
+    } else if (text_.compare(pos_, 2, "//") == 0) {
+      // The lexer only knows comments that end with a newline.
+      const size_t end = text_.find('\n', pos_);
+      if (end == string::npos) {
+        return false;
+      }
+      pos_ = end;
+    } else if (text_.compare(pos_, 2, "/*") == 0 ||
+               text_.compare(pos_, 3, "%%{") == 0) {
+      const bool copying = (c == '%');
+      const size_t end = text_.find((copying) ? "}%%" : "*/", pos_ + 2);
+      if (end == string::npos) {
+        return false;
+      }
+      line_ += std::count(text_.begin() + pos_, text_.begin() + end, '\n');
+      pos_ = end + ((copying) ? 3 : 2);
+    } else {
+      break;
+    }
+  }
+  return true;
+}
+
+bool DeclarationScanner::SkipString() {
+  const size_t end = text_.find('"', pos_ + 1);
+  if (end == string::npos) {
+    return false;
+  }
+  line_ += std::count(text_.begin() + pos_, text_.begin() + end, '\n');
+  pos_ = end + 1;
+  return true;
+}
+
+void DeclarationScanner::Advance() {
+  token_.clear();
+  if (!SkipSpaceAndComments()) {
+    kind_ = UNKNOWN;
+    return;
+  }
+  token_line_ = line_;
+  if (pos_ == text_.size()) {
+    kind_ = END;
+    return;
+  }
+
+  const size_t start = pos_;
+  const char c = text_[pos_];
+  if (c == '_' || isalpha(static_cast<unsigned char>(c))) {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == '_' ||
+            isalnum(static_cast<unsigned char>(text_[pos_])))) {
+      ++pos_;
+    }
+    kind_ = WORD;
+  } else if (c == '"') {
+    kind_ = (SkipString()) ? STRING : UNKNOWN;
+  } else if (c == ';' || c == '{' || c == '}' || c == '.') {
+    ++pos_;
+    kind_ = PUNCTUATION;
+  } else {
+    // Annotations, numbers and anything else that may not appear outside of
+    // an interface body in a file that needs no more than a quick scan.
+    kind_ = UNKNOWN;
+  }
+  token_ = text_.substr(start, pos_ - start);
+}
+
+bool DeclarationScanner::SkipBlock() {
+  int depth = 1;
+  while (SkipSpaceAndComments() && pos_ < text_.size()) {
+    const char c = text_[pos_];
+    if (c == '"') {
+      if (!SkipString()) {
+        return false;
+      }
+      continue;
+    }
+    ++pos_;
+    if (c == '{') {
+      ++depth;
+    } else if (c == '}' && --depth == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DeclarationScanner::Accept(Kind kind, const char* text) {
+  if (kind_ != kind || token_ != text) {
+    return false;
+  }
+  Advance();
+  return true;
+}
+
+bool DeclarationScanner::ReadIdentifier(string* identifier) {
+  // Of the keywords, only "cpp_header" and "int" double as identifiers.
+  static const char* const kKeywords[] = {
+      "parcelable", "import", "package", "in", "out", "inout", "const",
+      "interface", "oneway",
+  };
+  if (kind_ != WORD) {
+    return false;
+  }
+  for (const char* keyword : kKeywords) {
+    if (token_ == keyword) {
+      return false;
+    }
+  }
+  *identifier = token_;
+  Advance();
+  return true;
+}
+
+bool DeclarationScanner::ReadQualifiedName(Name* name) {
+  name->line = token_line_;
+  string term;
+  if (!ReadIdentifier(&term)) {
+    return false;
+  }
+  name->terms.push_back(term);
+  while (Accept(PUNCTUATION, ".")) {
+    if (!ReadIdentifier(&term)) {
+      return false;
+    }
+    name->terms.push_back(term);
+  }
+  return true;
+}
+
+bool DeclarationScanner::Scan() {
+  Advance();
+  if (Accept(WORD, "package")) {
+    Name package;
+    if (!ReadQualifiedName(&package) || !Accept(PUNCTUATION, ";")) {
+      return false;
+    }
+    package_ = package.terms;
+  }
+
+  while (kind_ == WORD && token_ == "import") {
+    const unsigned line = token_line_;
+    Advance();
+    Name import;
+    if (!ReadQualifiedName(&import) || !Accept(PUNCTUATION, ";")) {
+      return false;
+    }
+    import.line = line;
+    imports_.push_back(import);
+  }
+
+  if (kind_ == WORD && (token_ == "oneway" || token_ == "interface")) {
+    oneway_ = Accept(WORD, "oneway");
+    if (!Accept(WORD, "interface")) {
+      return false;
+    }
+    interface_.line = token_line_;
+    string name;
+    if (!ReadIdentifier(&name) || kind_ != PUNCTUATION || token_ != "{" ||
+        !SkipBlock()) {
+      return false;
+    }
+    interface_.terms.push_back(name);
+    has_interface_ = true;
+    Advance();
+    return kind_ == END;
+  }
+
+  while (Accept(WORD, "parcelable")) {
+    Parcelable parcelable;
+    if (!ReadQualifiedName(&parcelable.name)) {
+      return false;
+    }
+    if (Accept(WORD, "cpp_header")) {
+      if (kind_ != STRING) {
+        return false;
+      }
+      parcelable.cpp_header = token_;
+      Advance();
+    }
+    // Structured parcelables need their fields, so they get a full parse.
+    if (!Accept(PUNCTUATION, ";")) {
+      return false;
+    }
+    parcelables_.push_back(parcelable);
+  }
+  return kind_ == END;
+}
+
+}  // namespace
+
+bool Parser::ParseDeclarations(const string& filename) {
+  unique_ptr<string> contents = io_delegate_.GetFileContents(filename);
+  if (!contents) {
+    return ParseFile(filename);
+  }
+  return ParseDeclarations(filename, *contents);
+}
+
+bool Parser::ParseDeclarations(const string& filename,
+                               const string& contents) {
+  DeclarationScanner scanner(contents);
+  if (!scanner.Scan()) {
+    return ParseContents(filename, contents);
+  }
+
+  Reset(filename);
+  if (!scanner.package_.empty()) {
+    package_ = arena_->New<AidlQualifiedName>(Join(scanner.package_, '.'), "");
+  }
+  for (const auto& import : scanner.imports_) {
+    imports_.emplace_back(new AidlImport(filename_, Join(import.terms, '.'),
+                                         import.line));
+  }
+
+  if (scanner.has_interface_) {
+    SetDocument(new AidlDocument(new AidlInterface(
+        scanner.interface_.terms[0], scanner.interface_.line, "",
+        scanner.oneway_, new std::vector<AidlMember*>(), Package())));
+    return true;
+  }
+  AidlDocument* doc = new AidlDocument();
+  for (const auto& parcelable : scanner.parcelables_) {
+    doc->AddParcelable(new AidlParcelable(
+        arena_->New<AidlQualifiedName>(Join(parcelable.name.terms, '.'), ""),
+        parcelable.name.line, Package(), parcelable.cpp_header));
+  }
+  SetDocument(doc);
+  return true;
+}
+
 void Parser::ReportError(const string& err, unsigned line) {
   cerr << filename_ << ":" << line << ": " << err << endl;
   error_ = 1;
@@ -267,5 +637,21 @@ std::vector<std::string> Parser::Package() const {
 void Parser::AddImport(AidlQualifiedName* name, unsigned line) {
   imports_.emplace_back(new AidlImport(this->FileName(),
                                        name->GetDotName(), line));
-  delete name;
+}
+
+AidlToken* Parser::MakeToken(const char* text, size_t length,
+                             const string& comments) {
+  char* saved_comments = nullptr;
+  if (!comments.empty()) {
+    saved_comments =
+        static_cast<char*>(arena_->Allocate(comments.length(), 1));
+    memcpy(saved_comments, comments.data(), comments.length());
+  }
+  return arena_->New<AidlToken>(text, length,
+                                saved_comments, comments.length());
+}
+
+void Parser::SetDocument(AidlDocument* doc) {
+  doc->SetArena(arena_);
+  document_.reset(doc);
 }
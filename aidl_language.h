@@ -10,19 +10,28 @@
 
 #include <io_delegate.h>
 
+#include "aidl_arena.h"
+
 struct yy_buffer_state;
 typedef yy_buffer_state* YY_BUFFER_STATE;
 
+// Tokens are allocated from the Parser's arena and refer to text owned by
+// that arena rather than holding copies of their own.
 class AidlToken {
  public:
-  AidlToken(const std::string& text, const std::string& comments);
+  AidlToken(const char* text, size_t text_length,
+            const char* comments, size_t comments_length);
 
-  const std::string& GetText() const { return text_; }
-  const std::string& GetComments() const { return comments_; }
+  std::string GetText() const { return std::string(text_, text_length_); }
+  std::string GetComments() const {
+    return std::string(comments_, comments_length_);
+  }
 
  private:
-  std::string text_;
-  std::string comments_;
+  const char* text_;
+  size_t text_length_;
+  const char* comments_;
+  size_t comments_length_;
 
   DISALLOW_COPY_AND_ASSIGN(AidlToken);
 };
@@ -51,6 +60,8 @@ class AidlType : public AidlNode {
     AnnotationNullable = 1 << 0,
     AnnotationUtf8 = 1 << 1,
     AnnotationUtf8InCpp = 1 << 2,
+    AnnotationPacked = 1 << 3,
+    AnnotationCompressed = 1 << 4,
   };
 
   AidlType(const std::string& name, unsigned line,
@@ -83,6 +94,12 @@ class AidlType : public AidlNode {
   bool IsUtf8InCpp() const {
     return annotations_ & AnnotationUtf8InCpp;
   }
+  bool IsPacked() const {
+    return annotations_ & AnnotationPacked;
+  }
+  bool IsCompressed() const {
+    return annotations_ & AnnotationCompressed;
+  }
 
  private:
   std::string name_;
@@ -112,12 +129,12 @@ class AidlArgument : public AidlNode {
   std::string GetName() const { return name_; }
   int GetLine() const { return line_; }
   const AidlType& GetType() const { return *type_; }
-  AidlType* GetMutableType() { return type_.get(); }
+  AidlType* GetMutableType() { return type_; }
 
   std::string ToString() const;
 
  private:
-  std::unique_ptr<AidlType> type_;
+  AidlType* type_;
   Direction direction_;
   bool direction_specified_;
   std::string name_;
@@ -126,6 +143,27 @@ class AidlArgument : public AidlNode {
   DISALLOW_COPY_AND_ASSIGN(AidlArgument);
 };
 
+// A field of a structured parcelable.
+class AidlVariableDeclaration : public AidlNode {
+ public:
+  AidlVariableDeclaration(AidlType* type, std::string name, unsigned line);
+  virtual ~AidlVariableDeclaration() = default;
+
+  std::string GetName() const { return name_; }
+  unsigned GetLine() const { return line_; }
+  const AidlType& GetType() const { return *type_; }
+  AidlType* GetMutableType() { return type_; }
+
+  std::string ToString() const;
+
+ private:
+  AidlType* type_;
+  std::string name_;
+  unsigned line_;
+
+  DISALLOW_COPY_AND_ASSIGN(AidlVariableDeclaration);
+};
+
 class AidlMethod;
 class AidlConstant;
 class AidlMember : public AidlNode {
@@ -160,10 +198,10 @@ class AidlConstant : public AidlMember {
 class AidlMethod : public AidlMember {
  public:
   AidlMethod(bool oneway, AidlType* type, std::string name,
-             std::vector<std::unique_ptr<AidlArgument>>* args,
+             std::vector<AidlArgument*>* args,
              unsigned line, const std::string& comments);
   AidlMethod(bool oneway, AidlType* type, std::string name,
-             std::vector<std::unique_ptr<AidlArgument>>* args,
+             std::vector<AidlArgument*>* args,
              unsigned line, const std::string& comments, int id);
   virtual ~AidlMethod() = default;
 
@@ -171,17 +209,21 @@ class AidlMethod : public AidlMember {
 
   const std::string& GetComments() const { return comments_; }
   const AidlType& GetType() const { return *type_; }
-  AidlType* GetMutableType() { return type_.get(); }
+  AidlType* GetMutableType() { return type_; }
   bool IsOneway() const { return oneway_; }
   const std::string& GetName() const { return name_; }
   unsigned GetLine() const { return line_; }
   bool HasId() const { return has_id_; }
-  int GetId() { return id_; }
+  int GetId() const { return id_; }
   void SetId(unsigned id) { id_ = id; }
   bool IsDeduplicate() const { return deduplicate_; }
   void SetDeduplicate(bool deduplicate) { deduplicate_ = deduplicate; }
+  // A @batchable oneway method is buffered by the proxy and sent along with
+  // other such calls in a single transaction.
+  bool IsBatchable() const { return batchable_; }
+  void SetBatchable(bool batchable) { batchable_ = batchable; }
 
-  const std::vector<std::unique_ptr<AidlArgument>>& GetArguments() const {
+  const std::vector<AidlArgument*>& GetArguments() const {
     return arguments_;
   }
   // An inout parameter will appear in both GetInArguments()
@@ -197,20 +239,22 @@ class AidlMethod : public AidlMember {
  private:
   bool oneway_;
   std::string comments_;
-  std::unique_ptr<AidlType> type_;
+  AidlType* type_;
   std::string name_;
   unsigned line_;
-  const std::vector<std::unique_ptr<AidlArgument>> arguments_;
+  const std::vector<AidlArgument*> arguments_;
   std::vector<const AidlArgument*> in_arguments_;
   std::vector<const AidlArgument*> out_arguments_;
   bool has_id_;
   int id_;
-  bool deduplicate_;
+  bool deduplicate_ = false;
+  bool batchable_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(AidlMethod);
 };
 
 class AidlParcelable;
+class AidlStructuredParcelable;
 class AidlInterface;
 class AidlDocument : public AidlNode {
  public:
@@ -229,7 +273,17 @@ class AidlDocument : public AidlNode {
     parcelables_.push_back(std::unique_ptr<AidlParcelable>(parcelable));
   }
 
+  // Releases the parcelable declared by this document if it is the only one
+  // and has fields for us to generate code from, and returns nullptr
+  // otherwise.
+  AidlStructuredParcelable* ReleaseStructuredParcelable();
+
+  // Keeps the arena holding this document's nodes alive for as long as the
+  // document or its interface is.
+  void SetArena(const std::shared_ptr<AidlArena>& arena);
+
  private:
+  std::shared_ptr<AidlArena> arena_;
   std::vector<std::unique_ptr<AidlParcelable>> parcelables_;
   std::unique_ptr<AidlInterface> interface_;
 
@@ -265,11 +319,21 @@ class AidlParcelable : public AidlNode {
   unsigned GetLine() const { return line_; }
   std::string GetPackage() const;
   const std::vector<std::string>& GetSplitPackage() const { return package_; }
-  std::string GetCppHeader() const { return cpp_header_; }
+  virtual std::string GetCppHeader() const { return cpp_header_; }
   std::string GetCanonicalName() const;
 
+  virtual AidlStructuredParcelable* AsStructuredParcelable() {
+    return nullptr;
+  }
+  virtual const AidlStructuredParcelable* AsStructuredParcelable() const {
+    return nullptr;
+  }
+
+  void SetArena(const std::shared_ptr<AidlArena>& arena) { arena_ = arena; }
+
  private:
-  std::unique_ptr<AidlQualifiedName> name_;
+  std::shared_ptr<AidlArena> arena_;
+  AidlQualifiedName* name_;
   unsigned line_;
   const std::vector<std::string> package_;
   std::string cpp_header_;
@@ -277,11 +341,45 @@ class AidlParcelable : public AidlNode {
   DISALLOW_COPY_AND_ASSIGN(AidlParcelable);
 };
 
+// A parcelable declared with its fields, e.g. parcelable Foo { int a; }.
+// Rather than being hand written, its Java class and C++ struct are
+// generated from the declaration.
+class AidlStructuredParcelable : public AidlParcelable {
+ public:
+  AidlStructuredParcelable(AidlQualifiedName* name, unsigned line,
+                           const std::vector<std::string>& package,
+                           std::vector<AidlVariableDeclaration*>* fields,
+                           bool fixed_size = false);
+  virtual ~AidlStructuredParcelable() = default;
+
+  const std::vector<AidlVariableDeclaration*>& GetFields() const {
+    return fields_;
+  }
+
+  // True if declared @FixedSize: every field is a fixed size primitive, so
+  // the whole value is marshalled as one block of memory.
+  bool IsFixedSize() const { return fixed_size_; }
+
+  // The header generated for this parcelable, e.g. "foo/bar/Baz.h".
+  std::string GetCppHeader() const override;
+
+  AidlStructuredParcelable* AsStructuredParcelable() override { return this; }
+  const AidlStructuredParcelable* AsStructuredParcelable() const override {
+    return this;
+  }
+
+ private:
+  const std::vector<AidlVariableDeclaration*> fields_;
+  const bool fixed_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(AidlStructuredParcelable);
+};
+
 class AidlInterface : public AidlNode {
  public:
   AidlInterface(const std::string& name, unsigned line,
                 const std::string& comments, bool oneway_,
-                std::vector<std::unique_ptr<AidlMember>>* members,
+                std::vector<AidlMember*>* members,
                 const std::vector<std::string>& package);
   virtual ~AidlInterface() = default;
 
@@ -289,13 +387,14 @@ class AidlInterface : public AidlNode {
   unsigned GetLine() const { return line_; }
   const std::string& GetComments() const { return comments_; }
   bool IsOneway() const { return oneway_; }
-  const std::vector<std::unique_ptr<AidlMethod>>& GetMethods() const
+  const std::vector<AidlMethod*>& GetMethods() const
       { return methods_; }
-  const std::vector<std::unique_ptr<AidlConstant>>& GetConstants() const
+  const std::vector<AidlConstant*>& GetConstants() const
       { return constants_; }
   std::string GetPackage() const;
   std::string GetCanonicalName() const;
   const std::vector<std::string>& GetSplitPackage() const { return package_; }
+  bool HasBatchableMethods() const;
 
   void SetLanguageType(const android::aidl::ValidatableType* language_type) {
     language_type_ = language_type;
@@ -306,13 +405,16 @@ class AidlInterface : public AidlNode {
     return reinterpret_cast<const T*>(language_type_);
   }
 
+  void SetArena(const std::shared_ptr<AidlArena>& arena) { arena_ = arena; }
+
  private:
+  std::shared_ptr<AidlArena> arena_;
   std::string name_;
   std::string comments_;
   unsigned line_;
   bool oneway_;
-  std::vector<std::unique_ptr<AidlMethod>> methods_;
-  std::vector<std::unique_ptr<AidlConstant>> constants_;
+  std::vector<AidlMethod*> methods_;
+  std::vector<AidlConstant*> constants_;
   std::vector<std::string> package_;
 
   const android::aidl::ValidatableType* language_type_ = nullptr;
@@ -350,18 +452,35 @@ class Parser {
   // Parse contents of file |filename|.
   bool ParseFile(const std::string& filename);
 
+  // Like ParseFile(), but only reads the package, the imports and the
+  // declarations of |filename|: interfaces come back without any members.
+  // The body of an interface is skipped by matching braces, so its syntax
+  // is not checked.  Files the quick scan cannot handle get a full parse,
+  // which reports errors in the header exactly as ParseFile() does.
+  bool ParseDeclarations(const std::string& filename);
+  // Like ParseDeclarations(), for |contents| the caller already read from
+  // |filename|.
+  bool ParseDeclarations(const std::string& filename,
+                         const std::string& contents);
+
   void ReportError(const std::string& err, unsigned line);
 
   bool FoundNoErrors() const { return error_ == 0; }
   const std::string& FileName() const { return filename_; }
   void* Scanner() const { return scanner_; }
 
-  void SetDocument(AidlDocument* doc) { document_.reset(doc); };
+  // AST nodes built during a parse are allocated here.  The arena is
+  // replaced on every call to ParseFile().
+  AidlArena* Arena() const { return arena_.get(); }
+  AidlToken* MakeToken(const char* text, size_t length,
+                       const std::string& comments);
+
+  void SetDocument(AidlDocument* doc);
 
   void AddImport(AidlQualifiedName* name, unsigned line);
 
   std::vector<std::string> Package() const;
-  void SetPackage(AidlQualifiedName* name) { package_.reset(name); }
+  void SetPackage(AidlQualifiedName* name) { package_ = name; }
 
   AidlDocument* GetDocument() const { return document_.get(); }
   AidlDocument* ReleaseDocument() { return document_.release(); }
@@ -375,14 +494,21 @@ class Parser {
   }
 
  private:
+  // Throws away the state of any previous parse.
+  void Reset(const std::string& filename);
+  // Fully parses |contents|, read from |filename|.
+  bool ParseContents(const std::string& filename, const std::string& contents);
+
   const android::aidl::IoDelegate& io_delegate_;
   int error_ = 0;
   std::string filename_;
-  std::unique_ptr<AidlQualifiedName> package_;
+  std::shared_ptr<AidlArena> arena_;
+  AidlQualifiedName* package_ = nullptr;
   void* scanner_ = nullptr;
   std::unique_ptr<AidlDocument> document_;
   std::vector<std::unique_ptr<AidlImport>> imports_;
-  std::unique_ptr<std::string> raw_buffer_;
+  // Owned by |arena_| so that tokens may point into it.
+  char* raw_buffer_ = nullptr;
   YY_BUFFER_STATE buffer_;
 
   DISALLOW_COPY_AND_ASSIGN(Parser);
@@ -13,6 +13,7 @@
 %option reentrant
 %option bison-bridge
 %option bison-locations
+%option extra-type="Parser*"
 
 %x COPYING LONG_COMMENT
 
@@ -39,7 +40,7 @@ intvalue    [-+]?(0|[1-9][0-9]*)
 <LONG_COMMENT>\n+     { extra_text += yytext; yylloc->lines(yyleng); }
 <LONG_COMMENT>[^*\n]+ { extra_text += yytext; }
 
-\"[^\"]*\"            { yylval->token = new AidlToken(yytext, extra_text);
+\"[^\"]*\"            { yylval->token = yyextra->MakeToken(yytext, yyleng, extra_text);
                         return yy::parser::token::C_STR; }
 
 \/\/.*\n              { extra_text += yytext; yylloc->lines(1); yylloc->step(); }
@@ -75,16 +76,20 @@ const                 { return yy::parser::token::CONST; }
 @nullable             { return yy::parser::token::ANNOTATION_NULLABLE; }
 @utf8                 { return yy::parser::token::ANNOTATION_UTF8; }
 @utf8InCpp            { return yy::parser::token::ANNOTATION_UTF8_CPP; }
+@FixedSize            { return yy::parser::token::ANNOTATION_FIXED_SIZE; }
+@packed               { return yy::parser::token::ANNOTATION_PACKED; }
+@compressed           { return yy::parser::token::ANNOTATION_COMPRESSED; }
+@batchable            { return yy::parser::token::ANNOTATION_BATCHABLE; }
 
-interface             { yylval->token = new AidlToken("interface", extra_text);
+interface             { yylval->token = yyextra->MakeToken(yytext, yyleng, extra_text);
                         return yy::parser::token::INTERFACE;
                       }
-oneway                { yylval->token = new AidlToken("oneway", extra_text);
+oneway                { yylval->token = yyextra->MakeToken(yytext, yyleng, extra_text);
                         return yy::parser::token::ONEWAY;
                       }
 
     /* scalars */
-{identifier}          { yylval->token = new AidlToken(yytext, extra_text);
+{identifier}          { yylval->token = yyextra->MakeToken(yytext, yyleng, extra_text);
                         return yy::parser::token::IDENTIFIER;
                       }
 {intvalue}            { yylval->integer = std::stoi(yytext);
@@ -92,7 +97,7 @@ oneway                { yylval->token = new AidlToken("oneway", extra_text);
 
     /* syntax error! */
 .                     { printf("UNKNOWN(%s)", yytext);
-                        yylval->token = new AidlToken(yytext, extra_text);
+                        yylval->token = yyextra->MakeToken(yytext, yyleng, extra_text);
                         return yy::parser::token::IDENTIFIER;
                       }
 
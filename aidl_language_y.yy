@@ -27,14 +27,16 @@ int yylex(yy::parser::semantic_type *, yy::parser::location_type *, void *);
     AidlType* unannotated_type;
     AidlArgument* arg;
     AidlArgument::Direction direction;
-    std::vector<std::unique_ptr<AidlArgument>>* arg_list;
+    std::vector<AidlArgument*>* arg_list;
     AidlMethod* method;
     AidlConstant* constant;
-    std::vector<std::unique_ptr<AidlMember>>* members;
+    std::vector<AidlMember*>* members;
     AidlQualifiedName* qname;
     AidlInterface* interface_obj;
     AidlParcelable* parcelable;
     AidlDocument* parcelable_list;
+    AidlVariableDeclaration* variable;
+    std::vector<AidlVariableDeclaration*>* variable_list;
 }
 
 %token<token> IDENTIFIER INTERFACE ONEWAY C_STR
@@ -43,9 +45,13 @@ int yylex(yy::parser::semantic_type *, yy::parser::location_type *, void *);
 %token '(' ')' ',' '=' '[' ']' '<' '>' '.' '{' '}' ';'
 %token IN OUT INOUT PACKAGE IMPORT PARCELABLE CPP_HEADER CONST INT
 %token ANNOTATION_NULLABLE ANNOTATION_UTF8 ANNOTATION_UTF8_CPP
+%token ANNOTATION_FIXED_SIZE ANNOTATION_PACKED ANNOTATION_COMPRESSED
+%token ANNOTATION_BATCHABLE
 
 %type<parcelable_list> parcelable_decls
 %type<parcelable> parcelable_decl
+%type<variable> variable_decl
+%type<variable_list> variable_decls
 %type<members> members
 %type<interface_obj> interface_decl
 %type<method> method_decl
@@ -77,9 +83,9 @@ identifier
  : IDENTIFIER
   { $$ = $1; }
  | CPP_HEADER
-  { $$ = new AidlToken("cpp_header", ""); }
+  { $$ = ps->MakeToken("cpp_header", strlen("cpp_header"), ""); }
  | INT
-  { $$ = new AidlToken("int", ""); };
+  { $$ = ps->MakeToken("int", strlen("int"), ""); };
 
 package
  : {}
@@ -96,8 +102,8 @@ import
 
 qualified_name
  : identifier {
-    $$ = new AidlQualifiedName($1->GetText(), $1->GetComments());
-    delete $1;
+    $$ = ps->Arena()->New<AidlQualifiedName>($1->GetText(),
+                                             $1->GetComments());
   }
  | qualified_name '.' identifier
   { $$ = $1;
@@ -125,6 +131,17 @@ parcelable_decl
  | PARCELABLE qualified_name CPP_HEADER C_STR ';' {
     $$ = new AidlParcelable($2, @2.begin.line, ps->Package(), $4->GetText());
   }
+ | PARCELABLE identifier '{' variable_decls '}' {
+    AidlQualifiedName* name =
+        ps->Arena()->New<AidlQualifiedName>($2->GetText(), $2->GetComments());
+    $$ = new AidlStructuredParcelable(name, @2.begin.line, ps->Package(), $4);
+  }
+ | ANNOTATION_FIXED_SIZE PARCELABLE identifier '{' variable_decls '}' {
+    AidlQualifiedName* name =
+        ps->Arena()->New<AidlQualifiedName>($3->GetText(), $3->GetComments());
+    $$ = new AidlStructuredParcelable(name, @3.begin.line, ps->Package(), $5,
+                                      true /* fixed size */);
+  }
  | PARCELABLE ';' {
     fprintf(stderr, "%s:%d syntax error in parcelable declaration. Expected type name.\n",
             ps->FileName().c_str(), @1.begin.line);
@@ -136,42 +153,53 @@ parcelable_decl
     $$ = NULL;
   };
 
+variable_decls
+ :
+  { $$ = new std::vector<AidlVariableDeclaration*>(); }
+ | variable_decls variable_decl {
+    $$ = $1;
+    $$->push_back($2);
+  }
+ | variable_decls error ';' {
+    fprintf(stderr, "%s:%d: syntax error before ';' "
+                    "(expected field declaration)\n",
+            ps->FileName().c_str(), @3.begin.line);
+    $$ = $1;
+  };
+
+variable_decl
+ : type identifier ';' {
+    $$ = ps->Arena()->New<AidlVariableDeclaration>($1, $2->GetText(),
+                                                   @2.begin.line);
+  };
+
 interface_decl
  : INTERFACE identifier '{' members '}' {
     $$ = new AidlInterface($2->GetText(), @2.begin.line, $1->GetComments(),
                            false, $4, ps->Package());
-    delete $1;
-    delete $2;
   }
  | ONEWAY INTERFACE identifier '{' members '}' {
     $$ = new AidlInterface($3->GetText(), @3.begin.line, $1->GetComments(),
                            true, $5, ps->Package());
-    delete $1;
-    delete $2;
-    delete $3;
   }
  | INTERFACE error '{' members '}' {
     fprintf(stderr, "%s:%d: syntax error in interface declaration.  Expected type name, saw \"%s\"\n",
             ps->FileName().c_str(), @2.begin.line, $2->GetText().c_str());
     $$ = NULL;
-    delete $1;
-    delete $2;
   }
  | INTERFACE error '}' {
     fprintf(stderr, "%s:%d: syntax error in interface declaration.  Expected type name, saw \"%s\"\n",
             ps->FileName().c_str(), @2.begin.line, $2->GetText().c_str());
     $$ = NULL;
-    delete $1;
-    delete $2;
   };
 
 members
  :
-  { $$ = new std::vector<std::unique_ptr<AidlMember>>(); }
+  { $$ = new std::vector<AidlMember*>(); }
  | members method_decl
-  { $1->push_back(std::unique_ptr<AidlMember>($2)); }
+  { $1->push_back($2); }
  | members constant_decl
-  { $1->push_back(std::unique_ptr<AidlMember>($2)); }
+  { $1->push_back($2); }
  | members error ';' {
     fprintf(stderr, "%s:%d: syntax error before ';' "
                     "(expected method or constant declaration)\n",
@@ -181,74 +209,69 @@ members
 
 constant_decl
  : CONST INT identifier '=' INTVALUE ';' {
-    $$ = new AidlConstant($3->GetText(), $5);
+    $$ = ps->Arena()->New<AidlConstant>($3->GetText(), $5);
  };
 
 method_decl
  : type identifier '(' arg_list ')' ';' {
-    $$ = new AidlMethod(false, $1, $2->GetText(), $4, @2.begin.line,
-                        $1->GetComments());
-    delete $2;
+    $$ = ps->Arena()->New<AidlMethod>(false, $1, $2->GetText(), $4,
+                                      @2.begin.line, $1->GetComments());
   }
  | ONEWAY type identifier '(' arg_list ')' ';' {
-    $$ = new AidlMethod(true, $2, $3->GetText(), $5, @3.begin.line,
-                        $1->GetComments());
-    delete $1;
-    delete $3;
+    $$ = ps->Arena()->New<AidlMethod>(true, $2, $3->GetText(), $5,
+                                      @3.begin.line, $1->GetComments());
   }
  | type identifier '(' arg_list ')' '=' INTVALUE ';' {
-    $$ = new AidlMethod(false, $1, $2->GetText(), $4, @2.begin.line,
-                        $1->GetComments(), $7);
-    delete $2;
+    $$ = ps->Arena()->New<AidlMethod>(false, $1, $2->GetText(), $4,
+                                      @2.begin.line, $1->GetComments(), $7);
   }
  | ONEWAY type identifier '(' arg_list ')' '=' INTVALUE ';' {
-    $$ = new AidlMethod(true, $2, $3->GetText(), $5, @3.begin.line,
-                        $1->GetComments(), $8);
-    delete $1;
-    delete $3;
+    $$ = ps->Arena()->New<AidlMethod>(true, $2, $3->GetText(), $5,
+                                      @3.begin.line, $1->GetComments(), $8);
+  }
+ | ANNOTATION_BATCHABLE method_decl {
+    $$ = $2;
+    $$->SetBatchable(true);
   };
 
 arg_list
  :
-  { $$ = new std::vector<std::unique_ptr<AidlArgument>>(); }
+  { $$ = new std::vector<AidlArgument*>(); }
  | arg {
-    $$ = new std::vector<std::unique_ptr<AidlArgument>>();
-    $$->push_back(std::unique_ptr<AidlArgument>($1));
+    $$ = new std::vector<AidlArgument*>();
+    $$->push_back($1);
   }
  | arg_list ',' arg {
     $$ = $1;
-    $$->push_back(std::unique_ptr<AidlArgument>($3));
+    $$->push_back($3);
   }
  | error {
     fprintf(stderr, "%s:%d: syntax error in parameter list\n",
             ps->FileName().c_str(), @1.begin.line);
-    $$ = new std::vector<std::unique_ptr<AidlArgument>>();
+    $$ = new std::vector<AidlArgument*>();
   };
 
 arg
  : direction type identifier {
-    $$ = new AidlArgument($1, $2, $3->GetText(), @3.begin.line);
-    delete $3;
+    $$ = ps->Arena()->New<AidlArgument>($1, $2, $3->GetText(),
+                                        @3.begin.line);
   };
  | type identifier {
-    $$ = new AidlArgument($1, $2->GetText(), @2.begin.line);
-    delete $2;
+    $$ = ps->Arena()->New<AidlArgument>($1, $2->GetText(), @2.begin.line);
   };
 
 unannotated_type
  : qualified_name {
-    $$ = new AidlType($1->GetDotName(), @1.begin.line, $1->GetComments(), false);
-    delete $1;
+    $$ = ps->Arena()->New<AidlType>($1->GetDotName(), @1.begin.line,
+                                    $1->GetComments(), false);
   }
  | qualified_name '[' ']' {
-    $$ = new AidlType($1->GetDotName(), @1.begin.line, $1->GetComments(),
-                      true);
-    delete $1;
+    $$ = ps->Arena()->New<AidlType>($1->GetDotName(), @1.begin.line,
+                                    $1->GetComments(), true);
   }
  | qualified_name '<' generic_list '>' {
-    $$ = new AidlType($1->GetDotName() + "<" + *$3 + ">", @1.begin.line,
-                      $1->GetComments(), false);
-    delete $1;
+    $$ = ps->Arena()->New<AidlType>($1->GetDotName() + "<" + *$3 + ">",
+                                    @1.begin.line, $1->GetComments(), false);
     delete $3;
   };
 
@@ -264,12 +287,10 @@ type
 generic_list
  : qualified_name {
     $$ = new std::string($1->GetDotName());
-    delete $1;
   }
  | generic_list ',' qualified_name {
     $$ = new std::string(*$1 + "," + $3->GetDotName());
     delete $1;
-    delete $3;
   };
 
 annotation_list
@@ -284,7 +305,11 @@ annotation
  | ANNOTATION_UTF8
   { $$ = AidlType::AnnotationUtf8; }
  | ANNOTATION_UTF8_CPP
-  { $$ = AidlType::AnnotationUtf8InCpp; };
+  { $$ = AidlType::AnnotationUtf8InCpp; }
+ | ANNOTATION_PACKED
+  { $$ = AidlType::AnnotationPacked; }
+ | ANNOTATION_COMPRESSED
+  { $$ = AidlType::AnnotationCompressed; };
 
 direction
  : IN
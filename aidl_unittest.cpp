@@ -24,10 +24,14 @@
 
 #include "aidl.h"
 #include "aidl_language.h"
+#include "dispatch_profile.h"
+#include "options.h"
+#include "semantic_hash.h"
 #include "tests/fake_io_delegate.h"
 #include "type_cpp.h"
 #include "type_java.h"
 #include "type_namespace.h"
+#include "wire_size.h"
 
 using android::aidl::test::FakeIoDelegate;
 using android::base::StringPrintf;
@@ -161,6 +165,57 @@ TEST_F(AidlTest, ParsesUtf8Annotations) {
   }
 }
 
+TEST_F(AidlTest, ParsesPackedAnnotation) {
+  for (const char* type : {"boolean", "char", "int", "long"}) {
+    const string contents = StringPrintf(
+        "package a; interface IFoo { @packed %s[] f(in @packed %s[] a); }",
+        type, type);
+    EXPECT_NE(nullptr, Parse("a/IFoo.aidl", contents, &cpp_types_)) << type;
+    EXPECT_NE(nullptr, Parse("a/IFoo.aidl", contents, &java_types_)) << type;
+  }
+  for (const char* method : {"void f(in @packed int a);",
+                             "void f(in @packed byte[] a);",
+                             "void f(in @packed float[] a);",
+                             "void f(in @packed String[] a);",
+                             "void f(in @packed List<String> a);",
+                             "@packed void f();"}) {
+    const string contents =
+        StringPrintf("package a; interface IFoo { %s }", method);
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", contents, &cpp_types_)) << method;
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", contents, &java_types_)) << method;
+  }
+}
+
+TEST_F(AidlTest, ParsesCompressedAnnotation) {
+  import_paths_.push_back("");
+  io_delegate_.SetFileContents(
+      "a/Bar.aidl", "package a; parcelable Bar cpp_header \"a/Bar.h\";");
+  for (const char* method :
+       {"@compressed byte[] f(in @compressed byte[] a,"
+        "                     out @compressed byte[] b);",
+        "@compressed String f(@nullable @compressed String a);",
+        "void f(@utf8InCpp @compressed String a);",
+        "@compressed Bar f(in @compressed Bar a, out @compressed Bar b,"
+        "                  in @nullable @compressed Bar c);"}) {
+    const string contents = StringPrintf(
+        "package a; import a.Bar; interface IFoo { %s }", method);
+    EXPECT_NE(nullptr, Parse("a/IFoo.aidl", contents, &cpp_types_)) << method;
+    EXPECT_NE(nullptr, Parse("a/IFoo.aidl", contents, &java_types_)) << method;
+  }
+  for (const char* method : {"void f(in @compressed int a);",
+                             "void f(in @compressed int[] a);",
+                             "void f(in @compressed String[] a);",
+                             "void f(in @compressed Bar[] a);",
+                             "void f(in @compressed List<String> a);",
+                             "void f(in @packed @compressed int[] a);",
+                             "@compressed void f();"}) {
+    const string contents = StringPrintf(
+        "package a; import a.Bar; interface IFoo { %s }", method);
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", contents, &cpp_types_)) << method;
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", contents, &java_types_)) << method;
+  }
+}
+
 TEST_F(AidlTest, AcceptsOneway) {
   string oneway_method = "package a; interface IFoo { oneway void f(int a); }";
   string oneway_interface =
@@ -171,6 +226,33 @@ TEST_F(AidlTest, AcceptsOneway) {
   EXPECT_NE(nullptr, Parse("a/IBar.aidl", oneway_interface, &java_types_));
 }
 
+TEST_F(AidlTest, AcceptsBatchableOnlyWhenOneway) {
+  for (const char* contents :
+       {"package a; interface IFoo { @batchable oneway void f(int a); }",
+        "package a; oneway interface IFoo { @batchable void f(int a); }"}) {
+    EXPECT_NE(nullptr, Parse("a/IFoo.aidl", contents, &cpp_types_))
+        << contents;
+    EXPECT_NE(nullptr, Parse("a/IFoo.aidl", contents, &java_types_))
+        << contents;
+  }
+  for (const char* contents :
+       {"package a; interface IFoo { @batchable void f(int a); }",
+        "package a; interface IFoo { @batchable oneway void f(int a);"
+        "  void g() = 16777214; }",
+        "package a; interface IFoo { @batchable oneway void f(int a);"
+        "  void flushBatch(); }"}) {
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", contents, &cpp_types_))
+        << contents;
+    EXPECT_EQ(nullptr, Parse("a/IFoo.aidl", contents, &java_types_))
+        << contents;
+  }
+  // Without batchable methods, neither is reserved.
+  EXPECT_NE(nullptr, Parse("a/IFoo.aidl",
+                           "package a; interface IFoo {"
+                           "  void flushBatch() = 16777214; }",
+                           &cpp_types_));
+}
+
 TEST_F(AidlTest, ParsesPreprocessedFile) {
   string simple_content = "parcelable a.Foo;\ninterface b.IBar;";
   io_delegate_.SetFileContents("path", simple_content);
@@ -227,6 +309,63 @@ TEST_F(AidlTest, WritePreprocessedFile) {
   EXPECT_EQ("parcelable p.Outer.Inner;\ninterface one.IBar;\n", output);
 }
 
+TEST_F(AidlTest, ParsesOnlyDeclarations) {
+  io_delegate_.SetFileContents(
+      "p/IFoo.aidl",
+      "/* License */\n"
+      "package p;\n"
+      "import q.Bar; // The bar\n"
+      "\n"
+      "/** Comments { are skipped */\n"
+      "oneway interface IFoo {\n"
+      "  void f(in Bar b); // }\n"
+      "  const int kBrace = 1; /* { */\n"
+      "}\n");
+  Parser p{io_delegate_};
+  ASSERT_TRUE(p.ParseDeclarations("p/IFoo.aidl"));
+  const AidlInterface* interface = p.GetDocument()->GetInterface();
+  ASSERT_NE(nullptr, interface);
+  EXPECT_EQ("p.IFoo", interface->GetCanonicalName());
+  EXPECT_EQ(6u, interface->GetLine());
+  EXPECT_TRUE(interface->IsOneway());
+  EXPECT_TRUE(interface->GetMethods().empty());
+  ASSERT_EQ(1u, p.GetImports().size());
+  EXPECT_EQ("q.Bar", p.GetImports()[0]->GetNeededClass());
+  EXPECT_EQ(3u, p.GetImports()[0]->GetLine());
+
+  io_delegate_.SetFileContents(
+      "p/Bar.aidl",
+      "package p; parcelable Bar; parcelable Baz cpp_header \"p/Baz.h\";");
+  ASSERT_TRUE(p.ParseDeclarations("p/Bar.aidl"));
+  const auto& parcelables = p.GetDocument()->GetParcelables();
+  ASSERT_EQ(2u, parcelables.size());
+  EXPECT_EQ("p.Bar", parcelables[0]->GetCanonicalName());
+  EXPECT_EQ("p.Baz", parcelables[1]->GetCanonicalName());
+  EXPECT_EQ("p/Baz.h", parcelables[1]->GetCppHeader());
+}
+
+TEST_F(AidlTest, ParseDeclarationsFallsBackToFullParse) {
+  Parser p{io_delegate_};
+  // Structured parcelables keep their fields.
+  io_delegate_.SetFileContents("p/Bar.aidl",
+                               "package p; parcelable Bar { int a; }");
+  ASSERT_TRUE(p.ParseDeclarations("p/Bar.aidl"));
+  const AidlStructuredParcelable* bar =
+      p.GetDocument()->GetParcelables()[0]->AsStructuredParcelable();
+  ASSERT_NE(nullptr, bar);
+  EXPECT_EQ(1u, bar->GetFields().size());
+
+  // A malformed header fails just as it does in a full parse.
+  for (const char* contents : {"package p interface IFoo {}",
+                               "package p; import ; interface IFoo {}",
+                               "package p; interface IFoo { void f();",
+                               "package p; parcelable Bar"}) {
+    io_delegate_.SetFileContents("p/IFoo.aidl", contents);
+    EXPECT_FALSE(p.ParseDeclarations("p/IFoo.aidl")) << contents;
+    EXPECT_FALSE(p.ParseFile("p/IFoo.aidl")) << contents;
+  }
+}
+
 TEST_F(AidlTest, RequireOuterClass) {
   io_delegate_.SetFileContents("p/Outer.aidl",
                                "package p; parcelable Outer.Inner;");
@@ -326,5 +465,461 @@ TEST_F(AidlTest, WritesTrivialDependencyFileForParcelable) {
   EXPECT_EQ(actual_dep_file_contents, kExpectedParcelableDepFileContents);
 }
 
+TEST_F(AidlTest, CachesClassLoaderForUntypedContainers) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo { List f(in List a); Map g(in Map b); }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  // The class loader is looked up once per class rather than per call.
+  const string stub_field = "private final java.lang.ClassLoader mClassLoader"
+                            " = this.getClass().getClassLoader();";
+  const string proxy_field = "private static final java.lang.ClassLoader "
+                             "sClassLoader = p.IFoo.Stub.Proxy.class"
+                             ".getClassLoader();";
+  EXPECT_NE(string::npos, output.find(stub_field));
+  EXPECT_NE(string::npos, output.find(proxy_field));
+  EXPECT_NE(string::npos, output.find("data.readArrayList(mClassLoader)"));
+  EXPECT_NE(string::npos, output.find("_reply.readHashMap(sClassLoader)"));
+  size_t lookups = 0;
+  for (size_t pos = output.find("getClassLoader()"); pos != string::npos;
+       pos = output.find("getClassLoader()", pos + 1)) {
+    ++lookups;
+  }
+  EXPECT_EQ(2u, lookups);
+}
+
+TEST_F(AidlTest, WrapsJavaMethodsInTraceSections) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(options.input_file_name_,
+                               "package p; interface IFoo { int f(int a); }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_EQ(string::npos, output.find("android.os.Trace"));
+
+  options.generate_traces_ = true;
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  const string server_begin =
+      "android.os.Trace.beginSection(\"AIDL::java::IFoo::f::server\");\n"
+      "try {\n"
+      "data.enforceInterface(DESCRIPTOR);\n";
+  const string client_begin =
+      "android.os.Trace.beginSection(\"AIDL::java::IFoo::f::client\");\n"
+      "try {\n"
+      "android.os.Parcel _data = android.os.Parcel.obtain();\n";
+  const string end = "finally {\nandroid.os.Trace.endSection();\n}\n";
+  EXPECT_NE(string::npos, output.find(server_begin));
+  EXPECT_NE(string::npos, output.find(client_begin));
+  size_t first_end = output.find(end);
+  ASSERT_NE(string::npos, first_end);
+  size_t second_end = output.find(end, first_end + 1);
+  ASSERT_NE(string::npos, second_end);
+  EXPECT_EQ(string::npos, output.find(end, second_end + 1));
+}
+
+TEST_F(AidlTest, CompactJavaSharesParcelableHelpers) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  options.import_paths_.push_back("");
+  options.generate_compact_ = true;
+  io_delegate_.SetFileContents("p/Bar.aidl", "package p; parcelable Bar;");
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; import p.Bar; interface IFoo {"
+      "  Bar f(in Bar a); void g(inout Bar b); }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  // Each case forwards to its own handler.
+  EXPECT_NE(string::npos,
+            output.find("case TRANSACTION_f:\n{\n"
+                        "return this.onTransact_f(data, reply);\n}\n"));
+  EXPECT_NE(string::npos,
+            output.find("private boolean onTransact_g(android.os.Parcel data, "
+                        "android.os.Parcel reply)"));
+  // The helpers are declared once and used on both sides.
+  const string write_helper = "private static void _writeParcelable(";
+  size_t declared = output.find(write_helper);
+  ASSERT_NE(string::npos, declared);
+  EXPECT_EQ(string::npos, output.find(write_helper, declared + 1));
+  EXPECT_NE(string::npos, output.find("_writeParcelable(_data, a, 0);"));
+  EXPECT_NE(string::npos,
+            output.find("_result = (p.Bar)_createParcelable(_reply, "
+                        "p.Bar.CREATOR);"));
+  EXPECT_EQ(string::npos, output.find("if ((a!=null))"));
+}
+
+TEST_F(AidlTest, OrdersJavaDispatchByProfile) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  options.dispatch_profile_file_name_ = "calls.txt";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo { void f(); void g(); void h(); }");
+  io_delegate_.SetFileContents("calls.txt", "h 900\ng 80\nf 20\n");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  // The hot methods come first, and the cold one is handled out of line.
+  size_t h = output.find("case TRANSACTION_h:\n{\n");
+  size_t g = output.find("case TRANSACTION_g:\n{\n");
+  size_t f = output.find("case TRANSACTION_f:\n{\n"
+                         "return this.onTransact_f(data, reply);\n}\n");
+  ASSERT_NE(string::npos, h);
+  ASSERT_NE(string::npos, g);
+  ASSERT_NE(string::npos, f);
+  EXPECT_LT(h, g);
+  EXPECT_LT(g, f);
+  EXPECT_EQ(string::npos, output.find("onTransact_g("));
+}
+
+TEST_F(AidlTest, SelectsHotMethodsFromProfile) {
+  unique_ptr<AidlInterface> interface = Parse(
+      "p/IFoo.aidl",
+      "package p; interface IFoo { void a(); void b(); void c(); void d(); }",
+      &java_types_);
+  ASSERT_NE(nullptr, interface);
+  const auto& methods = interface->GetMethods();
+
+  // Without calls, every method is hot and keeps its place.
+  DispatchProfile profile;
+  EXPECT_EQ(vector<const AidlMethod*>(methods.begin(), methods.end()),
+            GetHotMethods(*interface, &profile));
+
+  // Transaction codes count towards the method with that id.
+  io_delegate_.SetFileContents("calls.txt",
+                               "# method calls\n"
+                               "c 10\n"
+                               "\n"
+                               "2 500\n"
+                               "b 400\n"
+                               "a 90\n"
+                               "unknown 1000\n");
+  ASSERT_TRUE(profile.Load("calls.txt", io_delegate_));
+  EXPECT_EQ(900u, profile.CallCount(*methods[1]));
+  EXPECT_EQ((vector<const AidlMethod*>{methods[1], methods[0]}),
+            GetHotMethods(*interface, &profile));
+
+  io_delegate_.SetFileContents("bad.txt", "a 10\nb lots\n");
+  DispatchProfile bad_profile;
+  EXPECT_FALSE(bad_profile.Load("bad.txt", io_delegate_));
+  EXPECT_FALSE(bad_profile.Load("missing.txt", io_delegate_));
+}
+
+TEST_F(AidlTest, MarshalsPackedArraysThroughRuntimeClass) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo {"
+      "  @packed int[] f(in @packed boolean[] a);"
+      "  void g(out @packed int[] b); }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_NE(string::npos,
+            output.find("_arg0 = android.aidl.PackedArrays."
+                        "createBooleanArray(data);"));
+  EXPECT_NE(string::npos,
+            output.find("android.aidl.PackedArrays.writeIntArray(reply, "
+                        "_arg0);"));
+  EXPECT_NE(string::npos,
+            output.find("android.aidl.PackedArrays.readIntArray(_reply, b);"));
+  EXPECT_EQ(string::npos, output.find("_aidl_writePacked"));
+  EXPECT_EQ(string::npos, output.find("reply.writeIntArray"));
+}
+
+TEST_F(AidlTest, MarshalsCompressedValuesThroughRuntimeClass) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo {"
+      "  @compressed String f(in @compressed byte[] a);"
+      "  void g(out @compressed byte[] b); }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_NE(string::npos,
+            output.find("_arg0 = android.aidl.CompressedPayload."
+                        "createByteArray(data);"));
+  EXPECT_NE(string::npos,
+            output.find("android.aidl.CompressedPayload.writeString(reply, "
+                        "_result);"));
+  EXPECT_NE(string::npos,
+            output.find("android.aidl.CompressedPayload.readByteArray(_reply, "
+                        "b);"));
+  EXPECT_EQ(string::npos, output.find("_aidl_compress"));
+  EXPECT_EQ(string::npos, output.find("writeByteArray(b)"));
+}
+
+TEST_F(AidlTest, BatchesBatchableCallsInJava) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo {"
+      "  @batchable oneway void f(int a); int g(); }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_NE(string::npos,
+            output.find("this._aidl_batchCall(Stub.TRANSACTION_f, _data);"));
+  EXPECT_EQ(string::npos, output.find("transact(Stub.TRANSACTION_f,"));
+  EXPECT_NE(string::npos,
+            output.find("this.flushBatch();\n"
+                        "android.os.Parcel _data = android.os.Parcel.obtain();"
+                        "\nandroid.os.Parcel _reply"));
+  EXPECT_NE(string::npos,
+            output.find("static final int TRANSACTION__aidl_batch = "
+                        "android.os.IBinder.LAST_CALL_TRANSACTION;"));
+  EXPECT_NE(string::npos, output.find("case TRANSACTION__aidl_batch:"));
+  EXPECT_NE(string::npos, output.find("(_aidl_code!=TRANSACTION_f)"));
+  // A call reading past the size its entry claimed fails the batch.
+  EXPECT_NE(string::npos,
+            output.find("if ((data.dataPosition()>_aidl_end)) {\n"
+                        "throw new java.lang.RuntimeException("
+                        "\"Malformed batch\");\n}\n"
+                        "data.setDataPosition(_aidl_end);"));
+  EXPECT_NE(string::npos,
+            output.find("public static void flushBatch(p.IFoo iface)"));
+  EXPECT_NE(string::npos,
+            output.find("private synchronized void _aidl_batchCall(int code, "
+                        "android.os.Parcel data)"));
+}
+
+TEST_F(AidlTest, DispatchesBatchesToRedefinedMethodsInJava) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo {"
+      "  @batchable oneway void f(int a) = 0;"
+      "  @batchable oneway void f(long a) = 1; }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_NE(string::npos,
+            output.find("this._aidl_batchCall(Stub.TRANSACTION_f_1, _data);"));
+  EXPECT_NE(string::npos,
+            output.find("((_aidl_code!=TRANSACTION_f)&&"
+                        "(_aidl_code!=TRANSACTION_f_1))"));
+}
+
+TEST_F(AidlTest, LooksUpSparseTransactionNamesWithSwitchInJava) {
+  JavaOptions options;
+  options.input_file_name_ = "p/IFoo.aidl";
+  options.output_file_name_ = "out/p/IFoo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; interface IFoo { void a() = 1; void b() = 16000000; }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  // A table would need an entry for every id up to 16000000.
+  EXPECT_EQ(string::npos, output.find("_aidl_transactionNames"));
+  EXPECT_NE(string::npos,
+            output.find("public static java.lang.String "
+                        "getTransactionName(int code)\n"
+                        "{\n"
+                        "switch (code)\n"
+                        "{\n"
+                        "case TRANSACTION_a:\n"
+                        "{\n"
+                        "return \"a\";\n"
+                        "}\n"
+                        "case TRANSACTION_b:\n"
+                        "{\n"
+                        "return \"b\";\n"
+                        "}\n"
+                        "}\n"
+                        "return null;\n"
+                        "}\n"));
+  EXPECT_NE(string::npos, output.find("public static int getMaxTransactionId()\n"
+                                      "{\n"
+                                      "return 16000000;\n"
+                                      "}\n"));
+}
+
+TEST_F(AidlTest, GeneratesStructuredParcelableJava) {
+  JavaOptions options;
+  options.input_file_name_ = "p/Foo.aidl";
+  options.output_file_name_ = "out/p/Foo.java";
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; parcelable Foo { int a; String b; }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_NE(string::npos,
+            output.find("public class Foo implements android.os.Parcelable\n"
+                        "{\npublic int a;\npublic java.lang.String b;\n"));
+  EXPECT_NE(string::npos, output.find("_aidl_parcel.writeInt(a);\n"
+                                      "_aidl_parcel.writeString(b);\n}\n"));
+  EXPECT_NE(string::npos, output.find("a = _aidl_parcel.readInt();\n"
+                                      "b = _aidl_parcel.readString();\n}\n"));
+}
+
+TEST_F(AidlTest, PassesWriteFlagsToNestedParcelablesInJava) {
+  JavaOptions options;
+  options.input_file_name_ = "p/Foo.aidl";
+  options.output_file_name_ = "out/p/Foo.java";
+  options.import_paths_.push_back("");
+  io_delegate_.SetFileContents("p/Bar.aidl", "package p; parcelable Bar;");
+  io_delegate_.SetFileContents(
+      options.input_file_name_,
+      "package p; import p.Bar; parcelable Foo { Bar a; Bar[] b; }");
+  EXPECT_EQ(0, ::android::aidl::compile_aidl_to_java(options, io_delegate_));
+  string output;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents(options.output_file_name_,
+                                              &output));
+  EXPECT_NE(string::npos,
+            output.find("a.writeToParcel(_aidl_parcel, _aidl_flag);"));
+  EXPECT_NE(string::npos,
+            output.find("_aidl_parcel.writeTypedArray(b, _aidl_flag);"));
+}
+
+TEST_F(AidlTest, RejectsInvalidParcelableFields) {
+  unique_ptr<AidlStructuredParcelable> parcelable;
+  const string path = "p/Foo.aidl";
+  for (const char* contents : {
+           "package p; parcelable Foo { int a; long a; }",
+           "package p; parcelable Foo { void a; }",
+           "package p; parcelable Foo { Bar a; }",
+           "package p; @FixedSize parcelable Foo { }",
+           "package p; @FixedSize parcelable Foo { int a; boolean b; }",
+           "package p; @FixedSize parcelable Foo { int[] a; }",
+           "package p; @FixedSize parcelable Foo { String a; }"}) {
+    io_delegate_.SetFileContents(path, contents);
+    EXPECT_NE(AidlError::OK,
+              ::android::aidl::internals::load_and_validate_aidl(
+                  preprocessed_files_, import_paths_, path, io_delegate_,
+                  &java_types_, nullptr, nullptr, nullptr, &parcelable));
+    EXPECT_EQ(nullptr, parcelable);
+  }
+}
+
+TEST_F(AidlTest, ComputesMethodWireSizes) {
+  unique_ptr<AidlInterface> interface = Parse(
+      "p/IFoo.aidl",
+      "package p; interface IFoo {"
+      "  long f(int a, IBinder b, out int[] c);"
+      "  void g(String s);"
+      "  oneway void h(double d);"
+      "}",
+      &cpp_types_);
+  ASSERT_NE(nullptr, interface);
+  const auto& methods = interface->GetMethods();
+  ASSERT_EQ(3u, methods.size());
+
+  // The interface token takes 8 bytes plus "p.IFoo" in UTF-16 with a
+  // terminator, padded to 16.
+  MethodWireSize f = GetMethodWireSize(*interface, *methods[0]);
+  EXPECT_EQ(24u + 4u + 24u, f.request.min);
+  EXPECT_EQ(24u + 4u + 24u, f.request.max);
+  EXPECT_EQ(4u + 8u + 4u, f.reply.min);
+  EXPECT_FALSE(f.reply.IsBounded());
+
+  MethodWireSize g = GetMethodWireSize(*interface, *methods[1]);
+  EXPECT_EQ(24u + 4u, g.request.min);
+  EXPECT_FALSE(g.request.IsBounded());
+  EXPECT_EQ(4u, g.reply.min);
+  EXPECT_EQ(4u, g.reply.max);
+
+  MethodWireSize h = GetMethodWireSize(*interface, *methods[2]);
+  EXPECT_EQ(24u + 8u, h.request.max);
+  EXPECT_EQ(0u, h.reply.max);
+
+  ASSERT_TRUE(WriteSizeReport(*interface, "sizes.json", io_delegate_));
+  string report;
+  ASSERT_TRUE(io_delegate_.GetWrittenContents("sizes.json", &report));
+  EXPECT_NE(string::npos,
+            report.find("{\"name\": \"g\", \"id\": 1, \"oneway\": false, "
+                        "\"request\": {\"min\": 28, \"max\": null}, "
+                        "\"reply\": {\"min\": 4, \"max\": 4}}"));
+  EXPECT_NE(string::npos,
+            report.find("{\"name\": \"h\", \"id\": 2, \"oneway\": true, "
+                        "\"request\": {\"min\": 32, \"max\": 32}}"));
+}
+
+TEST_F(AidlTest, SemanticHashIgnoresCommentsAndFormatting) {
+  const char* argv[] = {"aidl-cpp", "p/IFoo.aidl", "out", "out/IFoo.cpp"};
+  unique_ptr<CppOptions> options = CppOptions::Parse(4, argv);
+  ASSERT_NE(nullptr, options);
+  auto hash = [this, &options](const string& contents) {
+    cpp::TypeNamespace types;
+    types.Init();
+    unique_ptr<AidlInterface> interface =
+        Parse("p/IFoo.aidl", contents, &types);
+    EXPECT_NE(nullptr, interface) << contents;
+    return (interface) ? cpp::GetSemanticHash(*options, *interface, nullptr)
+                       : string();
+  };
+
+  const string base = hash("package p; interface IFoo { int f(in String s); }");
+  EXPECT_EQ(base, hash("package p;\n"
+                       "/** Docs. */\n"
+                       "interface IFoo {\n"
+                       "  // More docs.\n"
+                       "  int f(in String s);\n"
+                       "}\n"));
+  EXPECT_NE(base, hash("package p; interface IFoo { int f(in String t); }"));
+  EXPECT_NE(base, hash("package p; interface IFoo { long f(in String s); }"));
+  EXPECT_NE(base, hash("package p; interface IFoo {"
+                       "  int f(in @utf8InCpp String s); }"));
+  EXPECT_NE(base, hash("package p; interface IFoo {"
+                       "  int f(in String s) = 3; }"));
+}
+
+TEST_F(AidlTest, RejectsMethodsLargerThanTheTransactionBuffer) {
+  // A @FixedSize parcelable of 64k longs takes 512KiB, so two of them can
+  // never fit in one transaction.
+  string fields;
+  for (int i = 0; i < 64 * 1024; ++i) {
+    fields += android::base::StringPrintf("long f%d; ", i);
+  }
+  import_paths_.push_back("");
+  io_delegate_.SetFileContents(
+      "p/Big.aidl", "package p; @FixedSize parcelable Big { " + fields + "}");
+  const string contents = "package p; import p.Big; interface IFoo {"
+                          "  void f(in Big a);"
+                          "%s"
+                          "}";
+  EXPECT_NE(nullptr,
+            Parse("p/IFoo.aidl",
+                  android::base::StringPrintf(contents.c_str(), ""),
+                  &cpp_types_));
+  EXPECT_EQ(nullptr,
+            Parse("p/IFoo.aidl",
+                  android::base::StringPrintf(contents.c_str(),
+                                              "  void g(in Big a, in Big b);"),
+                  &cpp_types_));
+}
+
 }  // namespace aidl
 }  // namespace android
@@ -172,12 +172,16 @@ MethodDecl::MethodDecl(const std::string& return_type,
       is_const_(modifiers & IS_CONST),
       is_virtual_(modifiers & IS_VIRTUAL),
       is_override_(modifiers & IS_OVERRIDE),
-      is_pure_virtual_(modifiers & IS_PURE_VIRTUAL) {}
+      is_pure_virtual_(modifiers & IS_PURE_VIRTUAL),
+      is_static_(modifiers & IS_STATIC) {}
 
 void MethodDecl::Write(CodeWriter* to) const {
   if (is_virtual_)
     to->Write("virtual ");
 
+  if (is_static_)
+    to->Write("static ");
+
   to->Write("%s %s", return_type_.c_str(), name_.c_str());
 
   arguments_.Write(to);
@@ -214,10 +218,26 @@ void StatementBlock::AddLiteral(const std::string& expression_str,
 
 void StatementBlock::Write(CodeWriter* to) const {
   to->Write("{\n");
+  WriteStatements(to);
+  to->Write("}\n");
+}
+
+void StatementBlock::WriteStatements(CodeWriter* to) const {
   for (const auto& statement : statements_) {
     statement->Write(to);
   }
-  to->Write("}\n");
+}
+
+DeferredStatements::DeferredStatements(Builder build, bool* failed)
+    : build_(std::move(build)),
+      failed_(failed) {}
+
+void DeferredStatements::Write(CodeWriter* to) const {
+  StatementBlock statements;
+  if (!build_(&statements)) {
+    *failed_ = true;
+  }
+  statements.WriteStatements(to);
 }
 
 ConstructorImpl::ConstructorImpl(const string& class_name,
@@ -345,6 +365,16 @@ void IfStatement::Write(CodeWriter* to) const {
   }
 }
 
+WhileStatement::WhileStatement(AstNode* expression)
+    : expression_(expression) {}
+
+void WhileStatement::Write(CodeWriter* to) const {
+  to->Write("while (");
+  expression_->Write(to);
+  to->Write(") ");
+  body_.Write(to);
+}
+
 Statement::Statement(unique_ptr<AstNode> expression)
     : expression_(std::move(expression)) {}
 
@@ -378,6 +408,13 @@ void LiteralExpression::Write(CodeWriter* to) const {
   to->Write("%s", expression_.c_str());
 }
 
+LiteralDecl::LiteralDecl(const std::string& expression)
+    : expression_(expression) {}
+
+void LiteralDecl::Write(CodeWriter* to) const {
+  to->Write("%s", expression_.c_str());
+}
+
 CppNamespace::CppNamespace(const std::string& name,
                            std::vector<unique_ptr<Declaration>> declarations)
     : declarations_(std::move(declarations)),
@@ -404,8 +441,14 @@ void CppNamespace::Write(CodeWriter* to) const {
 
 Document::Document(const std::vector<std::string>& include_list,
                    unique_ptr<CppNamespace> a_namespace)
+    : include_list_(include_list) {
+  namespaces_.push_back(std::move(a_namespace));
+}
+
+Document::Document(const std::vector<std::string>& include_list,
+                   vector<unique_ptr<CppNamespace>> namespaces)
     : include_list_(include_list),
-      namespace_(std::move(a_namespace)) {}
+      namespaces_(std::move(namespaces)) {}
 
 void Document::Write(CodeWriter* to) const {
   for (const auto& include : include_list_) {
@@ -413,7 +456,12 @@ void Document::Write(CodeWriter* to) const {
   }
   to->Write("\n");
 
-  namespace_->Write(to);
+  for (size_t i = 0; i < namespaces_.size(); ++i) {
+    if (i != 0) {
+      to->Write("\n");
+    }
+    namespaces_[i]->Write(to);
+  }
 }
 
 CppHeader::CppHeader(const std::string& include_guard,
@@ -422,6 +470,12 @@ CppHeader::CppHeader(const std::string& include_guard,
     : Document(include_list, std::move(a_namespace)),
       include_guard_(include_guard) {}
 
+CppHeader::CppHeader(const std::string& include_guard,
+                     const std::vector<std::string>& include_list,
+                     vector<unique_ptr<CppNamespace>> namespaces)
+    : Document(include_list, std::move(namespaces)),
+      include_guard_(include_guard) {}
+
 void CppHeader::Write(CodeWriter* to) const {
   to->Write("#ifndef %s\n", include_guard_.c_str());
   to->Write("#define %s\n\n", include_guard_.c_str());
@@ -436,6 +490,38 @@ CppSource::CppSource(const std::vector<std::string>& include_list,
                      unique_ptr<CppNamespace> a_namespace)
     : Document(include_list, std::move(a_namespace)) {}
 
+StreamingCppSource::StreamingCppSource(CodeWriter* to,
+                                       const vector<string>& include_list,
+                                       const vector<string>& package)
+    : to_(to),
+      package_(package) {
+  for (const auto& include : include_list) {
+    to_->Write("#include <%s>\n", include.c_str());
+  }
+  to_->Write("\n");
+  for (const string& name : package_) {
+    to_->Write("namespace %s {\n\n", name.c_str());
+  }
+}
+
+void StreamingCppSource::Write(vector<unique_ptr<Declaration>>* decls) {
+  for (const auto& decl : *decls) {
+    decl->Write(to_);
+    to_->Write("\n");
+  }
+  decls->clear();
+}
+
+void StreamingCppSource::Finish() {
+  // Each namespace is followed by a blank line inside the one enclosing it.
+  for (auto name = package_.crbegin(); name != package_.crend(); ++name) {
+    if (name != package_.crbegin()) {
+      to_->Write("\n");
+    }
+    to_->Write("}  // namespace %s\n", name->c_str());
+  }
+}
+
 }  // namespace cpp
 }  // namespace aidl
 }  // namespace android
@@ -17,6 +17,7 @@
 #ifndef AIDL_AST_CPP_H_
 #define AIDL_AST_CPP_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -148,6 +149,7 @@ class MethodDecl : public Declaration {
     IS_VIRTUAL = 1 << 1,
     IS_OVERRIDE = 1 << 2,
     IS_PURE_VIRTUAL = 1 << 3,
+    IS_STATIC = 1 << 4,
   };
 
   MethodDecl(const std::string& return_type,
@@ -169,6 +171,7 @@ class MethodDecl : public Declaration {
   bool is_virtual_ = false;
   bool is_override_ = false;
   bool is_pure_virtual_ = false;
+  bool is_static_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(MethodDecl);
 };  // class MethodDecl
@@ -184,6 +187,8 @@ class StatementBlock : public Declaration {
   bool Empty() const { return statements_.empty(); }
 
   void Write(CodeWriter* to) const override;
+  // Writes the statements without the surrounding braces.
+  void WriteStatements(CodeWriter* to) const;
 
  private:
   std::vector<std::unique_ptr<AstNode>> statements_;
@@ -191,6 +196,25 @@ class StatementBlock : public Declaration {
   DISALLOW_COPY_AND_ASSIGN(StatementBlock);
 };  // class StatementBlock
 
+// Statements that are only built while being written, and are freed straight
+// after, so that large functions need not be held in memory all at once.
+class DeferredStatements : public AstNode {
+ public:
+  // |build| adds the statements to the block it is given, returning false on
+  // failure, in which case |*failed| is set.
+  using Builder = std::function<bool(StatementBlock*)>;
+
+  DeferredStatements(Builder build, bool* failed);
+  virtual ~DeferredStatements() = default;
+  void Write(CodeWriter* to) const override;
+
+ private:
+  const Builder build_;
+  bool* const failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeferredStatements);
+};  // class DeferredStatements
+
 class ConstructorImpl : public Declaration {
  public:
   ConstructorImpl(const std::string& class_name,
@@ -303,6 +327,20 @@ class IfStatement : public AstNode {
   DISALLOW_COPY_AND_ASSIGN(IfStatement);
 };  // class IfStatement
 
+class WhileStatement : public AstNode {
+ public:
+  explicit WhileStatement(AstNode* expression);
+  virtual ~WhileStatement() = default;
+  StatementBlock* Body() { return &body_; }
+  void Write(CodeWriter* to) const override;
+
+ private:
+  std::unique_ptr<AstNode> expression_;
+  StatementBlock body_;
+
+  DISALLOW_COPY_AND_ASSIGN(WhileStatement);
+};  // class WhileStatement
+
 class Statement : public AstNode {
  public:
   explicit Statement(std::unique_ptr<AstNode> expression);
@@ -343,6 +381,20 @@ class LiteralExpression : public AstNode {
   DISALLOW_COPY_AND_ASSIGN(LiteralExpression);
 };  // class LiteralExpression
 
+// A declaration written out verbatim, for constructs (typedefs, tables,
+// preprocessor conditionals) that don't warrant a node type of their own.
+class LiteralDecl : public Declaration {
+ public:
+  explicit LiteralDecl(const std::string& expression);
+  ~LiteralDecl() = default;
+  void Write(CodeWriter* to) const override;
+
+ private:
+  const std::string expression_;
+
+  DISALLOW_COPY_AND_ASSIGN(LiteralDecl);
+};  // class LiteralDecl
+
 class CppNamespace : public Declaration {
  public:
   CppNamespace(const std::string& name,
@@ -365,12 +417,14 @@ class Document : public AstNode {
  public:
   Document(const std::vector<std::string>& include_list,
            std::unique_ptr<CppNamespace> a_namespace);
+  Document(const std::vector<std::string>& include_list,
+           std::vector<std::unique_ptr<CppNamespace>> namespaces);
 
   void Write(CodeWriter* to) const override;
 
  private:
   std::vector<std::string> include_list_;
-  std::unique_ptr<CppNamespace> namespace_;
+  std::vector<std::unique_ptr<CppNamespace>> namespaces_;
 
   DISALLOW_COPY_AND_ASSIGN(Document);
 };  // class Document
@@ -380,6 +434,9 @@ class CppHeader final : public Document {
   CppHeader(const std::string& include_guard,
             const std::vector<std::string>& include_list,
             std::unique_ptr<CppNamespace> a_namespace);
+  CppHeader(const std::string& include_guard,
+            const std::vector<std::string>& include_list,
+            std::vector<std::unique_ptr<CppNamespace>> namespaces);
   void Write(CodeWriter* to) const override;
 
  private:
@@ -397,6 +454,27 @@ class CppSource final : public Document {
   DISALLOW_COPY_AND_ASSIGN(CppSource);
 };  // class CppSource
 
+// Writes the same as a CppSource nested in the namespaces of |package|, but
+// writes and frees declarations as they are handed over instead of holding
+// them until the end.
+class StreamingCppSource final {
+ public:
+  // Writes the includes and opens the namespaces.
+  StreamingCppSource(CodeWriter* to,
+                     const std::vector<std::string>& include_list,
+                     const std::vector<std::string>& package);
+  // Writes and then frees |decls|, leaving it empty.
+  void Write(std::vector<std::unique_ptr<Declaration>>* decls);
+  // Closes the namespaces.
+  void Finish();
+
+ private:
+  CodeWriter* const to_;
+  const std::vector<std::string> package_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingCppSource);
+};  // class StreamingCppSource
+
 }  // namespace cpp
 }  // namespace aidl
 }  // namespace android
@@ -218,6 +218,12 @@ TEST_F(AstCppTests, GeneratesIfStatement) {
   CompareGeneratedCode(s2, "if (bar) {\non true1;\n}\n");
 }
 
+TEST_F(AstCppTests, GeneratesWhileStatement) {
+  WhileStatement s(new LiteralExpression("foo"));
+  s.Body()->AddLiteral("bar");
+  CompareGeneratedCode(s, "while (foo) {\nbar;\n}\n");
+}
+
 TEST_F(AstCppTests, GeneratesSwitchStatement) {
   SwitchStatement s("var");
   // These are intentionally out of alphanumeric order.  We're testing
@@ -17,6 +17,7 @@
 #include "ast_java.h"
 
 #include "code_writer.h"
+#include "logging.h"
 #include "type_java.h"
 
 using std::vector;
@@ -25,6 +26,27 @@ using std::string;
 namespace android {
 namespace aidl {
 namespace java {
+namespace {
+
+// Each thread has its own stack of arenas, so threads generating Java at
+// the same time never allocate from one another's arenas.
+thread_local AstArena* current_arena = nullptr;
+
+}  // namespace
+
+AstArena::AstArena() : previous_(current_arena) {
+  current_arena = this;
+}
+
+AstArena::~AstArena() {
+  current_arena = previous_;
+}
+
+AidlArena* AstArena::Current() {
+  CHECK(current_arena != nullptr) << "Java AST node created outside of an "
+                                     "AstArena";
+  return &current_arena->arena_;
+}
 
 void WriteModifiers(CodeWriter* to, int mod, int mask) {
   int m = mod & mask;
@@ -52,6 +74,10 @@ void WriteModifiers(CodeWriter* to, int mod, int mask) {
   if (m & ABSTRACT) {
     to->Write("abstract ");
   }
+
+  if (m & SYNCHRONIZED) {
+    to->Write("synchronized ");
+  }
 }
 
 void WriteArgumentList(CodeWriter* to, const vector<Expression*>& arguments) {
@@ -71,14 +97,26 @@ void Field::Write(CodeWriter* to) const {
     to->Write("%s\n", this->comment.c_str());
   }
   WriteModifiers(to, this->modifiers, SCOPE_MASK | STATIC | FINAL | OVERRIDE);
-  to->Write("%s %s", this->variable->type->JavaType().c_str(),
-            this->variable->name.c_str());
+  this->variable->WriteDeclaration(to);
   if (this->value.length() != 0) {
     to->Write(" = %s", this->value.c_str());
   }
   to->Write(";\n");
 }
 
+LiteralClassElement::LiteralClassElement(const string& e) : element(e) {}
+
+void LiteralClassElement::Write(CodeWriter* to) const {
+  to->Write("%s", this->element.c_str());
+}
+
+DeferredClassElement::DeferredClassElement(Builder b) : build(std::move(b)) {}
+
+void DeferredClassElement::Write(CodeWriter* to) const {
+  AstArena arena;
+  this->build()->Write(to);
+}
+
 LiteralExpression::LiteralExpression(const string& v) : value(v) {}
 
 void LiteralExpression::Write(CodeWriter* to) const {
@@ -132,12 +170,23 @@ void StatementBlock::Write(CodeWriter* to) const {
   to->Write("}\n");
 }
 
+DeferredStatements::DeferredStatements(Builder b) : build(std::move(b)) {}
+
+void DeferredStatements::Write(CodeWriter* to) const {
+  AstArena arena;
+  StatementBlock* block = New<StatementBlock>();
+  this->build(block);
+  for (const Statement* statement : block->statements) {
+    statement->Write(to);
+  }
+}
+
 void StatementBlock::Add(Statement* statement) {
   this->statements.push_back(statement);
 }
 
 void StatementBlock::Add(Expression* expression) {
-  this->statements.push_back(new ExpressionStatement(expression));
+  this->statements.push_back(New<ExpressionStatement>(expression));
 }
 
 ExpressionStatement::ExpressionStatement(Expression* e) : expression(e) {}
@@ -304,6 +353,42 @@ void IfStatement::Write(CodeWriter* to) const {
   }
 }
 
+ForStatement::ForStatement(Variable* i, Expression* c) : index(i), count(c) {}
+
+void ForStatement::Write(CodeWriter* to) const {
+  to->Write("for (");
+  this->index->WriteDeclaration(to);
+  to->Write(" = 0; ");
+  this->index->Write(to);
+  to->Write(" < ");
+  this->count->Write(to);
+  to->Write("; ");
+  this->index->Write(to);
+  to->Write("++) ");
+  this->statements->Write(to);
+}
+
+ForEachStatement::ForEachStatement(Variable* v, Expression* c)
+    : variable(v), collection(c) {}
+
+void ForEachStatement::Write(CodeWriter* to) const {
+  to->Write("for (");
+  this->variable->WriteDeclaration(to);
+  to->Write(" : ");
+  this->collection->Write(to);
+  to->Write(") ");
+  this->statements->Write(to);
+}
+
+WhileStatement::WhileStatement(Expression* e) : expression(e) {}
+
+void WhileStatement::Write(CodeWriter* to) const {
+  to->Write("while (");
+  this->expression->Write(to);
+  to->Write(") ");
+  this->statements->Write(to);
+}
+
 ReturnStatement::ReturnStatement(Expression* e) : expression(e) {}
 
 void ReturnStatement::Write(CodeWriter* to) const {
@@ -312,13 +397,21 @@ void ReturnStatement::Write(CodeWriter* to) const {
   to->Write(";\n");
 }
 
+ThrowStatement::ThrowStatement(Expression* e) : expression(e) {}
+
+void ThrowStatement::Write(CodeWriter* to) const {
+  to->Write("throw ");
+  this->expression->Write(to);
+  to->Write(";\n");
+}
+
 void TryStatement::Write(CodeWriter* to) const {
   to->Write("try ");
   this->statements->Write(to);
 }
 
 CatchStatement::CatchStatement(Variable* e)
-    : statements(new StatementBlock), exception(e) {}
+    : statements(New<StatementBlock>()), exception(e) {}
 
 void CatchStatement::Write(CodeWriter* to) const {
   to->Write("catch ");
@@ -377,7 +470,8 @@ void Method::Write(CodeWriter* to) const {
   }
 
   WriteModifiers(to, this->modifiers,
-                 SCOPE_MASK | STATIC | ABSTRACT | FINAL | OVERRIDE);
+                 SCOPE_MASK | STATIC | ABSTRACT | FINAL | SYNCHRONIZED |
+                     OVERRIDE);
 
   if (this->returnType != NULL) {
     string dim;
@@ -489,11 +583,11 @@ static string escape_backslashes(const string& str) {
 Document::Document(const std::string& comment,
                    const std::string& package,
                    const std::string& original_src,
-                   std::unique_ptr<Class> clazz)
+                   Class* clazz)
     : comment_(comment),
       package_(package),
       original_src_(original_src),
-      clazz_(std::move(clazz)) {
+      clazz_(clazz) {
 }
 
 void Document::Write(CodeWriter* to) const {
@@ -17,12 +17,18 @@
 #ifndef AIDL_AST_JAVA_H_
 #define AIDL_AST_JAVA_H_
 
+#include <functional>
 #include <memory>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <android-base/macros.h>
+
+#include "aidl_arena.h"
+
 enum {
   PACKAGE_PRIVATE = 0x00000000,
   PUBLIC = 0x00000001,
@@ -33,6 +39,7 @@ enum {
   STATIC = 0x00000010,
   FINAL = 0x00000020,
   ABSTRACT = 0x00000040,
+  SYNCHRONIZED = 0x00000080,
 
   OVERRIDE = 0x00000100,
 
@@ -51,6 +58,31 @@ namespace java {
 
 class Type;
 
+// Java AST nodes do not own one another: the same Variable is usually
+// referenced from many expressions.  Instead, every node is created with
+// New<T>() from the calling thread's innermost live AstArena and is destroyed
+// with it.
+class AstArena {
+ public:
+  AstArena();
+  ~AstArena();
+
+  // Returns the calling thread's innermost live AstArena, aborting if there is
+  // none.
+  static AidlArena* Current();
+
+ private:
+  AidlArena arena_;
+  AstArena* previous_;
+
+  DISALLOW_COPY_AND_ASSIGN(AstArena);
+};
+
+template <typename T, typename... Args>
+T* New(Args&&... args) {
+  return AstArena::Current()->New<T>(std::forward<Args>(args)...);
+}
+
 // Write the modifiers that are set in both mod and mask
 void WriteModifiers(CodeWriter* to, int mod, int mask);
 
@@ -61,6 +93,29 @@ struct ClassElement {
   virtual void Write(CodeWriter* to) const = 0;
 };
 
+// Written out verbatim, for class members the AST has no node for.
+struct LiteralClassElement : public ClassElement {
+  std::string element;
+
+  LiteralClassElement(const std::string& element);
+  virtual ~LiteralClassElement() = default;
+
+  void Write(CodeWriter* to) const override;
+};
+
+// A class member that is only built while being written, in an AstArena of
+// its own that is freed straight after.  |build| must not hand any of the
+// nodes it creates to nodes outside the member.
+struct DeferredClassElement : public ClassElement {
+  using Builder = std::function<ClassElement*()>;
+  Builder build;
+
+  DeferredClassElement(Builder build);
+  virtual ~DeferredClassElement() = default;
+
+  void Write(CodeWriter* to) const override;
+};
+
 struct Expression {
   virtual ~Expression() = default;
   virtual void Write(CodeWriter* to) const = 0;
@@ -138,6 +193,18 @@ struct StatementBlock : public Statement {
   void Add(Expression* expression);
 };
 
+// Statements that are only built while being written, like the members of
+// a DeferredClassElement.  |build| adds them to the block it is given, which
+// is written without braces.
+struct DeferredStatements : public Statement {
+  using Builder = std::function<void(StatementBlock*)>;
+  Builder build;
+
+  DeferredStatements(Builder build);
+  virtual ~DeferredStatements() = default;
+  void Write(CodeWriter* to) const override;
+};
+
 struct ExpressionStatement : public Statement {
   Expression* expression;
 
@@ -244,7 +311,7 @@ struct VariableDeclaration : public Statement {
 
 struct IfStatement : public Statement {
   Expression* expression = nullptr;
-  StatementBlock* statements = new StatementBlock;
+  StatementBlock* statements = New<StatementBlock>();
   IfStatement* elseif = nullptr;
 
   IfStatement() = default;
@@ -252,6 +319,38 @@ struct IfStatement : public Statement {
   void Write(CodeWriter* to) const override;
 };
 
+// for (int index = 0; index < count; index++) statements
+struct ForStatement : public Statement {
+  Variable* index;
+  Expression* count;
+  StatementBlock* statements = New<StatementBlock>();
+
+  ForStatement(Variable* index, Expression* count);
+  virtual ~ForStatement() = default;
+  void Write(CodeWriter* to) const override;
+};
+
+// for (Type variable : collection) statements
+struct ForEachStatement : public Statement {
+  Variable* variable;
+  Expression* collection;
+  StatementBlock* statements = New<StatementBlock>();
+
+  ForEachStatement(Variable* variable, Expression* collection);
+  virtual ~ForEachStatement() = default;
+  void Write(CodeWriter* to) const override;
+};
+
+// while (expression) statements
+struct WhileStatement : public Statement {
+  Expression* expression;
+  StatementBlock* statements = New<StatementBlock>();
+
+  WhileStatement(Expression* expression);
+  virtual ~WhileStatement() = default;
+  void Write(CodeWriter* to) const override;
+};
+
 struct ReturnStatement : public Statement {
   Expression* expression;
 
@@ -260,8 +359,16 @@ struct ReturnStatement : public Statement {
   void Write(CodeWriter* to) const override;
 };
 
+struct ThrowStatement : public Statement {
+  Expression* expression;
+
+  ThrowStatement(Expression* expression);
+  virtual ~ThrowStatement() = default;
+  void Write(CodeWriter* to) const override;
+};
+
 struct TryStatement : public Statement {
-  StatementBlock* statements = new StatementBlock;
+  StatementBlock* statements = New<StatementBlock>();
 
   TryStatement() = default;
   virtual ~TryStatement() = default;
@@ -278,7 +385,7 @@ struct CatchStatement : public Statement {
 };
 
 struct FinallyStatement : public Statement {
-  StatementBlock* statements = new StatementBlock;
+  StatementBlock* statements = New<StatementBlock>();
 
   FinallyStatement() = default;
   virtual ~FinallyStatement() = default;
@@ -287,7 +394,7 @@ struct FinallyStatement : public Statement {
 
 struct Case {
   std::vector<std::string> cases;
-  StatementBlock* statements = new StatementBlock;
+  StatementBlock* statements = New<StatementBlock>();
 
   Case() = default;
   Case(const std::string& c);
@@ -355,10 +462,11 @@ struct Class : public ClassElement {
 
 class Document {
  public:
+  // |clazz| belongs to the AstArena it was created in.
   Document(const std::string& comment,
            const std::string& package,
            const std::string& original_src,
-           std::unique_ptr<Class> clazz);
+           Class* clazz);
   virtual ~Document() = default;
   virtual void Write(CodeWriter* to) const;
 
@@ -366,7 +474,7 @@ class Document {
   std::string comment_;
   std::string package_;
   std::string original_src_;
-  std::unique_ptr<Class> clazz_;
+  Class* clazz_;
 };
 
 }  // namespace java
@@ -15,6 +15,7 @@
  */
 
 #include <string>
+#include <thread>
 
 #include <gtest/gtest.h>
 
@@ -36,6 +37,12 @@ final class TestClass extends SuperClass
 }
 )";
 
+const char kExpectedIfStatementOutput[] =
+R"(if ((x==null)) {
+return null;
+}
+)";
+
 }  // namespace
 
 TEST(AstJavaTests, GeneratesClass) {
@@ -58,6 +65,80 @@ TEST(AstJavaTests, GeneratesClass) {
   EXPECT_EQ(string(kExpectedClassOutput), actual_output);
 }
 
+TEST(AstJavaTests, AllocatesNodesFromInnermostArena) {
+  JavaTypeNamespace types;
+  types.Init();
+  AstArena outer;
+  AidlArena* outer_arena = AstArena::Current();
+  string actual_output;
+  {
+    AstArena inner;
+    EXPECT_NE(outer_arena, AstArena::Current());
+    Variable* x = New<Variable>(types.IBinderType(), "x");
+    IfStatement* if_statement = New<IfStatement>();
+    if_statement->expression = New<Comparison>(x, "==", NULL_VALUE);
+    if_statement->statements->Add(New<ReturnStatement>(NULL_VALUE));
+    EXPECT_EQ(0u, outer_arena->BytesAllocated());
+
+    CodeWriterPtr writer = GetStringWriter(&actual_output);
+    if_statement->Write(writer.get());
+  }
+  EXPECT_EQ(outer_arena, AstArena::Current());
+  EXPECT_EQ(string(kExpectedIfStatementOutput), actual_output);
+}
+
+TEST(AstJavaTests, BuildsDeferredNodesWhileWriting) {
+  JavaTypeNamespace types;
+  types.Init();
+  AstArena outer;
+  AidlArena* outer_arena = AstArena::Current();
+  Class* a_class = New<Class>();
+  a_class->type = types.IBinderType();
+  Method* method = New<Method>();
+  method->returnType = types.VoidType();
+  method->name = "f";
+  method->statements = New<StatementBlock>();
+  method->statements->Add(New<DeferredStatements>([](StatementBlock* block) {
+    block->Add(New<ReturnStatement>(NULL_VALUE));
+  }));
+  a_class->elements.push_back(method);
+  a_class->elements.push_back(New<DeferredClassElement>([]() {
+    return New<LiteralClassElement>("int x;\n");
+  }));
+  const size_t built_bytes = outer_arena->BytesAllocated();
+
+  string actual_output;
+  CodeWriterPtr writer = GetStringWriter(&actual_output);
+  a_class->Write(writer.get());
+  // The deferred nodes came from arenas of their own, now freed.
+  EXPECT_EQ(built_bytes, outer_arena->BytesAllocated());
+  EXPECT_EQ(outer_arena, AstArena::Current());
+  EXPECT_EQ("class IBinder\n"
+            "{\n"
+            "void f()\n"
+            "{\n"
+            "return null;\n"
+            "}\n"
+            "int x;\n"
+            "}\n",
+            actual_output);
+}
+
+TEST(AstJavaTests, KeepsArenasPerThread) {
+  AstArena outer;
+  AidlArena* outer_arena = AstArena::Current();
+  AidlArena* thread_arena = nullptr;
+  std::thread other([&thread_arena]() {
+    AstArena arena;
+    New<LiteralExpression>("x");
+    thread_arena = AstArena::Current();
+  });
+  other.join();
+  EXPECT_NE(outer_arena, thread_arena);
+  EXPECT_EQ(outer_arena, AstArena::Current());
+  EXPECT_EQ(0u, outer_arena->BytesAllocated());
+}
+
 }  // namespace java
 }  // namespace aidl
 }  // namespace android
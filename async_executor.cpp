@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "aidl/async_executor.h"
+
+#include <utility>
+
+using std::function;
+using std::mutex;
+using std::unique_lock;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Enough to overlap a handful of slow calls without holding many threads
+// in processes that only make the odd asynchronous call.
+const size_t kDefaultMaxThreads = 4;
+const size_t kDefaultMaxPending = 64;
+
+// The executor whose thread is running the current task, if any.
+thread_local const AsyncExecutor* tls_current_executor = nullptr;
+
+}  // namespace
+
+AsyncExecutor::AsyncExecutor(size_t max_threads, size_t max_pending)
+    : max_threads_((max_threads > 0) ? max_threads : 1),
+      max_pending_((max_pending > 0) ? max_pending : 1) {}
+
+AsyncExecutor::~AsyncExecutor() {
+  {
+    unique_lock<mutex> l(lock_);
+    shutting_down_ = true;
+  }
+  task_posted_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void AsyncExecutor::Post(function<void()> task) {
+  unique_lock<mutex> l(lock_);
+  if (pending_.size() >= max_pending_ && tls_current_executor == this) {
+    // Callbacks issue calls from our own threads.  If all of them waited
+    // here for room in the queue, nothing would ever take a task off it.
+    l.unlock();
+    task();
+    return;
+  }
+  task_taken_.wait(l, [this] { return pending_.size() < max_pending_; });
+  pending_.push_back(std::move(task));
+  if (idle_threads_ < pending_.size() && threads_.size() < max_threads_) {
+    threads_.emplace_back(&AsyncExecutor::Run, this);
+  }
+  l.unlock();
+  task_posted_.notify_one();
+}
+
+AsyncExecutor* AsyncExecutor::Default() {
+  static AsyncExecutor* executor =
+      new AsyncExecutor(kDefaultMaxThreads, kDefaultMaxPending);
+  return executor;
+}
+
+void AsyncExecutor::Run() {
+  tls_current_executor = this;
+  unique_lock<mutex> l(lock_);
+  while (true) {
+    ++idle_threads_;
+    task_posted_.wait(l, [this] { return shutting_down_ || !pending_.empty(); });
+    --idle_threads_;
+    if (pending_.empty()) {
+      return;  // Shutting down, and nothing is left to run.
+    }
+    function<void()> task = std::move(pending_.front());
+    pending_.pop_front();
+    l.unlock();
+    task_taken_.notify_one();
+    task();
+    l.lock();
+  }
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aidl/async_executor.h"
+#include "tests/fake_transport.h"
+
+using android::aidl::test::FakeTransport;
+using std::function;
+using std::future;
+using std::promise;
+using std::shared_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const uint32_t kCode = 7;
+
+// Long enough for a thread that should stay blocked to have been scheduled.
+const std::chrono::milliseconds kSettleTime(50);
+
+// Issues calls the way clients generated with --async do: the request is
+// built on the calling thread and the transaction runs on the executor.
+class FakeClient {
+ public:
+  FakeClient(FakeTransport* transport, AsyncExecutor* executor)
+      : transport_(transport), executor_(executor) {}
+
+  void CallAsync(int32_t request, int32_t* reply,
+                 function<void(bool)> callback) {
+    FakeTransport* transport = transport_;
+    executor_->Post([transport, request, reply, callback]() {
+      *reply = transport->Transact(kCode, request);
+      callback(true);
+    });
+  }
+
+  future<bool> CallAsync(int32_t request, int32_t* reply) {
+    shared_ptr<promise<bool>> done = std::make_shared<promise<bool>>();
+    CallAsync(request, reply, [done](bool ok) { done->set_value(ok); });
+    return done->get_future();
+  }
+
+ private:
+  FakeTransport* transport_;
+  AsyncExecutor* executor_;
+};
+
+}  // namespace
+
+TEST(AsyncExecutorTest, PipelinesCallsUpToThreadLimit) {
+  FakeTransport transport;
+  AsyncExecutor executor(2, 16);
+  FakeClient client(&transport, &executor);
+
+  vector<int32_t> replies(5);
+  vector<future<bool>> results;
+  for (size_t i = 0; i < replies.size(); ++i) {
+    results.push_back(client.CallAsync(i, &replies[i]));
+  }
+
+  ASSERT_TRUE(transport.WaitForInFlight(2));
+  std::this_thread::sleep_for(kSettleTime);
+  EXPECT_EQ(2u, transport.InFlight());
+
+  transport.Release(replies.size());
+  for (size_t i = 0; i < replies.size(); ++i) {
+    EXPECT_TRUE(results[i].get());
+    EXPECT_EQ(FakeTransport::ReplyFor(kCode, i), replies[i]);
+  }
+  EXPECT_EQ(2u, transport.MaxInFlight());
+}
+
+TEST(AsyncExecutorTest, InvokesCallbacksOnExecutorThreads) {
+  FakeTransport transport;
+  AsyncExecutor executor(1, 4);
+  FakeClient client(&transport, &executor);
+
+  int32_t reply = 0;
+  promise<std::thread::id> callback_thread;
+  client.CallAsync(3, &reply, [&callback_thread](bool) {
+    callback_thread.set_value(std::this_thread::get_id());
+  });
+  transport.Release(1);
+
+  EXPECT_NE(std::this_thread::get_id(), callback_thread.get_future().get());
+  EXPECT_EQ(FakeTransport::ReplyFor(kCode, 3), reply);
+}
+
+TEST(AsyncExecutorTest, PostBlocksWhileQueueIsFull) {
+  FakeTransport transport;
+  AsyncExecutor executor(1, 1);
+  FakeClient client(&transport, &executor);
+
+  int32_t replies[3];
+  future<bool> first = client.CallAsync(0, &replies[0]);
+  ASSERT_TRUE(transport.WaitForInFlight(1));
+  // The only thread is busy, so this one waits in the queue...
+  future<bool> second = client.CallAsync(1, &replies[1]);
+
+  // ...and with the queue full, issuing a third call blocks.
+  std::atomic<bool> third_issued(false);
+  future<bool> third;
+  std::thread caller([&]() {
+    third = client.CallAsync(2, &replies[2]);
+    third_issued = true;
+  });
+  std::this_thread::sleep_for(kSettleTime);
+  EXPECT_FALSE(third_issued);
+
+  transport.Release(3);
+  caller.join();
+  EXPECT_TRUE(third_issued);
+  EXPECT_TRUE(first.get());
+  EXPECT_TRUE(second.get());
+  EXPECT_TRUE(third.get());
+  EXPECT_EQ(1u, transport.MaxInFlight());
+}
+
+TEST(AsyncExecutorTest, RunsTasksInlineWhenPostedFromFullExecutor) {
+  AsyncExecutor executor(1, 1);
+  promise<void> go;
+  promise<std::thread::id> first_thread;
+  std::thread::id inline_thread;
+  bool ran_inline = false;
+  executor.Post([&]() {
+    first_thread.set_value(std::this_thread::get_id());
+    go.get_future().wait();
+    // The only thread is this one and the queue is full, so waiting for
+    // room would never return.
+    executor.Post([&]() { inline_thread = std::this_thread::get_id(); });
+    ran_inline = (inline_thread == std::this_thread::get_id());
+  });
+  std::thread::id executor_thread = first_thread.get_future().get();
+  std::atomic<bool> second_ran(false);
+  executor.Post([&second_ran]() { second_ran = true; });
+  go.set_value();
+
+  while (!second_ran) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(ran_inline);
+  EXPECT_EQ(executor_thread, inline_thread);
+}
+
+TEST(AsyncExecutorTest, RunsPendingTasksBeforeDestruction) {
+  std::atomic<int> ran(0);
+  {
+    AsyncExecutor executor(1, 8);
+    for (int i = 0; i < 5; ++i) {
+      executor.Post([&ran]() { ++ran; });
+    }
+  }
+  EXPECT_EQ(5, ran);
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compilation_context.h"
+
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "dispatch_profile.h"
+#include "generate_cpp.h"
+#include "generate_java.h"
+#include "logging.h"
+#include "options.h"
+#include "os.h"
+#include "wire_size.h"
+
+using android::base::LogFunction;
+using android::base::LogId;
+using android::base::LogSeverity;
+using std::map;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Reads through to another IoDelegate, but keeps everything written in
+// memory rather than touching the filesystem.
+class CapturingIoDelegate : public IoDelegate {
+ public:
+  CapturingIoDelegate(const IoDelegate& reader,
+                      map<string, string>* outputs)
+      : reader_(reader),
+        outputs_(outputs) {}
+  virtual ~CapturingIoDelegate() = default;
+
+  unique_ptr<string> GetFileContents(
+      const string& filename,
+      const string& content_suffix = "") const override {
+    return reader_.GetFileContents(filename, content_suffix);
+  }
+  unique_ptr<LineReader> GetLineReader(
+      const string& file_path) const override {
+    return reader_.GetLineReader(file_path);
+  }
+  bool FileIsReadable(const string& path) const override {
+    return reader_.FileIsReadable(path);
+  }
+  bool CreatedNestedDirs(
+      const string& /* base_dir */,
+      const vector<string>& /* nested_subdirs */) const override {
+    return true;
+  }
+  unique_ptr<CodeWriter> GetCodeWriter(
+      const string& file_path) const override {
+    string* buffer = &(*outputs_)[file_path];
+    buffer->clear();
+    return GetStringWriter(buffer);
+  }
+  void RemovePath(const string& file_path) const override {
+    outputs_->erase(file_path);
+  }
+
+ private:
+  const IoDelegate& reader_;
+  map<string, string>* outputs_;
+
+  DISALLOW_COPY_AND_ASSIGN(CapturingIoDelegate);
+};  // class CapturingIoDelegate
+
+// Routes std::cerr and LOG() output into a string for as long as it lives.
+// Both are process wide, so captures are serialized: a second capture waits
+// until the first has restored the previous stream buffer and logger.
+class ScopedDiagnosticCapture {
+ public:
+  explicit ScopedDiagnosticCapture(string* diagnostics)
+      : lock_(CaptureMutex()),
+        diagnostics_(diagnostics),
+        old_cerr_(std::cerr.rdbuf(stream_.rdbuf())) {
+    std::ostringstream* stream = &stream_;
+    old_logger_ = android::base::SetLogger(
+        [stream](LogId, LogSeverity, const char*, const char*,
+                 unsigned int, const char* message) {
+          *stream << message << std::endl;
+        });
+  }
+  ~ScopedDiagnosticCapture() {
+    android::base::SetLogger(std::move(old_logger_));
+    std::cerr.rdbuf(old_cerr_);
+    *diagnostics_ = stream_.str();
+  }
+
+ private:
+  static std::mutex& CaptureMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  std::lock_guard<std::mutex> lock_;
+  string* diagnostics_;
+  std::ostringstream stream_;
+  std::streambuf* old_cerr_;
+  LogFunction old_logger_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDiagnosticCapture);
+};  // class ScopedDiagnosticCapture
+
+string JavaOutputPath(const vector<string>& package, const string& name) {
+  string result;
+  for (const string& part : package) {
+    result += part;
+    result += OS_PATH_SEPARATOR;
+  }
+  result += name;
+  result += ".java";
+  return result;
+}
+
+}  // namespace
+
+CompilationContext::CompilationContext(const IoDelegate& io_delegate)
+    : io_delegate_(io_delegate) {}
+
+CompileResult CompilationContext::Compile(const CompileRequest& request) {
+  CompileResult result;
+  CapturingIoDelegate output_delegate{io_delegate_, &result.outputs};
+  vector<unique_ptr<AidlImport>> imports;
+
+  {
+    ScopedDiagnosticCapture capture{&result.diagnostics};
+    if (request.language == CompileRequest::Language::CPP) {
+      result.error = CompileCpp(request, output_delegate, &imports);
+    } else {
+      result.error = CompileJava(request, output_delegate, &imports);
+    }
+  }
+
+  result.dependencies.push_back(request.input_file_name);
+  for (const auto& import : imports) {
+    if (!import->GetFilename().empty()) {
+      result.dependencies.push_back(import->GetFilename());
+    }
+  }
+
+  return result;
+}
+
+void CompilationContext::Clear() {
+  cache_.parsed_imports.clear();
+}
+
+AidlError CompilationContext::CompileCpp(
+    const CompileRequest& request,
+    const IoDelegate& output_delegate,
+    vector<unique_ptr<AidlImport>>* imports) {
+  CppOptions options;
+  options.input_file_name_ = request.input_file_name;
+  options.import_paths_ = request.import_paths;
+  options.output_header_dir_ = request.output_header_dir;
+  options.use_dispatch_table_ = request.use_dispatch_table;
+  options.generate_async_ = request.generate_async;
+  options.generate_coroutines_ = request.generate_coroutines;
+  options.size_report_file_name_ = request.size_report_file_name;
+  options.dispatch_profile_file_name_ = request.dispatch_profile_file_name;
+  options.client_only_ = request.client_only;
+  options.server_only_ = request.server_only;
+  options.output_file_name_ = request.output_file_name;
+  // Outputs from an earlier build on disk say nothing about what the caller
+  // already has in memory.
+  options.keep_current_outputs_ = false;
+
+  if (options.client_only_ && options.server_only_) {
+    LOG(ERROR) << "client_only and server_only are mutually exclusive.";
+    return AidlError::GENERATION_ERROR;
+  }
+
+  unique_ptr<AidlInterface> interface;
+  unique_ptr<AidlStructuredParcelable> parcelable;
+  cpp_types_.reset(new cpp::TypeNamespace());
+  cpp_types_->Init();
+  AidlError err = internals::load_and_validate_aidl(
+      vector<string>{},  // no preprocessed files
+      options.ImportPaths(),
+      options.InputFileName(),
+      output_delegate,
+      cpp_types_.get(),
+      &interface,
+      imports,
+      &cache_,
+      &parcelable);
+  if (err != AidlError::OK) {
+    return err;
+  }
+
+  if (parcelable) {
+    if (!cpp::GenerateCppParcel(options, *cpp_types_, *parcelable,
+                                output_delegate)) {
+      return AidlError::GENERATION_ERROR;
+    }
+    return AidlError::OK;
+  }
+
+  if (!options.SizeReportPath().empty() &&
+      !WriteSizeReport(*interface, options.SizeReportPath(),
+                       output_delegate)) {
+    return AidlError::GENERATION_ERROR;
+  }
+
+  DispatchProfile profile;
+  if (!options.DispatchProfilePath().empty() &&
+      !profile.Load(options.DispatchProfilePath(), output_delegate)) {
+    return AidlError::GENERATION_ERROR;
+  }
+
+  if (!cpp::GenerateCpp(options, *cpp_types_, *interface, output_delegate,
+                        &profile)) {
+    return AidlError::GENERATION_ERROR;
+  }
+  return AidlError::OK;
+}
+
+AidlError CompilationContext::CompileJava(
+    const CompileRequest& request,
+    const IoDelegate& output_delegate,
+    vector<unique_ptr<AidlImport>>* imports) {
+  unique_ptr<AidlInterface> interface;
+  unique_ptr<AidlStructuredParcelable> parcelable;
+  java_types_.reset(new java::JavaTypeNamespace());
+  java_types_->Init();
+  AidlError err = internals::load_and_validate_aidl(
+      request.preprocessed_files,
+      request.import_paths,
+      request.input_file_name,
+      output_delegate,
+      java_types_.get(),
+      &interface,
+      imports,
+      &cache_,
+      &parcelable);
+  if (err != AidlError::OK) {
+    return err;
+  }
+
+  string output_file_name = request.output_file_name;
+  if (output_file_name.empty()) {
+    output_file_name = (interface)
+        ? JavaOutputPath(interface->GetSplitPackage(), interface->GetName())
+        : JavaOutputPath(parcelable->GetSplitPackage(),
+                         parcelable->GetName());
+  }
+
+  if (parcelable) {
+    if (java::generate_java_parcel(output_file_name, request.input_file_name,
+                                   parcelable.get(), java_types_.get(),
+                                   output_delegate) != 0) {
+      return AidlError::GENERATION_ERROR;
+    }
+    return AidlError::OK;
+  }
+
+  unsigned int flags = 0;
+  if (request.generate_no_op_methods) {
+    flags |= GENERATE_NO_OP_CLASS;
+  }
+  if (request.generate_traces) {
+    flags |= GENERATE_TRACES;
+  }
+  if (request.generate_compact) {
+    flags |= GENERATE_COMPACT;
+  }
+
+  DispatchProfile profile;
+  if (!request.dispatch_profile_file_name.empty() &&
+      !profile.Load(request.dispatch_profile_file_name, output_delegate)) {
+    return AidlError::GENERATION_ERROR;
+  }
+
+  if (java::generate_java(output_file_name, request.input_file_name,
+                          interface.get(), java_types_.get(),
+                          output_delegate, flags, &profile) != 0) {
+    return AidlError::GENERATION_ERROR;
+  }
+  return AidlError::OK;
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_COMPILATION_CONTEXT_H_
+#define AIDL_COMPILATION_CONTEXT_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "aidl.h"
+#include "io_delegate.h"
+#include "type_cpp.h"
+#include "type_java.h"
+
+namespace android {
+namespace aidl {
+
+// Describes a single compile.  This mirrors the command line options of
+// aidl and aidl-cpp, but nothing is written to disk: generated files are
+// returned in a CompileResult keyed by the paths below.
+struct CompileRequest {
+  enum class Language {
+    CPP,
+    JAVA,
+  };
+
+  Language language{Language::JAVA};
+  std::string input_file_name;
+  std::vector<std::string> import_paths;
+  // Java only.
+  std::vector<std::string> preprocessed_files;
+  bool generate_no_op_methods{false};
+  bool generate_traces{false};
+  bool generate_compact{false};  // --compact-java
+  // For Java, the path of the generated .java file.  If empty, the path is
+  // derived from the package and name of the interface or parcelable.
+  // For C++, the path of the generated .cpp file.
+  std::string output_file_name;
+  // Call counts to lay out onTransact() with, or empty for none.  Read like
+  // any other input.
+  std::string dispatch_profile_file_name;
+  // C++ only.  Generated headers are placed under this directory.
+  std::string output_header_dir;
+  bool use_dispatch_table{false};
+  bool generate_async{false};
+  bool generate_coroutines{false};
+  // If set, the size report is returned with the outputs under this path.
+  std::string size_report_file_name;
+  // At most one of these may be set.
+  bool client_only{false};
+  bool server_only{false};
+};
+
+struct CompileResult {
+  AidlError error{AidlError::UNKOWN};
+  // Generated files, keyed by path.
+  std::map<std::string, std::string> outputs;
+  // The input file followed by every import it pulled in.  This is what
+  // would otherwise have been written to a dependency file.
+  std::vector<std::string> dependencies;
+  // Everything the compiler would have printed to stderr.
+  std::string diagnostics;
+
+  bool ok() const { return error == AidlError::OK; }
+};
+
+// Runs compiles in-process and keeps state that is reusable between them.
+// Parsed imports are cached across calls to Compile().  Imports are resolved
+// on every compile and reparsed when their contents change, so the context
+// may be kept alive while files are being edited.
+//
+// Diagnostics are captured by temporarily redirecting std::cerr and the
+// libbase logger, which are process wide.  Compile() may be called from
+// several threads, but compiles then run one at a time, even across
+// contexts.
+class CompilationContext {
+ public:
+  // |io_delegate| is used for all reads and must outlive the context.
+  explicit CompilationContext(const IoDelegate& io_delegate);
+  ~CompilationContext() = default;
+
+  CompileResult Compile(const CompileRequest& request);
+
+  // Drops everything cached from previous compiles.
+  void Clear();
+
+  // Type namespaces used by the most recent compile.  These are rebuilt
+  // for every compile, since validation adds the input interface to them.
+  const cpp::TypeNamespace* CppTypes() const { return cpp_types_.get(); }
+  const java::JavaTypeNamespace* JavaTypes() const {
+    return java_types_.get();
+  }
+
+ private:
+  AidlError CompileCpp(const CompileRequest& request,
+                       const IoDelegate& output_delegate,
+                       std::vector<std::unique_ptr<AidlImport>>* imports);
+  AidlError CompileJava(const CompileRequest& request,
+                        const IoDelegate& output_delegate,
+                        std::vector<std::unique_ptr<AidlImport>>* imports);
+
+  const IoDelegate& io_delegate_;
+  internals::LoadCache cache_;
+  std::unique_ptr<cpp::TypeNamespace> cpp_types_;
+  std::unique_ptr<java::JavaTypeNamespace> java_types_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompilationContext);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_COMPILATION_CONTEXT_H_
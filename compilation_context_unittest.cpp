@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <string>
+
+#include <android-base/logging.h>
+#include <gtest/gtest.h>
+
+#include "compilation_context.h"
+#include "tests/fake_io_delegate.h"
+
+using android::aidl::test::FakeIoDelegate;
+using std::map;
+using std::string;
+using std::unique_ptr;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// Counts how often each file is read.
+class CountingIoDelegate : public FakeIoDelegate {
+ public:
+  unique_ptr<string> GetFileContents(
+      const string& filename,
+      const string& append_content_suffix = "") const override {
+    ++reads_[filename];
+    return FakeIoDelegate::GetFileContents(filename, append_content_suffix);
+  }
+
+  mutable map<string, int> reads_;
+};
+
+}  // namespace
+
+class CompilationContextTest : public ::testing::Test {
+ protected:
+  CompilationContextTest() : context_(io_delegate_) {}
+
+  void SetUp() override {
+    io_delegate_.SetFileContents(
+        "p/IFoo.aidl",
+        "package p; import q.Bar; interface IFoo { void f(in Bar b); }");
+    io_delegate_.AddStubParcelable("q.Bar", "q/Bar.h");
+  }
+
+  CompileRequest JavaRequest() {
+    CompileRequest request;
+    request.language = CompileRequest::Language::JAVA;
+    request.input_file_name = "p/IFoo.aidl";
+    request.import_paths.push_back("");
+    request.output_file_name = "out/p/IFoo.java";
+    return request;
+  }
+
+  CountingIoDelegate io_delegate_;
+  CompilationContext context_;
+};
+
+TEST_F(CompilationContextTest, CompilesJavaInMemory) {
+  CompileResult result = context_.Compile(JavaRequest());
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  ASSERT_EQ(1u, result.outputs.size());
+  EXPECT_NE(string::npos,
+            result.outputs["out/p/IFoo.java"].find("public interface IFoo"));
+  EXPECT_EQ((std::vector<string>{"p/IFoo.aidl", "./q/Bar.aidl"}),
+            result.dependencies);
+  string unused;
+  EXPECT_FALSE(io_delegate_.GetWrittenContents("out/p/IFoo.java", &unused));
+}
+
+TEST_F(CompilationContextTest, DerivesJavaOutputPath) {
+  CompileRequest request = JavaRequest();
+  request.output_file_name = "";
+  CompileResult result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_EQ(1u, result.outputs.count("p/IFoo.java"));
+}
+
+TEST_F(CompilationContextTest, CompilesCppInMemory) {
+  CompileRequest request;
+  request.language = CompileRequest::Language::CPP;
+  request.input_file_name = "p/IFoo.aidl";
+  request.import_paths.push_back("");
+  request.output_file_name = "out/IFoo.cpp";
+  request.output_header_dir = "headers";
+  CompileResult result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_EQ(1u, result.outputs.count("out/IFoo.cpp"));
+  EXPECT_EQ(1u, result.outputs.count("headers/p/IFoo.h"));
+  EXPECT_EQ(1u, result.outputs.count("headers/p/BpFoo.h"));
+  EXPECT_EQ(1u, result.outputs.count("headers/p/BnFoo.h"));
+}
+
+TEST_F(CompilationContextTest, ReturnsCppOutputsThatAreCurrentOnDisk) {
+  CompileRequest request;
+  request.language = CompileRequest::Language::CPP;
+  request.input_file_name = "p/IFoo.aidl";
+  request.import_paths.push_back("");
+  request.output_file_name = "out/IFoo.cpp";
+  request.output_header_dir = "headers";
+  CompileResult first = context_.Compile(request);
+  ASSERT_TRUE(first.ok()) << first.diagnostics;
+
+  // Outputs of an earlier build are on disk, but must still be returned.
+  for (const auto& output : first.outputs) {
+    io_delegate_.SetFileContents(output.first, output.second);
+  }
+  CompileResult second = context_.Compile(request);
+  ASSERT_TRUE(second.ok()) << second.diagnostics;
+  EXPECT_EQ(first.outputs, second.outputs);
+}
+
+TEST_F(CompilationContextTest, PassesCppGeneratorOptions) {
+  io_delegate_.SetFileContents("profile.txt", "f 10\n");
+  CompileRequest request;
+  request.language = CompileRequest::Language::CPP;
+  request.input_file_name = "p/IFoo.aidl";
+  request.import_paths.push_back("");
+  request.output_file_name = "out/IFoo.cpp";
+  request.output_header_dir = "headers";
+  request.dispatch_profile_file_name = "profile.txt";
+  request.size_report_file_name = "out/sizes.json";
+  request.client_only = true;
+  CompileResult result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_NE(string::npos, result.outputs["out/sizes.json"].find("\"f\""));
+  EXPECT_EQ(string::npos,
+            result.outputs["out/IFoo.cpp"].find("BnFoo::onTransact"));
+
+  request.server_only = true;
+  EXPECT_FALSE(context_.Compile(request).ok());
+}
+
+TEST_F(CompilationContextTest, ReadsJavaDispatchProfile) {
+  CompileRequest request = JavaRequest();
+  request.dispatch_profile_file_name = "missing.txt";
+  CompileResult result = context_.Compile(request);
+  EXPECT_FALSE(result.ok());
+  EXPECT_NE(string::npos, result.diagnostics.find("missing.txt"));
+
+  io_delegate_.SetFileContents("profile.txt", "f 10\n");
+  request.dispatch_profile_file_name = "profile.txt";
+  EXPECT_TRUE(context_.Compile(request).ok());
+}
+
+TEST_F(CompilationContextTest, CompilesStructuredParcelables) {
+  io_delegate_.SetFileContents("p/Foo.aidl",
+                               "package p; parcelable Foo { int a; }");
+  CompileRequest request = JavaRequest();
+  request.input_file_name = "p/Foo.aidl";
+  request.output_file_name = "";
+  CompileResult result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_NE(string::npos, result.outputs["p/Foo.java"].find(
+      "public class Foo implements android.os.Parcelable"));
+
+  request.language = CompileRequest::Language::CPP;
+  request.output_file_name = "out/Foo.cpp";
+  request.output_header_dir = "headers";
+  result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_EQ(1u, result.outputs.count("out/Foo.cpp"));
+  EXPECT_EQ(1u, result.outputs.count("headers/p/Foo.h"));
+}
+
+TEST_F(CompilationContextTest, ReturnsDiagnostics) {
+  io_delegate_.SetFileContents("p/IFoo.aidl",
+                               "package p; interface IFoo { void f(in Baz b); }");
+  CompileResult result = context_.Compile(JavaRequest());
+  EXPECT_EQ(AidlError::BAD_TYPE, result.error);
+  EXPECT_TRUE(result.outputs.empty());
+  EXPECT_NE(string::npos, result.diagnostics.find("unknown type"));
+}
+
+TEST_F(CompilationContextTest, ReusesContextAcrossCompiles) {
+  ASSERT_TRUE(context_.Compile(JavaRequest()).ok());
+  ASSERT_TRUE(context_.Compile(JavaRequest()).ok());
+
+  // Edits to a cached import are picked up by the next compile.
+  io_delegate_.SetFileContents("q/Bar.aidl", "package q; parcelable Baz;");
+  CompileResult result = context_.Compile(JavaRequest());
+  EXPECT_EQ(AidlError::BAD_IMPORT, result.error);
+
+  io_delegate_.AddStubParcelable("q.Bar", "q/Bar.h");
+  EXPECT_TRUE(context_.Compile(JavaRequest()).ok());
+}
+
+TEST_F(CompilationContextTest, ReadsEachImportOncePerCompile) {
+  ASSERT_TRUE(context_.Compile(JavaRequest()).ok());
+  EXPECT_EQ(1, io_delegate_.reads_["./q/Bar.aidl"]);
+  ASSERT_TRUE(context_.Compile(JavaRequest()).ok());
+  EXPECT_EQ(2, io_delegate_.reads_["./q/Bar.aidl"]);
+}
+
+TEST_F(CompilationContextTest, ResolvesImportsAgainOnEachCompile) {
+  CompileRequest request = JavaRequest();
+  request.import_paths.insert(request.import_paths.begin(), "first");
+  CompileResult result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_EQ("./q/Bar.aidl", result.dependencies.back());
+
+  // An import that appears in an earlier import path takes precedence.
+  io_delegate_.SetFileContents("first/q/Bar.aidl",
+                               "package q; parcelable Bar;");
+  result = context_.Compile(request);
+  ASSERT_TRUE(result.ok()) << result.diagnostics;
+  EXPECT_EQ("first/q/Bar.aidl", result.dependencies.back());
+}
+
+TEST_F(CompilationContextTest, RestoresPreviousLogger) {
+  string logged;
+  android::base::SetLogger(
+      [&logged](android::base::LogId, android::base::LogSeverity,
+                const char*, const char*, unsigned int, const char* message) {
+        logged += message;
+      });
+  io_delegate_.SetFileContents("p/IFoo.aidl", "package p; interface IFoo {");
+  CompileResult result = context_.Compile(JavaRequest());
+  EXPECT_FALSE(result.ok());
+  EXPECT_TRUE(logged.empty());
+
+  LOG(ERROR) << "after compile";
+  android::base::SetLogger(android::base::StderrLogger);
+  EXPECT_EQ("after compile", logged);
+}
+
+}  // namespace aidl
+}  // namespace android
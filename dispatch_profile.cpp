@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dispatch_profile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+
+#include "line_reader.h"
+#include "logging.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+// IBinder::FIRST_CALL_TRANSACTION, the code of the method with id 0.
+const uint64_t kFirstCallTransaction = 1;
+
+bool ParseCount(const string& text, uint64_t* count) {
+  if (text.empty() || !isdigit(static_cast<unsigned char>(text[0]))) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  const unsigned long long value = strtoull(text.c_str(), &end, 10);
+  if (errno != 0 || *end != '\0') {
+    return false;
+  }
+  *count = value;
+  return true;
+}
+
+}  // namespace
+
+bool DispatchProfile::Load(const string& path, const IoDelegate& io_delegate) {
+  unique_ptr<LineReader> line_reader = io_delegate.GetLineReader(path);
+  if (!line_reader) {
+    LOG(ERROR) << "cannot open dispatch profile: " << path;
+    return false;
+  }
+
+  string line;
+  for (unsigned lineno = 1; line_reader->ReadLine(&line); ++lineno) {
+    std::istringstream fields(line);
+    string transaction;
+    if (!(fields >> transaction) || transaction[0] == '#') {
+      continue;
+    }
+    string count_text, extra;
+    uint64_t count = 0;
+    if (!(fields >> count_text) || (fields >> extra) ||
+        !ParseCount(count_text, &count)) {
+      LOG(ERROR) << path << ":" << lineno
+                 << ": expected \"<transaction> <count>\"";
+      return false;
+    }
+    counts_[transaction] += count;
+  }
+  return true;
+}
+
+uint64_t DispatchProfile::CallCount(const AidlMethod& method) const {
+  uint64_t count = 0;
+  auto it = counts_.find(method.GetName());
+  if (it != counts_.end()) {
+    count += it->second;
+  }
+  it = counts_.find(std::to_string(kFirstCallTransaction + method.GetId()));
+  if (it != counts_.end()) {
+    count += it->second;
+  }
+  return count;
+}
+
+vector<const AidlMethod*> GetHotMethods(const AidlInterface& interface,
+                                        const DispatchProfile* profile) {
+  vector<const AidlMethod*> methods;
+  vector<uint64_t> counts;
+  uint64_t total = 0;
+  for (const auto& method : interface.GetMethods()) {
+    methods.push_back(method);
+    counts.push_back((profile) ? profile->CallCount(*method) : 0);
+    total += counts.back();
+  }
+  if (total == 0) {
+    return methods;
+  }
+
+  vector<size_t> order(methods.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&counts](size_t a, size_t b) {
+    return counts[a] > counts[b];
+  });
+
+  vector<const AidlMethod*> hot;
+  uint64_t covered = 0;
+  for (size_t i : order) {
+    if (covered * 100 >= total * DispatchProfile::kHotCallPercent) {
+      break;
+    }
+    hot.push_back(methods[i]);
+    covered += counts[i];
+  }
+  return hot;
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_DISPATCH_PROFILE_H_
+#define AIDL_DISPATCH_PROFILE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "aidl_language.h"
+#include "io_delegate.h"
+
+namespace android {
+namespace aidl {
+
+// Call counts observed for the transactions of an interface, used to lay out
+// the generated onTransact() with its hot transactions first.
+//
+// A profile is a text file with one "<transaction> <count>" pair per line,
+// where the transaction is either a method name or a decimal transaction code
+// as seen by onTransact().  Blank lines and lines starting with '#' are
+// ignored, as are entries that match no method.
+class DispatchProfile {
+ public:
+  // Share of the profiled calls, in percent, that the hot methods cover.
+  static const int kHotCallPercent = 95;
+
+  DispatchProfile() = default;
+  ~DispatchProfile() = default;
+
+  bool Load(const std::string& path, const IoDelegate& io_delegate);
+
+  uint64_t CallCount(const AidlMethod& method) const;
+
+ private:
+  std::map<std::string, uint64_t> counts_;
+
+  DISALLOW_COPY_AND_ASSIGN(DispatchProfile);
+};
+
+// Returns the fewest methods of |interface| that account for kHotCallPercent
+// of the calls in |profile|, most frequently called first.  Without a
+// profile, or if it has no calls for |interface|, every method is hot and
+// they come in declaration order.
+std::vector<const AidlMethod*> GetHotMethods(const AidlInterface& interface,
+                                             const DispatchProfile* profile);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_DISPATCH_PROFILE_H_
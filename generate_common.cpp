@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "generate_common.h"
+
+#include <algorithm>
+
+namespace android {
+namespace aidl {
+
+size_t DenseTableSize(const AidlInterface& interface) {
+  const auto& methods = interface.GetMethods();
+  int max_id = -1;
+  for (const auto& method : methods) {
+    max_id = std::max(max_id, method->GetId());
+  }
+  const size_t table_size = max_id + 1;
+  if (methods.empty() || table_size > 2 * methods.size()) {
+    return 0;
+  }
+  return table_size;
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_GENERATE_COMMON_H_
+#define AIDL_GENERATE_COMMON_H_
+
+#include <cstddef>
+
+#include "aidl_language.h"
+
+namespace android {
+namespace aidl {
+
+// Settings shared by the C++ and Java generators, which must agree on them
+// for their proxies and stubs to work together.
+
+// Proxies send the @batchable calls they have buffered once there are this
+// many of them, or once they take up this many bytes.
+constexpr size_t kMaxBatchedCalls = 64;
+constexpr size_t kMaxBatchBytes = 16 * 1024;
+
+// Returns the number of slots needed for a table indexed by transaction id,
+// or 0 if such a table would be mostly holes, as happens with sparse,
+// explicitly assigned ids.  Those should be looked up with a switch instead.
+size_t DenseTableSize(const AidlInterface& interface);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_GENERATE_COMMON_H_
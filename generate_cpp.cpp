@@ -16,6 +16,7 @@
 
 #include "generate_cpp.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <memory>
@@ -28,8 +29,13 @@
 #include "aidl_language.h"
 #include "ast_cpp.h"
 #include "code_writer.h"
+#include "dispatch_profile.h"
+#include "generate_common.h"
+#include "line_reader.h"
 #include "logging.h"
 #include "os.h"
+#include "semantic_hash.h"
+#include "wire_size.h"
 
 using android::base::StringPrintf;
 using std::string;
@@ -49,13 +55,28 @@ const char kFlagsVarName[] = "_aidl_flags";
 const char kDataVarName[] = "_aidl_data";
 const char kErrorLabel[] = "_aidl_error";
 const char kImplVarName[] = "_aidl_impl";
+const char kParcelVarName[] = "_aidl_parcel";
 const char kReplyVarName[] = "_aidl_reply";
 const char kReturnVarName[] = "_aidl_return";
+const char kSelfVarName[] = "_aidl_self";
 const char kStatusVarName[] = "_aidl_status";
 const char kAndroidParcelLiteral[] = "::android::Parcel";
 const char kAndroidStatusLiteral[] = "::android::status_t";
 const char kAndroidStatusOk[] = "::android::OK";
 const char kBinderStatusLiteral[] = "::android::binder::Status";
+const char kAsyncExecutorLiteral[] = "::android::aidl::AsyncExecutor";
+const char kAsyncExecutorHeader[] = "aidl/async_executor.h";
+const char kStatusAwaitableHeader[] = "aidl/status_awaitable.h";
+const char kStatusAwaitableLiteral[] =
+    "::android::aidl::StatusAwaitable<::android::binder::Status>";
+const char kCoroutinesGuard[] = "AIDL_HAS_COROUTINES";
+const char kCallbackVarName[] = "_aidl_callback";
+const char kExecutorVarName[] = "_aidl_executor";
+const char kRemoteVarName[] = "_aidl_remote";
+const char kBatchVarName[] = "_aidl_batch_";
+const char kBatchMutexVarName[] = "_aidl_batch_mutex_";
+const char kBatchedCallsVarName[] = "_aidl_batched_calls_";
+const char kBatchCode[] = "AIDL_BATCH";
 const char kIBinderHeader[] = "binder/IBinder.h";
 const char kIInterfaceHeader[] = "binder/IInterface.h";
 const char kParcelHeader[] = "binder/Parcel.h";
@@ -87,6 +108,30 @@ unique_ptr<AstNode> ReturnOnStatusNotOk() {
   return unique_ptr<AstNode>(ret);
 }
 
+unique_ptr<AstNode> ReturnIf(const string& condition, const string& value) {
+  IfStatement* ret = new IfStatement(new LiteralExpression(condition));
+  ret->OnTrue()->AddLiteral("return " + value);
+  return unique_ptr<AstNode>(ret);
+}
+
+// Builds the call of |method|, one of |type|'s parcel methods, that reads or
+// writes |arg| through |parcel|.  |parcel| is a Parcel* if |parcel_is_pointer|
+// and a Parcel otherwise.
+MethodCall* BuildParcelCall(const Type& type, const string& method,
+                            const string& parcel, bool parcel_is_pointer,
+                            const string& arg) {
+  if (type.UsesParcelHelpers()) {
+    return new MethodCall(
+        method,
+        ArgList(vector<string>{(parcel_is_pointer) ? parcel : "&" + parcel,
+                               arg}));
+  }
+  return new MethodCall(StringPrintf("%s%s%s", parcel.c_str(),
+                                     (parcel_is_pointer) ? "->" : ".",
+                                     method.c_str()),
+                        ArgList(arg));
+}
+
 string UpperCase(const std::string& s) {
   string result = s;
   for (char& c : result)
@@ -102,12 +147,12 @@ string BuildVarName(const AidlArgument& a) {
   return prefix + a.GetName();
 }
 
-ArgList BuildArgList(const TypeNamespace& types,
-                     const AidlMethod& method,
-                     bool for_declaration) {
+vector<string> BuildArgs(const TypeNamespace& types,
+                         const AidlMethod& method,
+                         bool for_declaration) {
   // Build up the argument list for the server method call.
   vector<string> method_arguments;
-  for (const unique_ptr<AidlArgument>& a : method.GetArguments()) {
+  for (const AidlArgument* a : method.GetArguments()) {
     string literal;
     if (for_declaration) {
       // Method declarations need types, pointers to out params, and variable
@@ -148,7 +193,13 @@ ArgList BuildArgList(const TypeNamespace& types,
     method_arguments.push_back(literal);
   }
 
-  return ArgList(method_arguments);
+  return method_arguments;
+}
+
+ArgList BuildArgList(const TypeNamespace& types,
+                     const AidlMethod& method,
+                     bool for_declaration) {
+  return ArgList(BuildArgs(types, method, for_declaration));
 }
 
 unique_ptr<Declaration> BuildMethodDecl(const AidlMethod& method,
@@ -221,15 +272,16 @@ string ClassName(const AidlInterface& interface, ClassNames type) {
     case ClassNames::INTERFACE:
       c_name = "I" + c_name;
       break;
+    case ClassNames::FORWARD:
+      c_name = "I" + c_name + "Fwd";
+      break;
     case ClassNames::BASE:
       break;
   }
   return c_name;
 }
 
-string BuildHeaderGuard(const AidlInterface& interface,
-                        ClassNames header_type) {
-  string class_name = ClassName(interface, header_type);
+string BuildHeaderGuard(const string& package, string class_name) {
   for (size_t i = 1; i < class_name.size(); ++i) {
     if (isupper(class_name[i])) {
       class_name.insert(i, "_");
@@ -237,7 +289,7 @@ string BuildHeaderGuard(const AidlInterface& interface,
     }
   }
   string ret = StringPrintf("AIDL_GENERATED_%s_%s_H_",
-                            interface.GetPackage().c_str(),
+                            package.c_str(),
                             class_name.c_str());
   for (char& c : ret) {
     if (c == '.') {
@@ -248,27 +300,67 @@ string BuildHeaderGuard(const AidlInterface& interface,
   return ret;
 }
 
-unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
-                                                const AidlInterface& interface,
-                                                const AidlMethod& method) {
-  const string i_name = ClassName(interface, ClassNames::INTERFACE);
-  const string bp_name = ClassName(interface, ClassNames::CLIENT);
-  unique_ptr<MethodImpl> ret{new MethodImpl{
-      kBinderStatusLiteral, bp_name, method.GetName(),
-      ArgList{BuildArgList(types, method, true /* for method decl */)}}};
-  StatementBlock* b = ret->GetStatementBlock();
+string BuildHeaderGuard(const AidlInterface& interface,
+                        ClassNames header_type) {
+  return BuildHeaderGuard(interface.GetPackage(),
+                          ClassName(interface, header_type));
+}
 
-  // Declare parcels to hold our query and the response.
-  b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kDataVarName));
-  // Even if we're oneway, the transact method still takes a parcel.
-  b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kReplyVarName));
+// Returns the name of the constant IFoo declares for one of the wire size
+// bounds of |method|, e.g. PING_REQUEST_MIN_SIZE.
+string WireSizeConstant(const AidlMethod& method, const char* bound) {
+  return StringPrintf("%s_%s_SIZE", UpperCase(method.GetName()).c_str(),
+                      bound);
+}
 
-  // Declare the status_t variable we need for error handling.
-  b->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
-                             kAndroidStatusVarName,
-                             kAndroidStatusOk));
-  // We unconditionally return a Status object.
-  b->AddLiteral(StringPrintf("%s %s", kBinderStatusLiteral, kStatusVarName));
+// Returns the types of every argument and return value of |interface|.
+vector<const Type*> GetMethodTypes(const AidlInterface& interface) {
+  vector<const Type*> ret;
+  for (const auto& method : interface.GetMethods()) {
+    for (const auto& argument : method->GetArguments()) {
+      ret.push_back(argument->GetType().GetLanguageType<Type>());
+    }
+    ret.push_back(method->GetType().GetLanguageType<Type>());
+  }
+  return ret;
+}
+
+// Returns the headers defining the classes IFoo.h only forward declares,
+// which implementations of its methods need.
+vector<string> GetForwardDeclaredHeaders(const AidlInterface& interface) {
+  set<string> declaration_headers;
+  set<string> headers;
+  ForwardDeclarations classes;
+  for (const Type* type : GetMethodTypes(interface)) {
+    type->GetDeclarationHeaders(&declaration_headers, &classes);
+    type->GetHeaders(&headers);
+  }
+  vector<string> ret;
+  for (const string& header : headers) {
+    if (declaration_headers.count(header) == 0) {
+      ret.push_back(header);
+    }
+  }
+  return ret;
+}
+
+// Sends any pending batch before another call, so that calls reach the
+// service in the order they were made.
+void AddFlushBatch(StatementBlock* b) {
+  b->AddStatement(new Assignment(kAndroidStatusVarName, "_aidl_flushBatch()"));
+  b->AddStatement(GotoErrorOnBadStatus());
+}
+
+// Writes the interface token and every "in" argument into _aidl_data,
+// jumping to _aidl_error on failure.
+void AddWriteRequest(const AidlInterface& interface, const AidlMethod& method,
+                     StatementBlock* b) {
+  // Size the request once, up front, rather than growing it write by write.
+  const WireSize request = GetMethodWireSize(interface, method).request;
+  b->AddLiteral(StringPrintf(
+      "%s.setDataCapacity(%s)", kDataVarName,
+      WireSizeConstant(method, (request.IsBounded()) ? "REQUEST_MAX"
+                                                     : "REQUEST_MIN").c_str()));
 
   // Add the name of the interface we're hoping to call.
   b->AddStatement(new Assignment(
@@ -289,10 +381,20 @@ unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
     var_name = type->WriteCast(var_name);
     b->AddStatement(new Assignment(
         kAndroidStatusVarName,
-        new MethodCall(StringPrintf("%s.%s", kDataVarName, method.c_str()),
-                       ArgList(var_name))));
+        BuildParcelCall(*type, method, kDataVarName, false, var_name)));
     b->AddStatement(GotoErrorOnBadStatus());
   }
+}
+
+// Sends _aidl_data to |remote| and reads the reply into the return value and
+// "out" arguments, then returns the resulting Status.  |b| must already
+// declare the reply parcel and the status variables.
+void AddTransactAndReadReply(const TypeNamespace& types,
+                             const AidlInterface& interface,
+                             const AidlMethod& method,
+                             const string& remote,
+                             StatementBlock* b) {
+  const string i_name = ClassName(interface, ClassNames::INTERFACE);
 
   // Invoke the transaction on the remote binder and confirm status.
   string transaction_code = StringPrintf(
@@ -307,10 +409,9 @@ unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
 
   b->AddStatement(new Assignment(
       kAndroidStatusVarName,
-      new MethodCall("remote()->transact",
+      new MethodCall(remote + "->transact",
                      ArgList(args))));
   b->AddStatement(GotoErrorOnBadStatus());
-
   if (!interface.IsOneway() && !method.IsOneway()) {
     // Strip off the exception header and fail if we see a remote exception.
     // _aidl_ret_status = _aidl_status.readFromParcel(_aidl_reply);
@@ -333,12 +434,10 @@ unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
   // If the method is expected to return something, read it first by convention.
   const Type* return_type = method.GetType().GetLanguageType<Type>();
   if (return_type != types.VoidType()) {
-    string method_call = return_type->ReadFromParcelMethod();
     b->AddStatement(new Assignment(
         kAndroidStatusVarName,
-        new MethodCall(StringPrintf("%s.%s", kReplyVarName,
-                                    method_call.c_str()),
-                       ArgList(kReturnVarName))));
+        BuildParcelCall(*return_type, return_type->ReadFromParcelMethod(),
+                        kReplyVarName, false, kReturnVarName)));
     b->AddStatement(GotoErrorOnBadStatus());
   }
 
@@ -346,14 +445,12 @@ unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
     // Deserialization looks roughly like:
     //     _aidl_ret_status = _aidl_reply.ReadInt32(out_param_name);
     //     if (_aidl_status != ::android::OK) { goto _aidl_error; }
-    string method =
-      a->GetType().GetLanguageType<Type>()->ReadFromParcelMethod();
+    const Type* type = a->GetType().GetLanguageType<Type>();
 
     b->AddStatement(new Assignment(
         kAndroidStatusVarName,
-        new MethodCall(StringPrintf("%s.%s", kReplyVarName,
-                                    method.c_str()),
-                       ArgList(a->GetName()))));
+        BuildParcelCall(*type, type->ReadFromParcelMethod(), kReplyVarName,
+                        false, a->GetName())));
     b->AddStatement(GotoErrorOnBadStatus());
   }
 
@@ -368,48 +465,471 @@ unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
                    kAndroidStatusVarName));
   b->AddLiteral(StringPrintf("return %s", kStatusVarName));
 
+}
+
+unique_ptr<Declaration> DefineClientTransaction(const TypeNamespace& types,
+                                                const AidlInterface& interface,
+                                                const AidlMethod& method) {
+  const string bp_name = ClassName(interface, ClassNames::CLIENT);
+  unique_ptr<MethodImpl> ret{new MethodImpl{
+      kBinderStatusLiteral, bp_name, method.GetName(),
+      ArgList{BuildArgList(types, method, true /* for method decl */)}}};
+  StatementBlock* b = ret->GetStatementBlock();
+
+  // Declare parcels to hold our query and the response.
+  b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kDataVarName));
+  // Even if we're oneway, the transact method still takes a parcel.
+  if (!method.IsBatchable()) {
+    b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kReplyVarName));
+  }
+
+  // Declare the status_t variable we need for error handling.
+  b->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                             kAndroidStatusVarName,
+                             kAndroidStatusOk));
+  // We unconditionally return a Status object.
+  b->AddLiteral(StringPrintf("%s %s", kBinderStatusLiteral, kStatusVarName));
+
+  if (interface.HasBatchableMethods() && !method.IsBatchable()) {
+    AddFlushBatch(b);
+  }
+  AddWriteRequest(interface, method, b);
+  if (!method.IsBatchable()) {
+    AddTransactAndReadReply(types, interface, method, "remote()", b);
+    return unique_ptr<Declaration>(ret.release());
+  }
+
+  // Batched calls are appended to the pending batch instead of being sent.
+  b->AddStatement(new Assignment(
+      kAndroidStatusVarName,
+      StringPrintf("_aidl_batchCall(%s::%s, %s)",
+                   ClassName(interface, ClassNames::INTERFACE).c_str(),
+                   UpperCase(method.GetName()).c_str(), kDataVarName)));
+  b->AddLiteral(StringPrintf("%s:\n", kErrorLabel), false /* no semicolon */);
+  b->AddLiteral(
+      StringPrintf("%s.setFromStatusT(%s)", kStatusVarName,
+                   kAndroidStatusVarName));
+  b->AddLiteral(StringPrintf("return %s", kStatusVarName));
   return unique_ptr<Declaration>(ret.release());
 }
 
-}  // namespace
+// Defines the members of BpFoo that buffer @batchable calls: a destructor
+// and flushBatch(), which send whatever is pending, and the private helpers
+// behind them.  A batch is the interface token followed by each call's code,
+// size and request parcel, and goes out as a single oneway transaction.
+void AddClientBatchDecls(const AidlInterface& interface,
+                         vector<unique_ptr<Declaration>>* decls) {
+  const string bp_name = ClassName(interface, ClassNames::CLIENT);
+  const string i_name = ClassName(interface, ClassNames::INTERFACE);
 
-unique_ptr<Document> BuildClientSource(const TypeNamespace& types,
-                                       const AidlInterface& interface) {
+  // Calls still pending when the proxy goes away are sent rather than lost.
+  decls->emplace_back(new LiteralDecl{StringPrintf(
+      "%s::~%s() {\n"
+      "_aidl_flushBatch();\n"
+      "}\n",
+      bp_name.c_str(), bp_name.c_str())});
+
+  unique_ptr<MethodImpl> flush{new MethodImpl{
+      kBinderStatusLiteral, bp_name, "flushBatch", ArgList{}}};
+  flush->GetStatementBlock()->AddLiteral(StringPrintf(
+      "return %s::fromStatusT(_aidl_flushBatch())", kBinderStatusLiteral));
+  decls->push_back(std::move(flush));
+
+  unique_ptr<MethodImpl> locked_flush{new MethodImpl{
+      kAndroidStatusLiteral, bp_name, "_aidl_flushBatch", ArgList{}}};
+  StatementBlock* b = locked_flush->GetStatementBlock();
+  b->AddLiteral(StringPrintf("::std::lock_guard<::std::mutex> _aidl_lock(%s)",
+                             kBatchMutexVarName));
+  b->AddLiteral("return _aidl_sendBatch()");
+  decls->push_back(std::move(locked_flush));
+
+  // Appends a call to the batch, sending the batch once it is full.  On
+  // failure the batch is left as it was.
+  unique_ptr<MethodImpl> batch_call{new MethodImpl{
+      kAndroidStatusLiteral, bp_name, "_aidl_batchCall",
+      ArgList{{StringPrintf("uint32_t %s", kCodeVarName),
+               StringPrintf("const %s& %s", kAndroidParcelLiteral,
+                            kDataVarName)}}}};
+  b = batch_call->GetStatementBlock();
+  b->AddLiteral(StringPrintf("::std::lock_guard<::std::mutex> _aidl_lock(%s)",
+                             kBatchMutexVarName));
+  b->AddLiteral(StringPrintf("const size_t _aidl_start = %s.dataSize()",
+                             kBatchVarName));
+  b->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                             kAndroidStatusVarName, kAndroidStatusOk));
+  IfStatement* first_call =
+      new IfStatement(new LiteralExpression(StringPrintf(
+          "%s == 0", kBatchedCallsVarName)));
+  b->AddStatement(first_call);
+  first_call->OnTrue()->AddStatement(new Assignment(
+      kAndroidStatusVarName,
+      StringPrintf("%s.writeInterfaceToken(getInterfaceDescriptor())",
+                   kBatchVarName)));
+  first_call->OnTrue()->AddStatement(GotoErrorOnBadStatus());
+  for (const string& write : {
+           StringPrintf("%s.writeInt32(static_cast<int32_t>(%s))",
+                        kBatchVarName, kCodeVarName),
+           StringPrintf("%s.writeInt32(static_cast<int32_t>(%s.dataSize()))",
+                        kBatchVarName, kDataVarName),
+           StringPrintf("%s.appendFrom(&%s, 0, %s.dataSize())", kBatchVarName,
+                        kDataVarName, kDataVarName)}) {
+    b->AddStatement(new Assignment(kAndroidStatusVarName, write));
+    b->AddStatement(GotoErrorOnBadStatus());
+  }
+  IfStatement* full = new IfStatement(new LiteralExpression(StringPrintf(
+      "++%s >= %zu || %s.dataSize() >= %zu", kBatchedCallsVarName,
+      kMaxBatchedCalls, kBatchVarName, kMaxBatchBytes)));
+  b->AddStatement(full);
+  full->OnTrue()->AddLiteral("return _aidl_sendBatch()");
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+  b->AddLiteral(StringPrintf("%s:\n", kErrorLabel), false /* no semicolon */);
+  b->AddLiteral(StringPrintf("%s.setDataSize(_aidl_start)", kBatchVarName));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusVarName));
+  decls->push_back(std::move(batch_call));
+
+  // Sends the batch, if there is one.  Expects the batch mutex to be held.
+  unique_ptr<MethodImpl> send{new MethodImpl{
+      kAndroidStatusLiteral, bp_name, "_aidl_sendBatch", ArgList{}}};
+  b = send->GetStatementBlock();
+  IfStatement* empty = new IfStatement(new LiteralExpression(StringPrintf(
+      "%s == 0", kBatchedCallsVarName)));
+  b->AddStatement(empty);
+  empty->OnTrue()->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+  b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kReplyVarName));
+  b->AddLiteral(StringPrintf(
+      "%s %s = remote()->transact(%s::%s, %s, &%s, "
+      "::android::IBinder::FLAG_ONEWAY)",
+      kAndroidStatusLiteral, kAndroidStatusVarName, i_name.c_str(),
+      kBatchCode, kBatchVarName, kReplyVarName));
+  b->AddLiteral(StringPrintf("%s.freeData()", kBatchVarName));
+  b->AddLiteral(StringPrintf("%s = 0", kBatchedCallsVarName));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusVarName));
+  decls->push_back(std::move(send));
+}
+
+// The names of the "out" arguments and return value of |method|, which
+// outlive the call to an ...Async() method and are filled in by the
+// transaction it starts.
+vector<string> AsyncResultNames(const TypeNamespace& types,
+                                const AidlMethod& method) {
+  vector<string> names;
+  for (const AidlArgument* a : method.GetOutArguments()) {
+    names.push_back(a->GetName());
+  }
+  if (method.GetType().GetLanguageType<Type>() != types.VoidType()) {
+    names.push_back(kReturnVarName);
+  }
+  return names;
+}
+
+string JoinArgs(const vector<string>& args) {
+  string joined;
+  for (const string& arg : args) {
+    if (!joined.empty()) { joined += ", "; }
+    joined += arg;
+  }
+  return joined;
+}
+
+// Asynchronous calls marshal their request on the calling thread, and run
+// this on the executor to perform the transaction and read the reply.
+unique_ptr<Declaration> DefineClientAsyncTransact(
+    const TypeNamespace& types,
+    const AidlInterface& interface,
+    const AidlMethod& method) {
+  vector<string> params{
+      StringPrintf("const ::android::sp<::android::IBinder>& %s",
+                   kRemoteVarName),
+      StringPrintf("const %s& %s", kAndroidParcelLiteral, kDataVarName)};
+  for (const AidlArgument* a : method.GetOutArguments()) {
+    params.push_back(StringPrintf(
+        "%s* %s", a->GetType().GetLanguageType<Type>()->CppType().c_str(),
+        a->GetName().c_str()));
+  }
+  const Type* return_type = method.GetType().GetLanguageType<Type>();
+  if (return_type != types.VoidType()) {
+    params.push_back(StringPrintf("%s* %s", return_type->CppType().c_str(),
+                                  kReturnVarName));
+  }
+
+  unique_ptr<MethodImpl> ret{new MethodImpl{
+      string("static ") + kBinderStatusLiteral, "",
+      "_aidl_transact_" + method.GetName(), ArgList{params}}};
+  StatementBlock* b = ret->GetStatementBlock();
+  b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kReplyVarName));
+  b->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                             kAndroidStatusVarName,
+                             kAndroidStatusOk));
+  b->AddLiteral(StringPrintf("%s %s", kBinderStatusLiteral, kStatusVarName));
+  AddTransactAndReadReply(types, interface, method, kRemoteVarName, b);
+  return unique_ptr<Declaration>(ret.release());
+}
+
+// The callback flavor of an ...Async() method.  |_aidl_callback| is always
+// invoked on the executor, including when the request cannot be written.
+unique_ptr<Declaration> DefineClientAsyncCallbackMethod(
+    const TypeNamespace& types,
+    const AidlInterface& interface,
+    const AidlMethod& method) {
+  const string bp_name = ClassName(interface, ClassNames::CLIENT);
+  vector<string> params = BuildArgs(types, method, true /* for method decl */);
+  params.push_back(StringPrintf("::std::function<void(%s)> %s",
+                                kBinderStatusLiteral, kCallbackVarName));
+  unique_ptr<MethodImpl> ret{new MethodImpl{
+      "void", bp_name, method.GetName() + "Async", ArgList{params}}};
+  StatementBlock* b = ret->GetStatementBlock();
+
+  // The request parcel is shared with the task that sends it.  All
+  // declarations come first so that the gotos below skip none of them.
+  b->AddLiteral(StringPrintf(
+      "::std::shared_ptr<%s> _aidl_request = ::std::make_shared<%s>()",
+      kAndroidParcelLiteral, kAndroidParcelLiteral));
+  b->AddLiteral(StringPrintf("%s& %s = *_aidl_request",
+                             kAndroidParcelLiteral, kDataVarName));
+  b->AddLiteral(StringPrintf("::android::sp<::android::IBinder> %s = remote()",
+                             kRemoteVarName));
+  b->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                             kAndroidStatusVarName,
+                             kAndroidStatusOk));
+
+  if (interface.HasBatchableMethods()) {
+    AddFlushBatch(b);
+  }
+  AddWriteRequest(interface, method, b);
+
+  vector<string> captures{kRemoteVarName, "_aidl_request"};
+  vector<string> transact_args{kRemoteVarName, "*_aidl_request"};
+  for (const string& name : AsyncResultNames(types, method)) {
+    captures.push_back(name);
+    transact_args.push_back(name);
+  }
+  captures.push_back(kCallbackVarName);
+  b->AddLiteral(StringPrintf(
+      "%s->Post([%s]() {\n"
+      "%s(_aidl_transact_%s(%s));\n"
+      "})",
+      kExecutorVarName, JoinArgs(captures).c_str(),
+      kCallbackVarName, method.GetName().c_str(),
+      JoinArgs(transact_args).c_str()));
+  b->AddLiteral("return");
+
+  b->AddLiteral(StringPrintf("%s:\n", kErrorLabel), false /* no semicolon */);
+  b->AddLiteral(StringPrintf(
+      "%s->Post([%s, %s]() {\n"
+      "%s(%s::fromStatusT(%s));\n"
+      "})",
+      kExecutorVarName, kCallbackVarName, kAndroidStatusVarName,
+      kCallbackVarName, kBinderStatusLiteral, kAndroidStatusVarName));
+
+  return unique_ptr<Declaration>(ret.release());
+}
+
+// The future flavor of an ...Async() method, implemented on top of the
+// callback flavor.
+unique_ptr<Declaration> DefineClientAsyncFutureMethod(
+    const TypeNamespace& types,
+    const AidlInterface& interface,
+    const AidlMethod& method) {
+  const string bp_name = ClassName(interface, ClassNames::CLIENT);
+  const string promise_type =
+      StringPrintf("::std::promise<%s>", kBinderStatusLiteral);
+  unique_ptr<MethodImpl> ret{new MethodImpl{
+      StringPrintf("::std::future<%s>", kBinderStatusLiteral), bp_name,
+      method.GetName() + "Async",
+      ArgList{BuildArgs(types, method, true /* for method decl */)}}};
+  StatementBlock* b = ret->GetStatementBlock();
+
+  b->AddLiteral(StringPrintf(
+      "::std::shared_ptr<%s> _aidl_promise = ::std::make_shared<%s>()",
+      promise_type.c_str(), promise_type.c_str()));
+  vector<string> args;
+  for (const AidlArgument* a : method.GetArguments()) {
+    args.push_back(a->GetName());
+  }
+  if (method.GetType().GetLanguageType<Type>() != types.VoidType()) {
+    args.push_back(kReturnVarName);
+  }
+  args.push_back(StringPrintf(
+      "[_aidl_promise](%s %s) {\n"
+      "_aidl_promise->set_value(%s);\n"
+      "}",
+      kBinderStatusLiteral, kStatusVarName, kStatusVarName));
+  b->AddLiteral(StringPrintf("%sAsync(%s)", method.GetName().c_str(),
+                             JoinArgs(args).c_str()));
+  b->AddLiteral("return _aidl_promise->get_future()");
+
+  return unique_ptr<Declaration>(ret.release());
+}
+
+// The co_await flavor of an ...Async() method, also implemented on top of
+// the callback flavor so that errors map to a Status the same way.
+unique_ptr<Declaration> DefineClientCoroutineMethod(
+    const TypeNamespace& types,
+    const AidlInterface& interface,
+    const AidlMethod& method) {
+  const string bp_name = ClassName(interface, ClassNames::CLIENT);
+  unique_ptr<MethodImpl> ret{new MethodImpl{
+      kStatusAwaitableLiteral, bp_name, method.GetName() + "Co",
+      ArgList{BuildArgs(types, method, true /* for method decl */)}}};
+  StatementBlock* b = ret->GetStatementBlock();
+
+  b->AddLiteral(StringPrintf("%s _aidl_awaitable", kStatusAwaitableLiteral));
+  vector<string> args;
+  for (const AidlArgument* a : method.GetArguments()) {
+    args.push_back(a->GetName());
+  }
+  if (method.GetType().GetLanguageType<Type>() != types.VoidType()) {
+    args.push_back(kReturnVarName);
+  }
+  args.push_back("_aidl_awaitable.Completer()");
+  b->AddLiteral(StringPrintf("%sAsync(%s)", method.GetName().c_str(),
+                             JoinArgs(args).c_str()));
+  b->AddLiteral("return _aidl_awaitable");
+
+  return unique_ptr<Declaration>(ret.release());
+}
+
+// Coroutine support is optional in the compiler building the generated code,
+// so the ...Co() methods are only declared where it is available.
+void AddGuardedByCoroutineSupport(unique_ptr<Declaration> decl,
+                                  vector<unique_ptr<Declaration>>* decls) {
+  decls->emplace_back(
+      new LiteralDecl{StringPrintf("#ifdef %s\n", kCoroutinesGuard)});
+  decls->push_back(std::move(decl));
+  decls->emplace_back(
+      new LiteralDecl{StringPrintf("#endif  // %s\n", kCoroutinesGuard)});
+}
+
+bool HasAsyncMethod(const AidlInterface& interface, const AidlMethod& method) {
+  return !interface.IsOneway() && !method.IsOneway();
+}
+
+// When streaming, writes out and frees everything built so far.
+void Flush(StreamingCppSource* stream,
+           vector<unique_ptr<Declaration>>* decls) {
+  if (stream) {
+    stream->Write(decls);
+  }
+}
+
+vector<string> ClientSourceIncludes(const AidlInterface& interface) {
   vector<string> include_list = {
       HeaderFile(interface, ClassNames::CLIENT, false),
       kParcelHeader
   };
-  vector<unique_ptr<Declaration>> file_decls;
+  for (const string& header : GetForwardDeclaredHeaders(interface)) {
+    include_list.push_back(header);
+  }
+  return include_list;
+}
+
+// Adds the definitions of BpFoo to |file_decls|, flushing them to |stream|, if
+// any, a method at a time.
+bool AddClientDecls(const TypeNamespace& types,
+                    const AidlInterface& interface,
+                    bool generate_async,
+                    bool generate_coroutines,
+                    StreamingCppSource* stream,
+                    vector<unique_ptr<Declaration>>* file_decls) {
 
   // The constructor just passes the IBinder instance up to the super
   // class.
   const string i_name = ClassName(interface, ClassNames::INTERFACE);
-  file_decls.push_back(unique_ptr<Declaration>{new ConstructorImpl{
+  file_decls->push_back(unique_ptr<Declaration>{new ConstructorImpl{
       ClassName(interface, ClassNames::CLIENT),
       ArgList{StringPrintf("const ::android::sp<::android::IBinder>& %s",
                            kImplVarName)},
       { "BpInterface<" + i_name + ">(" + kImplVarName + ")" }}});
 
+  if (interface.HasBatchableMethods()) {
+    AddClientBatchDecls(interface, file_decls);
+  }
+
   // Clients define a method per transaction.
   for (const auto& method : interface.GetMethods()) {
+    Flush(stream, file_decls);
     unique_ptr<Declaration> m = DefineClientTransaction(
         types, interface, *method);
-    if (!m) { return nullptr; }
-    file_decls.push_back(std::move(m));
+    if (!m) { return false; }
+    file_decls->push_back(std::move(m));
+
+    if (generate_async && HasAsyncMethod(interface, *method)) {
+      file_decls->push_back(
+          DefineClientAsyncTransact(types, interface, *method));
+      file_decls->push_back(
+          DefineClientAsyncCallbackMethod(types, interface, *method));
+      file_decls->push_back(
+          DefineClientAsyncFutureMethod(types, interface, *method));
+      if (generate_coroutines) {
+        AddGuardedByCoroutineSupport(
+            DefineClientCoroutineMethod(types, interface, *method),
+            file_decls);
+      }
+    }
+  }
+
+  if (generate_async) {
+    unique_ptr<MethodImpl> set_executor{new MethodImpl{
+        "void", ClassName(interface, ClassNames::CLIENT), "setAsyncExecutor",
+        ArgList{StringPrintf("%s* executor", kAsyncExecutorLiteral)}}};
+    set_executor->GetStatementBlock()->AddLiteral(
+        StringPrintf("%s = executor", kExecutorVarName));
+    file_decls->push_back(std::move(set_executor));
+  }
+  Flush(stream, file_decls);
+  return true;
+}
+
+}  // namespace
+
+unique_ptr<Document> BuildClientSource(const TypeNamespace& types,
+                                       const AidlInterface& interface,
+                                       bool generate_async,
+                                       bool generate_coroutines) {
+  vector<unique_ptr<Declaration>> file_decls;
+  if (!AddClientDecls(types, interface, generate_async, generate_coroutines,
+                      nullptr, &file_decls)) {
+    return nullptr;
   }
   return unique_ptr<Document>{new CppSource{
-      include_list,
+      ClientSourceIncludes(interface),
       NestInNamespaces(std::move(file_decls), interface.GetSplitPackage())}};
 }
 
+bool StreamClientSource(const TypeNamespace& types,
+                        const AidlInterface& interface,
+                        bool generate_async,
+                        bool generate_coroutines,
+                        CodeWriter* to) {
+  StreamingCppSource stream{to, ClientSourceIncludes(interface),
+                            interface.GetSplitPackage()};
+  vector<unique_ptr<Declaration>> file_decls;
+  const bool success = AddClientDecls(types, interface, generate_async,
+                                      generate_coroutines, &stream,
+                                      &file_decls);
+  stream.Finish();
+  return success;
+}
+
 namespace {
 
+// Writes the body of a server transaction into |b|.  By default the body is
+// a case of the switch in onTransact, and bails out with a break.  With
+// |in_handler| it is instead the body of a free standing dispatch handler,
+// which returns on error and reaches the implementation through |kSelfVarName|.
 bool HandleServerTransaction(const TypeNamespace& types,
                              const AidlMethod& method,
-                             StatementBlock* b) {
+                             StatementBlock* b,
+                             bool in_handler = false) {
+  const string bail = (in_handler)
+      ? StringPrintf("return %s", kAndroidStatusVarName)
+      : "break";
+  auto bail_on_status_not_ok = (in_handler) ? ReturnOnStatusNotOk
+                                            : BreakOnStatusNotOk;
+
   // Declare all the parameters now.  In the common case, we expect no errors
   // in serialization.
-  for (const unique_ptr<AidlArgument>& a : method.GetArguments()) {
+  for (const AidlArgument* a : method.GetArguments()) {
     if (!DeclareLocalVariable(types, *a, b)) { return false; }
   }
 
@@ -424,12 +944,13 @@ bool HandleServerTransaction(const TypeNamespace& types,
   // Check that the client is calling the correct interface.
   IfStatement* interface_check = new IfStatement(
       new MethodCall(StringPrintf("%s.checkInterface",
-                                  kDataVarName), "this"),
+                                  kDataVarName),
+                     (in_handler) ? kSelfVarName : "this"),
       true /* invert the check */);
   b->AddStatement(interface_check);
   interface_check->OnTrue()->AddStatement(
       new Assignment(kAndroidStatusVarName, "::android::BAD_TYPE"));
-  interface_check->OnTrue()->AddLiteral("break");
+  interface_check->OnTrue()->AddLiteral(bail);
 
   // Deserialize each "in" parameter to the transaction.
   for (const AidlArgument* a : method.GetInArguments()) {
@@ -437,19 +958,20 @@ bool HandleServerTransaction(const TypeNamespace& types,
     //     _aidl_ret_status = _aidl_data.ReadInt32(&in_param_name);
     //     if (_aidl_ret_status != ::android::OK) { break; }
     const Type* type = a->GetType().GetLanguageType<Type>();
-    string readMethod = type->ReadFromParcelMethod();
 
     b->AddStatement(new Assignment{
         kAndroidStatusVarName,
-        new MethodCall{string(kDataVarName) + "." + readMethod,
-                       "&" + BuildVarName(*a)}});
-    b->AddStatement(BreakOnStatusNotOk());
+        BuildParcelCall(*type, type->ReadFromParcelMethod(), kDataVarName,
+                        false, "&" + BuildVarName(*a))});
+    b->AddStatement(bail_on_status_not_ok());
   }
 
   // Call the actual method.  This is implemented by the subclass.
   vector<unique_ptr<AstNode>> status_args;
   status_args.emplace_back(new MethodCall(
-          method.GetName(),
+          (in_handler)
+              ? StringPrintf("%s->%s", kSelfVarName, method.GetName().c_str())
+              : method.GetName(),
           BuildArgList(types, method, false /* not for method decl */)));
   b->AddStatement(new Statement(new MethodCall(
       StringPrintf("%s %s", kBinderStatusLiteral, kStatusVarName),
@@ -460,22 +982,21 @@ bool HandleServerTransaction(const TypeNamespace& types,
     b->AddStatement(new Assignment(
         kAndroidStatusVarName,
         StringPrintf("%s.writeToParcel(%s)", kStatusVarName, kReplyVarName)));
-    b->AddStatement(BreakOnStatusNotOk());
+    b->AddStatement(bail_on_status_not_ok());
     IfStatement* exception_check = new IfStatement(
         new LiteralExpression(StringPrintf("!%s.isOk()", kStatusVarName)));
     b->AddStatement(exception_check);
-    exception_check->OnTrue()->AddLiteral("break");
+    exception_check->OnTrue()->AddLiteral(bail);
   }
 
   // If we have a return value, write it first.
   if (return_type != types.VoidType()) {
-    string writeMethod =
-        string(kReplyVarName) + "->" +
-        return_type->WriteToParcelMethod();
     b->AddStatement(new Assignment{
-        kAndroidStatusVarName, new MethodCall{writeMethod,
-        ArgList{return_type->WriteCast(kReturnVarName)}}});
-    b->AddStatement(BreakOnStatusNotOk());
+        kAndroidStatusVarName,
+        BuildParcelCall(*return_type, return_type->WriteToParcelMethod(),
+                        kReplyVarName, true,
+                        return_type->WriteCast(kReturnVarName))});
+    b->AddStatement(bail_on_status_not_ok());
   }
 
   // Write each out parameter to the reply parcel.
@@ -484,27 +1005,275 @@ bool HandleServerTransaction(const TypeNamespace& types,
     //     _aidl_ret_status = data.WriteInt32(out_param_name);
     //     if (_aidl_ret_status != ::android::OK) { break; }
     const Type* type = a->GetType().GetLanguageType<Type>();
-    string writeMethod = type->WriteToParcelMethod();
 
     b->AddStatement(new Assignment{
         kAndroidStatusVarName,
-        new MethodCall{string(kReplyVarName) + "->" + writeMethod,
-                       type->WriteCast(BuildVarName(*a))}});
-    b->AddStatement(BreakOnStatusNotOk());
+        BuildParcelCall(*type, type->WriteToParcelMethod(), kReplyVarName,
+                        true, type->WriteCast(BuildVarName(*a)))});
+    b->AddStatement(bail_on_status_not_ok());
   }
 
   return true;
 }
 
-}  // namespace
+const char kHandlerTypeName[] = "_aidl_handler_t";
+const char kHandlerTableName[] = "_aidl_handlers";
+const char kIndexVarName[] = "_aidl_index";
+const char kTransactionNamesName[] = "_aidl_transaction_names";
+const char kBatchDispatcherName[] = "_aidl_dispatch_batch";
+const char kBatchedSizeVarName[] = "_aidl_size";
+const char kBatchedEndVarName[] = "_aidl_end";
 
-unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
-                                       const AidlInterface& interface) {
+string HandlerName(const AidlMethod& method) {
+  return "_aidl_handle_" + method.GetName();
+}
+
+// Returns a static function handling transactions of |method|, or nullptr on
+// error.  |is_cold| marks it as rarely called, which keeps it out of line and
+// tells the compiler that the calls into it are unlikely.
+unique_ptr<MethodImpl> BuildServerHandler(const TypeNamespace& types,
+                                          const AidlInterface& interface,
+                                          const AidlMethod& method,
+                                          bool is_cold = false) {
+  const string bn_name = ClassName(interface, ClassNames::SERVER);
+  string return_type = "static ";
+  if (is_cold) {
+    return_type += "__attribute__((cold, noinline)) ";
+  }
+  return_type += kAndroidStatusLiteral;
+  // Oneway methods never write a reply.
+  unique_ptr<MethodImpl> handler{new MethodImpl{
+      return_type, "", HandlerName(method),
+      ArgList{{StringPrintf("%s* %s", bn_name.c_str(), kSelfVarName),
+               StringPrintf("const %s& %s", kAndroidParcelLiteral,
+                            kDataVarName),
+               StringPrintf("%s* %s", kAndroidParcelLiteral,
+                            (method.IsOneway()) ? "/* _aidl_reply */"
+                                                : kReplyVarName)}}}};
+  StatementBlock* b = handler->GetStatementBlock();
+  b->AddLiteral(
+      StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                   kAndroidStatusVarName, kAndroidStatusOk));
+  if (!HandleServerTransaction(types, method, b, true /* in_handler */)) {
+    return nullptr;
+  }
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusVarName));
+  return handler;
+}
+
+// Returns a static function running each call of a batch through
+// onTransact, in order, as the oneway transaction it would otherwise have
+// been.  Anything but a well formed sequence of @batchable calls, each
+// reading no more than its own bytes, fails the rest of the batch.
+unique_ptr<MethodImpl> BuildBatchDispatcher(const AidlInterface& interface) {
+  const string i_name = ClassName(interface, ClassNames::INTERFACE);
+  const string bn_name = ClassName(interface, ClassNames::SERVER);
+  unique_ptr<MethodImpl> dispatcher{new MethodImpl{
+      string("static ") + kAndroidStatusLiteral, "", kBatchDispatcherName,
+      ArgList{{StringPrintf("%s* %s", bn_name.c_str(), kSelfVarName),
+               StringPrintf("const %s& %s", kAndroidParcelLiteral,
+                            kDataVarName)}}}};
+  StatementBlock* b = dispatcher->GetStatementBlock();
+
+  IfStatement* interface_check = new IfStatement(
+      new MethodCall(StringPrintf("%s.checkInterface", kDataVarName),
+                     kSelfVarName),
+      true /* invert the check */);
+  b->AddStatement(interface_check);
+  interface_check->OnTrue()->AddLiteral("return ::android::BAD_TYPE");
+
+  b->AddLiteral(StringPrintf("%s %s", kAndroidParcelLiteral, kReplyVarName));
+  b->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                             kAndroidStatusVarName, kAndroidStatusOk));
+  WhileStatement* each_call = new WhileStatement(new Comparison(
+      new MethodCall(StringPrintf("%s.dataAvail", kDataVarName), ArgList{}),
+      ">", new LiteralExpression("0")));
+  b->AddStatement(each_call);
+  StatementBlock* body = each_call->Body();
+  for (const char* var_name : {kCodeVarName, kBatchedSizeVarName}) {
+    body->AddLiteral(StringPrintf("int32_t %s = 0", var_name));
+  }
+  for (const char* var_name : {kCodeVarName, kBatchedSizeVarName}) {
+    body->AddStatement(new Assignment(
+        kAndroidStatusVarName,
+        new MethodCall(StringPrintf("%s.readInt32", kDataVarName),
+                       StringPrintf("&%s", var_name))));
+    body->AddStatement(ReturnOnStatusNotOk());
+  }
+
+  // Only calls to @batchable methods may be batched.
+  vector<string> not_batchable;
+  for (const auto& method : interface.GetMethods()) {
+    if (method->IsBatchable()) {
+      not_batchable.push_back(StringPrintf(
+          "%s != %s::%s", kCodeVarName, i_name.c_str(),
+          UpperCase(method->GetName()).c_str()));
+    }
+  }
+  body->AddStatement(ReturnIf(
+      StringPrintf("%s < 0 || static_cast<size_t>(%s) > %s.dataAvail() || "
+                   "(%s)",
+                   kBatchedSizeVarName, kBatchedSizeVarName, kDataVarName,
+                   android::base::Join(not_batchable, " && ").c_str()),
+      "::android::BAD_VALUE"));
+  body->AddLiteral(StringPrintf("const size_t %s = %s.dataPosition() + %s",
+                                kBatchedEndVarName, kDataVarName,
+                                kBatchedSizeVarName));
+  body->AddStatement(new Assignment(
+      kAndroidStatusVarName,
+      new MethodCall(
+          StringPrintf("%s->onTransact", kSelfVarName),
+          ArgList{{StringPrintf("static_cast<uint32_t>(%s)", kCodeVarName),
+                   kDataVarName, StringPrintf("&%s", kReplyVarName),
+                   "::android::IBinder::FLAG_ONEWAY"}})));
+  body->AddStatement(ReturnOnStatusNotOk());
+  // A call that read past its own bytes has consumed some of the next one's.
+  body->AddStatement(ReturnIf(StringPrintf("%s.dataPosition() > %s",
+                                           kDataVarName, kBatchedEndVarName),
+                              "::android::BAD_VALUE"));
+  body->AddLiteral(StringPrintf("%s.setDataPosition(%s)", kDataVarName,
+                                kBatchedEndVarName));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+  return dispatcher;
+}
+
+// Emits a static handler per method followed by a table of them indexed by
+// transaction id, and makes |on_transact| a bounds check and an indirect
+// call into that table.
+bool BuildDispatchTable(const TypeNamespace& types,
+                        const AidlInterface& interface,
+                        size_t table_size,
+                        StreamingCppSource* stream,
+                        vector<unique_ptr<Declaration>>* decls,
+                        StatementBlock* on_transact) {
+  const string bn_name = ClassName(interface, ClassNames::SERVER);
+  vector<string> entries(table_size, "nullptr");
+
+  for (const auto& method : interface.GetMethods()) {
+    unique_ptr<MethodImpl> handler =
+        BuildServerHandler(types, interface, *method);
+    if (!handler) {
+      return false;
+    }
+    entries[method->GetId()] = HandlerName(*method);
+    decls->push_back(std::move(handler));
+    Flush(stream, decls);
+  }
+
+  string table = StringPrintf(
+      "typedef %s (*%s)(%s*, const %s&, %s*);\n"
+      "constexpr %s %s[] = {\n",
+      kAndroidStatusLiteral, kHandlerTypeName, bn_name.c_str(),
+      kAndroidParcelLiteral, kAndroidParcelLiteral,
+      kHandlerTypeName, kHandlerTableName);
+  for (const string& entry : entries) {
+    table += entry + ",\n";
+  }
+  table += "};\n";
+  decls->emplace_back(new LiteralDecl{table});
+
+  // Codes below FIRST_CALL_TRANSACTION wrap around to large indices, so a
+  // single comparison bounds the index from both sides.
+  on_transact->AddLiteral(StringPrintf(
+      "const uint32_t %s = %s - ::android::IBinder::FIRST_CALL_TRANSACTION",
+      kIndexVarName, kCodeVarName));
+  string in_table = StringPrintf("%s < %zu", kIndexVarName, table_size);
+  if (table_size != interface.GetMethods().size()) {
+    in_table += StringPrintf(" && %s[%s] != nullptr",
+                             kHandlerTableName, kIndexVarName);
+  }
+  IfStatement* dispatch = new IfStatement(new LiteralExpression(in_table));
+  on_transact->AddStatement(dispatch);
+  dispatch->OnTrue()->AddStatement(new Assignment(
+      kAndroidStatusVarName,
+      StringPrintf("%s[%s](this, %s, %s)", kHandlerTableName, kIndexVarName,
+                   kDataVarName, kReplyVarName)));
+  StatementBlock* fallback = dispatch->OnFalse();
+  if (interface.HasBatchableMethods()) {
+    IfStatement* batch = new IfStatement(new LiteralExpression(StringPrintf(
+        "%s == Call::%s", kCodeVarName, kBatchCode)));
+    fallback->AddStatement(batch);
+    batch->OnTrue()->AddStatement(new Assignment(
+        kAndroidStatusVarName,
+        StringPrintf("%s(this, %s)", kBatchDispatcherName, kDataVarName)));
+    fallback = batch->OnFalse();
+  }
+  fallback->AddStatement(new Assignment(
+      kAndroidStatusVarName,
+      StringPrintf("::android::BBinder::onTransact(%s, %s, %s, %s)",
+                   kCodeVarName, kDataVarName, kReplyVarName,
+                   kFlagsVarName)));
+  return true;
+}
+
+// Emits BnFoo::getTransactionName(), backed by a table of method names
+// indexed by transaction id, or by a switch when the ids are too sparse for
+// one, and BnFoo::getMaxTransactionId().
+void BuildTransactionNames(const AidlInterface& interface,
+                           vector<unique_ptr<Declaration>>* decls) {
+  const string bn_name = ClassName(interface, ClassNames::SERVER);
+  int max_id = -1;
+  for (const auto& method : interface.GetMethods()) {
+    max_id = std::max(max_id, method->GetId());
+  }
+
+  unique_ptr<MethodImpl> get_name{new MethodImpl{
+      "const char*", bn_name, "getTransactionName",
+      ArgList{StringPrintf("uint32_t %s", kCodeVarName)}}};
+  StatementBlock* b = get_name->GetStatementBlock();
+  const size_t table_size = DenseTableSize(interface);
+  if (table_size > 0) {
+    vector<string> entries(table_size, "nullptr");
+    for (const auto& method : interface.GetMethods()) {
+      entries[method->GetId()] = '"' + method->GetName() + '"';
+    }
+    string table = StringPrintf("constexpr const char* %s[] = {\n",
+                                kTransactionNamesName);
+    for (const string& entry : entries) {
+      table += entry + ",\n";
+    }
+    table += "};\n";
+    decls->emplace_back(new LiteralDecl{table});
+
+    b->AddLiteral(StringPrintf(
+        "const uint32_t %s = %s - ::android::IBinder::FIRST_CALL_TRANSACTION",
+        kIndexVarName, kCodeVarName));
+    IfStatement* in_table = new IfStatement(new LiteralExpression(
+        StringPrintf("%s < %zu", kIndexVarName, table_size)));
+    b->AddStatement(in_table);
+    in_table->OnTrue()->AddLiteral(StringPrintf(
+        "return %s[%s]", kTransactionNamesName, kIndexVarName));
+  } else if (!interface.GetMethods().empty()) {
+    SwitchStatement* s = new SwitchStatement{kCodeVarName};
+    b->AddStatement(s);
+    for (const auto& method : interface.GetMethods()) {
+      StatementBlock* c = s->AddCase("Call::" + UpperCase(method->GetName()));
+      c->AddLiteral(StringPrintf("return \"%s\"", method->GetName().c_str()));
+    }
+  }
+  b->AddLiteral("return nullptr");
+  decls->push_back(std::move(get_name));
+
+  unique_ptr<MethodImpl> get_max{new MethodImpl{
+      "int32_t", bn_name, "getMaxTransactionId", ArgList{}}};
+  get_max->GetStatementBlock()->AddLiteral(StringPrintf("return %d", max_id));
+  decls->push_back(std::move(get_max));
+}
+
+vector<string> ServerSourceIncludes(const AidlInterface& interface) {
+  return {HeaderFile(interface, ClassNames::SERVER, false), kParcelHeader};
+}
+
+// Adds the definitions of BnFoo to |file_decls|.  With a |stream|, they are
+// flushed to it a method at a time, and the inline cases of onTransact are
+// only built as it is written.
+bool AddServerDecls(const TypeNamespace& types,
+                    const AidlInterface& interface,
+                    bool use_dispatch_table,
+                    const DispatchProfile* profile,
+                    StreamingCppSource* stream,
+                    vector<unique_ptr<Declaration>>* file_decls) {
   const string bn_name = ClassName(interface, ClassNames::SERVER);
-  vector<string> include_list{
-      HeaderFile(interface, ClassNames::SERVER, false),
-      kParcelHeader
-  };
   unique_ptr<MethodImpl> on_transact{new MethodImpl{
       kAndroidStatusLiteral, bn_name, "onTransact",
       ArgList{{StringPrintf("uint32_t %s", kCodeVarName),
@@ -519,25 +1288,76 @@ unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
       StringPrintf("%s %s = %s", kAndroidStatusLiteral, kAndroidStatusVarName,
                    kAndroidStatusOk));
 
-  // Add the all important switch statement, but retain a pointer to it.
-  SwitchStatement* s = new SwitchStatement{kCodeVarName};
-  on_transact->GetStatementBlock()->AddStatement(s);
+  if (interface.HasBatchableMethods()) {
+    file_decls->push_back(BuildBatchDispatcher(interface));
+    Flush(stream, file_decls);
+  }
 
-  // The switch statement has a case statement for each transaction code.
-  for (const auto& method : interface.GetMethods()) {
-    StatementBlock* b = s->AddCase("Call::" + UpperCase(method->GetName()));
-    if (!b) { return nullptr; }
+  bool deferred_failed = false;
+  const size_t table_size =
+      (use_dispatch_table) ? DenseTableSize(interface) : 0;
+  if (table_size > 0) {
+    if (!BuildDispatchTable(types, interface, table_size, stream, file_decls,
+                            on_transact->GetStatementBlock())) {
+      return false;
+    }
+  } else {
+    // Add the all important switch statement, but retain a pointer to it.
+    SwitchStatement* s = new SwitchStatement{kCodeVarName};
+    on_transact->GetStatementBlock()->AddStatement(s);
+
+    // The switch statement has a case statement for each transaction code.
+    // Hot transactions come first and are handled inline.
+    const vector<const AidlMethod*> hot = GetHotMethods(interface, profile);
+    for (const AidlMethod* method : hot) {
+      StatementBlock* b = s->AddCase("Call::" + UpperCase(method->GetName()));
+      if (!b) { return false; }
+
+      if (stream) {
+        b->AddStatement(new DeferredStatements(
+            [&types, method](StatementBlock* case_block) {
+              return HandleServerTransaction(types, *method, case_block);
+            },
+            &deferred_failed));
+      } else if (!HandleServerTransaction(types, *method, b)) {
+        return false;
+      }
+    }
 
-    if (!HandleServerTransaction(types, *method, b)) { return nullptr; }
-  }
+    // The cold ones only call out to a handler of their own.
+    for (const auto& method : interface.GetMethods()) {
+      if (std::find(hot.begin(), hot.end(), method) != hot.end()) {
+        continue;
+      }
+      unique_ptr<MethodImpl> handler =
+          BuildServerHandler(types, interface, *method, true /* is_cold */);
+      if (!handler) { return false; }
+      file_decls->push_back(std::move(handler));
+      Flush(stream, file_decls);
+
+      StatementBlock* b = s->AddCase("Call::" + UpperCase(method->GetName()));
+      if (!b) { return false; }
+      b->AddStatement(new Assignment(
+          kAndroidStatusVarName,
+          StringPrintf("%s(this, %s, %s)", HandlerName(*method).c_str(),
+                       kDataVarName, kReplyVarName)));
+    }
 
-  // The switch statement has a default case which defers to the super class.
-  // The superclass handles a few pre-defined transactions.
-  StatementBlock* b = s->AddCase("");
-  b->AddLiteral(StringPrintf(
-                "%s = ::android::BBinder::onTransact(%s, %s, "
-                "%s, %s)", kAndroidStatusVarName, kCodeVarName,
-                kDataVarName, kReplyVarName, kFlagsVarName));
+    if (interface.HasBatchableMethods()) {
+      StatementBlock* b = s->AddCase(StringPrintf("Call::%s", kBatchCode));
+      b->AddStatement(new Assignment(
+          kAndroidStatusVarName,
+          StringPrintf("%s(this, %s)", kBatchDispatcherName, kDataVarName)));
+    }
+
+    // The switch statement has a default case which defers to the super
+    // class.  The superclass handles a few pre-defined transactions.
+    StatementBlock* b = s->AddCase("");
+    b->AddLiteral(StringPrintf(
+                  "%s = ::android::BBinder::onTransact(%s, %s, "
+                  "%s, %s)", kAndroidStatusVarName, kCodeVarName,
+                  kDataVarName, kReplyVarName, kFlagsVarName));
+  }
 
   // If we saw a null reference, we can map that to an appropriate exception.
   IfStatement* null_check = new IfStatement(
@@ -555,35 +1375,115 @@ unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
   on_transact->GetStatementBlock()->AddLiteral(
       StringPrintf("return %s", kAndroidStatusVarName));
 
+  file_decls->push_back(std::move(on_transact));
+  Flush(stream, file_decls);
+  if (deferred_failed) {
+    return false;
+  }
+  BuildTransactionNames(interface, file_decls);
+  Flush(stream, file_decls);
+  return true;
+}
+
+}  // namespace
+
+unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
+                                       const AidlInterface& interface,
+                                       bool use_dispatch_table,
+                                       const DispatchProfile* profile) {
+  vector<unique_ptr<Declaration>> file_decls;
+  if (!AddServerDecls(types, interface, use_dispatch_table, profile, nullptr,
+                      &file_decls)) {
+    return nullptr;
+  }
   return unique_ptr<Document>{new CppSource{
-      include_list,
-      NestInNamespaces(std::move(on_transact), interface.GetSplitPackage())}};
+      ServerSourceIncludes(interface),
+      NestInNamespaces(std::move(file_decls), interface.GetSplitPackage())}};
 }
 
-unique_ptr<Document> BuildInterfaceSource(const TypeNamespace& /* types */,
-                                          const AidlInterface& interface) {
-  vector<string> include_list{
-      HeaderFile(interface, ClassNames::INTERFACE, false),
-      HeaderFile(interface, ClassNames::CLIENT, false),
-  };
+bool StreamServerSource(const TypeNamespace& types,
+                        const AidlInterface& interface,
+                        bool use_dispatch_table,
+                        const DispatchProfile* profile,
+                        CodeWriter* to) {
+  StreamingCppSource stream{to, ServerSourceIncludes(interface),
+                            interface.GetSplitPackage()};
+  vector<unique_ptr<Declaration>> file_decls;
+  const bool success = AddServerDecls(types, interface, use_dispatch_table,
+                                      profile, &stream, &file_decls);
+  stream.Finish();
+  return success;
+}
 
+unique_ptr<Document> BuildInterfaceSource(const TypeNamespace& /* types */,
+                                          const AidlInterface& interface,
+                                          bool generate_client) {
   string fq_name = ClassName(interface, ClassNames::INTERFACE);
   if (!interface.GetPackage().empty()) {
     fq_name = interface.GetPackage() + "." + fq_name;
   }
 
-  unique_ptr<ConstructorDecl> meta_if{new ConstructorDecl{
-      "IMPLEMENT_META_INTERFACE",
-      ArgList{vector<string>{ClassName(interface, ClassNames::BASE),
-                             '"' + fq_name + '"'}}}};
+  if (generate_client) {
+    vector<string> include_list{
+        HeaderFile(interface, ClassNames::INTERFACE, false),
+        HeaderFile(interface, ClassNames::CLIENT, false),
+    };
+
+    unique_ptr<ConstructorDecl> meta_if{new ConstructorDecl{
+        "IMPLEMENT_META_INTERFACE",
+        ArgList{vector<string>{ClassName(interface, ClassNames::BASE),
+                               '"' + fq_name + '"'}}}};
+
+    return unique_ptr<Document>{new CppSource{
+        include_list,
+        NestInNamespaces(std::move(meta_if), interface.GetSplitPackage())}};
+  }
+
+  // IMPLEMENT_META_INTERFACE wraps remote binders in a BpFoo, which we are
+  // not generating.  Spell out the rest of it, leaving asInterface() only
+  // able to find implementations living in this process.
+  const string i_name = ClassName(interface, ClassNames::INTERFACE);
+  vector<unique_ptr<Declaration>> decls;
+  decls.emplace_back(new LiteralDecl{StringPrintf(
+      "const ::android::String16 %s::descriptor(\"%s\");\n", i_name.c_str(),
+      fq_name.c_str())});
+
+  unique_ptr<MethodImpl> get_descriptor{new MethodImpl{
+      "const ::android::String16&", i_name, "getInterfaceDescriptor",
+      ArgList{}, true /* const */}};
+  get_descriptor->GetStatementBlock()->AddLiteral(
+      StringPrintf("return %s::descriptor", i_name.c_str()));
+  decls.push_back(std::move(get_descriptor));
+
+  unique_ptr<MethodImpl> as_interface{new MethodImpl{
+      "::android::sp<" + i_name + ">", i_name, "asInterface",
+      ArgList{StringPrintf("const ::android::sp<::android::IBinder>& %s",
+                           kImplVarName)}}};
+  StatementBlock* b = as_interface->GetStatementBlock();
+  b->AddLiteral(StringPrintf("::android::sp<%s> %s", i_name.c_str(),
+                             kReturnVarName));
+  IfStatement* found = new IfStatement(new LiteralExpression(
+      StringPrintf("%s != nullptr", kImplVarName)));
+  found->OnTrue()->AddLiteral(StringPrintf(
+      "%s = static_cast<%s*>(%s->queryLocalInterface(%s::descriptor).get())",
+      kReturnVarName, i_name.c_str(), kImplVarName, i_name.c_str()));
+  b->AddStatement(found);
+  b->AddLiteral(StringPrintf("return %s", kReturnVarName));
+  decls.push_back(std::move(as_interface));
+
+  decls.emplace_back(new LiteralDecl{StringPrintf(
+      "%s::%s() {}\n%s::~%s() {}\n", i_name.c_str(), i_name.c_str(),
+      i_name.c_str(), i_name.c_str())});
 
   return unique_ptr<Document>{new CppSource{
-      include_list,
-      NestInNamespaces(std::move(meta_if), interface.GetSplitPackage())}};
+      {HeaderFile(interface, ClassNames::INTERFACE, false)},
+      NestInNamespaces(std::move(decls), interface.GetSplitPackage())}};
 }
 
 unique_ptr<Document> BuildClientHeader(const TypeNamespace& types,
-                                       const AidlInterface& interface) {
+                                       const AidlInterface& interface,
+                                       bool generate_async,
+                                       bool generate_coroutines) {
   const string i_name = ClassName(interface, ClassNames::INTERFACE);
   const string bp_name = ClassName(interface, ClassNames::CLIENT);
 
@@ -593,10 +1493,14 @@ unique_ptr<Document> BuildClientHeader(const TypeNamespace& types,
                            kImplVarName)},
       ConstructorDecl::IS_EXPLICIT
   }};
+  // With batching, the destructor sends whatever calls are still pending.
+  const bool batches = interface.HasBatchableMethods();
+  uint32_t destructor_modifiers = ConstructorDecl::IS_VIRTUAL;
+  if (!batches) {
+    destructor_modifiers |= ConstructorDecl::IS_DEFAULT;
+  }
   unique_ptr<ConstructorDecl> destructor{new ConstructorDecl{
-      "~" + bp_name,
-      ArgList{},
-      ConstructorDecl::IS_VIRTUAL | ConstructorDecl::IS_DEFAULT}};
+      "~" + bp_name, ArgList{}, destructor_modifiers}};
 
   vector<unique_ptr<Declaration>> publics;
   publics.push_back(std::move(constructor));
@@ -606,19 +1510,78 @@ unique_ptr<Document> BuildClientHeader(const TypeNamespace& types,
     publics.push_back(BuildMethodDecl(*method, types, false));
   }
 
+  vector<unique_ptr<Declaration>> privates;
+  vector<string> include_list{kIBinderHeader,
+                              kIInterfaceHeader,
+                              "utils/Errors.h",
+                              HeaderFile(interface, ClassNames::INTERFACE,
+                                         false)};
+  if (batches) {
+    publics.emplace_back(new MethodDecl{
+        kBinderStatusLiteral, "flushBatch", ArgList{},
+        MethodDecl::IS_OVERRIDE});
+    privates.emplace_back(new MethodDecl{
+        kAndroidStatusLiteral, "_aidl_flushBatch", ArgList{}});
+    privates.emplace_back(new MethodDecl{
+        kAndroidStatusLiteral, "_aidl_batchCall",
+        ArgList{{StringPrintf("uint32_t %s", kCodeVarName),
+                 StringPrintf("const %s& %s", kAndroidParcelLiteral,
+                              kDataVarName)}}});
+    privates.emplace_back(new MethodDecl{
+        kAndroidStatusLiteral, "_aidl_sendBatch", ArgList{}});
+    privates.emplace_back(new LiteralDecl{StringPrintf(
+        "::std::mutex %s;\n"
+        "%s %s;\n"
+        "size_t %s = 0;\n",
+        kBatchMutexVarName, kAndroidParcelLiteral, kBatchVarName,
+        kBatchedCallsVarName)});
+    include_list.insert(include_list.end(), {kParcelHeader, "mutex"});
+  }
+  if (generate_async) {
+    for (const auto& method: interface.GetMethods()) {
+      if (!HasAsyncMethod(interface, *method)) { continue; }
+      vector<string> args = BuildArgs(types, *method, true);
+      publics.emplace_back(new MethodDecl{
+          StringPrintf("::std::future<%s>", kBinderStatusLiteral),
+          method->GetName() + "Async", ArgList{args}});
+      args.push_back(StringPrintf("::std::function<void(%s)> %s",
+                                  kBinderStatusLiteral, kCallbackVarName));
+      publics.emplace_back(new MethodDecl{
+          "void", method->GetName() + "Async", ArgList{args}});
+      if (generate_coroutines) {
+        args.pop_back();
+        AddGuardedByCoroutineSupport(
+            unique_ptr<Declaration>{new MethodDecl{
+                kStatusAwaitableLiteral, method->GetName() + "Co",
+                ArgList{args}}},
+            &publics);
+      }
+    }
+    publics.emplace_back(new MethodDecl{
+        "void", "setAsyncExecutor",
+        ArgList{StringPrintf("%s* executor", kAsyncExecutorLiteral)}});
+    privates.emplace_back(new LiteralDecl{StringPrintf(
+        "%s* %s = %s::Default();\n", kAsyncExecutorLiteral,
+        kExecutorVarName, kAsyncExecutorLiteral)});
+
+    include_list.insert(include_list.end(),
+                        {"functional", "future", "memory",
+                         kAsyncExecutorHeader});
+    if (generate_coroutines) {
+      include_list.push_back(kStatusAwaitableHeader);
+    }
+  }
+
   unique_ptr<ClassDecl> bp_class{
       new ClassDecl{bp_name,
                     "::android::BpInterface<" + i_name + ">",
                     std::move(publics),
-                    {}
+                    std::move(privates)
       }};
 
   return unique_ptr<Document>{new CppHeader{
       BuildHeaderGuard(interface, ClassNames::CLIENT),
-      {kIBinderHeader,
-       kIInterfaceHeader,
-       "utils/Errors.h",
-       HeaderFile(interface, ClassNames::INTERFACE, false)},
+      include_list,
       NestInNamespaces(std::move(bp_class), interface.GetSplitPackage())}};
 }
 
@@ -639,6 +1602,13 @@ unique_ptr<Document> BuildServerHeader(const TypeNamespace& /* types */,
 
   std::vector<unique_ptr<Declaration>> publics;
   publics.push_back(std::move(on_transact));
+  // Maps transaction codes back to method names, for profiling.
+  publics.emplace_back(new MethodDecl{
+      "const char*", "getTransactionName",
+      ArgList{StringPrintf("uint32_t %s", kCodeVarName)},
+      MethodDecl::IS_STATIC});
+  publics.emplace_back(new MethodDecl{
+      "int32_t", "getMaxTransactionId", ArgList{}, MethodDecl::IS_STATIC});
 
   unique_ptr<ClassDecl> bn_class{
       new ClassDecl{bn_name,
@@ -647,26 +1617,31 @@ unique_ptr<Document> BuildServerHeader(const TypeNamespace& /* types */,
                     {}
       }};
 
+  // IFoo.h only forward declares the classes its methods take, but anything
+  // implementing them is going to need their definitions.
+  vector<string> include_list{
+      "binder/IInterface.h",
+      HeaderFile(interface, ClassNames::INTERFACE, false)};
+  for (const string& header : GetForwardDeclaredHeaders(interface)) {
+    include_list.push_back(header);
+  }
+
   return unique_ptr<Document>{new CppHeader{
       BuildHeaderGuard(interface, ClassNames::SERVER),
-      {"binder/IInterface.h",
-       HeaderFile(interface, ClassNames::INTERFACE, false)},
+      include_list,
       NestInNamespaces(std::move(bn_class), interface.GetSplitPackage())}};
 }
 
 unique_ptr<Document> BuildInterfaceHeader(const TypeNamespace& types,
                                           const AidlInterface& interface) {
   set<string> includes = { kIBinderHeader, kIInterfaceHeader,
-                           kStatusHeader, kStrongPointerHeader };
-
-  for (const auto& method : interface.GetMethods()) {
-    for (const auto& argument : method->GetArguments()) {
-      const Type* type = argument->GetType().GetLanguageType<Type>();
-      type->GetHeaders(&includes);
-    }
+                           kStatusHeader, kStrongPointerHeader,
+                           HeaderFile(interface, ClassNames::FORWARD, false) };
 
-    const Type* return_type = method->GetType().GetLanguageType<Type>();
-    return_type->GetHeaders(&includes);
+  // The classes themselves are declared in IFooFwd.h.
+  ForwardDeclarations classes;
+  for (const Type* type : GetMethodTypes(interface)) {
+    type->GetDeclarationHeaders(&includes, &classes);
   }
 
   unique_ptr<ClassDecl> if_class{
@@ -694,30 +1669,364 @@ unique_ptr<Document> BuildInterfaceHeader(const TypeNamespace& types,
         StringPrintf("::android::IBinder::FIRST_CALL_TRANSACTION + %d",
                      method->GetId()));
   }
+  if (interface.HasBatchableMethods()) {
+    call_enum->AddValue(kBatchCode,
+                        "::android::IBinder::LAST_CALL_TRANSACTION");
+    // Only proxies batch calls, so there is nothing to flush otherwise.
+    if_class->AddPublic(unique_ptr<Declaration>{new LiteralDecl{StringPrintf(
+        "virtual %s flushBatch() { return %s::ok(); }\n",
+        kBinderStatusLiteral, kBinderStatusLiteral)}});
+  }
   if_class->AddPublic(std::move(call_enum));
 
+  // Parcel size bounds of each call, in bytes.  Maxima are only declared for
+  // parcels whose size does not depend on the arguments.
+  for (const auto& method : interface.GetMethods()) {
+    const MethodWireSize size = GetMethodWireSize(interface, *method);
+    vector<std::pair<const char*, const WireSize*>> bounds{
+        {"REQUEST", &size.request}};
+    if (!interface.IsOneway() && !method->IsOneway()) {
+      bounds.emplace_back("REPLY", &size.reply);
+    }
+    for (const auto& bound : bounds) {
+      const string prefix = bound.first;
+      if_class->AddPublic(unique_ptr<Declaration>{new LiteralDecl{
+          StringPrintf("static constexpr size_t %s = %zu;\n",
+                       WireSizeConstant(*method, (prefix + "_MIN").c_str())
+                           .c_str(),
+                       bound.second->min)}});
+      if (bound.second->IsBounded()) {
+        if_class->AddPublic(unique_ptr<Declaration>{new LiteralDecl{
+            StringPrintf("static constexpr size_t %s = %zu;\n",
+                         WireSizeConstant(*method, (prefix + "_MAX").c_str())
+                             .c_str(),
+                         bound.second->max)}});
+      }
+    }
+  }
+
   return unique_ptr<Document>{new CppHeader{
       BuildHeaderGuard(interface, ClassNames::INTERFACE),
       vector<string>(includes.begin(), includes.end()),
       NestInNamespaces(std::move(if_class), interface.GetSplitPackage())}};
 }
 
+unique_ptr<Document> BuildForwardDeclarationHeader(
+    const TypeNamespace& /* types */, const AidlInterface& interface) {
+  const string i_name = ClassName(interface, ClassNames::INTERFACE);
+  set<string> includes;
+  ForwardDeclarations classes;
+  for (const Type* type : GetMethodTypes(interface)) {
+    type->GetDeclarationHeaders(&includes, &classes);
+  }
+  classes[interface.GetSplitPackage()].insert(i_name);
+
+  vector<unique_ptr<CppNamespace>> namespaces;
+  for (const auto& package : classes) {
+    string declarations;
+    for (const string& class_name : package.second) {
+      declarations += "class " + class_name + ";\n";
+    }
+    vector<unique_ptr<Declaration>> decls;
+    decls.emplace_back(new LiteralDecl{declarations});
+    if (package.first == interface.GetSplitPackage()) {
+      decls.emplace_back(new LiteralDecl{StringPrintf(
+          "using %sPtr = ::android::sp<%s>;\n", i_name.c_str(),
+          i_name.c_str())});
+    }
+    namespaces.push_back(NestInNamespaces(std::move(decls), package.first));
+  }
+
+  return unique_ptr<Document>{new CppHeader{
+      BuildHeaderGuard(interface, ClassNames::FORWARD),
+      {kStrongPointerHeader},
+      std::move(namespaces)}};
+}
+
+namespace {
+
+const char kValueVarName[] = "_aidl_value";
+const char kSizeVarName[] = "_aidl_size";
+const char kBufferVarName[] = "_aidl_buffer";
+
+// A @FixedSize parcelable is a trivially copyable struct, packed to the 4
+// byte alignment of a parcel so that its bytes in memory are its bytes on
+// the wire.  Instead of overriding android::Parcelable, which would make it
+// polymorphic, it comes with static helpers that copy single values and
+// whole vectors in and out of the parcel with one memcpy.
+unique_ptr<Document> BuildFixedSizeParcelHeader(
+    const AidlStructuredParcelable& parcel) {
+  set<string> includes = {kParcelHeader, "type_traits", "utils/Errors.h",
+                          "vector"};
+  const string& name = parcel.GetName();
+
+  unique_ptr<ClassDecl> parcel_class{new ClassDecl{name, ""}};
+  for (const auto& field : parcel.GetFields()) {
+    const Type* type = field->GetType().GetLanguageType<Type>();
+    type->GetHeaders(&includes);
+    parcel_class->AddPublic(unique_ptr<Declaration>{new LiteralDecl{
+        StringPrintf("%s %s{};\n", type->CppType().c_str(),
+                     field->GetName().c_str())}});
+  }
+
+  const string read_parcel =
+      StringPrintf("const %s* %s", kAndroidParcelLiteral, kParcelVarName);
+  const string write_parcel =
+      StringPrintf("%s* %s", kAndroidParcelLiteral, kParcelVarName);
+  parcel_class->AddPublic(unique_ptr<Declaration>{new MethodDecl{
+      kAndroidStatusLiteral, "readFromParcel",
+      ArgList{vector<string>{
+          read_parcel, StringPrintf("%s* %s", name.c_str(), kValueVarName)}},
+      MethodDecl::IS_STATIC}});
+  parcel_class->AddPublic(unique_ptr<Declaration>{new MethodDecl{
+      kAndroidStatusLiteral, "writeToParcel",
+      ArgList{vector<string>{
+          write_parcel,
+          StringPrintf("const %s& %s", name.c_str(), kValueVarName)}},
+      MethodDecl::IS_STATIC}});
+  parcel_class->AddPublic(unique_ptr<Declaration>{new MethodDecl{
+      kAndroidStatusLiteral, "readVectorFromParcel",
+      ArgList{vector<string>{
+          read_parcel, StringPrintf("::std::vector<%s>* %s", name.c_str(),
+                                    kValueVarName)}},
+      MethodDecl::IS_STATIC}});
+  parcel_class->AddPublic(unique_ptr<Declaration>{new MethodDecl{
+      kAndroidStatusLiteral, "writeVectorToParcel",
+      ArgList{vector<string>{
+          write_parcel, StringPrintf("const ::std::vector<%s>& %s",
+                                     name.c_str(), kValueVarName)}},
+      MethodDecl::IS_STATIC}});
+
+  vector<unique_ptr<Declaration>> decls;
+  decls.emplace_back(new LiteralDecl{"#pragma pack(push, 4)\n"});
+  decls.push_back(std::move(parcel_class));
+  decls.emplace_back(new LiteralDecl{"#pragma pack(pop)\n"});
+  decls.emplace_back(new LiteralDecl{StringPrintf(
+      "static_assert(::std::is_trivially_copyable<%s>::value, "
+      "\"@FixedSize parcelable %s must be trivially copyable\");\n",
+      name.c_str(), name.c_str())});
+
+  return unique_ptr<Document>{new CppHeader{
+      BuildHeaderGuard(parcel.GetPackage(), name),
+      vector<string>(includes.begin(), includes.end()),
+      NestInNamespaces(std::move(decls), parcel.GetSplitPackage())}};
+}
+
+unique_ptr<Document> BuildFixedSizeParcelSource(
+    const AidlStructuredParcelable& parcel) {
+  const string& name = parcel.GetName();
+  const string read_parcel =
+      StringPrintf("const %s* %s", kAndroidParcelLiteral, kParcelVarName);
+  const string write_parcel =
+      StringPrintf("%s* %s", kAndroidParcelLiteral, kParcelVarName);
+
+  unique_ptr<MethodImpl> read{new MethodImpl{
+      kAndroidStatusLiteral, name, "readFromParcel",
+      ArgList{vector<string>{
+          read_parcel, StringPrintf("%s* %s", name.c_str(), kValueVarName)}}}};
+  StatementBlock* b = read->GetStatementBlock();
+  b->AddLiteral(StringPrintf("const void* %s = %s->readInplace(sizeof(%s))",
+                             kBufferVarName, kParcelVarName, name.c_str()));
+  b->AddStatement(ReturnIf(StringPrintf("%s == nullptr", kBufferVarName),
+                           "::android::NOT_ENOUGH_DATA"));
+  b->AddLiteral(StringPrintf("memcpy(%s, %s, sizeof(%s))", kValueVarName,
+                             kBufferVarName, name.c_str()));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+
+  unique_ptr<MethodImpl> write{new MethodImpl{
+      kAndroidStatusLiteral, name, "writeToParcel",
+      ArgList{vector<string>{
+          write_parcel,
+          StringPrintf("const %s& %s", name.c_str(), kValueVarName)}}}};
+  b = write->GetStatementBlock();
+  b->AddLiteral(StringPrintf("void* %s = %s->writeInplace(sizeof(%s))",
+                             kBufferVarName, kParcelVarName, name.c_str()));
+  b->AddStatement(ReturnIf(StringPrintf("%s == nullptr", kBufferVarName),
+                           "::android::NO_MEMORY"));
+  b->AddLiteral(StringPrintf("memcpy(%s, &%s, sizeof(%s))", kBufferVarName,
+                             kValueVarName, name.c_str()));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+
+  // Vectors are an element count followed by all of the elements, with a
+  // negative count for null, as the Java side writes them.
+  unique_ptr<MethodImpl> read_vector{new MethodImpl{
+      kAndroidStatusLiteral, name, "readVectorFromParcel",
+      ArgList{vector<string>{
+          read_parcel, StringPrintf("::std::vector<%s>* %s", name.c_str(),
+                                    kValueVarName)}}}};
+  b = read_vector->GetStatementBlock();
+  b->AddLiteral(StringPrintf("int32_t %s", kSizeVarName));
+  b->AddLiteral(StringPrintf("%s %s = %s->readInt32(&%s)",
+                             kAndroidStatusLiteral, kAndroidStatusVarName,
+                             kParcelVarName, kSizeVarName));
+  b->AddStatement(ReturnOnStatusNotOk());
+  b->AddStatement(ReturnIf(StringPrintf("%s < 0", kSizeVarName),
+                           "::android::UNEXPECTED_NULL"));
+  b->AddStatement(ReturnIf(
+      StringPrintf("static_cast<size_t>(%s) > %s->dataAvail() / sizeof(%s)",
+                   kSizeVarName, kParcelVarName, name.c_str()),
+      "::android::NOT_ENOUGH_DATA"));
+  b->AddLiteral(StringPrintf("%s->resize(%s)", kValueVarName, kSizeVarName));
+  b->AddStatement(ReturnIf(StringPrintf("%s == 0", kSizeVarName),
+                           kAndroidStatusOk));
+  b->AddLiteral(StringPrintf(
+      "const void* %s = %s->readInplace(%s * sizeof(%s))", kBufferVarName,
+      kParcelVarName, kSizeVarName, name.c_str()));
+  b->AddStatement(ReturnIf(StringPrintf("%s == nullptr", kBufferVarName),
+                           "::android::NOT_ENOUGH_DATA"));
+  b->AddLiteral(StringPrintf("memcpy(%s->data(), %s, %s * sizeof(%s))",
+                             kValueVarName, kBufferVarName, kSizeVarName,
+                             name.c_str()));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+
+  unique_ptr<MethodImpl> write_vector{new MethodImpl{
+      kAndroidStatusLiteral, name, "writeVectorToParcel",
+      ArgList{vector<string>{
+          write_parcel, StringPrintf("const ::std::vector<%s>& %s",
+                                     name.c_str(), kValueVarName)}}}};
+  b = write_vector->GetStatementBlock();
+  b->AddStatement(ReturnIf(
+      StringPrintf("%s.size() > INT32_MAX / sizeof(%s)", kValueVarName,
+                   name.c_str()),
+      "::android::BAD_VALUE"));
+  b->AddLiteral(StringPrintf(
+      "%s %s = %s->writeInt32(static_cast<int32_t>(%s.size()))",
+      kAndroidStatusLiteral, kAndroidStatusVarName, kParcelVarName,
+      kValueVarName));
+  b->AddStatement(ReturnOnStatusNotOk());
+  b->AddStatement(ReturnIf(StringPrintf("%s.empty()", kValueVarName),
+                           kAndroidStatusOk));
+  b->AddLiteral(StringPrintf(
+      "void* %s = %s->writeInplace(%s.size() * sizeof(%s))", kBufferVarName,
+      kParcelVarName, kValueVarName, name.c_str()));
+  b->AddStatement(ReturnIf(StringPrintf("%s == nullptr", kBufferVarName),
+                           "::android::NO_MEMORY"));
+  b->AddLiteral(StringPrintf("memcpy(%s, %s.data(), %s.size() * sizeof(%s))",
+                             kBufferVarName, kValueVarName, kValueVarName,
+                             name.c_str()));
+  b->AddLiteral(StringPrintf("return %s", kAndroidStatusOk));
+
+  vector<unique_ptr<Declaration>> file_decls;
+  file_decls.push_back(std::move(read));
+  file_decls.push_back(std::move(write));
+  file_decls.push_back(std::move(read_vector));
+  file_decls.push_back(std::move(write_vector));
+  return unique_ptr<Document>{new CppSource{
+      {HeaderFile(parcel, false), "cstring"},
+      NestInNamespaces(std::move(file_decls), parcel.GetSplitPackage())}};
+}
+
+}  // namespace
+
+unique_ptr<Document> BuildParcelHeader(const TypeNamespace& /* types */,
+                                       const AidlStructuredParcelable& parcel) {
+  if (parcel.IsFixedSize()) {
+    return BuildFixedSizeParcelHeader(parcel);
+  }
+  set<string> includes = {"binder/Parcelable.h", "utils/Errors.h"};
+
+  unique_ptr<ClassDecl> parcel_class{
+      new ClassDecl{parcel.GetName(), "::android::Parcelable"}};
+  for (const auto& field : parcel.GetFields()) {
+    const Type* type = field->GetType().GetLanguageType<Type>();
+    type->GetHeaders(&includes);
+    // Zero primitives rather than leave them uninitialized, as they would
+    // otherwise be marshalled as whatever was in memory.
+    const bool needs_init =
+        type->IsCppPrimitive() && !field->GetType().IsArray();
+    parcel_class->AddPublic(unique_ptr<Declaration>{new LiteralDecl{
+        StringPrintf("%s %s%s;\n", type->CppType().c_str(),
+                     field->GetName().c_str(), (needs_init) ? "{}" : "")}});
+  }
+
+  parcel_class->AddPublic(unique_ptr<Declaration>{new MethodDecl{
+      kAndroidStatusLiteral, "readFromParcel",
+      ArgList{StringPrintf("const %s* %s", kAndroidParcelLiteral,
+                           kParcelVarName)},
+      MethodDecl::IS_OVERRIDE}});
+  parcel_class->AddPublic(unique_ptr<Declaration>{new MethodDecl{
+      kAndroidStatusLiteral, "writeToParcel",
+      ArgList{StringPrintf("%s* %s", kAndroidParcelLiteral, kParcelVarName)},
+      MethodDecl::IS_OVERRIDE | MethodDecl::IS_CONST}});
+
+  return unique_ptr<Document>{new CppHeader{
+      BuildHeaderGuard(parcel.GetPackage(), parcel.GetName()),
+      vector<string>(includes.begin(), includes.end()),
+      NestInNamespaces(std::move(parcel_class), parcel.GetSplitPackage())}};
+}
+
+unique_ptr<Document> BuildParcelSource(const TypeNamespace& /* types */,
+                                       const AidlStructuredParcelable& parcel) {
+  if (parcel.IsFixedSize()) {
+    return BuildFixedSizeParcelSource(parcel);
+  }
+  // Both directions marshal the fields one after another, with no size or
+  // version header, returning at the first error.
+  unique_ptr<MethodImpl> read{new MethodImpl{
+      kAndroidStatusLiteral, parcel.GetName(), "readFromParcel",
+      ArgList{StringPrintf("const %s* %s", kAndroidParcelLiteral,
+                           kParcelVarName)}}};
+  StatementBlock* read_block = read->GetStatementBlock();
+  read_block->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                                      kAndroidStatusVarName,
+                                      kAndroidStatusOk));
+  for (const auto& field : parcel.GetFields()) {
+    const Type* type = field->GetType().GetLanguageType<Type>();
+    read_block->AddStatement(new Assignment(
+        kAndroidStatusVarName,
+        BuildParcelCall(*type, type->ReadFromParcelMethod(), kParcelVarName,
+                        true, "&" + field->GetName())));
+    read_block->AddStatement(ReturnOnStatusNotOk());
+  }
+  read_block->AddLiteral(StringPrintf("return %s", kAndroidStatusVarName));
+
+  unique_ptr<MethodImpl> write{new MethodImpl{
+      kAndroidStatusLiteral, parcel.GetName(), "writeToParcel",
+      ArgList{StringPrintf("%s* %s", kAndroidParcelLiteral, kParcelVarName)},
+      true /* const method */}};
+  StatementBlock* write_block = write->GetStatementBlock();
+  write_block->AddLiteral(StringPrintf("%s %s = %s", kAndroidStatusLiteral,
+                                       kAndroidStatusVarName,
+                                       kAndroidStatusOk));
+  for (const auto& field : parcel.GetFields()) {
+    const Type* type = field->GetType().GetLanguageType<Type>();
+    write_block->AddStatement(new Assignment(
+        kAndroidStatusVarName,
+        BuildParcelCall(*type, type->WriteToParcelMethod(), kParcelVarName,
+                        true, type->WriteCast(field->GetName()))));
+    write_block->AddStatement(ReturnOnStatusNotOk());
+  }
+  write_block->AddLiteral(StringPrintf("return %s", kAndroidStatusVarName));
+
+  vector<unique_ptr<Declaration>> file_decls;
+  file_decls.push_back(std::move(read));
+  file_decls.push_back(std::move(write));
+  return unique_ptr<Document>{new CppSource{
+      {HeaderFile(parcel, false), kParcelHeader},
+      NestInNamespaces(std::move(file_decls), parcel.GetSplitPackage())}};
+}
+
 bool WriteHeader(const CppOptions& options,
                  const TypeNamespace& types,
                  const AidlInterface& interface,
                  const IoDelegate& io_delegate,
-                 ClassNames header_type) {
+                 ClassNames header_type,
+                 const string& hash_line) {
   unique_ptr<Document> header;
   switch (header_type) {
     case ClassNames::INTERFACE:
       header = BuildInterfaceHeader(types, interface);
       break;
     case ClassNames::CLIENT:
-      header = BuildClientHeader(types, interface);
+      header = BuildClientHeader(types, interface, options.GenerateAsync(),
+                                 options.GenerateCoroutines());
       break;
     case ClassNames::SERVER:
       header = BuildServerHeader(types, interface);
       break;
+    case ClassNames::FORWARD:
+      header = BuildForwardDeclarationHeader(types, interface);
+      break;
     default:
       LOG(FATAL) << "aidl internal error";
   }
@@ -729,6 +2038,7 @@ bool WriteHeader(const CppOptions& options,
   const string header_path = options.OutputHeaderDir() + OS_PATH_SEPARATOR +
                              HeaderFile(interface, header_type);
   unique_ptr<CodeWriter> code_writer(io_delegate.GetCodeWriter(header_path));
+  code_writer->Write("%s\n", hash_line.c_str());
   header->Write(code_writer.get());
 
   const bool success = code_writer->Close();
@@ -761,15 +2071,107 @@ string HeaderFile(const AidlInterface& interface,
   return file_path;
 }
 
+string HeaderFile(const AidlStructuredParcelable& parcel, bool use_os_sep) {
+  string file_path = parcel.GetCppHeader();
+  if (use_os_sep) {
+    for (char& c : file_path) {
+      if (c == '/') {
+        c = OS_PATH_SEPARATOR;
+      }
+    }
+  }
+  return file_path;
+}
+
+bool GenerateCppParcel(const CppOptions& options,
+                       const TypeNamespace& types,
+                       const AidlStructuredParcelable& parcel,
+                       const IoDelegate& io_delegate) {
+  if (parcel.GetSplitPackage().empty()) {
+    LOG(ERROR) << "C++ generation requires a package declaration for "
+                  "parcelable " << parcel.GetName();
+    return false;
+  }
+
+  auto header = BuildParcelHeader(types, parcel);
+  auto source = BuildParcelSource(types, parcel);
+
+  if (!io_delegate.CreatedNestedDirs(options.OutputHeaderDir(),
+                                     parcel.GetSplitPackage())) {
+    LOG(ERROR) << "Failed to create directory structure for headers.";
+    return false;
+  }
+
+  const string header_path = options.OutputHeaderDir() + OS_PATH_SEPARATOR +
+                             HeaderFile(parcel);
+  unique_ptr<CodeWriter> header_writer(io_delegate.GetCodeWriter(header_path));
+  header->Write(header_writer.get());
+  if (!header_writer->Close()) {
+    io_delegate.RemovePath(header_path);
+    return false;
+  }
+
+  unique_ptr<CodeWriter> writer = io_delegate.GetCodeWriter(
+      options.OutputCppFilePath());
+  source->Write(writer.get());
+
+  const bool success = writer->Close();
+  if (!success) {
+    io_delegate.RemovePath(options.OutputCppFilePath());
+  }
+
+  return success;
+}
+
+namespace {
+
+// The source file followed by the headers generated for |interface|.
+vector<string> OutputPaths(const CppOptions& options,
+                           const AidlInterface& interface) {
+  vector<string> paths{options.OutputCppFilePath()};
+  for (ClassNames header_type : {ClassNames::FORWARD, ClassNames::INTERFACE,
+                                 ClassNames::CLIENT, ClassNames::SERVER}) {
+    paths.push_back(options.OutputHeaderDir() + OS_PATH_SEPARATOR +
+                    HeaderFile(interface, header_type));
+  }
+  return paths;
+}
+
+// True if every output of |interface| already starts with |hash_line|, so
+// that regenerating would not change any of them.
+bool OutputsAreCurrent(const CppOptions& options,
+                       const AidlInterface& interface,
+                       const IoDelegate& io_delegate,
+                       const string& hash_line) {
+  for (const string& path : OutputPaths(options, interface)) {
+    unique_ptr<LineReader> reader = io_delegate.GetLineReader(path);
+    string line;
+    if (!reader || !reader->ReadLine(&line) || line != hash_line) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 bool GenerateCpp(const CppOptions& options,
                  const TypeNamespace& types,
                  const AidlInterface& interface,
-                 const IoDelegate& io_delegate) {
-  auto interface_src = BuildInterfaceSource(types, interface);
-  auto client_src = BuildClientSource(types, interface);
-  auto server_src = BuildServerSource(types, interface);
+                 const IoDelegate& io_delegate,
+                 const DispatchProfile* profile) {
+  // Leave the outputs, and everything that depends on them, alone if the
+  // interface only changed in comments or formatting.
+  const string hash_line =
+      SemanticHashLine(GetSemanticHash(options, interface, profile));
+  if (options.KeepCurrentOutputs() &&
+      OutputsAreCurrent(options, interface, io_delegate, hash_line)) {
+    return true;
+  }
 
-  if (!interface_src || !client_src || !server_src) {
+  auto interface_src = BuildInterfaceSource(types, interface,
+                                            options.GenerateClient());
+  if (!interface_src) {
     return false;
   }
 
@@ -780,23 +2182,42 @@ bool GenerateCpp(const CppOptions& options,
   }
 
   if (!WriteHeader(options, types, interface, io_delegate,
-                   ClassNames::INTERFACE) ||
+                   ClassNames::FORWARD, hash_line) ||
       !WriteHeader(options, types, interface, io_delegate,
-                   ClassNames::CLIENT) ||
+                   ClassNames::INTERFACE, hash_line) ||
       !WriteHeader(options, types, interface, io_delegate,
-                   ClassNames::SERVER)) {
+                   ClassNames::CLIENT, hash_line) ||
+      !WriteHeader(options, types, interface, io_delegate,
+                   ClassNames::SERVER, hash_line)) {
     return false;
   }
 
   unique_ptr<CodeWriter> writer = io_delegate.GetCodeWriter(
       options.OutputCppFilePath());
+  writer->Write("%s\n", hash_line.c_str());
   interface_src->Write(writer.get());
-  client_src->Write(writer.get());
-  server_src->Write(writer.get());
 
-  const bool success = writer->Close();
+  // Headers are written regardless, but the source only implements the
+  // halves of the interface that were asked for.  Those are written a method
+  // at a time, so that interfaces with a great many methods need not be held
+  // in memory all at once.
+  bool success = true;
+  if (options.GenerateClient()) {
+    success = StreamClientSource(types, interface, options.GenerateAsync(),
+                                 options.GenerateCoroutines(), writer.get());
+  }
+  if (success && options.GenerateServer()) {
+    success = StreamServerSource(types, interface, options.UseDispatchTable(),
+                                 profile, writer.get());
+  }
+
+  success = writer->Close() && success;
   if (!success) {
-    io_delegate.RemovePath(options.OutputCppFilePath());
+    // The headers carry the new hash, so leaving them behind without the
+    // source would make the next run think the outputs are current.
+    for (const string& path : OutputPaths(options, interface)) {
+      io_delegate.RemovePath(path);
+    }
   }
 
   return success;
@@ -27,12 +27,27 @@
 
 namespace android {
 namespace aidl {
+
+class DispatchProfile;
+
 namespace cpp {
 
+// |profile| lays out the server's onTransact, as in BuildServerSource().
+// Every output starts with a line recording the semantic hash of
+// |parsed_doc|, and if all of them already carry the current hash they are
+// left untouched.
 bool GenerateCpp(const CppOptions& options,
                  const cpp::TypeNamespace& types,
                  const AidlInterface& parsed_doc,
-                 const IoDelegate& io_delegate);
+                 const IoDelegate& io_delegate,
+                 const DispatchProfile* profile = nullptr);
+
+// Generates the C++ class of a structured parcelable: a header declaring it
+// and a source file implementing its marshalling.
+bool GenerateCppParcel(const CppOptions& options,
+                       const cpp::TypeNamespace& types,
+                       const AidlStructuredParcelable& parcel,
+                       const IoDelegate& io_delegate);
 
 // These roughly correspond to the various class names in the C++ hierarchy:
 enum class ClassNames {
@@ -40,6 +55,7 @@ enum class ClassNames {
   CLIENT,     // BpFoo
   SERVER,     // BnFoo
   INTERFACE,  // IFoo
+  FORWARD,    // IFooFwd (only a header, forward declaring IFoo).
 };
 
 // Generate the relative path to a header file.  If |use_os_sep| we'll use the
@@ -47,20 +63,56 @@ enum class ClassNames {
 // including headers.
 std::string HeaderFile(const AidlInterface& interface, ClassNames class_type,
                        bool use_os_sep = true);
+std::string HeaderFile(const AidlStructuredParcelable& parcel,
+                       bool use_os_sep = true);
 
 namespace internals {
+// With |generate_async|, the client also gets ...Async() flavors of each
+// two-way method that run the transaction on an AsyncExecutor, and with
+// |generate_coroutines| as well, co_await-able ...Co() flavors.
 std::unique_ptr<Document> BuildClientSource(const TypeNamespace& types,
-                                            const AidlInterface& parsed_doc);
-std::unique_ptr<Document> BuildServerSource(const TypeNamespace& types,
-                                            const AidlInterface& parsed_doc);
+                                            const AidlInterface& parsed_doc,
+                                            bool generate_async = false,
+                                            bool generate_coroutines = false);
+// With |use_dispatch_table|, onTransact indexes a table of per-method
+// handlers rather than switching over every transaction inline.  Otherwise a
+// |profile| puts the hot transactions first in the switch and moves the cold
+// ones out to handlers.
+std::unique_ptr<Document> BuildServerSource(
+    const TypeNamespace& types, const AidlInterface& parsed_doc,
+    bool use_dispatch_table = false,
+    const DispatchProfile* profile = nullptr);
+// Write the same as the Documents built by BuildClientSource() and
+// BuildServerSource(), but build and free them a method at a time.
+bool StreamClientSource(const TypeNamespace& types,
+                        const AidlInterface& parsed_doc,
+                        bool generate_async, bool generate_coroutines,
+                        CodeWriter* to);
+bool StreamServerSource(const TypeNamespace& types,
+                        const AidlInterface& parsed_doc,
+                        bool use_dispatch_table,
+                        const DispatchProfile* profile, CodeWriter* to);
+// Without |generate_client|, IFoo::asInterface() only returns local
+// implementations, so that BpFoo need not be linked in.
 std::unique_ptr<Document> BuildInterfaceSource(const TypeNamespace& types,
-                                               const AidlInterface& parsed_doc);
+                                               const AidlInterface& parsed_doc,
+                                               bool generate_client = true);
 std::unique_ptr<Document> BuildClientHeader(const TypeNamespace& types,
-                                            const AidlInterface& parsed_doc);
+                                            const AidlInterface& parsed_doc,
+                                            bool generate_async = false,
+                                            bool generate_coroutines = false);
 std::unique_ptr<Document> BuildServerHeader(const TypeNamespace& types,
                                             const AidlInterface& parsed_doc);
 std::unique_ptr<Document> BuildInterfaceHeader(const TypeNamespace& types,
                                                const AidlInterface& parsed_doc);
+// Declares IFoo, the classes its methods take by reference, and IFooPtr for
+// ::android::sp<IFoo>, without including any of their definitions.
+std::unique_ptr<Document> BuildForwardDeclarationHeader(
+    const TypeNamespace& types, const AidlInterface& parsed_doc);
+std::unique_ptr<Document> BuildParcelHeader(
+    const TypeNamespace& types, const AidlStructuredParcelable& parcel);
+std::unique_ptr<Document> BuildParcelSource(
+    const TypeNamespace& types, const AidlStructuredParcelable& parcel);
 }
 }  // namespace cpp
 }  // namespace aidl
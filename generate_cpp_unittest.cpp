@@ -23,6 +23,7 @@
 #include "aidl_language.h"
 #include "ast_cpp.h"
 #include "code_writer.h"
+#include "dispatch_profile.h"
 #include "generate_cpp.h"
 #include "os.h"
 #include "tests/fake_io_delegate.h"
@@ -88,6 +89,7 @@ virtual ~BpComplexTypeInterface() = default;
 const char kExpectedComplexTypeClientSourceOutput[] =
 R"(#include <android/os/BpComplexTypeInterface.h>
 #include <binder/Parcel.h>
+#include <foo/IFooType.h>
 
 namespace android {
 
@@ -102,6 +104,7 @@ BpComplexTypeInterface::BpComplexTypeInterface(const ::android::sp<::android::IB
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(SEND_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -147,6 +150,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(PIFF_REQUEST_MAX_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -169,6 +173,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(TAKESABINDER_REQUEST_MAX_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -202,6 +207,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(STRINGLISTMETHOD_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -239,6 +245,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(BINDERLISTMETHOD_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -276,6 +283,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(TAKESAFILEDESCRIPTOR_REQUEST_MAX_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -309,6 +317,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(TAKESAFILEDESCRIPTORARRAY_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -348,6 +357,7 @@ R"(#ifndef AIDL_GENERATED_ANDROID_OS_BN_COMPLEX_TYPE_INTERFACE_H_
 
 #include <binder/IInterface.h>
 #include <android/os/IComplexTypeInterface.h>
+#include <foo/IFooType.h>
 
 namespace android {
 
@@ -356,6 +366,8 @@ namespace os {
 class BnComplexTypeInterface : public ::android::BnInterface<IComplexTypeInterface> {
 public:
 ::android::status_t onTransact(uint32_t _aidl_code, const ::android::Parcel& _aidl_data, ::android::Parcel* _aidl_reply, uint32_t _aidl_flags = 0) override;
+static const char* getTransactionName(uint32_t _aidl_code);
+static int32_t getMaxTransactionId();
 };  // class BnComplexTypeInterface
 
 }  // namespace os
@@ -581,6 +593,28 @@ _aidl_ret_status = ::android::binder::Status::fromExceptionCode(::android::binde
 return _aidl_ret_status;
 }
 
+constexpr const char* _aidl_transaction_names[] = {
+"Send",
+"Piff",
+"TakesABinder",
+"StringListMethod",
+"BinderListMethod",
+"TakesAFileDescriptor",
+"TakesAFileDescriptorArray",
+};
+
+const char* BnComplexTypeInterface::getTransactionName(uint32_t _aidl_code) {
+const uint32_t _aidl_index = _aidl_code - ::android::IBinder::FIRST_CALL_TRANSACTION;
+if (_aidl_index < 7) {
+return _aidl_transaction_names[_aidl_index];
+}
+return nullptr;
+}
+
+int32_t BnComplexTypeInterface::getMaxTransactionId() {
+return 6;
+}
+
 }  // namespace os
 
 }  // namespace android
@@ -590,11 +624,11 @@ const char kExpectedComplexTypeInterfaceHeaderOutput[] =
 R"(#ifndef AIDL_GENERATED_ANDROID_OS_I_COMPLEX_TYPE_INTERFACE_H_
 #define AIDL_GENERATED_ANDROID_OS_I_COMPLEX_TYPE_INTERFACE_H_
 
+#include <android/os/IComplexTypeInterfaceFwd.h>
 #include <binder/IBinder.h>
 #include <binder/IInterface.h>
 #include <binder/Status.h>
 #include <cstdint>
-#include <foo/IFooType.h>
 #include <nativehelper/ScopedFd.h>
 #include <utils/String16.h>
 #include <utils/StrongPointer.h>
@@ -626,6 +660,24 @@ enum Call {
   TAKESAFILEDESCRIPTOR = ::android::IBinder::FIRST_CALL_TRANSACTION + 5,
   TAKESAFILEDESCRIPTORARRAY = ::android::IBinder::FIRST_CALL_TRANSACTION + 6,
 };
+static constexpr size_t SEND_REQUEST_MIN_SIZE = 84;
+static constexpr size_t SEND_REPLY_MIN_SIZE = 16;
+static constexpr size_t PIFF_REQUEST_MIN_SIZE = 80;
+static constexpr size_t PIFF_REQUEST_MAX_SIZE = 80;
+static constexpr size_t TAKESABINDER_REQUEST_MIN_SIZE = 100;
+static constexpr size_t TAKESABINDER_REQUEST_MAX_SIZE = 100;
+static constexpr size_t TAKESABINDER_REPLY_MIN_SIZE = 28;
+static constexpr size_t TAKESABINDER_REPLY_MAX_SIZE = 28;
+static constexpr size_t STRINGLISTMETHOD_REQUEST_MIN_SIZE = 80;
+static constexpr size_t STRINGLISTMETHOD_REPLY_MIN_SIZE = 12;
+static constexpr size_t BINDERLISTMETHOD_REQUEST_MIN_SIZE = 80;
+static constexpr size_t BINDERLISTMETHOD_REPLY_MIN_SIZE = 12;
+static constexpr size_t TAKESAFILEDESCRIPTOR_REQUEST_MIN_SIZE = 100;
+static constexpr size_t TAKESAFILEDESCRIPTOR_REQUEST_MAX_SIZE = 100;
+static constexpr size_t TAKESAFILEDESCRIPTOR_REPLY_MIN_SIZE = 28;
+static constexpr size_t TAKESAFILEDESCRIPTOR_REPLY_MAX_SIZE = 28;
+static constexpr size_t TAKESAFILEDESCRIPTORARRAY_REQUEST_MIN_SIZE = 80;
+static constexpr size_t TAKESAFILEDESCRIPTORARRAY_REPLY_MIN_SIZE = 8;
 };  // class IComplexTypeInterface
 
 }  // namespace os
@@ -634,6 +686,32 @@ enum Call {
 
 #endif  // AIDL_GENERATED_ANDROID_OS_I_COMPLEX_TYPE_INTERFACE_H_)";
 
+const char kExpectedComplexTypeForwardDeclarationHeaderOutput[] =
+R"(#ifndef AIDL_GENERATED_ANDROID_OS_I_COMPLEX_TYPE_INTERFACE_FWD_H_
+#define AIDL_GENERATED_ANDROID_OS_I_COMPLEX_TYPE_INTERFACE_FWD_H_
+
+#include <utils/StrongPointer.h>
+
+namespace android {
+
+namespace os {
+
+class IComplexTypeInterface;
+
+using IComplexTypeInterfacePtr = ::android::sp<IComplexTypeInterface>;
+
+}  // namespace os
+
+}  // namespace android
+
+namespace foo {
+
+class IFooType;
+
+}  // namespace foo
+
+#endif  // AIDL_GENERATED_ANDROID_OS_I_COMPLEX_TYPE_INTERFACE_FWD_H_)";
+
 const char kExpectedComplexTypeInterfaceSourceOutput[] =
 R"(#include <android/os/IComplexTypeInterface.h>
 #include <android/os/BpComplexTypeInterface.h>
@@ -649,6 +727,35 @@ IMPLEMENT_META_INTERFACE(ComplexTypeInterface, "android.os.IComplexTypeInterface
 }  // namespace android
 )";
 
+const char kExpectedServerOnlyInterfaceSourceOutput[] =
+R"(#include <android/os/IComplexTypeInterface.h>
+
+namespace android {
+
+namespace os {
+
+const ::android::String16 IComplexTypeInterface::descriptor("android.os.IComplexTypeInterface");
+
+const ::android::String16& IComplexTypeInterface::getInterfaceDescriptor() const {
+return IComplexTypeInterface::descriptor;
+}
+
+::android::sp<IComplexTypeInterface> IComplexTypeInterface::asInterface(const ::android::sp<::android::IBinder>& _aidl_impl) {
+::android::sp<IComplexTypeInterface> _aidl_return;
+if (_aidl_impl != nullptr) {
+_aidl_return = static_cast<IComplexTypeInterface*>(_aidl_impl->queryLocalInterface(IComplexTypeInterface::descriptor).get());
+}
+return _aidl_return;
+}
+
+IComplexTypeInterface::IComplexTypeInterface() {}
+IComplexTypeInterface::~IComplexTypeInterface() {}
+
+}  // namespace os
+
+}  // namespace android
+)";
+
 }  // namespace
 
 class ASTTest : public ::testing::Test {
@@ -744,6 +851,14 @@ TEST_F(ComplexTypeInterfaceASTTest, GeneratesInterfaceHeader) {
   Compare(doc.get(), kExpectedComplexTypeInterfaceHeaderOutput);
 }
 
+TEST_F(ComplexTypeInterfaceASTTest, GeneratesForwardDeclarationHeader) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  unique_ptr<Document> doc =
+      internals::BuildForwardDeclarationHeader(types_, *interface);
+  Compare(doc.get(), kExpectedComplexTypeForwardDeclarationHeaderOutput);
+}
+
 TEST_F(ComplexTypeInterfaceASTTest, GeneratesInterfaceSource) {
   unique_ptr<AidlInterface> interface = Parse();
   ASSERT_NE(interface, nullptr);
@@ -751,6 +866,907 @@ TEST_F(ComplexTypeInterfaceASTTest, GeneratesInterfaceSource) {
   Compare(doc.get(), kExpectedComplexTypeInterfaceSourceOutput);
 }
 
+TEST_F(ComplexTypeInterfaceASTTest, GeneratesServerOnlyInterfaceSource) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  unique_ptr<Document> doc = internals::BuildInterfaceSource(
+      types_, *interface, false /* generate_client */);
+  Compare(doc.get(), kExpectedServerOnlyInterfaceSourceOutput);
+}
+
+TEST_F(ComplexTypeInterfaceASTTest, StreamsSameSourcesAsDocuments) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  io_delegate_.SetFileContents("calls.txt", "TakesABinder 1000\nSend 2\n");
+  DispatchProfile profile;
+  ASSERT_TRUE(profile.Load("calls.txt", io_delegate_));
+
+  for (bool generate_async : {false, true}) {
+    string expected;
+    internals::BuildClientSource(types_, *interface, generate_async,
+                                 generate_async)
+        ->Write(GetStringWriter(&expected).get());
+    string actual;
+    EXPECT_TRUE(internals::StreamClientSource(types_, *interface,
+                                              generate_async, generate_async,
+                                              GetStringWriter(&actual).get()));
+    EXPECT_EQ(expected, actual);
+  }
+
+  for (bool use_dispatch_table : {false, true}) {
+    for (const DispatchProfile* p : {static_cast<DispatchProfile*>(nullptr),
+                                     &profile}) {
+      string expected;
+      internals::BuildServerSource(types_, *interface, use_dispatch_table, p)
+          ->Write(GetStringWriter(&expected).get());
+      string actual;
+      EXPECT_TRUE(internals::StreamServerSource(
+          types_, *interface, use_dispatch_table, p,
+          GetStringWriter(&actual).get()));
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+const char kDispatchTableInterfaceAIDL[] =
+R"(package a;
+interface IFoo {
+  int Add(int a, int b);
+  oneway void Ping();
+})";
+
+const char kExpectedDispatchTableServerSourceOutput[] =
+R"(#include <a/BnFoo.h>
+#include <binder/Parcel.h>
+
+namespace a {
+
+static ::android::status_t _aidl_handle_Add(BnFoo* _aidl_self, const ::android::Parcel& _aidl_data, ::android::Parcel* _aidl_reply) {
+::android::status_t _aidl_ret_status = ::android::OK;
+int32_t in_a;
+int32_t in_b;
+int32_t _aidl_return;
+if (!(_aidl_data.checkInterface(_aidl_self))) {
+_aidl_ret_status = ::android::BAD_TYPE;
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_data.readInt32(&in_a);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_data.readInt32(&in_b);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+::android::binder::Status _aidl_status(_aidl_self->Add(in_a, in_b, &_aidl_return));
+_aidl_ret_status = _aidl_status.writeToParcel(_aidl_reply);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+if (!_aidl_status.isOk()) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_reply->writeInt32(_aidl_return);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+return _aidl_ret_status;
+}
+
+static ::android::status_t _aidl_handle_Ping(BnFoo* _aidl_self, const ::android::Parcel& _aidl_data, ::android::Parcel* /* _aidl_reply */) {
+::android::status_t _aidl_ret_status = ::android::OK;
+if (!(_aidl_data.checkInterface(_aidl_self))) {
+_aidl_ret_status = ::android::BAD_TYPE;
+return _aidl_ret_status;
+}
+::android::binder::Status _aidl_status(_aidl_self->Ping());
+return _aidl_ret_status;
+}
+
+typedef ::android::status_t (*_aidl_handler_t)(BnFoo*, const ::android::Parcel&, ::android::Parcel*);
+constexpr _aidl_handler_t _aidl_handlers[] = {
+_aidl_handle_Add,
+_aidl_handle_Ping,
+};
+
+::android::status_t BnFoo::onTransact(uint32_t _aidl_code, const ::android::Parcel& _aidl_data, ::android::Parcel* _aidl_reply, uint32_t _aidl_flags) {
+::android::status_t _aidl_ret_status = ::android::OK;
+const uint32_t _aidl_index = _aidl_code - ::android::IBinder::FIRST_CALL_TRANSACTION;
+if (_aidl_index < 2) {
+_aidl_ret_status = _aidl_handlers[_aidl_index](this, _aidl_data, _aidl_reply);
+}
+else {
+_aidl_ret_status = ::android::BBinder::onTransact(_aidl_code, _aidl_data, _aidl_reply, _aidl_flags);
+}
+if (_aidl_ret_status == ::android::UNEXPECTED_NULL) {
+_aidl_ret_status = ::android::binder::Status::fromExceptionCode(::android::binder::Status::EX_NULL_POINTER).writeToParcel(_aidl_reply);
+}
+return _aidl_ret_status;
+}
+
+constexpr const char* _aidl_transaction_names[] = {
+"Add",
+"Ping",
+};
+
+const char* BnFoo::getTransactionName(uint32_t _aidl_code) {
+const uint32_t _aidl_index = _aidl_code - ::android::IBinder::FIRST_CALL_TRANSACTION;
+if (_aidl_index < 2) {
+return _aidl_transaction_names[_aidl_index];
+}
+return nullptr;
+}
+
+int32_t BnFoo::getMaxTransactionId() {
+return 1;
+}
+
+}  // namespace a
+)";
+
+class DispatchTableASTTest : public ASTTest {
+ public:
+  DispatchTableASTTest()
+      : ASTTest("a/IFoo.aidl", kDispatchTableInterfaceAIDL) {}
+};
+
+TEST_F(DispatchTableASTTest, GeneratesServerSource) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  unique_ptr<Document> doc = internals::BuildServerSource(
+      types_, *interface, true /* use_dispatch_table */);
+  Compare(doc.get(), kExpectedDispatchTableServerSourceOutput);
+}
+
+const char kExpectedProfiledServerSourceOutput[] =
+R"(#include <a/BnFoo.h>
+#include <binder/Parcel.h>
+
+namespace a {
+
+static __attribute__((cold, noinline)) ::android::status_t _aidl_handle_Add(BnFoo* _aidl_self, const ::android::Parcel& _aidl_data, ::android::Parcel* _aidl_reply) {
+::android::status_t _aidl_ret_status = ::android::OK;
+int32_t in_a;
+int32_t in_b;
+int32_t _aidl_return;
+if (!(_aidl_data.checkInterface(_aidl_self))) {
+_aidl_ret_status = ::android::BAD_TYPE;
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_data.readInt32(&in_a);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_data.readInt32(&in_b);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+::android::binder::Status _aidl_status(_aidl_self->Add(in_a, in_b, &_aidl_return));
+_aidl_ret_status = _aidl_status.writeToParcel(_aidl_reply);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+if (!_aidl_status.isOk()) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_reply->writeInt32(_aidl_return);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+return _aidl_ret_status;
+}
+
+::android::status_t BnFoo::onTransact(uint32_t _aidl_code, const ::android::Parcel& _aidl_data, ::android::Parcel* _aidl_reply, uint32_t _aidl_flags) {
+::android::status_t _aidl_ret_status = ::android::OK;
+switch (_aidl_code) {
+case Call::PING:
+{
+if (!(_aidl_data.checkInterface(this))) {
+_aidl_ret_status = ::android::BAD_TYPE;
+break;
+}
+::android::binder::Status _aidl_status(Ping());
+}
+break;
+case Call::ADD:
+{
+_aidl_ret_status = _aidl_handle_Add(this, _aidl_data, _aidl_reply);
+}
+break;
+default:
+{
+_aidl_ret_status = ::android::BBinder::onTransact(_aidl_code, _aidl_data, _aidl_reply, _aidl_flags);
+}
+break;
+}
+if (_aidl_ret_status == ::android::UNEXPECTED_NULL) {
+_aidl_ret_status = ::android::binder::Status::fromExceptionCode(::android::binder::Status::EX_NULL_POINTER).writeToParcel(_aidl_reply);
+}
+return _aidl_ret_status;
+}
+
+constexpr const char* _aidl_transaction_names[] = {
+"Add",
+"Ping",
+};
+
+const char* BnFoo::getTransactionName(uint32_t _aidl_code) {
+const uint32_t _aidl_index = _aidl_code - ::android::IBinder::FIRST_CALL_TRANSACTION;
+if (_aidl_index < 2) {
+return _aidl_transaction_names[_aidl_index];
+}
+return nullptr;
+}
+
+int32_t BnFoo::getMaxTransactionId() {
+return 1;
+}
+
+}  // namespace a
+)";
+
+TEST_F(DispatchTableASTTest, OrdersServerSourceByProfile) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  io_delegate_.SetFileContents("calls.txt", "Ping 1000\nAdd 2\n");
+  DispatchProfile profile;
+  ASSERT_TRUE(profile.Load("calls.txt", io_delegate_));
+  unique_ptr<Document> doc = internals::BuildServerSource(
+      types_, *interface, false /* use_dispatch_table */, &profile);
+  Compare(doc.get(), kExpectedProfiledServerSourceOutput);
+}
+
+const char kAsyncInterfaceAIDL[] =
+R"(package a;
+interface IFoo {
+  int Add(int a, inout int[] b, out List<String> c);
+  oneway void Ping();
+})";
+
+const char kExpectedAsyncClientHeaderOutput[] =
+R"(#ifndef AIDL_GENERATED_A_BP_FOO_H_
+#define AIDL_GENERATED_A_BP_FOO_H_
+
+#include <binder/IBinder.h>
+#include <binder/IInterface.h>
+#include <utils/Errors.h>
+#include <a/IFoo.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <aidl/async_executor.h>
+
+namespace a {
+
+class BpFoo : public ::android::BpInterface<IFoo> {
+public:
+explicit BpFoo(const ::android::sp<::android::IBinder>& _aidl_impl);
+virtual ~BpFoo() = default;
+::android::binder::Status Add(int32_t a, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return) override;
+::android::binder::Status Ping() override;
+::std::future<::android::binder::Status> AddAsync(int32_t a, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return);
+void AddAsync(int32_t a, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return, ::std::function<void(::android::binder::Status)> _aidl_callback);
+void setAsyncExecutor(::android::aidl::AsyncExecutor* executor);
+private:
+::android::aidl::AsyncExecutor* _aidl_executor = ::android::aidl::AsyncExecutor::Default();
+};  // class BpFoo
+
+}  // namespace a
+
+#endif  // AIDL_GENERATED_A_BP_FOO_H_)";
+
+const char kExpectedAsyncClientSourceOutput[] =
+R"(#include <a/BpFoo.h>
+#include <binder/Parcel.h>
+
+namespace a {
+
+BpFoo::BpFoo(const ::android::sp<::android::IBinder>& _aidl_impl)
+    : BpInterface<IFoo>(_aidl_impl){
+}
+
+::android::binder::Status BpFoo::Add(int32_t a, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return) {
+::android::Parcel _aidl_data;
+::android::Parcel _aidl_reply;
+::android::status_t _aidl_ret_status = ::android::OK;
+::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(ADD_REQUEST_MIN_SIZE);
+_aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_data.writeInt32(a);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_data.writeInt32Vector(*b);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = remote()->transact(IFoo::ADD, _aidl_data, &_aidl_reply);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_status.readFromParcel(_aidl_reply);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+if (!_aidl_status.isOk()) {
+return _aidl_status;
+}
+_aidl_ret_status = _aidl_reply.readInt32(_aidl_return);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_reply.readInt32Vector(b);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_reply.readString16Vector(c);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_error:
+_aidl_status.setFromStatusT(_aidl_ret_status);
+return _aidl_status;
+}
+
+static ::android::binder::Status _aidl_transact_Add(const ::android::sp<::android::IBinder>& _aidl_remote, const ::android::Parcel& _aidl_data, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return) {
+::android::Parcel _aidl_reply;
+::android::status_t _aidl_ret_status = ::android::OK;
+::android::binder::Status _aidl_status;
+_aidl_ret_status = _aidl_remote->transact(IFoo::ADD, _aidl_data, &_aidl_reply);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_status.readFromParcel(_aidl_reply);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+if (!_aidl_status.isOk()) {
+return _aidl_status;
+}
+_aidl_ret_status = _aidl_reply.readInt32(_aidl_return);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_reply.readInt32Vector(b);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_reply.readString16Vector(c);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_error:
+_aidl_status.setFromStatusT(_aidl_ret_status);
+return _aidl_status;
+}
+
+void BpFoo::AddAsync(int32_t a, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return, ::std::function<void(::android::binder::Status)> _aidl_callback) {
+::std::shared_ptr<::android::Parcel> _aidl_request = ::std::make_shared<::android::Parcel>();
+::android::Parcel& _aidl_data = *_aidl_request;
+::android::sp<::android::IBinder> _aidl_remote = remote();
+::android::status_t _aidl_ret_status = ::android::OK;
+_aidl_data.setDataCapacity(ADD_REQUEST_MIN_SIZE);
+_aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_data.writeInt32(a);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = _aidl_data.writeInt32Vector(*b);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_executor->Post([_aidl_remote, _aidl_request, b, c, _aidl_return, _aidl_callback]() {
+_aidl_callback(_aidl_transact_Add(_aidl_remote, *_aidl_request, b, c, _aidl_return));
+});
+return;
+_aidl_error:
+_aidl_executor->Post([_aidl_callback, _aidl_ret_status]() {
+_aidl_callback(::android::binder::Status::fromStatusT(_aidl_ret_status));
+});
+}
+
+::std::future<::android::binder::Status> BpFoo::AddAsync(int32_t a, ::std::vector<int32_t>* b, ::std::vector<::android::String16>* c, int32_t* _aidl_return) {
+::std::shared_ptr<::std::promise<::android::binder::Status>> _aidl_promise = ::std::make_shared<::std::promise<::android::binder::Status>>();
+AddAsync(a, b, c, _aidl_return, [_aidl_promise](::android::binder::Status _aidl_status) {
+_aidl_promise->set_value(_aidl_status);
+});
+return _aidl_promise->get_future();
+}
+
+::android::binder::Status BpFoo::Ping() {
+::android::Parcel _aidl_data;
+::android::Parcel _aidl_reply;
+::android::status_t _aidl_ret_status = ::android::OK;
+::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(PING_REQUEST_MAX_SIZE);
+_aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_ret_status = remote()->transact(IFoo::PING, _aidl_data, &_aidl_reply, ::android::IBinder::FLAG_ONEWAY);
+if (((_aidl_ret_status) != (::android::OK))) {
+goto _aidl_error;
+}
+_aidl_error:
+_aidl_status.setFromStatusT(_aidl_ret_status);
+return _aidl_status;
+}
+
+void BpFoo::setAsyncExecutor(::android::aidl::AsyncExecutor* executor) {
+_aidl_executor = executor;
+}
+
+}  // namespace a
+)";
+
+class AsyncClientASTTest : public ASTTest {
+ public:
+  AsyncClientASTTest()
+      : ASTTest("a/IFoo.aidl", kAsyncInterfaceAIDL) {}
+};
+
+TEST_F(AsyncClientASTTest, GeneratesClientHeader) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  unique_ptr<Document> doc = internals::BuildClientHeader(
+      types_, *interface, true /* generate_async */);
+  Compare(doc.get(), kExpectedAsyncClientHeaderOutput);
+}
+
+TEST_F(AsyncClientASTTest, GeneratesClientSource) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  unique_ptr<Document> doc = internals::BuildClientSource(
+      types_, *interface, true /* generate_async */);
+  Compare(doc.get(), kExpectedAsyncClientSourceOutput);
+}
+
+TEST_F(AsyncClientASTTest, GeneratesGuardedCoroutineMethods) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  string header;
+  string source;
+  internals::BuildClientHeader(types_, *interface, true, true)->Write(
+      GetStringWriter(&header).get());
+  internals::BuildClientSource(types_, *interface, true, true)->Write(
+      GetStringWriter(&source).get());
+
+  EXPECT_NE(string::npos, header.find("#include <aidl/status_awaitable.h>"));
+  EXPECT_NE(string::npos, header.find(
+      "#ifdef AIDL_HAS_COROUTINES\n"
+      "::android::aidl::StatusAwaitable<::android::binder::Status> AddCo("
+      "int32_t a, ::std::vector<int32_t>* b, "
+      "::std::vector<::android::String16>* c, int32_t* _aidl_return);\n"
+      "#endif  // AIDL_HAS_COROUTINES\n"));
+  EXPECT_NE(string::npos, source.find(
+      "#ifdef AIDL_HAS_COROUTINES\n\n"
+      "::android::aidl::StatusAwaitable<::android::binder::Status> "
+      "BpFoo::AddCo(int32_t a, ::std::vector<int32_t>* b, "
+      "::std::vector<::android::String16>* c, int32_t* _aidl_return) {\n"
+      "::android::aidl::StatusAwaitable<::android::binder::Status> "
+      "_aidl_awaitable;\n"
+      "AddAsync(a, b, c, _aidl_return, _aidl_awaitable.Completer());\n"
+      "return _aidl_awaitable;\n"
+      "}\n\n"
+      "#endif  // AIDL_HAS_COROUTINES\n"));
+  // Oneway methods never block, so they get no asynchronous flavors.
+  EXPECT_EQ(string::npos, source.find("PingCo"));
+}
+
+class SparseIdsASTTest : public ASTTest {
+ public:
+  SparseIdsASTTest()
+      : ASTTest("a/IFoo.aidl",
+                "package a; interface IFoo { void A() = 1; void B() = 16000000; }") {}
+};
+
+TEST_F(SparseIdsASTTest, KeepsSwitchInsteadOfDispatchTable) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  string output;
+  unique_ptr<Document> doc = internals::BuildServerSource(
+      types_, *interface, true /* use_dispatch_table */);
+  doc->Write(GetStringWriter(&output).get());
+  EXPECT_NE(string::npos, output.find("switch (_aidl_code)"));
+  EXPECT_EQ(string::npos, output.find("_aidl_handlers"));
+}
+
+TEST_F(SparseIdsASTTest, LooksUpTransactionNamesWithSwitch) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  string output;
+  unique_ptr<Document> doc = internals::BuildServerSource(
+      types_, *interface, false /* use_dispatch_table */);
+  doc->Write(GetStringWriter(&output).get());
+  // A table would need an entry for every id up to 16000000.
+  EXPECT_EQ(string::npos, output.find("_aidl_transaction_names"));
+  EXPECT_NE(string::npos, output.find(
+      "const char* BnFoo::getTransactionName(uint32_t _aidl_code) {\n"
+      "switch (_aidl_code) {\n"
+      "case Call::A:\n"
+      "{\n"
+      "return \"A\";\n"
+      "}\n"
+      "break;\n"
+      "case Call::B:\n"
+      "{\n"
+      "return \"B\";\n"
+      "}\n"
+      "break;\n"
+      "}\n"
+      "return nullptr;\n"
+      "}\n"));
+  EXPECT_NE(string::npos, output.find(
+      "int32_t BnFoo::getMaxTransactionId() {\n"
+      "return 16000000;\n"
+      "}\n"));
+}
+
+class BatchableASTTest : public ASTTest {
+ public:
+  BatchableASTTest()
+      : ASTTest("a/IFoo.aidl",
+                "package a; interface IFoo {"
+                "  @batchable oneway void Add(int a); int Sum(); }") {}
+};
+
+TEST_F(BatchableASTTest, BatchesClientCalls) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  string interface_header;
+  string client_header;
+  string client_source;
+  internals::BuildInterfaceHeader(types_, *interface)->Write(
+      GetStringWriter(&interface_header).get());
+  internals::BuildClientHeader(types_, *interface)->Write(
+      GetStringWriter(&client_header).get());
+  internals::BuildClientSource(types_, *interface)->Write(
+      GetStringWriter(&client_source).get());
+
+  EXPECT_NE(string::npos, interface_header.find(
+      "AIDL_BATCH = ::android::IBinder::LAST_CALL_TRANSACTION"));
+  EXPECT_NE(string::npos, interface_header.find(
+      "virtual ::android::binder::Status flushBatch() {"));
+  EXPECT_NE(string::npos, client_header.find("virtual ~BpFoo();"));
+  EXPECT_NE(string::npos, client_header.find(
+      "::android::binder::Status flushBatch() override;"));
+  EXPECT_NE(string::npos, client_source.find("BpFoo::~BpFoo() {"));
+  EXPECT_NE(string::npos, client_source.find(
+      "_aidl_ret_status = _aidl_batchCall(IFoo::ADD, _aidl_data);"));
+  EXPECT_EQ(string::npos, client_source.find("IFoo::ADD, _aidl_data, &"));
+  // Sum() must not overtake batched calls.
+  EXPECT_NE(string::npos, client_source.find(
+      "::android::Parcel _aidl_reply;\n"
+      "::android::status_t _aidl_ret_status = ::android::OK;\n"
+      "::android::binder::Status _aidl_status;\n"
+      "_aidl_ret_status = _aidl_flushBatch();"));
+}
+
+TEST_F(BatchableASTTest, DispatchesBatchesWithEitherLayout) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  for (bool use_dispatch_table : {false, true}) {
+    string output;
+    internals::BuildServerSource(types_, *interface, use_dispatch_table)
+        ->Write(GetStringWriter(&output).get());
+    EXPECT_NE(string::npos, output.find("_aidl_dispatch_batch(BnFoo*"))
+        << use_dispatch_table;
+    EXPECT_NE(string::npos, output.find("_aidl_code != IFoo::ADD"))
+        << use_dispatch_table;
+    EXPECT_NE(string::npos, output.find(
+        "_aidl_ret_status = _aidl_dispatch_batch(this, _aidl_data);"))
+        << use_dispatch_table;
+  }
+}
+
+TEST_F(BatchableASTTest, RejectsBatchedCallsThatOverrunTheirBytes) {
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  string output;
+  internals::BuildServerSource(types_, *interface, false)
+      ->Write(GetStringWriter(&output).get());
+  // Entries claiming more bytes than are left are rejected up front, and
+  // entries whose call reads more than they claimed once it returns.
+  EXPECT_NE(string::npos, output.find(
+      "if (_aidl_size < 0 || "
+      "static_cast<size_t>(_aidl_size) > _aidl_data.dataAvail() || "
+      "(_aidl_code != IFoo::ADD)) {\n"
+      "return ::android::BAD_VALUE;\n"
+      "}\n"));
+  EXPECT_NE(string::npos, output.find(
+      "if (_aidl_data.dataPosition() > _aidl_end) {\n"
+      "return ::android::BAD_VALUE;\n"
+      "}\n"
+      "_aidl_data.setDataPosition(_aidl_end);\n"));
+}
+
+TEST_F(BatchableASTTest, RegeneratesOutputsWhenBatchableChanges) {
+  const char* argv[] = {"aidl-cpp", "a/IFoo.aidl", "headers", "output.cpp"};
+  unique_ptr<CppOptions> options = CppOptions::Parse(4, argv);
+  ASSERT_NE(nullptr, options);
+  unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  ASSERT_TRUE(GenerateCpp(*options, types_, *interface, io_delegate_));
+
+  // Compile the same interface without @batchable over those outputs.
+  FakeIoDelegate rerun_io_delegate;
+  rerun_io_delegate.SetFileContents(
+      "a/IFoo.aidl",
+      "package a; interface IFoo { oneway void Add(int a); int Sum(); }");
+  for (const char* path : {"output.cpp", "headers/a/IFoo.h",
+                           "headers/a/IFooFwd.h", "headers/a/BpFoo.h",
+                           "headers/a/BnFoo.h"}) {
+    string contents;
+    ASSERT_TRUE(io_delegate_.GetWrittenContents(path, &contents)) << path;
+    rerun_io_delegate.SetFileContents(path, contents);
+  }
+  TypeNamespace types;
+  types.Init();
+  unique_ptr<AidlInterface> unbatched;
+  std::vector<std::unique_ptr<AidlImport>> imports;
+  ASSERT_EQ(AidlError::OK,
+            ::android::aidl::internals::load_and_validate_aidl(
+                {}, {"."}, "a/IFoo.aidl", rerun_io_delegate, &types,
+                &unbatched, &imports));
+  ASSERT_TRUE(GenerateCpp(*options, types, *unbatched, rerun_io_delegate));
+
+  string header;
+  ASSERT_TRUE(rerun_io_delegate.GetWrittenContents("headers/a/IFoo.h",
+                                                   &header));
+  EXPECT_EQ(string::npos, header.find("flushBatch"));
+  EXPECT_TRUE(rerun_io_delegate.GetWrittenContents("output.cpp", nullptr));
+}
+
+namespace {
+
+const char kStructuredParcelableAIDL[] =
+R"(package a; parcelable Foo { int x; String s; boolean[] b; })";
+
+const char kExpectedParcelHeaderOutput[] =
+R"(#ifndef AIDL_GENERATED_A_FOO_H_
+#define AIDL_GENERATED_A_FOO_H_
+
+#include <binder/Parcelable.h>
+#include <cstdint>
+#include <utils/Errors.h>
+#include <utils/String16.h>
+#include <vector>
+
+namespace a {
+
+class Foo : public ::android::Parcelable {
+public:
+int32_t x{};
+::android::String16 s;
+::std::vector<bool> b;
+::android::status_t readFromParcel(const ::android::Parcel* _aidl_parcel) override;
+::android::status_t writeToParcel(::android::Parcel* _aidl_parcel) const override;
+};  // class Foo
+
+}  // namespace a
+
+#endif  // AIDL_GENERATED_A_FOO_H_)";
+
+const char kExpectedParcelSourceOutput[] =
+R"(#include <a/Foo.h>
+#include <binder/Parcel.h>
+
+namespace a {
+
+::android::status_t Foo::readFromParcel(const ::android::Parcel* _aidl_parcel) {
+::android::status_t _aidl_ret_status = ::android::OK;
+_aidl_ret_status = _aidl_parcel->readInt32(&x);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_parcel->readString16(&s);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_parcel->readBoolVector(&b);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+return _aidl_ret_status;
+}
+
+::android::status_t Foo::writeToParcel(::android::Parcel* _aidl_parcel) const {
+::android::status_t _aidl_ret_status = ::android::OK;
+_aidl_ret_status = _aidl_parcel->writeInt32(x);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_parcel->writeString16(s);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+_aidl_ret_status = _aidl_parcel->writeBoolVector(b);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+return _aidl_ret_status;
+}
+
+}  // namespace a
+)";
+
+}  // namespace
+
+const char kFixedSizeParcelableAIDL[] =
+R"(package a; @FixedSize parcelable Foo { long t; float x; })";
+
+const char kExpectedFixedSizeParcelHeaderOutput[] =
+R"(#ifndef AIDL_GENERATED_A_FOO_H_
+#define AIDL_GENERATED_A_FOO_H_
+
+#include <binder/Parcel.h>
+#include <cstdint>
+#include <type_traits>
+#include <utils/Errors.h>
+#include <vector>
+
+namespace a {
+
+#pragma pack(push, 4)
+
+class Foo {
+public:
+int64_t t{};
+float x{};
+static ::android::status_t readFromParcel(const ::android::Parcel* _aidl_parcel, Foo* _aidl_value);
+static ::android::status_t writeToParcel(::android::Parcel* _aidl_parcel, const Foo& _aidl_value);
+static ::android::status_t readVectorFromParcel(const ::android::Parcel* _aidl_parcel, ::std::vector<Foo>* _aidl_value);
+static ::android::status_t writeVectorToParcel(::android::Parcel* _aidl_parcel, const ::std::vector<Foo>& _aidl_value);
+};  // class Foo
+
+#pragma pack(pop)
+
+static_assert(::std::is_trivially_copyable<Foo>::value, "@FixedSize parcelable Foo must be trivially copyable");
+
+}  // namespace a
+
+#endif  // AIDL_GENERATED_A_FOO_H_)";
+
+const char kExpectedFixedSizeParcelSourceOutput[] =
+R"(#include <a/Foo.h>
+#include <cstring>
+
+namespace a {
+
+::android::status_t Foo::readFromParcel(const ::android::Parcel* _aidl_parcel, Foo* _aidl_value) {
+const void* _aidl_buffer = _aidl_parcel->readInplace(sizeof(Foo));
+if (_aidl_buffer == nullptr) {
+return ::android::NOT_ENOUGH_DATA;
+}
+memcpy(_aidl_value, _aidl_buffer, sizeof(Foo));
+return ::android::OK;
+}
+
+::android::status_t Foo::writeToParcel(::android::Parcel* _aidl_parcel, const Foo& _aidl_value) {
+void* _aidl_buffer = _aidl_parcel->writeInplace(sizeof(Foo));
+if (_aidl_buffer == nullptr) {
+return ::android::NO_MEMORY;
+}
+memcpy(_aidl_buffer, &_aidl_value, sizeof(Foo));
+return ::android::OK;
+}
+
+::android::status_t Foo::readVectorFromParcel(const ::android::Parcel* _aidl_parcel, ::std::vector<Foo>* _aidl_value) {
+int32_t _aidl_size;
+::android::status_t _aidl_ret_status = _aidl_parcel->readInt32(&_aidl_size);
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+if (_aidl_size < 0) {
+return ::android::UNEXPECTED_NULL;
+}
+if (static_cast<size_t>(_aidl_size) > _aidl_parcel->dataAvail() / sizeof(Foo)) {
+return ::android::NOT_ENOUGH_DATA;
+}
+_aidl_value->resize(_aidl_size);
+if (_aidl_size == 0) {
+return ::android::OK;
+}
+const void* _aidl_buffer = _aidl_parcel->readInplace(_aidl_size * sizeof(Foo));
+if (_aidl_buffer == nullptr) {
+return ::android::NOT_ENOUGH_DATA;
+}
+memcpy(_aidl_value->data(), _aidl_buffer, _aidl_size * sizeof(Foo));
+return ::android::OK;
+}
+
+::android::status_t Foo::writeVectorToParcel(::android::Parcel* _aidl_parcel, const ::std::vector<Foo>& _aidl_value) {
+if (_aidl_value.size() > INT32_MAX / sizeof(Foo)) {
+return ::android::BAD_VALUE;
+}
+::android::status_t _aidl_ret_status = _aidl_parcel->writeInt32(static_cast<int32_t>(_aidl_value.size()));
+if (((_aidl_ret_status) != (::android::OK))) {
+return _aidl_ret_status;
+}
+if (_aidl_value.empty()) {
+return ::android::OK;
+}
+void* _aidl_buffer = _aidl_parcel->writeInplace(_aidl_value.size() * sizeof(Foo));
+if (_aidl_buffer == nullptr) {
+return ::android::NO_MEMORY;
+}
+memcpy(_aidl_buffer, _aidl_value.data(), _aidl_value.size() * sizeof(Foo));
+return ::android::OK;
+}
+
+}  // namespace a
+)";
+
+class StructuredParcelableASTTest : public ASTTest {
+ public:
+  StructuredParcelableASTTest()
+      : ASTTest("a/Foo.aidl", kStructuredParcelableAIDL) {}
+  explicit StructuredParcelableASTTest(const string& file_contents)
+      : ASTTest("a/Foo.aidl", file_contents) {}
+
+  unique_ptr<AidlStructuredParcelable> ParseParcelable() {
+    io_delegate_.SetFileContents(file_path_, file_contents_);
+
+    unique_ptr<AidlInterface> interface;
+    unique_ptr<AidlStructuredParcelable> ret;
+    AidlError err = ::android::aidl::internals::load_and_validate_aidl(
+        {},  // no preprocessed files
+        {"."},
+        file_path_,
+        io_delegate_,
+        &types_,
+        &interface,
+        nullptr,  // no imports
+        nullptr,  // no cache
+        &ret);
+
+    if (err != AidlError::OK)
+      return nullptr;
+
+    return ret;
+  }
+};
+
+TEST_F(StructuredParcelableASTTest, GeneratesParcelHeader) {
+  unique_ptr<AidlStructuredParcelable> parcel = ParseParcelable();
+  ASSERT_NE(parcel, nullptr);
+  unique_ptr<Document> doc = internals::BuildParcelHeader(types_, *parcel);
+  Compare(doc.get(), kExpectedParcelHeaderOutput);
+}
+
+TEST_F(StructuredParcelableASTTest, GeneratesParcelSource) {
+  unique_ptr<AidlStructuredParcelable> parcel = ParseParcelable();
+  ASSERT_NE(parcel, nullptr);
+  unique_ptr<Document> doc = internals::BuildParcelSource(types_, *parcel);
+  Compare(doc.get(), kExpectedParcelSourceOutput);
+}
+
+class FixedSizeParcelableASTTest : public StructuredParcelableASTTest {
+ public:
+  FixedSizeParcelableASTTest()
+      : StructuredParcelableASTTest(kFixedSizeParcelableAIDL) {}
+};
+
+TEST_F(FixedSizeParcelableASTTest, GeneratesParcelHeader) {
+  unique_ptr<AidlStructuredParcelable> parcel = ParseParcelable();
+  ASSERT_NE(parcel, nullptr);
+  unique_ptr<Document> doc = internals::BuildParcelHeader(types_, *parcel);
+  Compare(doc.get(), kExpectedFixedSizeParcelHeaderOutput);
+}
+
+TEST_F(FixedSizeParcelableASTTest, GeneratesParcelSource) {
+  unique_ptr<AidlStructuredParcelable> parcel = ParseParcelable();
+  ASSERT_NE(parcel, nullptr);
+  unique_ptr<Document> doc = internals::BuildParcelSource(types_, *parcel);
+  Compare(doc.get(), kExpectedFixedSizeParcelSourceOutput);
+}
+
 namespace test_io_handling {
 
 const char kInputPath[] = "a/IFoo.aidl";
@@ -788,6 +1804,34 @@ TEST_F(IoErrorHandlingTest, GenerateCorrectlyAbsentErrors) {
   ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, io_delegate_));
 }
 
+TEST_F(IoErrorHandlingTest, LeavesCurrentOutputsUntouched) {
+  using namespace test_io_handling;
+  const unique_ptr<AidlInterface> interface = Parse();
+  ASSERT_NE(interface, nullptr);
+  ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, io_delegate_));
+
+  // Put the outputs on disk for a second compile.
+  FakeIoDelegate rerun_io_delegate;
+  const string header_dir = StringPrintf("%s%c", kHeaderDir, OS_PATH_SEPARATOR);
+  for (const string& path : {string(kOutputPath),
+                             header_dir + kInterfaceHeaderRelPath,
+                             header_dir + "a/IFooFwd.h",
+                             header_dir + "a/BpFoo.h",
+                             header_dir + "a/BnFoo.h"}) {
+    string contents;
+    ASSERT_TRUE(io_delegate_.GetWrittenContents(path, &contents)) << path;
+    EXPECT_EQ(0u, contents.find("// aidl semantic hash: ")) << path;
+    rerun_io_delegate.SetFileContents(path, contents);
+  }
+  ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, rerun_io_delegate));
+  EXPECT_FALSE(rerun_io_delegate.GetWrittenContents(kOutputPath, nullptr));
+
+  // Any output that is missing or out of date regenerates all of them.
+  rerun_io_delegate.SetFileContents(header_dir + "a/BnFoo.h", "");
+  ASSERT_TRUE(GenerateCpp(*options_, types_, *interface, rerun_io_delegate));
+  EXPECT_TRUE(rerun_io_delegate.GetWrittenContents(kOutputPath, nullptr));
+}
+
 TEST_F(IoErrorHandlingTest, HandlesBadHeaderWrite) {
   using namespace test_io_handling;
   const unique_ptr<AidlInterface> interface = Parse();
@@ -806,15 +1850,22 @@ TEST_F(IoErrorHandlingTest, HandlesBadHeaderWrite) {
 }
 
 TEST_F(IoErrorHandlingTest, HandlesBadCppWrite) {
-  using test_io_handling::kOutputPath;
+  using namespace test_io_handling;
   const unique_ptr<AidlInterface> interface = Parse();
   ASSERT_NE(interface, nullptr);
 
   // Simulate issues closing the cpp file.
   io_delegate_.AddBrokenFilePath(kOutputPath);
   ASSERT_FALSE(GenerateCpp(*options_, types_, *interface, io_delegate_));
-  // We should remove partial results.
+  // We should remove partial results, including the headers already written.
   ASSERT_TRUE(io_delegate_.PathWasRemoved(kOutputPath));
+  const string header_dir = StringPrintf("%s%c", kHeaderDir, OS_PATH_SEPARATOR);
+  for (const string& path : {header_dir + kInterfaceHeaderRelPath,
+                             header_dir + "a/IFooFwd.h",
+                             header_dir + "a/BpFoo.h",
+                             header_dir + "a/BnFoo.h"}) {
+    EXPECT_TRUE(io_delegate_.PathWasRemoved(path)) << path;
+  }
 }
 
 }  // namespace cpp
@@ -29,6 +29,7 @@
 using std::unique_ptr;
 using ::android::aidl::java::Variable;
 using std::string;
+using std::vector;
 using android::base::StringPrintf;
 
 namespace android {
@@ -41,7 +42,7 @@ VariableFactory::VariableFactory(const string& base)
 }
 
 Variable* VariableFactory::Get(const Type* type) {
-  Variable* v = new Variable(
+  Variable* v = java::New<Variable>(
       type, StringPrintf("%s%d", base_.c_str(), index_));
   vars_.push_back(v);
   index_++;
@@ -56,21 +57,134 @@ namespace java {
 
 int generate_java(const string& filename, const string& originalSrc,
                   AidlInterface* iface, JavaTypeNamespace* types,
-                  const IoDelegate& io_delegate, unsigned int flags) {
-  Class* cl = generate_binder_interface_class(iface, types, flags);
+                  const IoDelegate& io_delegate, unsigned int flags,
+                  const DispatchProfile* profile) {
+  // Everything generated for this file is freed when |arena| goes away.
+  AstArena arena;
+  Class* cl = generate_binder_interface_class(iface, types, flags, profile);
 
-  Document* document = new Document(
+  Document document(
       "" /* no comment */,
       (!iface->GetPackage().empty()) ? iface->GetPackage() : "",
       originalSrc,
-      unique_ptr<Class>(cl));
+      cl);
 
   CodeWriterPtr code_writer = io_delegate.GetCodeWriter(filename);
-  document->Write(code_writer.get());
+  document.Write(code_writer.get());
 
   return 0;
 }
 
+int generate_java_parcel(const std::string& filename,
+                         const std::string& originalSrc,
+                         const AidlStructuredParcelable* parcel,
+                         JavaTypeNamespace* types,
+                         const IoDelegate& io_delegate) {
+  AstArena arena;
+  Class* cl = generate_parcel_class(parcel, types);
+
+  Document document("" /* no comment */, parcel->GetPackage(), originalSrc,
+                    cl);
+
+  CodeWriterPtr code_writer = io_delegate.GetCodeWriter(filename);
+  document.Write(code_writer.get());
+
+  return 0;
+}
+
+Class* generate_parcel_class(const AidlStructuredParcelable* parcel,
+                             JavaTypeNamespace* types) {
+  const Type* parcelType =
+      types->FindTypeByCanonicalName(parcel->GetCanonicalName());
+  const string name = parcelType->JavaType();
+
+  Class* parcelClass = New<Class>();
+  parcelClass->modifiers = PUBLIC;
+  parcelClass->what = Class::CLASS;
+  parcelClass->type = parcelType;
+  parcelClass->interfaces.push_back(types->ParcelableInterfaceType());
+
+  // the fields, in declaration order
+  vector<Variable*> fields;
+  for (const AidlVariableDeclaration* item : parcel->GetFields()) {
+    Variable* field = New<Variable>(item->GetType().GetLanguageType<Type>(),
+                                    item->GetName(),
+                                    item->GetType().IsArray() ? 1 : 0);
+    parcelClass->elements.push_back(New<Field>(PUBLIC, field));
+    fields.push_back(field);
+  }
+
+  parcelClass->elements.push_back(New<LiteralClassElement>(StringPrintf(
+      "public static final android.os.Parcelable.Creator<%s> CREATOR = "
+      "new android.os.Parcelable.Creator<%s>() {\n"
+      "@Override public %s createFromParcel(android.os.Parcel _aidl_source) "
+      "{\n"
+      "%s _aidl_out = new %s();\n"
+      "_aidl_out.readFromParcel(_aidl_source);\n"
+      "return _aidl_out;\n"
+      "}\n"
+      "@Override public %s[] newArray(int _aidl_size) {\n"
+      "return new %s[_aidl_size];\n"
+      "}\n"
+      "};\n",
+      name.c_str(), name.c_str(), name.c_str(), name.c_str(), name.c_str(),
+      name.c_str(), name.c_str())));
+
+  // Both directions marshal the fields one after another, with no size or
+  // version header.
+  Variable* parcel_variable =
+      New<Variable>(types->ParcelType(), "_aidl_parcel");
+  Variable* flag_variable =
+      New<Variable>(types->IntType(), kWriteToParcelFlags);
+
+  Method* writeMethod = New<Method>();
+  writeMethod->modifiers = PUBLIC | OVERRIDE | FINAL;
+  writeMethod->returnType = types->VoidType();
+  writeMethod->name = "writeToParcel";
+  writeMethod->parameters.push_back(parcel_variable);
+  writeMethod->parameters.push_back(flag_variable);
+  writeMethod->statements = New<StatementBlock>();
+  for (Variable* field : fields) {
+    field->type->WriteToParcel(writeMethod->statements, field,
+                               parcel_variable,
+                               Type::PARCELABLE_WRITE_CALLER_FLAGS);
+  }
+  parcelClass->elements.push_back(writeMethod);
+
+  Method* readMethod = New<Method>();
+  readMethod->modifiers = PUBLIC | FINAL;
+  readMethod->returnType = types->VoidType();
+  readMethod->name = "readFromParcel";
+  readMethod->parameters.push_back(parcel_variable);
+  readMethod->statements = New<StatementBlock>();
+  Variable* cl = nullptr;
+  for (Variable* field : fields) {
+    field->type->CreateFromParcel(readMethod->statements, field,
+                                  parcel_variable, &cl);
+  }
+  if (cl != nullptr) {
+    // Only untyped containers need this, so look it up once per call.
+    auto& statements = readMethod->statements->statements;
+    statements.insert(
+        statements.begin(),
+        New<VariableDeclaration>(
+            cl, New<MethodCall>(New<MethodCall>(THIS_VALUE, "getClass"),
+                                "getClassLoader")));
+  }
+  parcelClass->elements.push_back(readMethod);
+
+  Method* describeContents = New<Method>();
+  describeContents->modifiers = PUBLIC | OVERRIDE;
+  describeContents->returnType = types->IntType();
+  describeContents->name = "describeContents";
+  describeContents->statements = New<StatementBlock>();
+  describeContents->statements->Add(
+      New<ReturnStatement>(New<LiteralExpression>("0")));
+  parcelClass->elements.push_back(describeContents);
+
+  return parcelClass;
+}
+
 }  // namespace java
 }  // namespace android
 }  // namespace aidl
@@ -26,17 +26,31 @@
 namespace android {
 namespace aidl {
 
+class DispatchProfile;
+
 namespace java {
 
 class JavaTypeNamespace;
 
+// With a |profile|, onTransact() handles the hot transactions first and
+// forwards the rest to per-method handlers.
 int generate_java(const std::string& filename, const std::string& originalSrc,
                   AidlInterface* iface, java::JavaTypeNamespace* types,
-                  const IoDelegate& io_delegate, unsigned int flags);
+                  const IoDelegate& io_delegate, unsigned int flags,
+                  const DispatchProfile* profile = nullptr);
 
 android::aidl::java::Class* generate_binder_interface_class(
     const AidlInterface* iface, java::JavaTypeNamespace* types,
-    unsigned int flags);
+    unsigned int flags, const DispatchProfile* profile = nullptr);
+
+int generate_java_parcel(const std::string& filename,
+                         const std::string& originalSrc,
+                         const AidlStructuredParcelable* parcel,
+                         java::JavaTypeNamespace* types,
+                         const IoDelegate& io_delegate);
+
+android::aidl::java::Class* generate_parcel_class(
+    const AidlStructuredParcelable* parcel, java::JavaTypeNamespace* types);
 
 }  // namespace java
 
@@ -62,5 +76,7 @@ class VariableFactory {
 
 // Flags that can be passed to generate_java
 #define GENERATE_NO_OP_CLASS 1 << 0
+#define GENERATE_TRACES 1 << 1
+#define GENERATE_COMPACT 1 << 2
 
 #endif // AIDL_GENERATE_JAVA_H_
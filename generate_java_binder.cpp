@@ -21,11 +21,17 @@
 #include <string.h>
 #include <string.h>
 
+#include <algorithm>
+#include <map>
+
 #include <android-base/macros.h>
 
+#include "dispatch_profile.h"
+#include "generate_common.h"
 #include "type_java.h"
 
 using std::string;
+using std::vector;
 
 namespace android {
 namespace aidl {
@@ -43,6 +49,14 @@ class StubClass : public Class {
   Variable* transact_reply;
   Variable* transact_flags;
   SwitchStatement* transact_switch;
+  // Set in compact mode, where nullable parcelables are marshalled by the
+  // shared helpers below instead of inline.
+  bool compact = false;
+  Method* write_parcelable = nullptr;
+  Method* create_parcelable = nullptr;
+  // Cached class loader for untyped List and Map arguments, or NULL if no
+  // method has needed one yet.
+  Variable* class_loader = nullptr;
 
  private:
   void make_as_interface(const InterfaceType* interfaceType,
@@ -63,22 +77,22 @@ StubClass::StubClass(const Type* type, const InterfaceType* interfaceType,
 
   // descriptor
   Field* descriptor =
-      new Field(STATIC | FINAL | PRIVATE,
-                new Variable(types->StringType(), "DESCRIPTOR"));
+      New<Field>(STATIC | FINAL | PRIVATE,
+                 New<Variable>(types->StringType(), "DESCRIPTOR"));
   descriptor->value = "\"" + interfaceType->JavaType() + "\"";
   this->elements.push_back(descriptor);
 
   // ctor
-  Method* ctor = new Method;
+  Method* ctor = New<Method>();
   ctor->modifiers = PUBLIC;
   ctor->comment =
       "/** Construct the stub at attach it to the "
       "interface. */";
   ctor->name = "Stub";
-  ctor->statements = new StatementBlock;
+  ctor->statements = New<StatementBlock>();
   MethodCall* attach =
-      new MethodCall(THIS_VALUE, "attachInterface", 2, THIS_VALUE,
-                     new LiteralExpression("DESCRIPTOR"));
+      New<MethodCall>(THIS_VALUE, "attachInterface", 2, THIS_VALUE,
+                      New<LiteralExpression>("DESCRIPTOR"));
   ctor->statements->Add(attach);
   this->elements.push_back(ctor);
 
@@ -86,20 +100,20 @@ StubClass::StubClass(const Type* type, const InterfaceType* interfaceType,
   make_as_interface(interfaceType, types);
 
   // asBinder
-  Method* asBinder = new Method;
+  Method* asBinder = New<Method>();
   asBinder->modifiers = PUBLIC | OVERRIDE;
   asBinder->returnType = types->IBinderType();
   asBinder->name = "asBinder";
-  asBinder->statements = new StatementBlock;
-  asBinder->statements->Add(new ReturnStatement(THIS_VALUE));
+  asBinder->statements = New<StatementBlock>();
+  asBinder->statements->Add(New<ReturnStatement>(THIS_VALUE));
   this->elements.push_back(asBinder);
 
   // onTransact
-  this->transact_code = new Variable(types->IntType(), "code");
-  this->transact_data = new Variable(types->ParcelType(), "data");
-  this->transact_reply = new Variable(types->ParcelType(), "reply");
-  this->transact_flags = new Variable(types->IntType(), "flags");
-  Method* onTransact = new Method;
+  this->transact_code = New<Variable>(types->IntType(), "code");
+  this->transact_data = New<Variable>(types->ParcelType(), "data");
+  this->transact_reply = New<Variable>(types->ParcelType(), "reply");
+  this->transact_flags = New<Variable>(types->IntType(), "flags");
+  Method* onTransact = New<Method>();
   onTransact->modifiers = PUBLIC | OVERRIDE;
   onTransact->returnType = types->BoolType();
   onTransact->name = "onTransact";
@@ -107,23 +121,23 @@ StubClass::StubClass(const Type* type, const InterfaceType* interfaceType,
   onTransact->parameters.push_back(this->transact_data);
   onTransact->parameters.push_back(this->transact_reply);
   onTransact->parameters.push_back(this->transact_flags);
-  onTransact->statements = new StatementBlock;
+  onTransact->statements = New<StatementBlock>();
   onTransact->exceptions.push_back(types->RemoteExceptionType());
   this->elements.push_back(onTransact);
-  this->transact_switch = new SwitchStatement(this->transact_code);
+  this->transact_switch = New<SwitchStatement>(this->transact_code);
 
   onTransact->statements->Add(this->transact_switch);
-  MethodCall* superCall = new MethodCall(
+  MethodCall* superCall = New<MethodCall>(
       SUPER_VALUE, "onTransact", 4, this->transact_code, this->transact_data,
       this->transact_reply, this->transact_flags);
-  onTransact->statements->Add(new ReturnStatement(superCall));
+  onTransact->statements->Add(New<ReturnStatement>(superCall));
 }
 
 void StubClass::make_as_interface(const InterfaceType* interfaceType,
                                   JavaTypeNamespace* types) {
-  Variable* obj = new Variable(types->IBinderType(), "obj");
+  Variable* obj = New<Variable>(types->IBinderType(), "obj");
 
-  Method* m = new Method;
+  Method* m = New<Method>();
   m->comment = "/**\n * Cast an IBinder object into an ";
   m->comment += interfaceType->JavaType();
   m->comment += " interface,\n";
@@ -132,21 +146,23 @@ void StubClass::make_as_interface(const InterfaceType* interfaceType,
   m->returnType = interfaceType;
   m->name = "asInterface";
   m->parameters.push_back(obj);
-  m->statements = new StatementBlock;
+  m->statements = New<StatementBlock>();
 
-  IfStatement* ifstatement = new IfStatement();
-  ifstatement->expression = new Comparison(obj, "==", NULL_VALUE);
-  ifstatement->statements = new StatementBlock;
-  ifstatement->statements->Add(new ReturnStatement(NULL_VALUE));
+  IfStatement* ifstatement = New<IfStatement>();
+  ifstatement->expression = New<Comparison>(obj, "==", NULL_VALUE);
+  ifstatement->statements = New<StatementBlock>();
+  ifstatement->statements->Add(New<ReturnStatement>(NULL_VALUE));
   m->statements->Add(ifstatement);
 
   // IInterface iin = obj.queryLocalInterface(DESCRIPTOR)
-  MethodCall* queryLocalInterface = new MethodCall(obj, "queryLocalInterface");
-  queryLocalInterface->arguments.push_back(new LiteralExpression("DESCRIPTOR"));
-  IInterfaceType* iinType = new IInterfaceType(types);
-  Variable* iin = new Variable(iinType, "iin");
+  MethodCall* queryLocalInterface =
+      New<MethodCall>(obj, "queryLocalInterface");
+  queryLocalInterface->arguments.push_back(
+      New<LiteralExpression>("DESCRIPTOR"));
+  const Type* iinType = types->IInterfaceType();
+  Variable* iin = New<Variable>(iinType, "iin");
   VariableDeclaration* iinVd =
-      new VariableDeclaration(iin, queryLocalInterface, NULL);
+      New<VariableDeclaration>(iin, queryLocalInterface, nullptr);
   m->statements->Add(iinVd);
 
   // Ensure the instance type of the local object is as expected.
@@ -155,20 +171,20 @@ void StubClass::make_as_interface(const InterfaceType* interfaceType,
 
   // if (iin != null && iin instanceof <interfaceType>) return (<interfaceType>)
   // iin;
-  Comparison* iinNotNull = new Comparison(iin, "!=", NULL_VALUE);
+  Comparison* iinNotNull = New<Comparison>(iin, "!=", NULL_VALUE);
   Comparison* instOfCheck =
-      new Comparison(iin, " instanceof ",
-                     new LiteralExpression(interfaceType->JavaType()));
-  IfStatement* instOfStatement = new IfStatement();
-  instOfStatement->expression = new Comparison(iinNotNull, "&&", instOfCheck);
-  instOfStatement->statements = new StatementBlock;
+      New<Comparison>(iin, " instanceof ",
+                      New<LiteralExpression>(interfaceType->JavaType()));
+  IfStatement* instOfStatement = New<IfStatement>();
+  instOfStatement->expression = New<Comparison>(iinNotNull, "&&", instOfCheck);
+  instOfStatement->statements = New<StatementBlock>();
   instOfStatement->statements->Add(
-      new ReturnStatement(new Cast(interfaceType, iin)));
+      New<ReturnStatement>(New<Cast>(interfaceType, iin)));
   m->statements->Add(instOfStatement);
 
-  NewExpression* ne = new NewExpression(interfaceType->GetProxy());
+  NewExpression* ne = New<NewExpression>(interfaceType->GetProxy());
   ne->arguments.push_back(obj);
-  m->statements->Add(new ReturnStatement(ne));
+  m->statements->Add(New<ReturnStatement>(ne));
 
   this->elements.push_back(m);
 }
@@ -182,6 +198,12 @@ class ProxyClass : public Class {
 
   Variable* mRemote;
   bool mOneWay;
+  // Set when the interface has @batchable methods, whose calls the proxy
+  // buffers, and which every other call must first flush.
+  bool batches = false;
+  // Cached class loader for untyped List and Map results, or NULL if no
+  // method has needed one yet.
+  Variable* class_loader = nullptr;
 };
 
 ProxyClass::ProxyClass(const JavaTypeNamespace* types, const Type* type,
@@ -195,25 +217,25 @@ ProxyClass::ProxyClass(const JavaTypeNamespace* types, const Type* type,
   mOneWay = interfaceType->OneWay();
 
   // IBinder mRemote
-  mRemote = new Variable(types->IBinderType(), "mRemote");
-  this->elements.push_back(new Field(PRIVATE, mRemote));
+  mRemote = New<Variable>(types->IBinderType(), "mRemote");
+  this->elements.push_back(New<Field>(PRIVATE, mRemote));
 
   // Proxy()
-  Variable* remote = new Variable(types->IBinderType(), "remote");
-  Method* ctor = new Method;
+  Variable* remote = New<Variable>(types->IBinderType(), "remote");
+  Method* ctor = New<Method>();
   ctor->name = "Proxy";
-  ctor->statements = new StatementBlock;
+  ctor->statements = New<StatementBlock>();
   ctor->parameters.push_back(remote);
-  ctor->statements->Add(new Assignment(mRemote, remote));
+  ctor->statements->Add(New<Assignment>(mRemote, remote));
   this->elements.push_back(ctor);
 
   // IBinder asBinder()
-  Method* asBinder = new Method;
+  Method* asBinder = New<Method>();
   asBinder->modifiers = PUBLIC | OVERRIDE;
   asBinder->returnType = types->IBinderType();
   asBinder->name = "asBinder";
-  asBinder->statements = new StatementBlock;
-  asBinder->statements->Add(new ReturnStatement(mRemote));
+  asBinder->statements = New<StatementBlock>();
+  asBinder->statements->Add(New<ReturnStatement>(mRemote));
   this->elements.push_back(asBinder);
 }
 
@@ -238,12 +260,12 @@ DefaultNoOpClass::DefaultNoOpClass(const JavaTypeNamespace* types, const Type* t
   this->interfaces.push_back(interfaceType);
 
   // IBinder asBinder()
-  Method* asBinder = new Method;
+  Method* asBinder = New<Method>();
   asBinder->modifiers = PUBLIC | OVERRIDE;
   asBinder->returnType = types->IBinderType();
   asBinder->name = "asBinder";
-  asBinder->statements = new StatementBlock;
-  asBinder->statements->Add(new ReturnStatement(NULL_VALUE));
+  asBinder->statements = New<StatementBlock>();
+  asBinder->statements->Add(New<ReturnStatement>(NULL_VALUE));
   this->elements.push_back(asBinder);
 }
 
@@ -253,26 +275,111 @@ DefaultNoOpClass::~DefaultNoOpClass() {}
 static void generate_new_array(const Type* t, StatementBlock* addTo,
                                Variable* v, Variable* parcel,
                                JavaTypeNamespace* types) {
-  Variable* len = new Variable(types->IntType(), v->name + "_length");
-  addTo->Add(new VariableDeclaration(len, new MethodCall(parcel, "readInt")));
-  IfStatement* lencheck = new IfStatement();
-  lencheck->expression = new Comparison(len, "<", new LiteralExpression("0"));
-  lencheck->statements->Add(new Assignment(v, NULL_VALUE));
-  lencheck->elseif = new IfStatement();
+  Variable* len = New<Variable>(types->IntType(), v->name + "_length");
+  addTo->Add(New<VariableDeclaration>(len, New<MethodCall>(parcel, "readInt")));
+  IfStatement* lencheck = New<IfStatement>();
+  lencheck->expression = New<Comparison>(len, "<", New<LiteralExpression>("0"));
+  lencheck->statements->Add(New<Assignment>(v, NULL_VALUE));
+  lencheck->elseif = New<IfStatement>();
   lencheck->elseif->statements->Add(
-      new Assignment(v, new NewArrayExpression(t, len)));
+      New<Assignment>(v, New<NewArrayExpression>(t, len)));
   addTo->Add(lencheck);
 }
 
+// Nullable parcelables (but not arrays of them) are written as a null flag
+// followed by the object.  In compact mode that logic lives in two private
+// helpers on the Stub, added the first time a method needs them, rather than
+// being inlined at every use.  The wire format is the same either way.
+static bool use_parcelable_helpers(const Type* t, const StubClass* stub) {
+  return stub->compact && t->Kind() == ValidatableType::KIND_PARCELABLE &&
+         t->CanBeArray() && t->NullableType() != nullptr;
+}
+
+static void add_parcelable_helpers(StubClass* stub,
+                                   const JavaTypeNamespace* types) {
+  if (stub->write_parcelable != nullptr) {
+    return;
+  }
+  Variable* parcel = New<Variable>(types->ParcelType(), "parcel");
+
+  // private static void _writeParcelable(Parcel parcel, Parcelable value,
+  //                                      int flags)
+  Variable* value = New<Variable>(types->ParcelableInterfaceType(), "value");
+  Variable* flags = New<Variable>(types->IntType(), "flags");
+  Method* write = New<Method>();
+  write->modifiers = PRIVATE | STATIC;
+  write->returnType = types->VoidType();
+  write->name = "_writeParcelable";
+  write->parameters.push_back(parcel);
+  write->parameters.push_back(value);
+  write->parameters.push_back(flags);
+  write->statements = New<StatementBlock>();
+  IfStatement* nonnull = New<IfStatement>();
+  nonnull->expression = New<Comparison>(value, "!=", NULL_VALUE);
+  nonnull->statements->Add(
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("1")));
+  nonnull->statements->Add(
+      New<MethodCall>(value, "writeToParcel", 2, parcel, flags));
+  nonnull->elseif = New<IfStatement>();
+  nonnull->elseif->statements->Add(
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("0")));
+  write->statements->Add(nonnull);
+  stub->elements.push_back(write);
+  stub->write_parcelable = write;
+
+  // private static Object _createParcelable(Parcel parcel,
+  //                                         Parcelable.Creator creator)
+  Variable* creator =
+      New<Variable>(types->ParcelableCreatorType(), "creator");
+  Method* create = New<Method>();
+  create->modifiers = PRIVATE | STATIC;
+  create->returnType = types->ObjectType();
+  create->name = "_createParcelable";
+  create->parameters.push_back(parcel);
+  create->parameters.push_back(creator);
+  create->statements = New<StatementBlock>();
+  IfStatement* present = New<IfStatement>();
+  present->expression = New<Comparison>(New<LiteralExpression>("0"), "!=",
+                                        New<MethodCall>(parcel, "readInt"));
+  present->statements->Add(New<ReturnStatement>(
+      New<MethodCall>(creator, "createFromParcel", 1, parcel)));
+  create->statements->Add(present);
+  create->statements->Add(New<ReturnStatement>(NULL_VALUE));
+  stub->elements.push_back(create);
+  stub->create_parcelable = create;
+}
+
 static void generate_write_to_parcel(const Type* t, StatementBlock* addTo,
-                                     Variable* v, Variable* parcel, int flags) {
-  t->WriteToParcel(addTo, v, parcel, flags);
+                                     Variable* v, Variable* parcel, int flags,
+                                     StubClass* stub,
+                                     const JavaTypeNamespace* types) {
+  if (!use_parcelable_helpers(t, stub)) {
+    t->WriteToParcel(addTo, v, parcel, flags);
+    return;
+  }
+  add_parcelable_helpers(stub, types);
+  addTo->Add(New<MethodCall>(
+      stub->write_parcelable->name, 3, parcel, v,
+      New<LiteralExpression>(
+          (flags & Type::PARCELABLE_WRITE_RETURN_VALUE)
+              ? "android.os.Parcelable.PARCELABLE_WRITE_RETURN_VALUE"
+              : "0")));
 }
 
 static void generate_create_from_parcel(const Type* t, StatementBlock* addTo,
                                         Variable* v, Variable* parcel,
-                                        Variable** cl) {
-  t->CreateFromParcel(addTo, v, parcel, cl);
+                                        Variable** cl, StubClass* stub,
+                                        const JavaTypeNamespace* types) {
+  if (!use_parcelable_helpers(t, stub)) {
+    t->CreateFromParcel(addTo, v, parcel, cl);
+    return;
+  }
+  add_parcelable_helpers(stub, types);
+  addTo->Add(New<Assignment>(
+      v,
+      New<MethodCall>(stub->create_parcelable->name, 2, parcel,
+                      New<LiteralExpression>(t->CreatorName())),
+      t));
 }
 
 static void generate_read_from_parcel(const Type* t, StatementBlock* addTo,
@@ -281,8 +388,41 @@ static void generate_read_from_parcel(const Type* t, StatementBlock* addTo,
   t->ReadFromParcel(addTo, v, parcel, cl);
 }
 
+// Binds |cl|, created while reading an untyped List or Map, to a field of
+// |clazz| initialized with |value|, so the class loader is looked up once
+// instead of on every transaction.
+static void declare_class_loader(Class* clazz, Variable** class_loader,
+                                 Variable* cl, int modifiers,
+                                 const string& name, const string& value) {
+  if (cl == NULL || *class_loader != NULL) {
+    return;
+  }
+  cl->name = name;
+  Field* field = New<Field>(PRIVATE | FINAL | modifiers, cl);
+  field->value = value;
+  clazz->elements.push_back(field);
+  *class_loader = cl;
+}
+
+// Moves the contents of |block| into a try/finally bracketed by an
+// android.os.Trace section named |section|.  beginSection() and endSection()
+// return right away unless tracing is enabled, and |section| is a constant,
+// so this costs next to nothing when nobody is tracing.
+static void wrap_in_trace_section(StatementBlock* block,
+                                  const string& section) {
+  Expression* trace = New<LiteralExpression>("android.os.Trace");
+  TryStatement* tryStatement = New<TryStatement>();
+  tryStatement->statements->statements.swap(block->statements);
+  FinallyStatement* finallyStatement = New<FinallyStatement>();
+  finallyStatement->statements->Add(New<MethodCall>(trace, "endSection"));
+  block->Add(New<MethodCall>(trace, "beginSection", 1,
+                             New<StringLiteralExpression>(section)));
+  block->Add(tryStatement);
+  block->Add(finallyStatement);
+}
+
 static void generate_constant(const AidlConstant& constant, Class* interface) {
-  Constant* decl = new Constant;
+  Constant* decl = New<Constant>();
   decl->name = constant.GetName();
   decl->value = constant.GetValue();
 
@@ -302,114 +442,86 @@ static bool is_numeric_java_type(const std::string name) {
   return false;
 }
 
-static void generate_method(const AidlMethod& method, Class* interface,
-                            StubClass* stubClass, ProxyClass* proxyClass,
-                            DefaultNoOpClass *noOpClass,
-                            int index, JavaTypeNamespace* types) {
-  int i;
-  bool hasOutParams = false;
-
-  const bool oneway = proxyClass->mOneWay || method.IsOneway();
-
-  // == the TRANSACT_ constant =============================================
-  string transactCodeName = "TRANSACTION_";
-  transactCodeName += method.GetName();
+// The suffix of the TRANSACTION_ constant for |method|, whose transaction
+// code is FIRST_CALL_TRANSACTION + |index|.  A method redefined with an
+// explicit id has the id appended, to keep it apart from the original.
+static string get_method_id(const AidlMethod& method, int index) {
+  string methodId = method.GetName();
 
   if (method.IsDeduplicate()) {
     char tmp[16];
     sprintf(tmp, "_%d", index);
-    transactCodeName += tmp;
+    methodId += tmp;
   }
+  return methodId;
+}
 
-  char transactCodeValue[60];
-  sprintf(transactCodeValue, "(android.os.IBinder.FIRST_CALL_TRANSACTION + %d)",
-          index);
-
-  Field* transactCode = new Field(
-      STATIC | FINAL, new Variable(types->IntType(), transactCodeName));
-  transactCode->value = transactCodeValue;
-  stubClass->elements.push_back(transactCode);
-
-  // == the declaration in the interface ===================================
-  Method* decl = new Method;
-  decl->comment = method.GetComments();
-  decl->modifiers = PUBLIC;
-  decl->returnType = method.GetType().GetLanguageType<Type>();
-  decl->returnTypeDimension = method.GetType().IsArray() ? 1 : 0;
-  decl->name = method.GetName();
-
-  for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
-    decl->parameters.push_back(
-        new Variable(arg->GetType().GetLanguageType<Type>(), arg->GetName(),
-                     arg->GetType().IsArray() ? 1 : 0));
+// Whether reading what |method| receives creates a class loader: its
+// arguments on the stub side, or its results on the proxy side.  The reads
+// are built in a scratch arena and thrown away.
+static bool reads_class_loader(const AidlMethod& method, bool proxy_side,
+                               const StubClass* stub,
+                               const JavaTypeNamespace* types) {
+  AstArena scratch;
+  StatementBlock* block = New<StatementBlock>();
+  Variable* parcel = New<Variable>(types->ParcelType(), "parcel");
+  Variable* cl = nullptr;
+  const Type* return_type = method.GetType().GetLanguageType<Type>();
+  if (proxy_side && method.GetType().GetName() != "void" &&
+      !use_parcelable_helpers(return_type, stub)) {
+    return_type->CreateFromParcel(
+        block, New<Variable>(return_type, "v", method.GetType().IsArray()),
+        parcel, &cl);
   }
-
-  decl->exceptions.push_back(types->RemoteExceptionType());
-
-  interface->elements.push_back(decl);
-
-  // == the no-op method ===================================================
-
-  if (noOpClass != NULL) {
-    Method* noOpMethod = new Method;
-    noOpMethod->comment = method.GetComments();
-    noOpMethod->modifiers = OVERRIDE | PUBLIC;
-    noOpMethod->returnType = method.GetType().GetLanguageType<Type>();
-    noOpMethod->returnTypeDimension = method.GetType().IsArray() ? 1 : 0;
-    noOpMethod->name = method.GetName();
-    noOpMethod->statements = new StatementBlock;
-    for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
-      noOpMethod->parameters.push_back(
-          new Variable(arg->GetType().GetLanguageType<Type>(), arg->GetName(),
-                       arg->GetType().IsArray() ? 1 : 0));
-    }
-
-    std::string typeName = method.GetType().GetLanguageType<Type>()->JavaType();
-    if (typeName != "void") {
-      bool isNumeric = is_numeric_java_type(typeName);
-      bool isBoolean = typeName == "boolean";
-
-      if (isNumeric && !method.GetType().IsArray()) {
-        noOpMethod->statements->Add(new ReturnStatement(new LiteralExpression("0")));
-      } else if (isBoolean && !method.GetType().IsArray()) {
-        noOpMethod->statements->Add(new ReturnStatement(FALSE_VALUE));
-      } else {
-        noOpMethod->statements->Add(new ReturnStatement(NULL_VALUE));
-      }
+  for (const AidlArgument* arg : method.GetArguments()) {
+    const Type* t = arg->GetType().GetLanguageType<Type>();
+    Variable* v = New<Variable>(t, "v", arg->GetType().IsArray() ? 1 : 0);
+    if (proxy_side && (arg->GetDirection() & AidlArgument::OUT_DIR)) {
+      generate_read_from_parcel(t, block, v, parcel, &cl);
+    } else if (!proxy_side && (arg->GetDirection() & AidlArgument::IN_DIR) &&
+               !use_parcelable_helpers(t, stub)) {
+      t->CreateFromParcel(block, v, parcel, &cl);
     }
-    noOpMethod->exceptions.push_back(types->RemoteExceptionType());
-    noOpClass->elements.push_back(noOpMethod);
   }
+  return cl != nullptr;
+}
 
-  // == the stub method ====================================================
-
-  Case* c = new Case(transactCodeName);
+// Adds what the stub does for a call of |method| to |statements|: reading
+// the arguments, calling the implementation and writing the results.
+static void generate_stub_statements(const AidlMethod& method,
+                                     StubClass* stubClass, bool oneway,
+                                     JavaTypeNamespace* types,
+                                     unsigned int flags,
+                                     const string& trace_section,
+                                     StatementBlock* statements) {
+  int i;
+  bool hasOutParams = false;
 
-  MethodCall* realCall = new MethodCall(THIS_VALUE, method.GetName());
+  MethodCall* realCall = New<MethodCall>(THIS_VALUE, method.GetName());
 
   // interface token validation is the very first thing we do
-  c->statements->Add(new MethodCall(stubClass->transact_data,
-                                    "enforceInterface", 1,
-                                    new LiteralExpression("DESCRIPTOR")));
+  statements->Add(New<MethodCall>(stubClass->transact_data,
+                                  "enforceInterface", 1,
+                                  New<LiteralExpression>("DESCRIPTOR")));
 
   // args
-  Variable* cl = NULL;
+  Variable* cl = stubClass->class_loader;
   VariableFactory stubArgs("_arg");
-  for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
+  for (const AidlArgument* arg : method.GetArguments()) {
     const Type* t = arg->GetType().GetLanguageType<Type>();
     Variable* v = stubArgs.Get(t);
     v->dimension = arg->GetType().IsArray() ? 1 : 0;
 
-    c->statements->Add(new VariableDeclaration(v));
+    statements->Add(New<VariableDeclaration>(v));
 
     if (arg->GetDirection() & AidlArgument::IN_DIR) {
-      generate_create_from_parcel(t, c->statements, v, stubClass->transact_data,
-                                  &cl);
+      generate_create_from_parcel(t, statements, v, stubClass->transact_data,
+                                  &cl, stubClass, types);
     } else {
       if (!arg->GetType().IsArray()) {
-        c->statements->Add(new Assignment(v, new NewExpression(v->type)));
+        statements->Add(New<Assignment>(v, New<NewExpression>(v->type)));
       } else {
-        generate_new_array(v->type, c->statements, v, stubClass->transact_data,
+        generate_new_array(v->type, statements, v, stubClass->transact_data,
                            types);
       }
     }
@@ -418,185 +530,648 @@ static void generate_method(const AidlMethod& method, Class* interface,
   }
 
   // the real call
-  Variable* _result = NULL;
   if (method.GetType().GetName() == "void") {
-    c->statements->Add(realCall);
+    statements->Add(realCall);
 
     if (!oneway) {
       // report that there were no exceptions
       MethodCall* ex =
-          new MethodCall(stubClass->transact_reply, "writeNoException", 0);
-      c->statements->Add(ex);
+          New<MethodCall>(stubClass->transact_reply, "writeNoException", 0);
+      statements->Add(ex);
     }
   } else {
-    _result =
-        new Variable(decl->returnType, "_result", decl->returnTypeDimension);
-    c->statements->Add(new VariableDeclaration(_result, realCall));
+    Variable* _result =
+        New<Variable>(method.GetType().GetLanguageType<Type>(), "_result",
+                      method.GetType().IsArray() ? 1 : 0);
+    statements->Add(New<VariableDeclaration>(_result, realCall));
 
     if (!oneway) {
       // report that there were no exceptions
       MethodCall* ex =
-          new MethodCall(stubClass->transact_reply, "writeNoException", 0);
-      c->statements->Add(ex);
+          New<MethodCall>(stubClass->transact_reply, "writeNoException", 0);
+      statements->Add(ex);
     }
 
     // marshall the return value
-    generate_write_to_parcel(decl->returnType, c->statements, _result,
+    generate_write_to_parcel(_result->type, statements, _result,
                              stubClass->transact_reply,
-                             Type::PARCELABLE_WRITE_RETURN_VALUE);
+                             Type::PARCELABLE_WRITE_RETURN_VALUE, stubClass,
+                             types);
   }
 
   // out parameters
   i = 0;
-  for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
+  for (const AidlArgument* arg : method.GetArguments()) {
     const Type* t = arg->GetType().GetLanguageType<Type>();
     Variable* v = stubArgs.Get(i++);
 
     if (arg->GetDirection() & AidlArgument::OUT_DIR) {
-      generate_write_to_parcel(t, c->statements, v, stubClass->transact_reply,
-                               Type::PARCELABLE_WRITE_RETURN_VALUE);
+      generate_write_to_parcel(t, statements, v, stubClass->transact_reply,
+                               Type::PARCELABLE_WRITE_RETURN_VALUE, stubClass,
+                               types);
       hasOutParams = true;
     }
   }
 
   // return true
-  c->statements->Add(new ReturnStatement(TRUE_VALUE));
-  stubClass->transact_switch->cases.push_back(c);
+  statements->Add(New<ReturnStatement>(TRUE_VALUE));
 
-  // == the proxy method ===================================================
-  Method* proxy = new Method;
+  if (flags & GENERATE_TRACES) {
+    wrap_in_trace_section(statements, trace_section + "::server");
+  }
+}
+
+// Returns the proxy's implementation of |method|.
+static Method* generate_proxy_method(const AidlMethod& method,
+                                     StubClass* stubClass,
+                                     ProxyClass* proxyClass, bool oneway,
+                                     JavaTypeNamespace* types,
+                                     unsigned int flags,
+                                     const string& transactCodeName,
+                                     const string& trace_section) {
+  Method* proxy = New<Method>();
   proxy->comment = method.GetComments();
   proxy->modifiers = PUBLIC | OVERRIDE;
   proxy->returnType = method.GetType().GetLanguageType<Type>();
   proxy->returnTypeDimension = method.GetType().IsArray() ? 1 : 0;
   proxy->name = method.GetName();
-  proxy->statements = new StatementBlock;
-  for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
+  proxy->statements = New<StatementBlock>();
+  for (const AidlArgument* arg : method.GetArguments()) {
     proxy->parameters.push_back(
-        new Variable(arg->GetType().GetLanguageType<Type>(), arg->GetName(),
-                     arg->GetType().IsArray() ? 1 : 0));
+        New<Variable>(arg->GetType().GetLanguageType<Type>(), arg->GetName(),
+                      arg->GetType().IsArray() ? 1 : 0));
   }
   proxy->exceptions.push_back(types->RemoteExceptionType());
-  proxyClass->elements.push_back(proxy);
+
+  // calls made after batched ones must not overtake them
+  if (proxyClass->batches && !method.IsBatchable()) {
+    proxy->statements->Add(New<MethodCall>(THIS_VALUE, "flushBatch"));
+  }
 
   // the parcels
-  Variable* _data = new Variable(types->ParcelType(), "_data");
-  proxy->statements->Add(new VariableDeclaration(
-      _data, new MethodCall(types->ParcelType(), "obtain")));
+  Variable* _data = New<Variable>(types->ParcelType(), "_data");
+  proxy->statements->Add(New<VariableDeclaration>(
+      _data, New<MethodCall>(types->ParcelType(), "obtain")));
   Variable* _reply = NULL;
   if (!oneway) {
-    _reply = new Variable(types->ParcelType(), "_reply");
-    proxy->statements->Add(new VariableDeclaration(
-        _reply, new MethodCall(types->ParcelType(), "obtain")));
+    _reply = New<Variable>(types->ParcelType(), "_reply");
+    proxy->statements->Add(New<VariableDeclaration>(
+        _reply, New<MethodCall>(types->ParcelType(), "obtain")));
   }
 
   // the return value
-  _result = NULL;
+  Variable* _result = NULL;
   if (method.GetType().GetName() != "void") {
-    _result = new Variable(proxy->returnType, "_result",
-                           method.GetType().IsArray() ? 1 : 0);
-    proxy->statements->Add(new VariableDeclaration(_result));
+    _result = New<Variable>(proxy->returnType, "_result",
+                            method.GetType().IsArray() ? 1 : 0);
+    proxy->statements->Add(New<VariableDeclaration>(_result));
   }
 
   // try and finally
-  TryStatement* tryStatement = new TryStatement();
+  TryStatement* tryStatement = New<TryStatement>();
   proxy->statements->Add(tryStatement);
-  FinallyStatement* finallyStatement = new FinallyStatement();
+  FinallyStatement* finallyStatement = New<FinallyStatement>();
   proxy->statements->Add(finallyStatement);
 
   // the interface identifier token: the DESCRIPTOR constant, marshalled as a
   // string
-  tryStatement->statements->Add(new MethodCall(
-      _data, "writeInterfaceToken", 1, new LiteralExpression("DESCRIPTOR")));
+  tryStatement->statements->Add(New<MethodCall>(
+      _data, "writeInterfaceToken", 1, New<LiteralExpression>("DESCRIPTOR")));
 
   // the parameters
-  for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
+  for (const AidlArgument* arg : method.GetArguments()) {
     const Type* t = arg->GetType().GetLanguageType<Type>();
     Variable* v =
-        new Variable(t, arg->GetName(), arg->GetType().IsArray() ? 1 : 0);
+        New<Variable>(t, arg->GetName(), arg->GetType().IsArray() ? 1 : 0);
     AidlArgument::Direction dir = arg->GetDirection();
     if (dir == AidlArgument::OUT_DIR && arg->GetType().IsArray()) {
-      IfStatement* checklen = new IfStatement();
-      checklen->expression = new Comparison(v, "==", NULL_VALUE);
+      IfStatement* checklen = New<IfStatement>();
+      checklen->expression = New<Comparison>(v, "==", NULL_VALUE);
       checklen->statements->Add(
-          new MethodCall(_data, "writeInt", 1, new LiteralExpression("-1")));
-      checklen->elseif = new IfStatement();
+          New<MethodCall>(_data, "writeInt", 1, New<LiteralExpression>("-1")));
+      checklen->elseif = New<IfStatement>();
       checklen->elseif->statements->Add(
-          new MethodCall(_data, "writeInt", 1, new FieldVariable(v, "length")));
+          New<MethodCall>(_data, "writeInt", 1,
+                          New<FieldVariable>(v, "length")));
       tryStatement->statements->Add(checklen);
     } else if (dir & AidlArgument::IN_DIR) {
-      generate_write_to_parcel(t, tryStatement->statements, v, _data, 0);
+      generate_write_to_parcel(t, tryStatement->statements, v, _data, 0,
+                               stubClass, types);
     }
   }
 
-  // the transact call
-  MethodCall* call = new MethodCall(
-      proxyClass->mRemote, "transact", 4,
-      new LiteralExpression("Stub." + transactCodeName), _data,
-      _reply ? _reply : NULL_VALUE,
-      new LiteralExpression(oneway ? "android.os.IBinder.FLAG_ONEWAY" : "0"));
-  tryStatement->statements->Add(call);
+  // the transact call, or for batched calls, adding the request to the batch
+  if (method.IsBatchable()) {
+    tryStatement->statements->Add(New<MethodCall>(
+        THIS_VALUE, "_aidl_batchCall", 2,
+        New<LiteralExpression>("Stub." + transactCodeName), _data));
+  } else {
+    MethodCall* call = New<MethodCall>(
+        proxyClass->mRemote, "transact", 4,
+        New<LiteralExpression>("Stub." + transactCodeName), _data,
+        _reply ? _reply : NULL_VALUE,
+        New<LiteralExpression>(oneway ? "android.os.IBinder.FLAG_ONEWAY"
+                                      : "0"));
+    tryStatement->statements->Add(call);
+  }
 
   // throw back exceptions.
   if (_reply) {
-    MethodCall* ex = new MethodCall(_reply, "readException", 0);
+    MethodCall* ex = New<MethodCall>(_reply, "readException", 0);
     tryStatement->statements->Add(ex);
   }
 
   // returning and cleanup
+  Variable* cl = proxyClass->class_loader;
   if (_reply != NULL) {
     if (_result != NULL) {
       generate_create_from_parcel(proxy->returnType, tryStatement->statements,
-                                  _result, _reply, &cl);
+                                  _result, _reply, &cl, stubClass, types);
     }
 
     // the out/inout parameters
-    for (const std::unique_ptr<AidlArgument>& arg : method.GetArguments()) {
+    for (const AidlArgument* arg : method.GetArguments()) {
       const Type* t = arg->GetType().GetLanguageType<Type>();
       Variable* v =
-          new Variable(t, arg->GetName(), arg->GetType().IsArray() ? 1 : 0);
+          New<Variable>(t, arg->GetName(), arg->GetType().IsArray() ? 1 : 0);
       if (arg->GetDirection() & AidlArgument::OUT_DIR) {
         generate_read_from_parcel(t, tryStatement->statements, v, _reply, &cl);
       }
     }
 
-    finallyStatement->statements->Add(new MethodCall(_reply, "recycle"));
+    finallyStatement->statements->Add(New<MethodCall>(_reply, "recycle"));
   }
-  finallyStatement->statements->Add(new MethodCall(_data, "recycle"));
+  finallyStatement->statements->Add(New<MethodCall>(_data, "recycle"));
 
   if (_result != NULL) {
-    proxy->statements->Add(new ReturnStatement(_result));
+    proxy->statements->Add(New<ReturnStatement>(_result));
+  }
+
+  if (flags & GENERATE_TRACES) {
+    wrap_in_trace_section(proxy->statements, trace_section + "::client");
+  }
+  return proxy;
+}
+
+// Adds everything generated for |method|.  The bodies of its onTransact case
+// (or handler) and of its proxy method, which make up most of the output,
+// are deferred: each is built while being written, in an arena of its own,
+// so only one method's worth of them is held in memory at a time.  The
+// class loaders and parcelable helpers they share with other methods are
+// declared here, where the method first needs them.
+static void generate_method(const AidlMethod& method, Class* interface,
+                            StubClass* stubClass, ProxyClass* proxyClass,
+                            DefaultNoOpClass *noOpClass,
+                            int index, JavaTypeNamespace* types,
+                            unsigned int flags, bool out_of_line) {
+  const bool oneway = proxyClass->mOneWay || method.IsOneway();
+
+  // == the TRANSACT_ constant =============================================
+  string methodId = get_method_id(method, index);
+
+  string transactCodeName = "TRANSACTION_" + methodId;
+
+  char transactCodeValue[60];
+  sprintf(transactCodeValue, "(android.os.IBinder.FIRST_CALL_TRANSACTION + %d)",
+          index);
+
+  Field* transactCode = New<Field>(
+      STATIC | FINAL, New<Variable>(types->IntType(), transactCodeName));
+  transactCode->value = transactCodeValue;
+  stubClass->elements.push_back(transactCode);
+
+  // == the declaration in the interface ===================================
+  Method* decl = New<Method>();
+  decl->comment = method.GetComments();
+  decl->modifiers = PUBLIC;
+  decl->returnType = method.GetType().GetLanguageType<Type>();
+  decl->returnTypeDimension = method.GetType().IsArray() ? 1 : 0;
+  decl->name = method.GetName();
+
+  for (const AidlArgument* arg : method.GetArguments()) {
+    decl->parameters.push_back(
+        New<Variable>(arg->GetType().GetLanguageType<Type>(), arg->GetName(),
+                      arg->GetType().IsArray() ? 1 : 0));
+  }
+
+  decl->exceptions.push_back(types->RemoteExceptionType());
+
+  interface->elements.push_back(decl);
+
+  // == the no-op method ===================================================
+
+  if (noOpClass != NULL) {
+    Method* noOpMethod = New<Method>();
+    noOpMethod->comment = method.GetComments();
+    noOpMethod->modifiers = OVERRIDE | PUBLIC;
+    noOpMethod->returnType = method.GetType().GetLanguageType<Type>();
+    noOpMethod->returnTypeDimension = method.GetType().IsArray() ? 1 : 0;
+    noOpMethod->name = method.GetName();
+    noOpMethod->statements = New<StatementBlock>();
+    for (const AidlArgument* arg : method.GetArguments()) {
+      noOpMethod->parameters.push_back(
+          New<Variable>(arg->GetType().GetLanguageType<Type>(), arg->GetName(),
+                        arg->GetType().IsArray() ? 1 : 0));
+    }
+
+    std::string typeName = method.GetType().GetLanguageType<Type>()->JavaType();
+    if (typeName != "void") {
+      bool isNumeric = is_numeric_java_type(typeName);
+      bool isBoolean = typeName == "boolean";
+
+      if (isNumeric && !method.GetType().IsArray()) {
+        noOpMethod->statements->Add(
+            New<ReturnStatement>(New<LiteralExpression>("0")));
+      } else if (isBoolean && !method.GetType().IsArray()) {
+        noOpMethod->statements->Add(New<ReturnStatement>(FALSE_VALUE));
+      } else {
+        noOpMethod->statements->Add(New<ReturnStatement>(NULL_VALUE));
+      }
+    }
+    noOpMethod->exceptions.push_back(types->RemoteExceptionType());
+    noOpClass->elements.push_back(noOpMethod);
+  }
+
+  // == the stub method ====================================================
+
+  const string trace_section =
+      "AIDL::java::" + interface->type->ShortName() + "::" + method.GetName();
+
+  // Every value the stub reads or writes is an argument or the result.
+  bool uses_helpers = method.GetType().GetName() != "void" &&
+      use_parcelable_helpers(method.GetType().GetLanguageType<Type>(),
+                             stubClass);
+  for (const AidlArgument* arg : method.GetArguments()) {
+    uses_helpers = uses_helpers ||
+        use_parcelable_helpers(arg->GetType().GetLanguageType<Type>(),
+                               stubClass);
+  }
+  if (uses_helpers) {
+    add_parcelable_helpers(stubClass, types);
+  }
+
+  Case* c = New<Case>(transactCodeName);
+  stubClass->transact_switch->cases.push_back(c);
+  DeferredStatements::Builder build_stub =
+      [&method, stubClass, oneway, types, flags,
+       trace_section](StatementBlock* statements) {
+        generate_stub_statements(method, stubClass, oneway, types, flags,
+                                 trace_section, statements);
+      };
+
+  // Out of line, the case only forwards to a handler of its own.  Compact mode
+  // does this for every method, which keeps onTransact small enough for the
+  // JIT to compile, and a dispatch profile does it for the cold ones.
+  if (out_of_line) {
+    const string handler_name = "onTransact_" + methodId;
+    stubClass->elements.push_back(New<DeferredClassElement>(
+        [stubClass, types, handler_name, build_stub]() {
+          Method* handler = New<Method>();
+          handler->modifiers = PRIVATE;
+          handler->returnType = types->BoolType();
+          handler->name = handler_name;
+          handler->parameters.push_back(stubClass->transact_data);
+          handler->parameters.push_back(stubClass->transact_reply);
+          handler->exceptions.push_back(types->RemoteExceptionType());
+          handler->statements = New<StatementBlock>();
+          build_stub(handler->statements);
+          return handler;
+        }));
+
+    c->statements->Add(New<ReturnStatement>(
+        New<MethodCall>(THIS_VALUE, handler_name, 2, stubClass->transact_data,
+                        stubClass->transact_reply)));
+  } else {
+    c->statements->Add(New<DeferredStatements>(build_stub));
+  }
+
+  // The implementation may live in a different class loader than Stub, so
+  // this has to be looked up per instance.
+  if (stubClass->class_loader == NULL &&
+      reads_class_loader(method, false /* proxy_side */, stubClass, types)) {
+    declare_class_loader(stubClass, &stubClass->class_loader,
+                         New<Variable>(types->ClassLoaderType(), "cl"), 0,
+                         "mClassLoader", "this.getClass().getClassLoader()");
+  }
+
+  // == the proxy method ===================================================
+  proxyClass->elements.push_back(New<DeferredClassElement>(
+      [&method, stubClass, proxyClass, oneway, types, flags, transactCodeName,
+       trace_section]() {
+        return generate_proxy_method(method, stubClass, proxyClass, oneway,
+                                     types, flags, transactCodeName,
+                                     trace_section);
+      }));
+
+  if (proxyClass->class_loader == NULL && !oneway &&
+      reads_class_loader(method, true /* proxy_side */, stubClass, types)) {
+    declare_class_loader(proxyClass, &proxyClass->class_loader,
+                         New<Variable>(types->ClassLoaderType(), "cl"), STATIC,
+                         "sClassLoader",
+                         proxyClass->type->JavaType() +
+                             ".class.getClassLoader()");
   }
 }
 
 static void generate_interface_descriptors(StubClass* stub, ProxyClass* proxy,
                                            const JavaTypeNamespace* types) {
   // the interface descriptor transaction handler
-  Case* c = new Case("INTERFACE_TRANSACTION");
-  c->statements->Add(new MethodCall(stub->transact_reply, "writeString", 1,
-                                    new LiteralExpression("DESCRIPTOR")));
-  c->statements->Add(new ReturnStatement(TRUE_VALUE));
+  Case* c = New<Case>("INTERFACE_TRANSACTION");
+  c->statements->Add(New<MethodCall>(stub->transact_reply, "writeString", 1,
+                                     New<LiteralExpression>("DESCRIPTOR")));
+  c->statements->Add(New<ReturnStatement>(TRUE_VALUE));
   stub->transact_switch->cases.push_back(c);
 
   // and the proxy-side method returning the descriptor directly
-  Method* getDesc = new Method;
+  Method* getDesc = New<Method>();
   getDesc->modifiers = PUBLIC;
   getDesc->returnType = types->StringType();
   getDesc->returnTypeDimension = 0;
   getDesc->name = "getInterfaceDescriptor";
-  getDesc->statements = new StatementBlock;
+  getDesc->statements = New<StatementBlock>();
   getDesc->statements->Add(
-      new ReturnStatement(new LiteralExpression("DESCRIPTOR")));
+      New<ReturnStatement>(New<LiteralExpression>("DESCRIPTOR")));
   proxy->elements.push_back(getDesc);
 }
 
+static void generate_transaction_names(const AidlInterface* iface,
+                                       StubClass* stub,
+                                       const JavaTypeNamespace* types) {
+  int max_id = -1;
+  for (const auto& method : iface->GetMethods()) {
+    max_id = std::max(max_id, method->GetId());
+  }
+
+  // public static String getTransactionName(int code)
+  Variable* code = New<Variable>(types->IntType(), "code");
+  Method* get_name = New<Method>();
+  get_name->comment =
+      "/** Returns the name of the method a transaction code calls, "
+      "or null. */";
+  get_name->modifiers = PUBLIC | STATIC;
+  get_name->returnType = types->StringType();
+  get_name->name = "getTransactionName";
+  get_name->parameters.push_back(code);
+  get_name->statements = New<StatementBlock>();
+
+  const size_t table_size = DenseTableSize(*iface);
+  if (table_size > 0) {
+    // the method names, indexed by transaction id
+    vector<string> entries(table_size, "null");
+    for (const auto& method : iface->GetMethods()) {
+      entries[method->GetId()] = "\"" + method->GetName() + "\"";
+    }
+    Variable* names =
+        New<Variable>(types->StringType(), "_aidl_transactionNames", 1);
+    Field* names_field = New<Field>(PRIVATE | STATIC | FINAL, names);
+    names_field->value = "{\n";
+    for (const string& entry : entries) {
+      names_field->value += entry + ",\n";
+    }
+    names_field->value += "}";
+    stub->elements.push_back(names_field);
+
+    Variable* index = New<Variable>(types->IntType(), "index");
+    get_name->statements->Add(New<VariableDeclaration>(
+        index,
+        New<Comparison>(code, "-",
+                        New<LiteralExpression>(
+                            "android.os.IBinder.FIRST_CALL_TRANSACTION"))));
+    IfStatement* in_table = New<IfStatement>();
+    in_table->expression = New<Comparison>(
+        New<Comparison>(index, ">=", New<LiteralExpression>("0")), "&&",
+        New<Comparison>(index, "<", New<FieldVariable>(names, "length")));
+    in_table->statements->Add(New<ReturnStatement>(
+        New<LiteralExpression>(names->name + "[" + index->name + "]")));
+    get_name->statements->Add(in_table);
+  } else if (!iface->GetMethods().empty()) {
+    // the ids are too sparse for a table
+    SwitchStatement* by_code = New<SwitchStatement>(code);
+    for (const auto& method : iface->GetMethods()) {
+      Case* c = New<Case>(
+          "TRANSACTION_" + get_method_id(*method, method->GetId()));
+      c->statements->Add(New<ReturnStatement>(
+          New<StringLiteralExpression>(method->GetName())));
+      by_code->cases.push_back(c);
+    }
+    get_name->statements->Add(by_code);
+  }
+  get_name->statements->Add(New<ReturnStatement>(NULL_VALUE));
+  stub->elements.push_back(get_name);
+
+  // public static int getMaxTransactionId()
+  Method* get_max = New<Method>();
+  get_max->comment =
+      "/** Returns the largest transaction id used by this interface, "
+      "or -1. */";
+  get_max->modifiers = PUBLIC | STATIC;
+  get_max->returnType = types->IntType();
+  get_max->name = "getMaxTransactionId";
+  get_max->statements = New<StatementBlock>();
+  get_max->statements->Add(New<ReturnStatement>(
+      New<LiteralExpression>(std::to_string(max_id))));
+  stub->elements.push_back(get_max);
+}
+
+// Batches of @batchable calls go out as one oneway transaction holding the
+// interface token followed by each call's code, size and request parcel,
+// the same format as the C++ proxies send.  The proxy buffers the calls
+// until the batch is full or flushed, and the stub runs each one back
+// through onTransact, rejecting the batch if a call reads past its own bytes.
+static void generate_batch_support(const AidlInterface* iface,
+                                   const InterfaceType* interfaceType,
+                                   StubClass* stub, ProxyClass* proxy,
+                                   const JavaTypeNamespace* types) {
+  const string batch_code = "TRANSACTION__aidl_batch";
+  Field* code = New<Field>(
+      STATIC | FINAL, New<Variable>(types->IntType(), batch_code));
+  code->value = "android.os.IBinder.LAST_CALL_TRANSACTION";
+  stub->elements.push_back(code);
+
+  Expression* descriptor = New<LiteralExpression>("DESCRIPTOR");
+  Expression* oneway_flag =
+      New<LiteralExpression>("android.os.IBinder.FLAG_ONEWAY");
+
+  // private boolean _aidl_dispatchBatch(Parcel data)
+  Variable* data = stub->transact_data;
+  Variable* reply = New<Variable>(types->ParcelType(), "_aidl_reply");
+  Method* dispatch = New<Method>();
+  dispatch->modifiers = PRIVATE;
+  dispatch->returnType = types->BoolType();
+  dispatch->name = "_aidl_dispatchBatch";
+  dispatch->parameters.push_back(data);
+  dispatch->exceptions.push_back(types->RemoteExceptionType());
+  dispatch->statements = New<StatementBlock>();
+  dispatch->statements->Add(
+      New<MethodCall>(data, "enforceInterface", 1, descriptor));
+  dispatch->statements->Add(New<VariableDeclaration>(
+      reply, New<MethodCall>(types->ParcelType(), "obtain")));
+  TryStatement* tryStatement = New<TryStatement>();
+  dispatch->statements->Add(tryStatement);
+  FinallyStatement* finallyStatement = New<FinallyStatement>();
+  finallyStatement->statements->Add(New<MethodCall>(reply, "recycle"));
+  dispatch->statements->Add(finallyStatement);
+  dispatch->statements->Add(New<ReturnStatement>(TRUE_VALUE));
+  stub->elements.push_back(dispatch);
+
+  Expression* avail = New<MethodCall>(data, "dataAvail");
+  WhileStatement* each_call = New<WhileStatement>(
+      New<Comparison>(avail, ">", New<LiteralExpression>("0")));
+  tryStatement->statements->Add(each_call);
+  Variable* call_code = New<Variable>(types->IntType(), "_aidl_code");
+  Variable* size = New<Variable>(types->IntType(), "_aidl_size");
+  each_call->statements->Add(
+      New<VariableDeclaration>(call_code, New<MethodCall>(data, "readInt")));
+  each_call->statements->Add(
+      New<VariableDeclaration>(size, New<MethodCall>(data, "readInt")));
+
+  // Only calls to @batchable methods may be batched.
+  Expression* not_batchable = nullptr;
+  for (const auto& method : iface->GetMethods()) {
+    if (!method->IsBatchable()) {
+      continue;
+    }
+    Expression* other_code = New<Comparison>(
+        call_code, "!=",
+        New<LiteralExpression>(
+            "TRANSACTION_" + get_method_id(*method, method->GetId())));
+    not_batchable = (not_batchable == nullptr)
+                        ? other_code
+                        : New<Comparison>(not_batchable, "&&", other_code);
+  }
+  IfStatement* malformed = New<IfStatement>();
+  malformed->expression = New<Comparison>(
+      New<Comparison>(
+          New<Comparison>(size, "<", New<LiteralExpression>("0")), "||",
+          New<Comparison>(size, ">", avail)),
+      "||", not_batchable);
+  Statement* reject = New<ThrowStatement>(
+      New<NewExpression>(types->RuntimeExceptionType(), 1,
+                         New<StringLiteralExpression>("Malformed batch")));
+  malformed->statements->Add(reject);
+  each_call->statements->Add(malformed);
+
+  Variable* end = New<Variable>(types->IntType(), "_aidl_end");
+  each_call->statements->Add(New<VariableDeclaration>(
+      end, New<Comparison>(New<MethodCall>(data, "dataPosition"), "+", size)));
+  each_call->statements->Add(New<MethodCall>(THIS_VALUE, "onTransact", 4,
+                                             call_code, data, reply,
+                                             oneway_flag));
+  // A call that read past its own bytes has consumed some of the next one's.
+  IfStatement* overran = New<IfStatement>();
+  overran->expression =
+      New<Comparison>(New<MethodCall>(data, "dataPosition"), ">", end);
+  overran->statements->Add(reject);
+  each_call->statements->Add(overran);
+  each_call->statements->Add(New<MethodCall>(data, "setDataPosition", 1, end));
+
+  Case* c = New<Case>(batch_code);
+  c->statements->Add(New<ReturnStatement>(
+      New<MethodCall>(THIS_VALUE, dispatch->name, 1, data)));
+  stub->transact_switch->cases.push_back(c);
+
+  // public static void flushBatch(<interfaceType> iface)
+  Variable* iface_variable = New<Variable>(interfaceType, "iface");
+  Method* flush_iface = New<Method>();
+  flush_iface->comment =
+      "/** Sends the calls a proxy for |iface| has batched, if any. */";
+  flush_iface->modifiers = PUBLIC | STATIC;
+  flush_iface->returnType = types->VoidType();
+  flush_iface->name = "flushBatch";
+  flush_iface->parameters.push_back(iface_variable);
+  flush_iface->exceptions.push_back(types->RemoteExceptionType());
+  flush_iface->statements = New<StatementBlock>();
+  IfStatement* is_proxy = New<IfStatement>();
+  is_proxy->expression = New<Comparison>(iface_variable, " instanceof ",
+                                         New<LiteralExpression>("Proxy"));
+  is_proxy->statements->Add(New<MethodCall>(
+      New<Cast>(proxy->type, iface_variable), "flushBatch"));
+  flush_iface->statements->Add(is_proxy);
+  stub->elements.push_back(flush_iface);
+
+  // The batch being filled, or null, and the number of calls in it.
+  Variable* batch = New<Variable>(types->ParcelType(), "mBatch");
+  Field* batch_field = New<Field>(PRIVATE, batch);
+  batch_field->value = "null";
+  proxy->elements.push_back(batch_field);
+  Variable* batched_calls = New<Variable>(types->IntType(), "mBatchedCalls");
+  Field* batched_calls_field = New<Field>(PRIVATE, batched_calls);
+  batched_calls_field->value = "0";
+  proxy->elements.push_back(batched_calls_field);
+
+  // private synchronized void _aidl_batchCall(int code, Parcel data)
+  Variable* batched_code = New<Variable>(types->IntType(), "code");
+  Variable* batched_data = New<Variable>(types->ParcelType(), "data");
+  Method* batch_call = New<Method>();
+  batch_call->modifiers = PRIVATE | SYNCHRONIZED;
+  batch_call->returnType = types->VoidType();
+  batch_call->name = "_aidl_batchCall";
+  batch_call->parameters.push_back(batched_code);
+  batch_call->parameters.push_back(batched_data);
+  batch_call->exceptions.push_back(types->RemoteExceptionType());
+  batch_call->statements = New<StatementBlock>();
+  IfStatement* first_call = New<IfStatement>();
+  first_call->expression = New<Comparison>(batch, "==", NULL_VALUE);
+  first_call->statements->Add(
+      New<Assignment>(batch, New<MethodCall>(types->ParcelType(), "obtain")));
+  first_call->statements->Add(
+      New<MethodCall>(batch, "writeInterfaceToken", 1, descriptor));
+  batch_call->statements->Add(first_call);
+  Expression* data_size = New<MethodCall>(batched_data, "dataSize");
+  batch_call->statements->Add(
+      New<MethodCall>(batch, "writeInt", 1, batched_code));
+  batch_call->statements->Add(New<MethodCall>(batch, "writeInt", 1, data_size));
+  batch_call->statements->Add(New<MethodCall>(batch, "appendFrom", 3,
+                                              batched_data,
+                                              New<LiteralExpression>("0"),
+                                              data_size));
+  batch_call->statements->Add(New<Assignment>(
+      batched_calls,
+      New<Comparison>(batched_calls, "+", New<LiteralExpression>("1"))));
+  IfStatement* full = New<IfStatement>();
+  full->expression = New<Comparison>(
+      New<Comparison>(batched_calls, ">=",
+                      New<LiteralExpression>(std::to_string(kMaxBatchedCalls))),
+      "||",
+      New<Comparison>(New<MethodCall>(batch, "dataSize"), ">=",
+                      New<LiteralExpression>(std::to_string(kMaxBatchBytes))));
+  full->statements->Add(New<MethodCall>(THIS_VALUE, "flushBatch"));
+  batch_call->statements->Add(full);
+  proxy->elements.push_back(batch_call);
+
+  // public synchronized void flushBatch()
+  Method* flush = New<Method>();
+  flush->modifiers = PUBLIC | SYNCHRONIZED;
+  flush->returnType = types->VoidType();
+  flush->name = "flushBatch";
+  flush->exceptions.push_back(types->RemoteExceptionType());
+  flush->statements = New<StatementBlock>();
+  IfStatement* pending = New<IfStatement>();
+  pending->expression = New<Comparison>(batch, "!=", NULL_VALUE);
+  TryStatement* send = New<TryStatement>();
+  send->statements->Add(
+      New<MethodCall>(proxy->mRemote, "transact", 4,
+                      New<LiteralExpression>("Stub." + batch_code), batch,
+                      NULL_VALUE, oneway_flag));
+  pending->statements->Add(send);
+  FinallyStatement* reset = New<FinallyStatement>();
+  reset->statements->Add(New<MethodCall>(batch, "recycle"));
+  reset->statements->Add(New<Assignment>(batch, NULL_VALUE));
+  reset->statements->Add(
+      New<Assignment>(batched_calls, New<LiteralExpression>("0")));
+  pending->statements->Add(reset);
+  flush->statements->Add(pending);
+  proxy->elements.push_back(flush);
+}
+
 Class* generate_binder_interface_class(const AidlInterface* iface,
                                        JavaTypeNamespace* types,
-                                       unsigned int flags) {
+                                       unsigned int flags,
+                                       const DispatchProfile* profile) {
   const InterfaceType* interfaceType = iface->GetLanguageType<InterfaceType>();
 
   // the interface class
-  Class* interface = new Class;
+  Class* interface = New<Class>();
   interface->comment = iface->GetComments();
   interface->modifiers = PUBLIC;
   interface->what = Class::INTERFACE;
@@ -607,18 +1182,18 @@ Class* generate_binder_interface_class(const AidlInterface* iface,
   DefaultNoOpClass* noOpClass = NULL;
   if ((flags & GENERATE_NO_OP_CLASS) != 0) {
     noOpClass =
-      new DefaultNoOpClass(types, interfaceType->GetNoOp(), interfaceType);
+      New<DefaultNoOpClass>(types, interfaceType->GetNoOp(), interfaceType);
     interface->elements.push_back(noOpClass);
   }
 
   // the stub inner class
   StubClass* stub =
-      new StubClass(interfaceType->GetStub(), interfaceType, types);
+      New<StubClass>(interfaceType->GetStub(), interfaceType, types);
   interface->elements.push_back(stub);
 
   // the proxy inner class
   ProxyClass* proxy =
-      new ProxyClass(types, interfaceType->GetProxy(), interfaceType);
+      New<ProxyClass>(types, interfaceType->GetProxy(), interfaceType);
   stub->elements.push_back(proxy);
 
   // stub and proxy support for getInterfaceDescriptor()
@@ -630,10 +1205,39 @@ Class* generate_binder_interface_class(const AidlInterface* iface,
   }
 
   // all the declared methods of the interface
+  stub->compact = (flags & GENERATE_COMPACT) != 0;
+  proxy->batches = iface->HasBatchableMethods();
+  const vector<const AidlMethod*> hot = GetHotMethods(*iface, profile);
+  std::map<const AidlMethod*, Case*> method_cases;
+  for (const auto& item : iface->GetMethods()) {
+    const bool cold =
+        std::find(hot.begin(), hot.end(), item) == hot.end();
+    generate_method(*item, interface, stub, proxy, noOpClass, item->GetId(),
+                    types, flags, stub->compact || cold);
+    method_cases[item] = stub->transact_switch->cases.back();
+  }
+
+  // Lay out onTransact with the hot transactions first, right after the
+  // descriptor transaction, and the cold ones in declaration order after them.
+  vector<Case*>& cases = stub->transact_switch->cases;
+  cases.resize(cases.size() - method_cases.size());
+  for (const AidlMethod* method : hot) {
+    cases.push_back(method_cases[method]);
+    method_cases.erase(method);
+  }
   for (const auto& item : iface->GetMethods()) {
-    generate_method(*item, interface, stub, proxy, noOpClass, item->GetId(), types);
+    if (method_cases.count(item) != 0) {
+      cases.push_back(method_cases[item]);
+    }
   }
 
+  if (proxy->batches) {
+    generate_batch_support(iface, interfaceType, stub, proxy, types);
+  }
+
+  // transaction code to method name mapping, for profiling
+  generate_transaction_names(iface, stub, types);
+
   return interface;
 }
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_ASYNC_EXECUTOR_H_
+#define AIDL_ASYNC_EXECUTOR_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace aidl {
+
+// Runs the transactions issued by the ...Async() methods of clients generated
+// with aidl-cpp --async.
+//
+// At most |max_threads| tasks run at once, and at most |max_pending| more
+// wait for a thread.  Post() blocks while the queue is full, so callers that
+// issue calls faster than the remote can serve them are slowed down rather
+// than queueing without bound.  Threads are started on demand.
+//
+// Callbacks and resumed coroutines run on the executor's threads.  When one
+// of them posts to a full queue, the task runs inline instead, since those
+// threads are the only ones that could make room.
+class AsyncExecutor {
+ public:
+  AsyncExecutor(size_t max_threads, size_t max_pending);
+  // Runs every task that has already been posted, then joins the threads.
+  ~AsyncExecutor();
+
+  // Queues |task| to run on one of the executor's threads.  Called from one
+  // of those threads while the queue is full, runs |task| before returning.
+  void Post(std::function<void()> task);
+
+  // The executor used by generated clients that have not been given one.
+  // It is never destroyed.
+  static AsyncExecutor* Default();
+
+ private:
+  void Run();
+
+  const size_t max_threads_;
+  const size_t max_pending_;
+
+  std::mutex lock_;
+  std::condition_variable task_posted_;
+  std::condition_variable task_taken_;
+  std::deque<std::function<void()>> pending_;
+  std::vector<std::thread> threads_;
+  size_t idle_threads_ = 0;
+  bool shutting_down_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncExecutor);
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_ASYNC_EXECUTOR_H_
@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_COMPRESSED_PAYLOAD_H_
+#define AIDL_COMPRESSED_PAYLOAD_H_
+
+// Marshalling for values declared @compressed, which generated code calls in
+// place of the Parcel methods for ordinary values.
+//
+// A compressed value is written as a format word, then:
+//   -1  nothing; the value is null.
+//    0  its payload as a byte array.
+//    1  the size of its payload, then the payload compressed as an LZ4 block
+//       (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), as a
+//       byte array.
+// Payloads under kCompressionThreshold bytes, and those that compression
+// does not shrink, are written as they are.  The payload of a byte[] is the
+// array itself, that of a String is its UTF-16 code units, little endian,
+// and that of a parcelable is the data it writes to a Parcel of its own, so
+// it may not hold binders or file descriptors.
+// The Java generator writes the same format.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <binder/Parcel.h>
+#include <utils/Errors.h>
+#include <utils/String16.h>
+#include <utils/String8.h>
+
+namespace android {
+namespace aidl {
+
+// Smaller payloads rarely compress enough to pay for the extra work.  This is
+// not part of the format, so the two sides of a transaction need not agree.
+constexpr size_t kCompressionThreshold = 1024;
+
+namespace compressed_internal {
+
+enum : int32_t {
+  kNullFormat = -1,
+  kRawFormat = 0,
+  kLz4Format = 1,
+};
+
+// Limits of the LZ4 block format: matches are at least kMinMatch bytes long
+// and at most kMaxOffset bytes back, and the last match starts kMatchEnd
+// bytes or more before the end of the data and stops kLastLiterals bytes or
+// more before it.
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr size_t kMatchEnd = 12;
+constexpr size_t kLastLiterals = 5;
+// No block decompresses to more than this many times its own size.
+constexpr uint64_t kMaxRatio = 255;
+constexpr unsigned kHashBits = 12;
+
+inline uint32_t Load32(const uint8_t* p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline void PutLength(size_t length, std::vector<uint8_t>* block) {
+  for (; length >= 255; length -= 255) {
+    block->push_back(255);
+  }
+  block->push_back(static_cast<uint8_t>(length));
+}
+
+// Appends |literal_length| bytes at |literals| followed by a |match_length|
+// byte match |offset| bytes back.  Only the last sequence has no match, with
+// a |match_length| of 0.
+inline void PutSequence(const uint8_t* literals, size_t literal_length,
+                        size_t offset, size_t match_length,
+                        std::vector<uint8_t>* block) {
+  const size_t match_code = (match_length == 0) ? 0 : match_length - kMinMatch;
+  block->push_back(static_cast<uint8_t>(
+      std::min<size_t>(literal_length, 15) << 4 |
+      std::min<size_t>(match_code, 15)));
+  if (literal_length >= 15) {
+    PutLength(literal_length - 15, block);
+  }
+  block->insert(block->end(), literals, literals + literal_length);
+  if (match_length == 0) {
+    return;
+  }
+  block->push_back(static_cast<uint8_t>(offset));
+  block->push_back(static_cast<uint8_t>(offset >> 8));
+  if (match_code >= 15) {
+    PutLength(match_code - 15, block);
+  }
+}
+
+// Compresses |size| bytes at |data| into |block| with a greedy search for
+// matches, giving up and returning false once |block| grows to |size|.
+inline bool Compress(const uint8_t* data, size_t size,
+                     std::vector<uint8_t>* block) {
+  block->clear();
+  block->reserve(size);
+  std::vector<uint32_t> positions(1 << kHashBits);
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + kMatchEnd <= size) {
+    const uint32_t sequence = Load32(data + pos);
+    uint32_t* const entry =
+        &positions[(sequence * 2654435761u) >> (32 - kHashBits)];
+    const size_t candidate = *entry;
+    *entry = static_cast<uint32_t>(pos);
+    if (candidate >= pos || pos - candidate > kMaxOffset ||
+        Load32(data + candidate) != sequence) {
+      ++pos;
+      continue;
+    }
+    size_t length = kMinMatch;
+    while (pos + length < size - kLastLiterals &&
+           data[candidate + length] == data[pos + length]) {
+      ++length;
+    }
+    PutSequence(data + anchor, pos - anchor, pos - candidate, length, block);
+    pos += length;
+    anchor = pos;
+    if (block->size() >= size) {
+      return false;
+    }
+  }
+  PutSequence(data + anchor, size - anchor, 0, 0, block);
+  return block->size() < size;
+}
+
+// Adds to |length| the bytes of a length continued at |*offset| in |block|,
+// failing if it would pass |limit|.
+inline bool GetLength(const std::vector<uint8_t>& block, size_t limit,
+                      size_t* offset, size_t* length) {
+  uint8_t byte;
+  do {
+    if (*offset == block.size() || *length > limit) {
+      return false;
+    }
+    byte = block[(*offset)++];
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// Decompresses |block| into |data|, failing unless it comes to exactly |size|
+// bytes.
+inline bool Decompress(const std::vector<uint8_t>& block, size_t size,
+                       std::vector<uint8_t>* data) {
+  data->clear();
+  data->reserve(size);
+  size_t offset = 0;
+  while (true) {
+    if (offset == block.size()) {
+      return false;
+    }
+    const uint8_t token = block[offset++];
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 &&
+        !GetLength(block, size, &offset, &literal_length)) {
+      return false;
+    }
+    if (literal_length > block.size() - offset ||
+        literal_length > size - data->size()) {
+      return false;
+    }
+    data->insert(data->end(), block.begin() + offset,
+                 block.begin() + offset + literal_length);
+    offset += literal_length;
+    if (offset == block.size()) {
+      break;
+    }
+
+    if (block.size() - offset < 2) {
+      return false;
+    }
+    const size_t match_offset = block[offset] | block[offset + 1] << 8;
+    offset += 2;
+    if (match_offset == 0 || match_offset > data->size()) {
+      return false;
+    }
+    size_t match_length = token & 15;
+    if (match_length == 15 &&
+        !GetLength(block, size, &offset, &match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (match_length > size - data->size()) {
+      return false;
+    }
+    // Matches may overlap the bytes they produce, so copy one at a time.
+    for (size_t from = data->size() - match_offset; match_length > 0;
+         --match_length) {
+      data->push_back((*data)[from++]);
+    }
+  }
+  return data->size() == size;
+}
+
+inline status_t WritePayload(Parcel* parcel, const uint8_t* data,
+                             size_t size) {
+  if (size > INT32_MAX) {
+    return BAD_VALUE;
+  }
+  std::vector<uint8_t> block;
+  const bool compressed =
+      size >= kCompressionThreshold && Compress(data, size, &block);
+  status_t status = parcel->writeInt32((compressed) ? kLz4Format
+                                                    : kRawFormat);
+  if (status != OK) {
+    return status;
+  }
+  if (compressed) {
+    status = parcel->writeInt32(static_cast<int32_t>(size));
+    if (status != OK) {
+      return status;
+    }
+    return parcel->writeByteVector(block);
+  }
+  status = parcel->writeInt32(static_cast<int32_t>(size));
+  if (status != OK || size == 0) {
+    return status;
+  }
+  return parcel->write(data, size);
+}
+
+// Reads a byte array that may not be null.
+inline status_t ReadBytes(const Parcel* parcel, std::vector<uint8_t>* bytes) {
+  status_t status = parcel->readByteVector(bytes);
+  return (status == UNEXPECTED_NULL) ? BAD_VALUE : status;
+}
+
+// Reads a payload into |data|, returning UNEXPECTED_NULL if it is null.
+inline status_t ReadPayload(const Parcel* parcel, std::vector<uint8_t>* data) {
+  int32_t format;
+  status_t status = parcel->readInt32(&format);
+  if (status != OK) {
+    return status;
+  }
+  switch (format) {
+    case kNullFormat:
+      return UNEXPECTED_NULL;
+    case kRawFormat:
+      return ReadBytes(parcel, data);
+    case kLz4Format:
+      break;
+    default:
+      return BAD_VALUE;
+  }
+
+  int32_t size;
+  status = parcel->readInt32(&size);
+  if (status != OK) {
+    return status;
+  }
+  std::vector<uint8_t> block;
+  status = ReadBytes(parcel, &block);
+  if (status != OK) {
+    return status;
+  }
+  if (size < 0 || static_cast<uint64_t>(size) > block.size() * kMaxRatio ||
+      !Decompress(block, static_cast<size_t>(size), data)) {
+    return BAD_VALUE;
+  }
+  return OK;
+}
+
+inline status_t WriteString(Parcel* parcel, const char16_t* chars,
+                            size_t length) {
+  std::vector<uint8_t> payload;
+  payload.reserve(length * 2);
+  for (size_t i = 0; i < length; ++i) {
+    payload.push_back(static_cast<uint8_t>(chars[i]));
+    payload.push_back(static_cast<uint8_t>(chars[i] >> 8));
+  }
+  return WritePayload(parcel, payload.data(), payload.size());
+}
+
+inline status_t ReadString(const Parcel* parcel, String16* value) {
+  std::vector<uint8_t> payload;
+  status_t status = ReadPayload(parcel, &payload);
+  if (status != OK) {
+    return status;
+  }
+  if (payload.size() % 2 != 0) {
+    return BAD_VALUE;
+  }
+  std::vector<char16_t> chars(payload.size() / 2);
+  for (size_t i = 0; i < chars.size(); ++i) {
+    chars[i] = payload[2 * i] | payload[2 * i + 1] << 8;
+  }
+  *value = (chars.empty()) ? String16() : String16(chars.data(), chars.size());
+  return OK;
+}
+
+template <typename T, typename Write>
+status_t WriteNullable(Parcel* parcel, const std::unique_ptr<T>& value,
+                       Write write) {
+  if (!value) {
+    return parcel->writeInt32(kNullFormat);
+  }
+  return write(parcel, *value);
+}
+
+template <typename T, typename Read>
+status_t ReadNullable(const Parcel* parcel, std::unique_ptr<T>* value,
+                      Read read) {
+  value->reset(new T());
+  status_t status = read(parcel, value->get());
+  if (status == UNEXPECTED_NULL) {
+    value->reset();
+    return OK;
+  }
+  return status;
+}
+
+}  // namespace compressed_internal
+
+inline status_t WriteCompressedByteVector(Parcel* parcel,
+                                          const std::vector<uint8_t>& value) {
+  return compressed_internal::WritePayload(parcel, value.data(),
+                                           value.size());
+}
+
+inline status_t ReadCompressedByteVector(const Parcel* parcel,
+                                         std::vector<uint8_t>* value) {
+  return compressed_internal::ReadPayload(parcel, value);
+}
+
+inline status_t WriteCompressedString16(Parcel* parcel,
+                                        const String16& value) {
+  return compressed_internal::WriteString(parcel, value.string(),
+                                          value.size());
+}
+
+inline status_t ReadCompressedString16(const Parcel* parcel,
+                                       String16* value) {
+  return compressed_internal::ReadString(parcel, value);
+}
+
+// For @utf8InCpp Strings, which are UTF-16 on the wire like any other.
+inline status_t WriteCompressedUtf8String(Parcel* parcel,
+                                          const std::string& value) {
+  const String16 utf16(value.data(), value.size());
+  return compressed_internal::WriteString(parcel, utf16.string(),
+                                          utf16.size());
+}
+
+inline status_t ReadCompressedUtf8String(const Parcel* parcel,
+                                         std::string* value) {
+  String16 utf16;
+  status_t status = compressed_internal::ReadString(parcel, &utf16);
+  if (status != OK) {
+    return status;
+  }
+  const String8 utf8(utf16);
+  value->assign(utf8.string(), utf8.size());
+  return OK;
+}
+
+template <typename T>
+status_t WriteCompressedParcelable(Parcel* parcel, const T& value) {
+  Parcel flattened;
+  status_t status = value.writeToParcel(&flattened);
+  if (status != OK) {
+    return status;
+  }
+  if (flattened.objectsCount() != 0) {
+    return BAD_VALUE;
+  }
+  return compressed_internal::WritePayload(parcel, flattened.data(),
+                                           flattened.dataSize());
+}
+
+template <typename T>
+status_t ReadCompressedParcelable(const Parcel* parcel, T* value) {
+  std::vector<uint8_t> payload;
+  status_t status = compressed_internal::ReadPayload(parcel, &payload);
+  if (status != OK) {
+    return status;
+  }
+  Parcel flattened;
+  if (!payload.empty()) {
+    status = flattened.setData(payload.data(), payload.size());
+    if (status != OK) {
+      return status;
+    }
+  }
+  return value->readFromParcel(&flattened);
+}
+
+#define AIDL_NULLABLE_COMPRESSED_FUNCTIONS(name)                           \
+  template <typename T>                                                    \
+  status_t WriteCompressed##name(Parcel* parcel,                           \
+                                 const std::unique_ptr<T>& value) {        \
+    return compressed_internal::WriteNullable(                             \
+        parcel, value, [](Parcel* p, const T& v) {                         \
+          return WriteCompressed##name(p, v);                              \
+        });                                                                \
+  }                                                                        \
+  template <typename T>                                                    \
+  status_t ReadCompressed##name(const Parcel* parcel,                      \
+                                std::unique_ptr<T>* value) {               \
+    return compressed_internal::ReadNullable(                              \
+        parcel, value, [](const Parcel* p, T* v) {                         \
+          return ReadCompressed##name(p, v);                               \
+        });                                                                \
+  }
+
+AIDL_NULLABLE_COMPRESSED_FUNCTIONS(ByteVector)
+AIDL_NULLABLE_COMPRESSED_FUNCTIONS(String16)
+AIDL_NULLABLE_COMPRESSED_FUNCTIONS(Utf8String)
+AIDL_NULLABLE_COMPRESSED_FUNCTIONS(Parcelable)
+
+#undef AIDL_NULLABLE_COMPRESSED_FUNCTIONS
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_COMPRESSED_PAYLOAD_H_
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_PACKED_ARRAYS_H_
+#define AIDL_PACKED_ARRAYS_H_
+
+// Marshalling for arrays declared @packed, which generated code calls in
+// place of the Parcel methods for ordinary arrays.
+//
+// A packed array is written as its element count (-1 for null) followed,
+// unless it is null, by a byte array holding the elements:
+//   boolean[]  one bit each, least significant bit first.
+//   char[]     a base 128 varint each.
+//   int[]      a zigzag encoded base 128 varint each, so that values near
+//   long[]     zero take a byte whatever their sign.
+// The Java generator writes the same format.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <binder/Parcel.h>
+#include <utils/Errors.h>
+
+namespace android {
+namespace aidl {
+namespace packed_internal {
+
+inline uint64_t ToVarint(char16_t value) { return value; }
+inline uint64_t ToVarint(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+inline uint64_t ToVarint(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline void FromVarint(uint64_t bits, char16_t* value) {
+  *value = static_cast<char16_t>(bits);
+}
+inline void FromVarint(uint64_t bits, int32_t* value) {
+  *value = static_cast<int32_t>(static_cast<uint32_t>(bits >> 1) ^
+                                -static_cast<uint32_t>(bits & 1));
+}
+inline void FromVarint(uint64_t bits, int64_t* value) {
+  *value = static_cast<int64_t>((bits >> 1) ^ -(bits & 1));
+}
+
+inline status_t WriteBytes(Parcel* parcel, size_t count,
+                           const std::vector<uint8_t>& bytes) {
+  if (count > INT32_MAX) {
+    return BAD_VALUE;
+  }
+  status_t status = parcel->writeInt32(static_cast<int32_t>(count));
+  if (status != OK) {
+    return status;
+  }
+  return parcel->writeByteVector(bytes);
+}
+
+// Reads the header of a packed array, leaving |bytes| empty and returning
+// UNEXPECTED_NULL if it is null.  Each element needs at least one bit or one
+// byte, so an array cannot claim more elements than |bytes| has room for.
+inline status_t ReadBytes(const Parcel* parcel, bool bit_packed,
+                          size_t* count, std::vector<uint8_t>* bytes) {
+  int32_t length;
+  status_t status = parcel->readInt32(&length);
+  if (status != OK) {
+    return status;
+  }
+  if (length < 0) {
+    return UNEXPECTED_NULL;
+  }
+  status = parcel->readByteVector(bytes);
+  if (status != OK) {
+    return status;
+  }
+  *count = static_cast<size_t>(length);
+  const size_t needed = (bit_packed) ? (*count + 7) / 8 : *count;
+  if ((bit_packed && bytes->size() != needed) || bytes->size() < needed) {
+    return BAD_VALUE;
+  }
+  return OK;
+}
+
+inline status_t Write(Parcel* parcel, const std::vector<bool>& values) {
+  std::vector<uint8_t> bytes((values.size() + 7) / 8);
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i]) {
+      bytes[i / 8] |= 1 << (i % 8);
+    }
+  }
+  return WriteBytes(parcel, values.size(), bytes);
+}
+
+template <typename T>
+status_t Write(Parcel* parcel, const std::vector<T>& values) {
+  std::vector<uint8_t> bytes;
+  bytes.reserve(values.size());
+  for (T value : values) {
+    uint64_t bits = ToVarint(value);
+    while (bits >= 0x80) {
+      bytes.push_back(static_cast<uint8_t>(bits | 0x80));
+      bits >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(bits));
+  }
+  return WriteBytes(parcel, values.size(), bytes);
+}
+
+inline status_t Read(const Parcel* parcel, std::vector<bool>* values) {
+  size_t count;
+  std::vector<uint8_t> bytes;
+  status_t status = ReadBytes(parcel, true, &count, &bytes);
+  if (status != OK) {
+    return status;
+  }
+  values->resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    (*values)[i] = (bytes[i / 8] >> (i % 8)) & 1;
+  }
+  return OK;
+}
+
+template <typename T>
+status_t Read(const Parcel* parcel, std::vector<T>* values) {
+  // The last byte of a varint may only hold the bits left over from the
+  // ones before it.
+  const unsigned kBits = sizeof(T) * 8;
+  const unsigned kLastShift = (kBits - 1) / 7 * 7;
+
+  size_t count;
+  std::vector<uint8_t> bytes;
+  status_t status = ReadBytes(parcel, false, &count, &bytes);
+  if (status != OK) {
+    return status;
+  }
+  values->resize(count);
+  size_t offset = 0;
+  for (T& value : *values) {
+    uint64_t bits = 0;
+    for (unsigned shift = 0;; shift += 7) {
+      if (offset == bytes.size()) {
+        return BAD_VALUE;
+      }
+      const uint8_t byte = bytes[offset++];
+      if (shift == kLastShift && (byte >> (kBits - kLastShift)) != 0) {
+        return BAD_VALUE;
+      }
+      bits |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+    }
+    FromVarint(bits, &value);
+  }
+  return (offset == bytes.size()) ? OK : BAD_VALUE;
+}
+
+template <typename T>
+status_t WriteNullable(Parcel* parcel,
+                       const std::unique_ptr<std::vector<T>>& values) {
+  if (!values) {
+    return parcel->writeInt32(-1);
+  }
+  return Write(parcel, *values);
+}
+
+template <typename T>
+status_t ReadNullable(const Parcel* parcel,
+                      std::unique_ptr<std::vector<T>>* values) {
+  values->reset(new std::vector<T>());
+  status_t status = Read(parcel, values->get());
+  if (status == UNEXPECTED_NULL) {
+    values->reset();
+    return OK;
+  }
+  return status;
+}
+
+}  // namespace packed_internal
+
+#define AIDL_PACKED_ARRAY_FUNCTIONS(name, type)                              \
+  inline status_t WritePacked##name##Vector(                                 \
+      Parcel* parcel, const std::vector<type>& values) {                     \
+    return packed_internal::Write(parcel, values);                           \
+  }                                                                          \
+  inline status_t WritePacked##name##Vector(                                 \
+      Parcel* parcel, const std::unique_ptr<std::vector<type>>& values) {    \
+    return packed_internal::WriteNullable(parcel, values);                   \
+  }                                                                          \
+  inline status_t ReadPacked##name##Vector(const Parcel* parcel,             \
+                                           std::vector<type>* values) {      \
+    return packed_internal::Read(parcel, values);                            \
+  }                                                                          \
+  inline status_t ReadPacked##name##Vector(                                  \
+      const Parcel* parcel, std::unique_ptr<std::vector<type>>* values) {    \
+    return packed_internal::ReadNullable(parcel, values);                    \
+  }
+
+AIDL_PACKED_ARRAY_FUNCTIONS(Bool, bool)
+AIDL_PACKED_ARRAY_FUNCTIONS(Char, char16_t)
+AIDL_PACKED_ARRAY_FUNCTIONS(Int32, int32_t)
+AIDL_PACKED_ARRAY_FUNCTIONS(Int64, int64_t)
+
+#undef AIDL_PACKED_ARRAY_FUNCTIONS
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_PACKED_ARRAYS_H_
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_STATUS_AWAITABLE_H_
+#define AIDL_STATUS_AWAITABLE_H_
+
+// Clients generated with aidl-cpp --coroutines only declare their ...Co()
+// methods when this header finds compiler and library support for
+// coroutines, so the same generated code still builds as C++11.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define AIDL_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef AIDL_HAS_COROUTINES
+
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace android {
+namespace aidl {
+
+// The result of a generated ...Co() method, to be co_await'ed for the Status
+// of the call.
+//
+// The transaction is already on its way when the awaitable is returned; it
+// completes through the callback returned by Completer().  The awaiting
+// coroutine is resumed on the thread that completes it, normally a thread of
+// the client's AsyncExecutor, or not suspended at all if the call has already
+// finished by the time it is awaited.  Each awaitable is awaited at most once.
+template <typename Status>
+class StatusAwaitable {
+ public:
+  StatusAwaitable() : state_(std::make_shared<State>()) {}
+
+  // Returns the callback that delivers the result of the call.
+  std::function<void(Status)> Completer() const {
+    std::shared_ptr<State> state = state_;
+    return [state](Status status) { state->Complete(std::move(status)); };
+  }
+
+  bool await_ready() const {
+    std::lock_guard<std::mutex> l(state_->lock);
+    return state_->done;
+  }
+
+  bool await_suspend(std::coroutine_handle<> waiter) {
+    std::lock_guard<std::mutex> l(state_->lock);
+    if (state_->done) {
+      return false;  // Completed since await_ready(); carry on.
+    }
+    state_->waiter = waiter;
+    return true;
+  }
+
+  Status await_resume() {
+    std::lock_guard<std::mutex> l(state_->lock);
+    return std::move(state_->status);
+  }
+
+ private:
+  struct State {
+    void Complete(Status result) {
+      std::coroutine_handle<> to_resume;
+      {
+        std::lock_guard<std::mutex> l(lock);
+        status = std::move(result);
+        done = true;
+        to_resume = waiter;
+      }
+      if (to_resume) {
+        to_resume.resume();
+      }
+    }
+
+    std::mutex lock;
+    bool done = false;
+    Status status;
+    std::coroutine_handle<> waiter;
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_HAS_COROUTINES
+
+#endif  // AIDL_STATUS_AWAITABLE_H_
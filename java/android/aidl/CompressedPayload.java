@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package android.aidl;
+
+import android.os.BadParcelableException;
+import android.os.Parcel;
+import android.os.Parcelable;
+
+import java.io.ByteArrayOutputStream;
+import java.util.Arrays;
+
+/**
+ * Marshalling for values declared @compressed, which generated code calls in
+ * place of the Parcel methods for ordinary values.
+ *
+ * The format is the one described in include/aidl/compressed_payload.h: a
+ * format word (-1 for null, 0 for a raw payload, 1 for an LZ4 block) followed
+ * by the payload.  The payload of a String is its UTF-16 code units, little
+ * endian, and that of a parcelable is what it writes to a Parcel of its own.
+ */
+public final class CompressedPayload {
+    // Smaller payloads rarely compress enough to pay for the extra work.
+    // This is not part of the format, so the two sides need not agree.
+    private static final int COMPRESSION_THRESHOLD = 1024;
+
+    private static final int NULL_FORMAT = -1;
+    private static final int RAW_FORMAT = 0;
+    private static final int LZ4_FORMAT = 1;
+
+    // Limits of the LZ4 block format, as in compressed_payload.h.
+    private static final int MIN_MATCH = 4;
+    private static final int MAX_OFFSET = 65535;
+    private static final int MATCH_END = 12;
+    private static final int LAST_LITERALS = 5;
+    private static final long MAX_RATIO = 255;
+    private static final int HASH_BITS = 12;
+
+    private CompressedPayload() {}
+
+    public static void writeByteArray(Parcel parcel, byte[] value) {
+        writePayload(parcel, value);
+    }
+
+    public static byte[] createByteArray(Parcel parcel) {
+        return createPayload(parcel);
+    }
+
+    public static void readByteArray(Parcel parcel, byte[] value) {
+        byte[] read = createPayload(parcel);
+        if (read == null || read.length != value.length) {
+            throw new RuntimeException("bad array lengths");
+        }
+        System.arraycopy(read, 0, value, 0, value.length);
+    }
+
+    // Strings are compressed as UTF-16, which unlike a charset encoder keeps
+    // unpaired surrogates intact.
+    public static void writeString(Parcel parcel, String value) {
+        byte[] payload = null;
+        if (value != null) {
+            payload = new byte[value.length() * 2];
+            for (int i = 0; i < value.length(); ++i) {
+                char c = value.charAt(i);
+                payload[2 * i] = (byte) c;
+                payload[2 * i + 1] = (byte) (c >>> 8);
+            }
+        }
+        writePayload(parcel, payload);
+    }
+
+    public static String createString(Parcel parcel) {
+        byte[] payload = createPayload(parcel);
+        if (payload == null) {
+            return null;
+        }
+        if (payload.length % 2 != 0) {
+            throw malformed();
+        }
+        char[] chars = new char[payload.length / 2];
+        for (int i = 0; i < chars.length; ++i) {
+            chars[i] = (char) ((payload[2 * i] & 0xff) | (payload[2 * i + 1] & 0xff) << 8);
+        }
+        return new String(chars);
+    }
+
+    public static void writeParcelable(Parcel parcel, Parcelable value, int flags) {
+        byte[] payload = null;
+        if (value != null) {
+            Parcel flattened = Parcel.obtain();
+            value.writeToParcel(flattened, flags);
+            payload = flattened.marshall();
+            flattened.recycle();
+        }
+        writePayload(parcel, payload);
+    }
+
+    public static <T> T createParcelable(Parcel parcel, Parcelable.Creator<T> creator) {
+        Parcel flattened = unmarshall(parcel);
+        if (flattened == null) {
+            return null;
+        }
+        T value = creator.createFromParcel(flattened);
+        flattened.recycle();
+        return value;
+    }
+
+    /**
+     * Returns a Parcel, positioned at its start, holding the data a
+     * compressed parcelable wrote, or null if the parcelable is null.  The
+     * caller must recycle it.
+     */
+    public static Parcel unmarshall(Parcel parcel) {
+        byte[] payload = createPayload(parcel);
+        if (payload == null) {
+            return null;
+        }
+        Parcel flattened = Parcel.obtain();
+        flattened.unmarshall(payload, 0, payload.length);
+        flattened.setDataPosition(0);
+        return flattened;
+    }
+
+    private static void writePayload(Parcel parcel, byte[] payload) {
+        if (payload == null) {
+            parcel.writeInt(NULL_FORMAT);
+            return;
+        }
+        byte[] block = (payload.length < COMPRESSION_THRESHOLD) ? null : compress(payload);
+        if (block == null) {
+            parcel.writeInt(RAW_FORMAT);
+            parcel.writeByteArray(payload);
+        } else {
+            parcel.writeInt(LZ4_FORMAT);
+            parcel.writeInt(payload.length);
+            parcel.writeByteArray(block);
+        }
+    }
+
+    private static byte[] createPayload(Parcel parcel) {
+        int format = parcel.readInt();
+        if (format == NULL_FORMAT) {
+            return null;
+        }
+        if (format == RAW_FORMAT) {
+            byte[] payload = parcel.createByteArray();
+            if (payload != null) {
+                return payload;
+            }
+        } else if (format == LZ4_FORMAT) {
+            int size = parcel.readInt();
+            byte[] block = parcel.createByteArray();
+            if (block != null && size >= 0 && size <= MAX_RATIO * block.length) {
+                return decompress(block, size);
+            }
+        }
+        throw malformed();
+    }
+
+    private static BadParcelableException malformed() {
+        return new BadParcelableException("Malformed compressed payload");
+    }
+
+    private static int load32(byte[] data, int i) {
+        return (data[i] & 0xff) | (data[i + 1] & 0xff) << 8 | (data[i + 2] & 0xff) << 16
+                | data[i + 3] << 24;
+    }
+
+    private static void putLength(ByteArrayOutputStream block, int length) {
+        for (; length >= 255; length -= 255) {
+            block.write(255);
+        }
+        block.write(length);
+    }
+
+    /**
+     * Appends |literals| bytes of |data| from |start| followed by a |match|
+     * byte match |offset| bytes back.  Only the last sequence has no match,
+     * with a |match| of 0.
+     */
+    private static void putSequence(ByteArrayOutputStream block, byte[] data, int start,
+            int literals, int offset, int match) {
+        int code = (match == 0) ? 0 : match - MIN_MATCH;
+        block.write(Math.min(literals, 15) << 4 | Math.min(code, 15));
+        if (literals >= 15) {
+            putLength(block, literals - 15);
+        }
+        block.write(data, start, literals);
+        if (match != 0) {
+            block.write(offset);
+            block.write(offset >>> 8);
+            if (code >= 15) {
+                putLength(block, code - 15);
+            }
+        }
+    }
+
+    /**
+     * Compresses |data| with a greedy search for matches, returning null if
+     * that does not make it smaller.
+     */
+    private static byte[] compress(byte[] data) {
+        int[] positions = new int[1 << HASH_BITS];
+        Arrays.fill(positions, -1);
+        ByteArrayOutputStream block = new ByteArrayOutputStream(data.length);
+        int anchor = 0;
+        int pos = 0;
+        while (pos + MATCH_END <= data.length) {
+            int sequence = load32(data, pos);
+            int hash = (sequence * -1640531535) >>> (32 - HASH_BITS);
+            int candidate = positions[hash];
+            positions[hash] = pos;
+            if (candidate < 0 || pos - candidate > MAX_OFFSET
+                    || load32(data, candidate) != sequence) {
+                ++pos;
+                continue;
+            }
+            int match = MIN_MATCH;
+            while (pos + match < data.length - LAST_LITERALS
+                    && data[candidate + match] == data[pos + match]) {
+                ++match;
+            }
+            putSequence(block, data, anchor, pos - anchor, pos - candidate, match);
+            pos += match;
+            anchor = pos;
+            if (block.size() >= data.length) {
+                return null;
+            }
+        }
+        putSequence(block, data, anchor, data.length - anchor, 0, 0);
+        return (block.size() < data.length) ? block.toByteArray() : null;
+    }
+
+    private static byte[] decompress(byte[] block, int size) {
+        return new Decompressor(block, size).run();
+    }
+
+    /** Decodes LZ4 blocks, which must come to exactly |size| bytes. */
+    private static final class Decompressor {
+        private final byte[] mBlock;
+        private final byte[] mData;
+        private int mIn = 0;
+        private int mOut = 0;
+
+        Decompressor(byte[] block, int size) {
+            mBlock = block;
+            mData = new byte[size];
+        }
+
+        /** Adds to |length| the bytes of a length continued in the block. */
+        private int getLength(int length) {
+            int b;
+            do {
+                if (mIn == mBlock.length || length > mData.length) {
+                    throw malformed();
+                }
+                b = mBlock[mIn++] & 0xff;
+                length += b;
+            } while (b == 255);
+            return length;
+        }
+
+        byte[] run() {
+            while (true) {
+                if (mIn == mBlock.length) {
+                    throw malformed();
+                }
+                int token = mBlock[mIn++] & 0xff;
+                int length = token >>> 4;
+                if (length == 15) {
+                    length = getLength(length);
+                }
+                if (length > mBlock.length - mIn || length > mData.length - mOut) {
+                    throw malformed();
+                }
+                System.arraycopy(mBlock, mIn, mData, mOut, length);
+                mIn += length;
+                mOut += length;
+                if (mIn == mBlock.length) {
+                    break;
+                }
+
+                if (mBlock.length - mIn < 2) {
+                    throw malformed();
+                }
+                int offset = (mBlock[mIn] & 0xff) | (mBlock[mIn + 1] & 0xff) << 8;
+                mIn += 2;
+                if (offset == 0 || offset > mOut) {
+                    throw malformed();
+                }
+                length = token & 15;
+                if (length == 15) {
+                    length = getLength(length);
+                }
+                length += MIN_MATCH;
+                if (length > mData.length - mOut) {
+                    throw malformed();
+                }
+                // Matches may overlap the bytes they produce, so copy one at
+                // a time.
+                for (; length > 0; --length, ++mOut) {
+                    mData[mOut] = mData[mOut - offset];
+                }
+            }
+            if (mOut != mData.length) {
+                throw malformed();
+            }
+            return mData;
+        }
+    }
+}
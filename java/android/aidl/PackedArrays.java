@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package android.aidl;
+
+import android.os.BadParcelableException;
+import android.os.Parcel;
+
+/**
+ * Marshalling for arrays declared @packed, which generated code calls in
+ * place of the Parcel methods for ordinary arrays.
+ *
+ * The format is the one described in include/aidl/packed_arrays.h: the
+ * element count (-1 for null) followed by a byte array of bits for boolean[],
+ * varints for char[] and zigzag encoded varints for int[] and long[].
+ */
+public final class PackedArrays {
+    private PackedArrays() {}
+
+    public static void writeBooleanArray(Parcel parcel, boolean[] value) {
+        if (value == null) {
+            parcel.writeInt(-1);
+            return;
+        }
+        byte[] bytes = new byte[(value.length + 7) / 8];
+        for (int i = 0; i < value.length; ++i) {
+            if (value[i]) {
+                bytes[i / 8] |= 1 << (i % 8);
+            }
+        }
+        parcel.writeInt(value.length);
+        parcel.writeByteArray(bytes);
+    }
+
+    public static boolean[] createBooleanArray(Parcel parcel) {
+        int length = parcel.readInt();
+        if (length < 0) {
+            return null;
+        }
+        byte[] bytes = parcel.createByteArray();
+        if (bytes == null || bytes.length != (length + 7L) / 8) {
+            throw malformed("boolean");
+        }
+        boolean[] value = new boolean[length];
+        for (int i = 0; i < length; ++i) {
+            value[i] = (bytes[i / 8] & (1 << (i % 8))) != 0;
+        }
+        return value;
+    }
+
+    public static void readBooleanArray(Parcel parcel, boolean[] value) {
+        boolean[] read = createBooleanArray(parcel);
+        checkLength(read == null ? -1 : read.length, value.length);
+        System.arraycopy(read, 0, value, 0, value.length);
+    }
+
+    public static void writeCharArray(Parcel parcel, char[] value) {
+        if (value == null) {
+            parcel.writeInt(-1);
+            return;
+        }
+        VarintWriter writer = new VarintWriter(value.length, 3);
+        for (char element : value) {
+            writer.put(element);
+        }
+        writer.writeTo(parcel);
+    }
+
+    public static char[] createCharArray(Parcel parcel) {
+        VarintReader reader = VarintReader.read(parcel, 16, "char");
+        if (reader == null) {
+            return null;
+        }
+        char[] value = new char[reader.count];
+        for (int i = 0; i < value.length; ++i) {
+            value[i] = (char) reader.next();
+        }
+        reader.finish();
+        return value;
+    }
+
+    public static void readCharArray(Parcel parcel, char[] value) {
+        char[] read = createCharArray(parcel);
+        checkLength(read == null ? -1 : read.length, value.length);
+        System.arraycopy(read, 0, value, 0, value.length);
+    }
+
+    public static void writeIntArray(Parcel parcel, int[] value) {
+        if (value == null) {
+            parcel.writeInt(-1);
+            return;
+        }
+        VarintWriter writer = new VarintWriter(value.length, 5);
+        for (int element : value) {
+            writer.put(((element << 1) ^ (element >> 31)) & 0xffffffffL);
+        }
+        writer.writeTo(parcel);
+    }
+
+    public static int[] createIntArray(Parcel parcel) {
+        VarintReader reader = VarintReader.read(parcel, 32, "int");
+        if (reader == null) {
+            return null;
+        }
+        int[] value = new int[reader.count];
+        for (int i = 0; i < value.length; ++i) {
+            int bits = (int) reader.next();
+            value[i] = (bits >>> 1) ^ -(bits & 1);
+        }
+        reader.finish();
+        return value;
+    }
+
+    public static void readIntArray(Parcel parcel, int[] value) {
+        int[] read = createIntArray(parcel);
+        checkLength(read == null ? -1 : read.length, value.length);
+        System.arraycopy(read, 0, value, 0, value.length);
+    }
+
+    public static void writeLongArray(Parcel parcel, long[] value) {
+        if (value == null) {
+            parcel.writeInt(-1);
+            return;
+        }
+        VarintWriter writer = new VarintWriter(value.length, 10);
+        for (long element : value) {
+            writer.put((element << 1) ^ (element >> 63));
+        }
+        writer.writeTo(parcel);
+    }
+
+    public static long[] createLongArray(Parcel parcel) {
+        VarintReader reader = VarintReader.read(parcel, 64, "long");
+        if (reader == null) {
+            return null;
+        }
+        long[] value = new long[reader.count];
+        for (int i = 0; i < value.length; ++i) {
+            long bits = reader.next();
+            value[i] = (bits >>> 1) ^ -(bits & 1);
+        }
+        reader.finish();
+        return value;
+    }
+
+    public static void readLongArray(Parcel parcel, long[] value) {
+        long[] read = createLongArray(parcel);
+        checkLength(read == null ? -1 : read.length, value.length);
+        System.arraycopy(read, 0, value, 0, value.length);
+    }
+
+    private static void checkLength(int read, int expected) {
+        if (read != expected) {
+            throw new RuntimeException("bad array lengths");
+        }
+    }
+
+    private static BadParcelableException malformed(String type) {
+        return new BadParcelableException("Malformed packed " + type + "[]");
+    }
+
+    /** Collects the varints of |count| elements of at most |maxBytes| each. */
+    private static final class VarintWriter {
+        private final int mCount;
+        private final byte[] mBytes;
+        private int mSize = 0;
+
+        VarintWriter(int count, int maxBytes) {
+            mCount = count;
+            mBytes = new byte[count * maxBytes];
+        }
+
+        void put(long bits) {
+            while ((bits & ~0x7fL) != 0) {
+                mBytes[mSize++] = (byte) ((bits & 0x7f) | 0x80);
+                bits >>>= 7;
+            }
+            mBytes[mSize++] = (byte) bits;
+        }
+
+        void writeTo(Parcel parcel) {
+            parcel.writeInt(mCount);
+            parcel.writeByteArray(mBytes, 0, mSize);
+        }
+    }
+
+    /** Reads back the varints of elements of at most |bits| bits. */
+    private static final class VarintReader {
+        final int count;
+        private final byte[] mBytes;
+        private final int mBits;
+        private final String mType;
+        private int mOffset = 0;
+
+        private VarintReader(int count, byte[] bytes, int bits, String type) {
+            this.count = count;
+            mBytes = bytes;
+            mBits = bits;
+            mType = type;
+        }
+
+        /** Returns null if the array is null. */
+        static VarintReader read(Parcel parcel, int bits, String type) {
+            int length = parcel.readInt();
+            if (length < 0) {
+                return null;
+            }
+            byte[] bytes = parcel.createByteArray();
+            // Every element takes at least a byte.
+            if (bytes == null || bytes.length < length) {
+                throw malformed(type);
+            }
+            return new VarintReader(length, bytes, bits, type);
+        }
+
+        long next() {
+            // The last byte of a varint may only hold the bits left over from
+            // the ones before it.
+            final int lastShift = (mBits - 1) / 7 * 7;
+            long bits = 0;
+            for (int shift = 0; ; shift += 7) {
+                if (mOffset == mBytes.length) {
+                    throw malformed(mType);
+                }
+                byte b = mBytes[mOffset++];
+                if (shift == lastShift && ((b & 0xff) >>> (mBits - lastShift)) != 0) {
+                    throw malformed(mType);
+                }
+                bits |= (long) (b & 0x7f) << shift;
+                if (b >= 0) {
+                    return bits;
+                }
+            }
+        }
+
+        void finish() {
+            if (mOffset != mBytes.length) {
+                throw malformed(mType);
+            }
+        }
+    }
+}
@@ -47,6 +47,14 @@ unique_ptr<JavaOptions> java_usage() {
           "   -o<FOLDER> base output folder for generated files.\n"
           "   -b         fail when trying to compile a parcelable.\n"
           "   -n         generate no-op classes.\n"
+          "   --trace-java\n"
+          "              wrap generated methods in android.os.Trace sections.\n"
+          "   --compact-java\n"
+          "              generate smaller classes: one method per transaction,\n"
+          "              sharing helpers for nullable parcelables.\n"
+          "   --dispatch-profile=<FILE>\n"
+          "              order onTransact() by the call counts in FILE, moving\n"
+          "              rarely called transactions out of line.\n"
           "\n"
           "INPUT:\n"
           "   An aidl interface file.\n"
@@ -125,6 +133,13 @@ unique_ptr<JavaOptions> JavaOptions::Parse(int argc, const char* const* argv) {
       options->fail_on_parcelable_ = true;
     } else if (s[1] == 'n') {
       options->generate_no_op_methods_ = true;
+    } else if (strcmp(s, "--trace-java") == 0) {
+      options->generate_traces_ = true;
+    } else if (strcmp(s, "--compact-java") == 0) {
+      options->generate_compact_ = true;
+    } else if (strncmp(s, "--dispatch-profile=",
+                       strlen("--dispatch-profile=")) == 0) {
+      options->dispatch_profile_file_name_ = s + strlen("--dispatch-profile=");
     } else {
       // s[1] is not known
       fprintf(stderr, "unknown option (%d): %s\n", i, s);
@@ -189,6 +204,22 @@ unique_ptr<CppOptions> cpp_usage() {
        << "OPTIONS:" << endl
        << "   -I<DIR>   search path for import statements" << endl
        << "   -d<FILE>  generate dependency file" << endl
+       << "   --dispatch-table  dispatch server transactions through a"
+       << " table" << endl
+       << "             of per-method handlers" << endl
+       << "   --async   also generate ...Async() client methods" << endl
+       << "   --coroutines  also generate co_await-able ...Co() client"
+       << " methods" << endl
+       << "   --size-report=<FILE>  write the parcel size bounds of each"
+       << " method" << endl
+       << "             to FILE as JSON" << endl
+       << "   --dispatch-profile=<FILE>  order onTransact() by the call counts"
+       << " in FILE," << endl
+       << "             moving rarely called transactions out of line" << endl
+       << "   --client-only  only implement the client (BpFoo) in OUTPUT_FILE"
+       << endl
+       << "   --server-only  only implement the server (BnFoo) in OUTPUT_FILE"
+       << endl
        << endl
        << "INPUT_FILE:" << endl
        << "   an aidl interface file" << endl
@@ -217,7 +248,22 @@ unique_ptr<CppOptions> CppOptions::Parse(int argc, const char* const* argv) {
       return cpp_usage();
     }
     const string the_rest = s + 2;
-    if (s[1] == 'I') {
+    if (strcmp(s, "--dispatch-table") == 0) {
+      options->use_dispatch_table_ = true;
+    } else if (strcmp(s, "--async") == 0) {
+      options->generate_async_ = true;
+    } else if (strcmp(s, "--coroutines") == 0) {
+      options->generate_coroutines_ = true;
+    } else if (strncmp(s, "--size-report=", strlen("--size-report=")) == 0) {
+      options->size_report_file_name_ = s + strlen("--size-report=");
+    } else if (strncmp(s, "--dispatch-profile=",
+                       strlen("--dispatch-profile=")) == 0) {
+      options->dispatch_profile_file_name_ = s + strlen("--dispatch-profile=");
+    } else if (strcmp(s, "--client-only") == 0) {
+      options->client_only_ = true;
+    } else if (strcmp(s, "--server-only") == 0) {
+      options->server_only_ = true;
+    } else if (s[1] == 'I') {
       options->import_paths_.push_back(the_rest);
     } else if (s[1] == 'd') {
       options->dep_file_name_ = the_rest;
@@ -227,6 +273,11 @@ unique_ptr<CppOptions> CppOptions::Parse(int argc, const char* const* argv) {
     }
   }
 
+  if (options->client_only_ && options->server_only_) {
+    cerr << "--client-only and --server-only are mutually exclusive." << endl;
+    return cpp_usage();
+  }
+
   // There are exactly three positional arguments.
   const int remaining_args = argc - i;
   if (remaining_args != 3) {
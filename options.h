@@ -26,6 +26,8 @@
 namespace android {
 namespace aidl {
 
+class CompilationContext;
+
 // This object represents the parsed options to the Java generating aidl.
 class JavaOptions final {
  public:
@@ -54,6 +56,9 @@ class JavaOptions final {
   bool auto_dep_file_{false};
   std::vector<std::string> files_to_preprocess_;
   bool generate_no_op_methods_{false};
+  bool generate_traces_{false};
+  bool generate_compact_{false};
+  std::string dispatch_profile_file_name_;
 
  private:
   JavaOptions() = default;
@@ -63,6 +68,17 @@ class JavaOptions final {
   FRIEND_TEST(AidlTest, WritePreprocessedFile);
   FRIEND_TEST(AidlTest, WritesCorrectDependencyFile);
   FRIEND_TEST(AidlTest, WritesTrivialDependencyFileForParcelable);
+  FRIEND_TEST(AidlTest, CachesClassLoaderForUntypedContainers);
+  FRIEND_TEST(AidlTest, WrapsJavaMethodsInTraceSections);
+  FRIEND_TEST(AidlTest, CompactJavaSharesParcelableHelpers);
+  FRIEND_TEST(AidlTest, MarshalsPackedArraysThroughRuntimeClass);
+  FRIEND_TEST(AidlTest, MarshalsCompressedValuesThroughRuntimeClass);
+  FRIEND_TEST(AidlTest, BatchesBatchableCallsInJava);
+  FRIEND_TEST(AidlTest, PassesWriteFlagsToNestedParcelablesInJava);
+  FRIEND_TEST(AidlTest, DispatchesBatchesToRedefinedMethodsInJava);
+  FRIEND_TEST(AidlTest, LooksUpSparseTransactionNamesWithSwitchInJava);
+  FRIEND_TEST(AidlTest, GeneratesStructuredParcelableJava);
+  FRIEND_TEST(AidlTest, OrdersJavaDispatchByProfile);
 
   DISALLOW_COPY_AND_ASSIGN(JavaOptions);
 };
@@ -84,6 +100,37 @@ class CppOptions final {
   std::vector<std::string> ImportPaths() const { return import_paths_; }
   std::string DependencyFilePath() const { return dep_file_name_; }
 
+  // Dispatch server transactions through a table of per-method handlers
+  // instead of one large switch.
+  bool UseDispatchTable() const { return use_dispatch_table_; }
+
+  // Also generate future and callback based ...Async() client methods.
+  bool GenerateAsync() const {
+    return generate_async_ || generate_coroutines_;
+  }
+  // Also generate co_await-able ...Co() client methods, which are built on
+  // the ...Async() ones.
+  bool GenerateCoroutines() const { return generate_coroutines_; }
+
+  // Where to write the request and reply sizes of each method as JSON, or
+  // empty for no report.
+  std::string SizeReportPath() const { return size_report_file_name_; }
+
+  // Call counts to lay out onTransact() with, or empty for none.
+  std::string DispatchProfilePath() const {
+    return dispatch_profile_file_name_;
+  }
+
+  // Whether the generated source implements BpFoo and BnFoo respectively.
+  // The headers of both are always generated.
+  bool GenerateClient() const { return !server_only_; }
+  bool GenerateServer() const { return !client_only_; }
+
+  // Whether outputs that already carry the current semantic hash may be
+  // left as they are.  Compiles that return their outputs in memory rather
+  // than writing them need every output generated.
+  bool KeepCurrentOutputs() const { return keep_current_outputs_; }
+
  private:
   CppOptions() = default;
 
@@ -92,7 +139,16 @@ class CppOptions final {
   std::string output_header_dir_;
   std::string output_file_name_;
   std::string dep_file_name_;
-
+  bool use_dispatch_table_{false};
+  bool generate_async_{false};
+  bool generate_coroutines_{false};
+  std::string size_report_file_name_;
+  std::string dispatch_profile_file_name_;
+  bool client_only_{false};
+  bool server_only_{false};
+  bool keep_current_outputs_{true};
+
+  friend class CompilationContext;
   FRIEND_TEST(CppOptionsTests, ParsesCompileCpp);
   DISALLOW_COPY_AND_ASSIGN(CppOptions);
 };
@@ -115,6 +115,18 @@ TEST(JavaOptionsTests, ParsesCompileJava) {
   EXPECT_EQ(false, options->auto_dep_file_);
 }
 
+TEST(JavaOptionsTests, ParsesDispatchProfile) {
+  const char* command[] = {
+      "aidl",
+      "--dispatch-profile=calls.txt",
+      kCompileCommandInput,
+      nullptr,
+  };
+  unique_ptr<JavaOptions> options = GetOptions<JavaOptions>(command);
+  ASSERT_NE(options, nullptr);
+  EXPECT_EQ("calls.txt", options->dispatch_profile_file_name_);
+}
+
 TEST(CppOptionsTests, ParsesCompileCpp) {
   unique_ptr<CppOptions> options = GetOptions<CppOptions>(kCompileCppCommand);
   ASSERT_EQ(1u, options->import_paths_.size());
@@ -124,6 +136,96 @@ TEST(CppOptionsTests, ParsesCompileCpp) {
   EXPECT_EQ(kCompileCommandInput, options->InputFileName());
   EXPECT_EQ(kCompileCommandHeaderDir, options->OutputHeaderDir());
   EXPECT_EQ(kCompileCommandCppOutput, options->OutputCppFilePath());
+  EXPECT_FALSE(options->UseDispatchTable());
+  EXPECT_FALSE(options->GenerateAsync());
+  EXPECT_FALSE(options->GenerateCoroutines());
+}
+
+TEST(CppOptionsTests, ParsesGeneratorFlags) {
+  const char* command[] = {
+      "aidl-cpp",
+      "--dispatch-table",
+      "--async",
+      kCompileCommandInput,
+      kCompileCommandHeaderDir,
+      kCompileCommandCppOutput,
+      nullptr,
+  };
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(command);
+  ASSERT_NE(options, nullptr);
+  EXPECT_TRUE(options->UseDispatchTable());
+  EXPECT_TRUE(options->GenerateAsync());
+  EXPECT_EQ(kCompileCommandInput, options->InputFileName());
+}
+
+TEST(CppOptionsTests, ParsesSizeReport) {
+  const char* command[] = {
+      "aidl-cpp",
+      "--size-report=sizes.json",
+      kCompileCommandInput,
+      kCompileCommandHeaderDir,
+      kCompileCommandCppOutput,
+      nullptr,
+  };
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(command);
+  ASSERT_NE(options, nullptr);
+  EXPECT_EQ("sizes.json", options->SizeReportPath());
+}
+
+TEST(CppOptionsTests, ParsesDispatchProfile) {
+  const char* command[] = {
+      "aidl-cpp",
+      "--dispatch-profile=calls.txt",
+      kCompileCommandInput,
+      kCompileCommandHeaderDir,
+      kCompileCommandCppOutput,
+      nullptr,
+  };
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(command);
+  ASSERT_NE(options, nullptr);
+  EXPECT_EQ("calls.txt", options->DispatchProfilePath());
+}
+
+TEST(CppOptionsTests, ParsesClientOnly) {
+  const char* command[] = {
+      "aidl-cpp",
+      "--client-only",
+      kCompileCommandInput,
+      kCompileCommandHeaderDir,
+      kCompileCommandCppOutput,
+      nullptr,
+  };
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(command);
+  ASSERT_NE(options, nullptr);
+  EXPECT_TRUE(options->GenerateClient());
+  EXPECT_FALSE(options->GenerateServer());
+}
+
+TEST(CppOptionsTests, RejectsClientOnlyWithServerOnly) {
+  const char* command[] = {
+      "aidl-cpp",
+      "--client-only",
+      "--server-only",
+      kCompileCommandInput,
+      kCompileCommandHeaderDir,
+      kCompileCommandCppOutput,
+  };
+  EXPECT_EQ(CppOptions::Parse(6, command), nullptr);
+}
+
+TEST(CppOptionsTests, CoroutinesImplyAsync) {
+  const char* command[] = {
+      "aidl-cpp",
+      "--coroutines",
+      kCompileCommandInput,
+      kCompileCommandHeaderDir,
+      kCompileCommandCppOutput,
+      nullptr,
+  };
+  unique_ptr<CppOptions> options = GetOptions<CppOptions>(command);
+  ASSERT_NE(options, nullptr);
+  EXPECT_TRUE(options->GenerateCoroutines());
+  EXPECT_TRUE(options->GenerateAsync());
 }
 
 TEST(OptionsTests, EndsWith) {
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "semantic_hash.h"
+
+#include <cstdint>
+#include <set>
+
+#include <android-base/stringprintf.h>
+
+#include "dispatch_profile.h"
+#include "type_cpp.h"
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using std::string;
+
+namespace android {
+namespace aidl {
+namespace cpp {
+namespace {
+
+// Bump this whenever the C++ generator changes what it emits for the same
+// input, so that outputs written by an older aidl are not mistaken for
+// current ones.  EndToEndTest.IPingResponderCppPinsGeneratorVersion fails
+// when the golden outputs change without a bump.
+const int kGeneratorVersion = 3;
+
+void DescribeType(const AidlType& aidl_type, string* out) {
+  const Type* type = aidl_type.GetLanguageType<Type>();
+  std::set<string> headers;
+  type->GetHeaders(&headers);
+  StringAppendF(out, "%s read=%s write=%s cast=%s helpers=%d size=%zu",
+                type->CppType().c_str(), type->ReadFromParcelMethod().c_str(),
+                type->WriteToParcelMethod().c_str(),
+                type->WriteCast("v").c_str(), type->UsesParcelHelpers(),
+                type->FixedWireSize());
+  for (const string& header : headers) {
+    StringAppendF(out, " <%s>", header.c_str());
+  }
+  out->push_back('\n');
+}
+
+}  // namespace
+
+string GetSemanticHash(const CppOptions& options,
+                       const AidlInterface& interface,
+                       const DispatchProfile* profile) {
+  string text = StringPrintf(
+      "generator %d async=%d coroutines=%d dispatch_table=%d client=%d "
+      "server=%d\n",
+      kGeneratorVersion, options.GenerateAsync(), options.GenerateCoroutines(),
+      options.UseDispatchTable(), options.GenerateClient(),
+      options.GenerateServer());
+  StringAppendF(&text, "interface %s oneway=%d\n",
+                interface.GetCanonicalName().c_str(), interface.IsOneway());
+  for (const AidlConstant* constant : interface.GetConstants()) {
+    StringAppendF(&text, "const %s=%d\n", constant->GetName().c_str(),
+                  constant->GetValue());
+  }
+  for (const AidlMethod* method : interface.GetMethods()) {
+    StringAppendF(&text, "method %d %s oneway=%d batchable=%d returns ",
+                  method->GetId(), method->GetName().c_str(),
+                  method->IsOneway(), method->IsBatchable());
+    DescribeType(method->GetType(), &text);
+    for (const AidlArgument* arg : method->GetArguments()) {
+      StringAppendF(&text, "arg %d %s ", arg->GetDirection(),
+                    arg->GetName().c_str());
+      DescribeType(arg->GetType(), &text);
+    }
+  }
+  for (const AidlMethod* method : GetHotMethods(interface, profile)) {
+    StringAppendF(&text, "hot %s\n", method->GetName().c_str());
+  }
+  return HashText(text);
+}
+
+string HashText(const string& text) {
+  // 64 bit FNV-1a, which unlike std::hash is the same on every host.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return StringPrintf("%016llx", static_cast<unsigned long long>(hash));
+}
+
+string SemanticHashLine(const string& hash) {
+  return "// aidl semantic hash: " + hash;
+}
+
+}  // namespace cpp
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_SEMANTIC_HASH_H_
+#define AIDL_SEMANTIC_HASH_H_
+
+#include <string>
+
+#include "aidl_language.h"
+#include "options.h"
+
+namespace android {
+namespace aidl {
+
+class DispatchProfile;
+
+namespace cpp {
+
+// Returns a hash of everything that shapes the C++ generated for a validated
+// |interface|: its methods and constants, the C++ types that its arguments
+// and imports resolved to, and the options of the generator.  Comments and
+// formatting, which the C++ backend drops, do not change it.
+std::string GetSemanticHash(const CppOptions& options,
+                            const AidlInterface& interface,
+                            const DispatchProfile* profile);
+
+// Returns a 16 hex digit hash of |text| that is the same on every host.
+std::string HashText(const std::string& text);
+
+// The first line of each generated file, recording |hash|, without its
+// trailing newline.
+std::string SemanticHashLine(const std::string& hash);
+
+}  // namespace cpp
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_SEMANTIC_HASH_H_
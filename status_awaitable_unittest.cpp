@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "aidl/async_executor.h"
+#include "aidl/status_awaitable.h"
+#include "tests/fake_transport.h"
+
+#ifndef AIDL_HAS_COROUTINES
+#error "aidl_coroutine_unittests must be built with coroutine support"
+#endif
+
+using android::aidl::test::FakeTransport;
+using std::function;
+using std::promise;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const uint32_t kCode = 3;
+
+// Stands in for binder::Status, which is not available on the host.
+struct FakeStatus {
+  int32_t reply = -1;
+};
+
+// Issues calls the way clients generated with --coroutines do: a ...Co()
+// call starts the transaction through the callback flavor of ...Async().
+class FakeClient {
+ public:
+  FakeClient(FakeTransport* transport, AsyncExecutor* executor)
+      : transport_(transport), executor_(executor) {}
+
+  void CallAsync(int32_t request, function<void(FakeStatus)> callback) {
+    FakeTransport* transport = transport_;
+    executor_->Post([transport, request, callback]() {
+      FakeStatus status;
+      status.reply = transport->Transact(kCode, request);
+      callback(status);
+    });
+  }
+
+  StatusAwaitable<FakeStatus> CallCo(int32_t request) {
+    StatusAwaitable<FakeStatus> awaitable;
+    CallAsync(request, awaitable.Completer());
+    return awaitable;
+  }
+
+ private:
+  FakeTransport* transport_;
+  AsyncExecutor* executor_;
+};
+
+// The least a coroutine needs to be started and run to completion.
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+Task CallInSequence(FakeClient* client, vector<int32_t> requests,
+                    promise<vector<int32_t>>* replies) {
+  vector<int32_t> results;
+  for (int32_t request : requests) {
+    FakeStatus status = co_await client->CallCo(request);
+    results.push_back(status.reply);
+  }
+  replies->set_value(results);
+}
+
+Task CallTogether(FakeClient* client, promise<vector<int32_t>>* replies) {
+  // Both transactions are in flight before either is awaited.
+  StatusAwaitable<FakeStatus> first = client->CallCo(1);
+  StatusAwaitable<FakeStatus> second = client->CallCo(2);
+  FakeStatus first_status = co_await first;
+  FakeStatus second_status = co_await second;
+  replies->set_value({first_status.reply, second_status.reply});
+}
+
+}  // namespace
+
+TEST(StatusAwaitableTest, ResumesWithStatusOfEachCall) {
+  FakeTransport transport;
+  AsyncExecutor executor(1, 4);
+  FakeClient client(&transport, &executor);
+
+  promise<vector<int32_t>> replies;
+  CallInSequence(&client, {4, 5, 6}, &replies);
+  transport.Release(3);
+
+  EXPECT_EQ((vector<int32_t>{FakeTransport::ReplyFor(kCode, 4),
+                             FakeTransport::ReplyFor(kCode, 5),
+                             FakeTransport::ReplyFor(kCode, 6)}),
+            replies.get_future().get());
+}
+
+TEST(StatusAwaitableTest, OverlapsCallsWithoutAThreadPerCall) {
+  FakeTransport transport;
+  AsyncExecutor executor(2, 4);
+  FakeClient client(&transport, &executor);
+
+  promise<vector<int32_t>> replies;
+  CallTogether(&client, &replies);
+  // The coroutine is suspended, not blocking this thread, while both calls
+  // are outstanding.
+  ASSERT_TRUE(transport.WaitForInFlight(2));
+  transport.Release(2);
+
+  EXPECT_EQ((vector<int32_t>{FakeTransport::ReplyFor(kCode, 1),
+                             FakeTransport::ReplyFor(kCode, 2)}),
+            replies.get_future().get());
+}
+
+TEST(StatusAwaitableTest, DoesNotSuspendOnceComplete) {
+  StatusAwaitable<FakeStatus> awaitable;
+  EXPECT_FALSE(awaitable.await_ready());
+  FakeStatus status;
+  status.reply = 42;
+  awaitable.Completer()(status);
+  EXPECT_TRUE(awaitable.await_ready());
+  EXPECT_EQ(42, awaitable.await_resume().reply);
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures what the C++ aidl generates costs to build.  Synthetic
+// interfaces of increasing size are generated in memory, written out and
+// compiled with the host compiler against the stub libbinder headers in
+// tests/benchmark_stubs.  For each, it reports how long the compile took,
+// and the size of and number of symbols defined by the object it produced.
+//
+// Besides plain arguments of each type, there are kinds of interface that
+// exercise @packed, @compressed, @batchable and --async, which pull in the
+// headers under include/.  Flags after "--" go to aidl-cpp, so that the code
+// shape of, say, --dispatch-table can be compared with the default.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+#include "aidl.h"
+#include "code_writer.h"
+#include "io_delegate.h"
+#include "options.h"
+#include "os.h"
+#include "tests/fake_io_delegate.h"
+
+using android::aidl::test::FakeIoDelegate;
+using android::base::Join;
+using android::base::Split;
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using std::cerr;
+using std::endl;
+using std::map;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace android {
+namespace aidl {
+namespace {
+
+const char kPackage[] = "bench";
+const char kInterfaceName[] = "IBench";
+const char kInterfacePath[] = "bench/IBench.aidl";
+const char kHeaderDir[] = "include";
+const char kSourcePath[] = "IBench.cpp";
+const char kObjectPath[] = "IBench.o";
+
+// A kind of interface: the types its arguments cycle through, the
+// directions they cycle through if they can be out parameters, the
+// annotation of each argument and return value, what methods are declared
+// to return (the first of |types| if empty) and any aidl-cpp flags it needs.
+struct Kind {
+  vector<string> types;
+  vector<string> directions;
+  string annotation;
+  string return_type;
+  vector<string> aidl_flags;
+};
+
+const map<string, Kind> kKinds = {
+    {"primitive", {{"int", "long", "boolean", "double"}, {}, "", "", {}}},
+    {"string", {{"String"}, {}, "", "", {}}},
+    {"container",
+     {{"int[]", "String[]", "List<String>"}, {"in", "out", "inout"}, "", "",
+      {}}},
+    {"packed",
+     {{"int[]", "long[]", "boolean[]", "char[]"}, {"in"}, "@packed ", "",
+      {}}},
+    {"compressed", {{"byte[]", "String"}, {"in"}, "@compressed ", "", {}}},
+    {"batchable",
+     {{"int", "long", "boolean", "double"}, {}, "",
+      "@batchable oneway void", {}}},
+    {"async",
+     {{"int", "long", "boolean", "double"}, {}, "", "", {"--async"}}},
+};
+
+struct BenchmarkOptions {
+  string stub_dir;
+  string cxx = "c++";
+  string include_dir;
+  string cxx_flags = "-std=c++14 -O2";
+  vector<size_t> method_counts = {8, 64, 256};
+  vector<size_t> arg_counts = {1, 4};
+  vector<string> kinds = {"primitive", "string",     "container", "packed",
+                          "compressed", "batchable", "async"};
+  string work_dir;
+  vector<string> aidl_flags;
+};
+
+struct Result {
+  size_t source_bytes = 0;
+  double compile_ms = 0;
+  size_t text_bytes = 0;
+  size_t symbols = 0;
+};
+
+bool Usage() {
+  cerr << "usage: aidl_codegen_benchmark --stubs=<DIR> [OPTIONS]"
+       << " [-- AIDL_CPP_FLAGS]" << endl
+       << endl
+       << "OPTIONS:" << endl
+       << "   --stubs=<DIR>  the stub libbinder headers, i.e."
+       << " tests/benchmark_stubs" << endl
+       << "   --include=<DIR>  the headers generated code includes, defaults"
+       << " to" << endl
+       << "             the include directory next to tests/" << endl
+       << "   --cxx=<COMPILER>  defaults to $CXX, then c++" << endl
+       << "   --cxxflags=<FLAGS>  defaults to \"-std=c++14 -O2\"" << endl
+       << "   --methods=<N,...>  methods per interface, defaults to 8,64,256"
+       << endl
+       << "   --args=<N,...>  arguments per method, defaults to 1,4" << endl
+       << "   --kinds=<KIND,...>  any of primitive, string, container, packed,"
+       << endl
+       << "             compressed, batchable and async" << endl
+       << "   --work-dir=<DIR>  keep the generated code in DIR rather than a"
+       << " temporary" << endl
+       << "             directory" << endl;
+  return false;
+}
+
+bool ParseCounts(const string& list, vector<size_t>* counts) {
+  counts->clear();
+  for (const string& item : Split(list, ",")) {
+    char* end = nullptr;
+    const unsigned long count = strtoul(item.c_str(), &end, 10);
+    if (item.empty() || *end != '\0' || count == 0) {
+      cerr << "Invalid count '" << item << "'." << endl;
+      return false;
+    }
+    counts->push_back(count);
+  }
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  const char* cxx = getenv("CXX");
+  if (cxx != nullptr && *cxx != '\0') {
+    options->cxx = cxx;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    const size_t equals = arg.find('=');
+    const string name = arg.substr(0, equals);
+    const string value =
+        (equals == string::npos) ? "" : arg.substr(equals + 1);
+    if (arg == "--") {
+      options->aidl_flags.assign(argv + i + 1, argv + argc);
+      break;
+    } else if (name == "--stubs") {
+      options->stub_dir = value;
+    } else if (name == "--include") {
+      options->include_dir = value;
+    } else if (name == "--cxx") {
+      options->cxx = value;
+    } else if (name == "--cxxflags") {
+      options->cxx_flags = value;
+    } else if (name == "--methods") {
+      if (!ParseCounts(value, &options->method_counts)) { return Usage(); }
+    } else if (name == "--args") {
+      if (!ParseCounts(value, &options->arg_counts)) { return Usage(); }
+    } else if (name == "--kinds") {
+      options->kinds = Split(value, ",");
+      for (const string& kind : options->kinds) {
+        if (kKinds.count(kind) == 0) {
+          cerr << "Unknown kind '" << kind << "'." << endl;
+          return Usage();
+        }
+      }
+    } else if (name == "--work-dir") {
+      options->work_dir = value;
+    } else {
+      cerr << "Invalid argument '" << arg << "'." << endl;
+      return Usage();
+    }
+  }
+
+  if (options->stub_dir.empty()) {
+    cerr << "--stubs is required." << endl;
+    return Usage();
+  }
+  if (options->include_dir.empty()) {
+    options->include_dir = StringPrintf(
+        "%s%c..%c..%cinclude", options->stub_dir.c_str(), OS_PATH_SEPARATOR,
+        OS_PATH_SEPARATOR, OS_PATH_SEPARATOR);
+  }
+  return true;
+}
+
+// Returns an interface of |method_count| methods taking |arg_count|
+// arguments of |kind| each.
+string BuildInterface(const Kind& kind, size_t method_count,
+                      size_t arg_count) {
+  const vector<string>& types = kind.types;
+  const string return_type = (kind.return_type.empty())
+      ? kind.annotation + types[0]
+      : kind.return_type;
+
+  string aidl = StringPrintf("package %s;\ninterface %s {\n", kPackage,
+                             kInterfaceName);
+  for (size_t m = 0; m < method_count; ++m) {
+    vector<string> args;
+    for (size_t a = 0; a < arg_count; ++a) {
+      string arg;
+      if (!kind.directions.empty()) {
+        arg = kind.directions[(m + a) % kind.directions.size()] + " ";
+      }
+      arg += kind.annotation + types[(m + a) % types.size()] +
+             StringPrintf(" arg%zu", a);
+      args.push_back(arg);
+    }
+    StringAppendF(&aidl, "  %s method%zu(%s);\n", return_type.c_str(), m,
+                  Join(args, ", ").c_str());
+  }
+  aidl += "}\n";
+  return aidl;
+}
+
+// Runs |command| through the shell, storing what it prints to |*output| if
+// that is non-null.
+bool RunCommand(const string& command, string* output) {
+  FILE* pipe = popen(command.c_str(), "r");
+  if (pipe == nullptr) {
+    cerr << "Failed to run " << command << endl;
+    return false;
+  }
+  char buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+    if (output) {
+      output->append(buffer, read);
+    }
+  }
+  if (pclose(pipe) != 0) {
+    cerr << "Command failed: " << command << endl;
+    return false;
+  }
+  return true;
+}
+
+// Generates C++ for |aidl| with aidl-cpp's |flags| into |dir|.
+bool GenerateSources(const string& aidl, const vector<string>& flags,
+                     const string& dir, size_t* source_bytes) {
+  vector<string> args = {"aidl-cpp"};
+  args.insert(args.end(), flags.begin(), flags.end());
+  args.insert(args.end(), {kInterfacePath, kHeaderDir, kSourcePath});
+  vector<const char*> argv;
+  for (const string& arg : args) {
+    argv.push_back(arg.c_str());
+  }
+  unique_ptr<CppOptions> options = CppOptions::Parse(argv.size(), &argv[0]);
+  if (!options) {
+    return false;
+  }
+
+  FakeIoDelegate fake_io;
+  fake_io.SetFileContents(kInterfacePath, aidl);
+  if (compile_aidl_to_cpp(*options, fake_io) != 0) {
+    cerr << "Failed to generate C++ for:" << endl << aidl;
+    return false;
+  }
+
+  IoDelegate io;
+  const string header_prefix =
+      StringPrintf("%s%c%s%c", kHeaderDir, OS_PATH_SEPARATOR, kPackage,
+                   OS_PATH_SEPARATOR);
+  const string base = string(kInterfaceName).substr(1);
+  for (const string& path : {string(kSourcePath),
+                             header_prefix + "I" + base + "Fwd.h",
+                             header_prefix + "I" + base + ".h",
+                             header_prefix + "Bp" + base + ".h",
+                             header_prefix + "Bn" + base + ".h"}) {
+    string contents;
+    if (!fake_io.GetWrittenContents(path, &contents)) {
+      cerr << "aidl-cpp did not write " << path << endl;
+      return false;
+    }
+    const string out_path = dir + OS_PATH_SEPARATOR + path;
+    unique_ptr<CodeWriter> writer;
+    if (io.CreatePathForFile(out_path)) {
+      writer = io.GetCodeWriter(out_path);
+    }
+    if (!writer || !writer->Write("%s", contents.c_str()) ||
+        !writer->Close()) {
+      cerr << "Failed to write " << out_path << endl;
+      return false;
+    }
+    if (path == kSourcePath) {
+      *source_bytes = contents.size();
+    }
+  }
+  return true;
+}
+
+bool Measure(const BenchmarkOptions& options, const Kind& kind,
+             const string& aidl, const string& dir, Result* result) {
+  vector<string> aidl_flags = kind.aidl_flags;
+  aidl_flags.insert(aidl_flags.end(), options.aidl_flags.begin(),
+                    options.aidl_flags.end());
+  if (!GenerateSources(aidl, aidl_flags, dir, &result->source_bytes)) {
+    return false;
+  }
+
+  const string object = dir + OS_PATH_SEPARATOR + kObjectPath;
+  const string compile = StringPrintf(
+      "%s %s -I%s -I%s -I%s%c%s -c %s%c%s -o %s", options.cxx.c_str(),
+      options.cxx_flags.c_str(), options.stub_dir.c_str(),
+      options.include_dir.c_str(), dir.c_str(), OS_PATH_SEPARATOR,
+      kHeaderDir, dir.c_str(), OS_PATH_SEPARATOR, kSourcePath,
+      object.c_str());
+  const auto start = std::chrono::steady_clock::now();
+  if (!RunCommand(compile, nullptr)) {
+    return false;
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  result->compile_ms = elapsed.count();
+
+  // size prints a header line, then text, data, bss, ... for the object.
+  string sizes;
+  if (!RunCommand("size " + object, &sizes)) {
+    return false;
+  }
+  const vector<string> lines = Split(sizes, "\n");
+  if (lines.size() < 2) {
+    cerr << "Unexpected output from size: " << sizes << endl;
+    return false;
+  }
+  result->text_bytes = strtoul(lines[1].c_str(), nullptr, 10);
+
+  string symbols;
+  if (!RunCommand("nm --defined-only " + object, &symbols)) {
+    return false;
+  }
+  for (const string& line : Split(symbols, "\n")) {
+    if (!line.empty()) {
+      ++result->symbols;
+    }
+  }
+  return true;
+}
+
+bool RunBenchmark(const BenchmarkOptions& options) {
+  string work_dir = options.work_dir;
+  const bool is_temporary = work_dir.empty();
+  if (is_temporary) {
+    char dir_template[] = "/tmp/aidl_codegen_benchmark.XXXXXX";
+    if (mkdtemp(dir_template) == nullptr) {
+      cerr << "Failed to create a temporary directory." << endl;
+      return false;
+    }
+    work_dir = dir_template;
+  }
+
+  printf("%-10s %8s %5s %12s %12s %12s %8s\n", "kind", "methods", "args",
+         "source_bytes", "compile_ms", "text_bytes", "symbols");
+  bool success = true;
+  for (const string& name : options.kinds) {
+    const Kind& kind = kKinds.at(name);
+    for (size_t method_count : options.method_counts) {
+      for (size_t arg_count : options.arg_counts) {
+        const string dir = StringPrintf(
+            "%s%c%s_%zu_%zu", work_dir.c_str(), OS_PATH_SEPARATOR,
+            name.c_str(), method_count, arg_count);
+        Result result;
+        if (!Measure(options, kind,
+                     BuildInterface(kind, method_count, arg_count),
+                     dir, &result)) {
+          success = false;
+          continue;
+        }
+        printf("%-10s %8zu %5zu %12zu %12.0f %12zu %8zu\n", name.c_str(),
+               method_count, arg_count, result.source_bytes,
+               result.compile_ms, result.text_bytes, result.symbols);
+        fflush(stdout);
+      }
+    }
+  }
+
+  if (is_temporary) {
+    RunCommand("rm -rf " + work_dir, nullptr);
+  }
+  return success;
+}
+
+}  // namespace
+}  // namespace aidl
+}  // namespace android
+
+int main(int argc, char** argv) {
+  android::aidl::BenchmarkOptions options;
+  if (!android::aidl::ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  return android::aidl::RunBenchmark(options) ? 0 : 1;
+}
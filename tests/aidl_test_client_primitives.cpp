@@ -16,6 +16,7 @@
 
 #include "aidl_test_client_primitives.h"
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -97,6 +98,22 @@ bool ConfirmPrimitiveRepeat(const sp<ITestService>& s) {
       return false;
     }
   }
+
+  String16 large;
+  for (int i = 0; i < 256; ++i) {
+    large.append(String16("Deliver us from evil. "));
+  }
+  inputs.push_back(large);
+  for (const auto& input : inputs) {
+    String16 reply;
+    Status status = s->RepeatCompressedString(input, &reply);
+    if (!status.isOk() || input != reply) {
+      cerr << "Failed while requesting service to repeat compressed String16"
+           << " of length " << input.size()
+           << ". Got status=" << status.toString8() << endl;
+      return false;
+    }
+  }
   return true;
 }
 
@@ -118,7 +135,26 @@ bool ConfirmReverseArrays(const sp<ITestService>& s) {
       !ReverseArray(s, &ITestService::ReverseDouble,
                     {1.0/3.0, 1.0/7.0, 42.0}) ||
       !ReverseArray(s, &ITestService::ReverseString,
-                    {String16{"f"}, String16{"a"}, String16{"b"}})) {
+                    {String16{"f"}, String16{"a"}, String16{"b"}}) ||
+      !ReverseArray(s, &ITestService::ReversePackedBoolean,
+                    {true, false, false, true, true, true, true, true, true}) ||
+      !ReverseArray(s, &ITestService::ReversePackedChar,
+                    {char16_t{'A'}, char16_t{0x80}, char16_t{0xffff}}) ||
+      !ReverseArray(s, &ITestService::ReversePackedInt,
+                    {0, -1, 64, INT32_MIN, INT32_MAX}) ||
+      !ReverseArray(s, &ITestService::ReversePackedLong,
+                    {0ll, -1ll, int64_t{1ll << 60}, INT64_MIN, INT64_MAX}) ||
+      !ReverseArray(s, &ITestService::ReverseCompressedByte,
+                    {uint8_t{255}, uint8_t{0}, uint8_t{127}})) {
+    return false;
+  }
+
+  // Large enough, and repetitive enough, to be sent compressed.
+  vector<uint8_t> large(4096);
+  for (size_t i = 0; i < large.size(); ++i) {
+    large[i] = static_cast<uint8_t>(i % 7);
+  }
+  if (!ReverseArray(s, &ITestService::ReverseCompressedByte, large)) {
     return false;
   }
 
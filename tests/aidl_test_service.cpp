@@ -234,6 +234,36 @@ class NativeService : public BnTestService {
                        vector<String16>* _aidl_return) override {
     return ReverseArray(input, repeated, _aidl_return);
   }
+  Status ReversePackedBoolean(const vector<bool>& input,
+                              vector<bool>* repeated,
+                              vector<bool>* _aidl_return) override {
+    return ReverseArray(input, repeated, _aidl_return);
+  }
+  Status ReversePackedChar(const vector<char16_t>& input,
+                           vector<char16_t>* repeated,
+                           vector<char16_t>* _aidl_return) override {
+    return ReverseArray(input, repeated, _aidl_return);
+  }
+  Status ReversePackedInt(const vector<int32_t>& input,
+                          vector<int32_t>* repeated,
+                          vector<int32_t>* _aidl_return) override {
+    return ReverseArray(input, repeated, _aidl_return);
+  }
+  Status ReversePackedLong(const vector<int64_t>& input,
+                           vector<int64_t>* repeated,
+                           vector<int64_t>* _aidl_return) override {
+    return ReverseArray(input, repeated, _aidl_return);
+  }
+  Status ReverseCompressedByte(const vector<uint8_t>& input,
+                               vector<uint8_t>* repeated,
+                               vector<uint8_t>* _aidl_return) override {
+    return ReverseArray(input, repeated, _aidl_return);
+  }
+  Status RepeatCompressedString(const String16& input,
+                                String16* _aidl_return) override {
+    *_aidl_return = input;
+    return Status::ok();
+  }
   Status ReverseSimpleParcelables(
       const vector<SimpleParcelable>& input,
       vector<SimpleParcelable>* repeated,
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_BINDER_BINDER_H_
+#define AIDL_BENCHMARK_STUBS_BINDER_BINDER_H_
+
+#include <binder/IBinder.h>
+
+namespace android {
+
+class BBinder : public IBinder {
+ public:
+  BBinder();
+
+  const String16& getInterfaceDescriptor() const override;
+  status_t transact(uint32_t code, const Parcel& data, Parcel* reply,
+                    uint32_t flags = 0) final;
+  BBinder* localBinder() override;
+
+ protected:
+  ~BBinder() override;
+
+  virtual status_t onTransact(uint32_t code, const Parcel& data,
+                              Parcel* reply, uint32_t flags = 0);
+};
+
+class BpRefBase {
+ protected:
+  explicit BpRefBase(const sp<IBinder>& o);
+  virtual ~BpRefBase();
+
+  IBinder* remote() const { return remote_; }
+
+ private:
+  IBinder* const remote_;
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_BINDER_BINDER_H_
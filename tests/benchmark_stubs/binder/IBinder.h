@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_BINDER_IBINDER_H_
+#define AIDL_BENCHMARK_STUBS_BINDER_IBINDER_H_
+
+#include <cstdint>
+
+#include <utils/Errors.h>
+#include <utils/String16.h>
+#include <utils/StrongPointer.h>
+
+namespace android {
+
+class BBinder;
+class IInterface;
+class Parcel;
+
+class IBinder {
+ public:
+  enum {
+    FIRST_CALL_TRANSACTION = 0x00000001,
+    LAST_CALL_TRANSACTION = 0x00ffffff,
+    INTERFACE_TRANSACTION = 0x5f4e5446,
+    FLAG_ONEWAY = 0x00000001,
+  };
+
+  virtual sp<IInterface> queryLocalInterface(const String16& descriptor);
+  virtual const String16& getInterfaceDescriptor() const = 0;
+  virtual status_t transact(uint32_t code, const Parcel& data, Parcel* reply,
+                            uint32_t flags = 0) = 0;
+  virtual BBinder* localBinder();
+
+ protected:
+  IBinder();
+  virtual ~IBinder();
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_BINDER_IBINDER_H_
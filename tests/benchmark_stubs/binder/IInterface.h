@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_BINDER_IINTERFACE_H_
+#define AIDL_BENCHMARK_STUBS_BINDER_IINTERFACE_H_
+
+#include <binder/Binder.h>
+
+namespace android {
+
+class IInterface {
+ public:
+  IInterface();
+  static sp<IBinder> asBinder(const IInterface* iface);
+  static sp<IBinder> asBinder(const sp<IInterface>& iface);
+
+ protected:
+  virtual ~IInterface();
+  virtual IBinder* onAsBinder() = 0;
+};
+
+template <typename INTERFACE>
+class BnInterface : public INTERFACE, public BBinder {
+ public:
+  sp<IInterface> queryLocalInterface(const String16& descriptor) override;
+  const String16& getInterfaceDescriptor() const override;
+
+ protected:
+  IBinder* onAsBinder() override;
+};
+
+template <typename INTERFACE>
+class BpInterface : public INTERFACE, public BpRefBase {
+ public:
+  explicit BpInterface(const sp<IBinder>& remote);
+
+ protected:
+  IBinder* onAsBinder() override;
+};
+
+#define DECLARE_META_INTERFACE(INTERFACE)                               \
+  static const ::android::String16 descriptor;                          \
+  static ::android::sp<I##INTERFACE> asInterface(                       \
+      const ::android::sp<::android::IBinder>& obj);                    \
+  virtual const ::android::String16& getInterfaceDescriptor() const;    \
+  I##INTERFACE();                                                       \
+  virtual ~I##INTERFACE();
+
+#define IMPLEMENT_META_INTERFACE(INTERFACE, NAME)                       \
+  const ::android::String16 I##INTERFACE::descriptor(NAME);             \
+  const ::android::String16& I##INTERFACE::getInterfaceDescriptor()     \
+      const {                                                           \
+    return I##INTERFACE::descriptor;                                    \
+  }                                                                     \
+  ::android::sp<I##INTERFACE> I##INTERFACE::asInterface(                \
+      const ::android::sp<::android::IBinder>& obj) {                   \
+    ::android::sp<I##INTERFACE> intr;                                   \
+    if (obj != nullptr) {                                               \
+      intr = static_cast<I##INTERFACE*>(                                \
+          obj->queryLocalInterface(I##INTERFACE::descriptor).get());    \
+      if (intr == nullptr) {                                            \
+        intr = new Bp##INTERFACE(obj);                                  \
+      }                                                                 \
+    }                                                                   \
+    return intr;                                                        \
+  }                                                                     \
+  I##INTERFACE::I##INTERFACE() {}                                       \
+  I##INTERFACE::~I##INTERFACE() {}
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_BINDER_IINTERFACE_H_
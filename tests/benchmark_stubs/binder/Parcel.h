@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_BINDER_PARCEL_H_
+#define AIDL_BENCHMARK_STUBS_BINDER_PARCEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <binder/IBinder.h>
+#include <utils/Errors.h>
+#include <utils/String16.h>
+#include <utils/StrongPointer.h>
+
+namespace android {
+
+class Parcel {
+ public:
+  Parcel();
+  ~Parcel();
+
+  const uint8_t* data() const;
+  size_t dataSize() const;
+  size_t dataAvail() const;
+  size_t dataPosition() const;
+  status_t setDataSize(size_t size);
+  void setDataPosition(size_t pos) const;
+  status_t setDataCapacity(size_t size);
+  status_t setData(const uint8_t* buffer, size_t len);
+  void freeData();
+
+  status_t appendFrom(const Parcel* parcel, size_t start, size_t len);
+  size_t objectsCount() const;
+
+  status_t writeInterfaceToken(const String16& interface);
+  bool checkInterface(IBinder* binder) const;
+
+  status_t write(const void* data, size_t len);
+  void* writeInplace(size_t len);
+  const void* readInplace(size_t len) const;
+
+  status_t writeInt32(int32_t val);
+  status_t writeInt64(int64_t val);
+  status_t writeFloat(float val);
+  status_t writeDouble(double val);
+  status_t writeBool(bool val);
+  status_t writeChar(char16_t val);
+  status_t writeByte(int8_t val);
+  status_t writeString16(const String16& str);
+  status_t writeString16(const std::unique_ptr<String16>& str);
+  status_t writeUtf8AsUtf16(const std::string& str);
+  status_t writeUtf8AsUtf16(const std::unique_ptr<std::string>& str);
+  status_t writeStrongBinder(const sp<IBinder>& val);
+
+  status_t writeByteVector(const std::vector<int8_t>& val);
+  status_t writeByteVector(const std::vector<uint8_t>& val);
+  status_t writeByteVector(const std::unique_ptr<std::vector<int8_t>>& val);
+  status_t writeByteVector(const std::unique_ptr<std::vector<uint8_t>>& val);
+  status_t writeInt32Vector(const std::vector<int32_t>& val);
+  status_t writeInt32Vector(
+      const std::unique_ptr<std::vector<int32_t>>& val);
+  status_t writeInt64Vector(const std::vector<int64_t>& val);
+  status_t writeInt64Vector(
+      const std::unique_ptr<std::vector<int64_t>>& val);
+  status_t writeFloatVector(const std::vector<float>& val);
+  status_t writeFloatVector(const std::unique_ptr<std::vector<float>>& val);
+  status_t writeDoubleVector(const std::vector<double>& val);
+  status_t writeDoubleVector(
+      const std::unique_ptr<std::vector<double>>& val);
+  status_t writeBoolVector(const std::vector<bool>& val);
+  status_t writeBoolVector(const std::unique_ptr<std::vector<bool>>& val);
+  status_t writeCharVector(const std::vector<char16_t>& val);
+  status_t writeCharVector(
+      const std::unique_ptr<std::vector<char16_t>>& val);
+  status_t writeString16Vector(const std::vector<String16>& val);
+  status_t writeString16Vector(
+      const std::unique_ptr<std::vector<std::unique_ptr<String16>>>& val);
+  status_t writeUtf8VectorAsUtf16Vector(const std::vector<std::string>& val);
+  status_t writeUtf8VectorAsUtf16Vector(
+      const std::unique_ptr<std::vector<std::unique_ptr<std::string>>>& val);
+  status_t writeStrongBinderVector(const std::vector<sp<IBinder>>& val);
+  status_t writeStrongBinderVector(
+      const std::unique_ptr<std::vector<sp<IBinder>>>& val);
+  template <typename T>
+  status_t writeParcelable(const T& parcelable);
+  template <typename T>
+  status_t writeNullableParcelable(const std::unique_ptr<T>& parcelable);
+  template <typename T>
+  status_t writeParcelableVector(const std::vector<T>& val);
+  template <typename T>
+  status_t writeParcelableVector(
+      const std::unique_ptr<std::vector<std::unique_ptr<T>>>& val);
+
+  status_t readInt32(int32_t* pArg) const;
+  status_t readInt64(int64_t* pArg) const;
+  status_t readFloat(float* pArg) const;
+  status_t readDouble(double* pArg) const;
+  status_t readBool(bool* pArg) const;
+  status_t readChar(char16_t* pArg) const;
+  status_t readByte(int8_t* pArg) const;
+  status_t readString16(String16* pArg) const;
+  status_t readString16(std::unique_ptr<String16>* pArg) const;
+  status_t readUtf8FromUtf16(std::string* str) const;
+  status_t readUtf8FromUtf16(std::unique_ptr<std::string>* str) const;
+  status_t readStrongBinder(sp<IBinder>* val) const;
+  status_t readNullableStrongBinder(sp<IBinder>* val) const;
+
+  status_t readByteVector(std::vector<int8_t>* val) const;
+  status_t readByteVector(std::vector<uint8_t>* val) const;
+  status_t readByteVector(std::unique_ptr<std::vector<int8_t>>* val) const;
+  status_t readByteVector(std::unique_ptr<std::vector<uint8_t>>* val) const;
+  status_t readInt32Vector(std::vector<int32_t>* val) const;
+  status_t readInt32Vector(std::unique_ptr<std::vector<int32_t>>* val) const;
+  status_t readInt64Vector(std::vector<int64_t>* val) const;
+  status_t readInt64Vector(std::unique_ptr<std::vector<int64_t>>* val) const;
+  status_t readFloatVector(std::vector<float>* val) const;
+  status_t readFloatVector(std::unique_ptr<std::vector<float>>* val) const;
+  status_t readDoubleVector(std::vector<double>* val) const;
+  status_t readDoubleVector(std::unique_ptr<std::vector<double>>* val) const;
+  status_t readBoolVector(std::vector<bool>* val) const;
+  status_t readBoolVector(std::unique_ptr<std::vector<bool>>* val) const;
+  status_t readCharVector(std::vector<char16_t>* val) const;
+  status_t readCharVector(std::unique_ptr<std::vector<char16_t>>* val) const;
+  status_t readString16Vector(std::vector<String16>* val) const;
+  status_t readString16Vector(
+      std::unique_ptr<std::vector<std::unique_ptr<String16>>>* val) const;
+  status_t readUtf8VectorFromUtf16Vector(std::vector<std::string>* val) const;
+  status_t readUtf8VectorFromUtf16Vector(
+      std::unique_ptr<std::vector<std::unique_ptr<std::string>>>* val) const;
+  status_t readStrongBinderVector(std::vector<sp<IBinder>>* val) const;
+  status_t readStrongBinderVector(
+      std::unique_ptr<std::vector<sp<IBinder>>>* val) const;
+  template <typename T>
+  status_t readParcelable(T* parcelable) const;
+  template <typename T>
+  status_t readParcelable(std::unique_ptr<T>* parcelable) const;
+  template <typename T>
+  status_t readParcelableVector(std::vector<T>* val) const;
+  template <typename T>
+  status_t readParcelableVector(
+      std::unique_ptr<std::vector<std::unique_ptr<T>>>* val) const;
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_BINDER_PARCEL_H_
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_BINDER_PARCELABLE_H_
+#define AIDL_BENCHMARK_STUBS_BINDER_PARCELABLE_H_
+
+#include <utils/Errors.h>
+
+namespace android {
+
+class Parcel;
+
+class Parcelable {
+ public:
+  virtual ~Parcelable() = default;
+  virtual status_t writeToParcel(Parcel* parcel) const = 0;
+  virtual status_t readFromParcel(const Parcel* parcel) = 0;
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_BINDER_PARCELABLE_H_
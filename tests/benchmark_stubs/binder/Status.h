@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_BINDER_STATUS_H_
+#define AIDL_BENCHMARK_STUBS_BINDER_STATUS_H_
+
+#include <cstdint>
+
+#include <utils/Errors.h>
+#include <utils/String16.h>
+
+namespace android {
+
+class Parcel;
+
+namespace binder {
+
+class Status final {
+ public:
+  enum Exception {
+    EX_NONE = 0,
+    EX_SECURITY = -1,
+    EX_BAD_PARCELABLE = -2,
+    EX_ILLEGAL_ARGUMENT = -3,
+    EX_NULL_POINTER = -4,
+    EX_ILLEGAL_STATE = -5,
+    EX_NETWORK_MAIN_THREAD = -6,
+    EX_UNSUPPORTED_OPERATION = -7,
+    EX_SERVICE_SPECIFIC = -8,
+    EX_HAS_REPLY_HEADER = -128,
+    EX_TRANSACTION_FAILED = -129,
+  };
+
+  static Status ok();
+  static Status fromExceptionCode(int32_t exception_code);
+  static Status fromServiceSpecificError(int32_t service_specific_error);
+  static Status fromStatusT(status_t status);
+
+  Status();
+  Status(const Status& status);
+  Status& operator=(const Status& status);
+
+  status_t readFromParcel(const Parcel& parcel);
+  status_t writeToParcel(Parcel* parcel) const;
+
+  void setFromStatusT(status_t status);
+  bool isOk() const { return exception_ == EX_NONE; }
+  int32_t exceptionCode() const { return exception_; }
+  status_t transactionError() const { return error_; }
+
+ private:
+  int32_t exception_;
+  status_t error_;
+};
+
+}  // namespace binder
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_BINDER_STATUS_H_
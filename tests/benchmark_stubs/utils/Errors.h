@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_UTILS_ERRORS_H_
+#define AIDL_BENCHMARK_STUBS_UTILS_ERRORS_H_
+
+#include <cstdint>
+
+namespace android {
+
+typedef int32_t status_t;
+
+enum {
+  OK = 0,
+  NO_ERROR = OK,
+  UNKNOWN_ERROR = (-2147483647 - 1),
+  NO_MEMORY = -12,
+  BAD_VALUE = -22,
+  BAD_INDEX = -75,
+  NOT_ENOUGH_DATA = -61,
+  UNEXPECTED_NULL = -74,
+  BAD_TYPE = (UNKNOWN_ERROR + 1),
+  FAILED_TRANSACTION = (UNKNOWN_ERROR + 2),
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_UTILS_ERRORS_H_
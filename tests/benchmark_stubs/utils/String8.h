@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_UTILS_STRING8_H_
+#define AIDL_BENCHMARK_STUBS_UTILS_STRING8_H_
+
+#include <cstddef>
+
+#include <utils/String16.h>
+
+namespace android {
+
+class String8 {
+ public:
+  String8();
+  explicit String8(const String16& other);
+  ~String8();
+
+  const char* string() const;
+  size_t size() const;
+
+ private:
+  const char* string_;
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_UTILS_STRING8_H_
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_BENCHMARK_STUBS_UTILS_STRONG_POINTER_H_
+#define AIDL_BENCHMARK_STUBS_UTILS_STRONG_POINTER_H_
+
+#include <cstddef>
+
+namespace android {
+
+template <typename T>
+class sp {
+ public:
+  sp() : ptr_(nullptr) {}
+  sp(T* other);  // NOLINT(implicit)
+  sp(const sp<T>& other);
+  template <typename U> sp(const sp<U>& other);  // NOLINT(implicit)
+  ~sp();
+
+  sp& operator=(T* other);
+  sp& operator=(const sp<T>& other);
+  template <typename U> sp& operator=(const sp<U>& other);
+
+  T& operator*() const { return *ptr_; }
+  T* operator->() const { return ptr_; }
+  T* get() const { return ptr_; }
+
+  bool operator==(const T* other) const { return ptr_ == other; }
+  bool operator!=(const T* other) const { return ptr_ != other; }
+  bool operator==(std::nullptr_t) const { return ptr_ == nullptr; }
+  bool operator!=(std::nullptr_t) const { return ptr_ != nullptr; }
+
+ private:
+  T* ptr_;
+};
+
+}  // namespace android
+
+#endif  // AIDL_BENCHMARK_STUBS_UTILS_STRONG_POINTER_H_
@@ -23,10 +23,12 @@
 
 #include "aidl.h"
 #include "options.h"
+#include "semantic_hash.h"
 #include "tests/fake_io_delegate.h"
 #include "tests/test_data.h"
 #include "tests/test_util.h"
 
+using android::aidl::cpp::HashText;
 using android::aidl::test::CanonicalNameToPath;
 using android::aidl::test::FakeIoDelegate;
 using std::string;
@@ -117,5 +119,36 @@ TEST_F(EndToEndTest, IPingResponderCpp) {
   CheckFileContents(options->DependencyFilePath(), kExpectedCppDepsOutput);
 }
 
+TEST_F(EndToEndTest, IPingResponderCppPinsGeneratorVersion) {
+  using namespace ::android::aidl::test_data::ping_responder;
+
+  ASSERT_GT(kGeneratorVersionPinCount, 0u);
+  for (size_t i = 1; i < kGeneratorVersionPinCount; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      EXPECT_STRNE(kGeneratorVersionPins[j].semantic_hash,
+                   kGeneratorVersionPins[i].semantic_hash)
+          << "The expected outputs changed without a bump of "
+             "kGeneratorVersion in semantic_hash.cpp";
+    }
+  }
+
+  // The expected outputs match what aidl-cpp writes (see IPingResponderCpp)
+  // and start with the semantic hash they were generated with.
+  const GeneratorVersionPin& current =
+      kGeneratorVersionPins[kGeneratorVersionPinCount - 1];
+  const string hash_line =
+      cpp::SemanticHashLine(current.semantic_hash) + "\n";
+  for (const char* output : {kExpectedCppOutput, kExpectedIHeaderOutput,
+                             kExpectedBpHeaderOutput,
+                             kExpectedBnHeaderOutput}) {
+    EXPECT_EQ(0u, string(output).find(hash_line));
+  }
+  EXPECT_EQ(current.output_fingerprint,
+            HashText(string(kExpectedCppOutput) + kExpectedIHeaderOutput +
+                     kExpectedBpHeaderOutput + kExpectedBnHeaderOutput))
+      << "The expected outputs changed: bump kGeneratorVersion in "
+         "semantic_hash.cpp, then append a row to kGeneratorVersionPins";
+}
+
 }  // namespace android
 }  // namespace aidl
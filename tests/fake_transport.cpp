@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tests/fake_transport.h"
+
+#include <algorithm>
+#include <chrono>
+
+using std::mutex;
+using std::unique_lock;
+
+namespace android {
+namespace aidl {
+namespace test {
+
+int32_t FakeTransport::Transact(uint32_t code, int32_t request) {
+  unique_lock<mutex> l(lock_);
+  ++in_flight_;
+  max_in_flight_ = std::max(max_in_flight_, in_flight_);
+  changed_.notify_all();
+  changed_.wait(l, [this] { return released_ > 0; });
+  --released_;
+  --in_flight_;
+  ++completed_;
+  changed_.notify_all();
+  return ReplyFor(code, request);
+}
+
+void FakeTransport::Release(size_t count) {
+  unique_lock<mutex> l(lock_);
+  released_ += count;
+  changed_.notify_all();
+}
+
+bool FakeTransport::WaitForInFlight(size_t count) {
+  unique_lock<mutex> l(lock_);
+  return changed_.wait_for(l, std::chrono::seconds(5),
+                           [this, count] { return in_flight_ >= count; });
+}
+
+size_t FakeTransport::InFlight() {
+  unique_lock<mutex> l(lock_);
+  return in_flight_;
+}
+
+size_t FakeTransport::MaxInFlight() {
+  unique_lock<mutex> l(lock_);
+  return max_in_flight_;
+}
+
+size_t FakeTransport::Completed() {
+  unique_lock<mutex> l(lock_);
+  return completed_;
+}
+
+int32_t FakeTransport::ReplyFor(uint32_t code, int32_t request) {
+  return static_cast<int32_t>(code) * 1000 + request;
+}
+
+}  // namespace test
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_TESTS_FAKE_TRANSPORT_H_
+#define AIDL_TESTS_FAKE_TRANSPORT_H_
+
+#include <android-base/macros.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace android {
+namespace aidl {
+namespace test {
+
+// An in-process stand-in for a remote binder, so that asynchronous clients
+// can be exercised on a host without a binder driver.  Every transaction
+// blocks until the test lets it finish, which lets tests observe how many
+// calls are in flight at once.
+class FakeTransport {
+ public:
+  FakeTransport() = default;
+  ~FakeTransport() = default;
+
+  // Blocks until Release() lets this call finish, then returns the reply the
+  // "remote" computed for |request|.
+  int32_t Transact(uint32_t code, int32_t request);
+
+  // Lets |count| more transactions finish.
+  void Release(size_t count);
+  // Returns true once |count| transactions are blocked in Transact(), or
+  // false if that does not happen within a few seconds.
+  bool WaitForInFlight(size_t count);
+
+  size_t InFlight();
+  size_t MaxInFlight();
+  size_t Completed();
+
+  // The reply Transact() gives for |request|.
+  static int32_t ReplyFor(uint32_t code, int32_t request);
+
+ private:
+  std::mutex lock_;
+  std::condition_variable changed_;
+  size_t released_ = 0;
+  size_t in_flight_ = 0;
+  size_t max_in_flight_ = 0;
+  size_t completed_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeTransport);
+};
+
+}  // namespace test
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_TESTS_FAKE_TRANSPORT_H_
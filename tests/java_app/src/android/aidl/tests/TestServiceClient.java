@@ -387,6 +387,112 @@ public class TestServiceClient extends Activity {
         mLog.log("...service can reverse and return arrays.");
     }
 
+    private void checkPackedArrayReversal(ITestService service)
+            throws TestFailException {
+        mLog.log("Checking that service can reverse packed arrays...");
+        try {
+            {
+                boolean[] input = {
+                        true, false, false, true, true, true, true, true, true};
+                boolean[] echoed = new boolean[input.length];
+                boolean[] reversed = service.ReversePackedBoolean(input, echoed);
+                boolean[] expected = new boolean[input.length];
+                for (int i = 0; i < input.length; ++i) {
+                    expected[input.length - (1 + i)] = input[i];
+                }
+                if (!Arrays.equals(input, echoed) ||
+                        !Arrays.equals(expected, reversed)) {
+                    mLog.logAndThrow("Failed to reverse packed boolean[].");
+                }
+            }
+            {
+                char[] input = {'A', (char) 0x80, Character.MAX_VALUE};
+                char[] echoed = new char[input.length];
+                char[] reversed = service.ReversePackedChar(input, echoed);
+                char[] expected = new char[input.length];
+                for (int i = 0; i < input.length; ++i) {
+                    expected[input.length - (1 + i)] = input[i];
+                }
+                if (!Arrays.equals(input, echoed) ||
+                        !Arrays.equals(expected, reversed)) {
+                    mLog.logAndThrow("Failed to reverse packed char[].");
+                }
+            }
+            {
+                int[] input = {0, -1, 64, Integer.MIN_VALUE, Integer.MAX_VALUE};
+                int[] echoed = new int[input.length];
+                int[] reversed = service.ReversePackedInt(input, echoed);
+                int[] expected = new int[input.length];
+                for (int i = 0; i < input.length; ++i) {
+                    expected[input.length - (1 + i)] = input[i];
+                }
+                if (!Arrays.equals(input, echoed) ||
+                        !Arrays.equals(expected, reversed)) {
+                    mLog.logAndThrow("Failed to reverse packed int[].");
+                }
+            }
+            {
+                long[] input = {0, -1, 1L << 60, Long.MIN_VALUE, Long.MAX_VALUE};
+                long[] echoed = new long[input.length];
+                long[] reversed = service.ReversePackedLong(input, echoed);
+                long[] expected = new long[input.length];
+                for (int i = 0; i < input.length; ++i) {
+                    expected[input.length - (1 + i)] = input[i];
+                }
+                if (!Arrays.equals(input, echoed) ||
+                        !Arrays.equals(expected, reversed)) {
+                    mLog.logAndThrow("Failed to reverse packed long[].");
+                }
+            }
+        } catch (RemoteException ex) {
+            mLog.log(ex.toString());
+            mLog.logAndThrow("Service failed to reverse a packed array.");
+        }
+        mLog.log("...service can reverse packed arrays.");
+    }
+
+    private void checkCompressedValues(ITestService service)
+            throws TestFailException {
+        mLog.log("Checking that service can repeat compressed values...");
+        try {
+            // The large inputs are big enough to be sent compressed.
+            byte[] large = new byte[4096];
+            for (int i = 0; i < large.length; ++i) {
+                large[i] = (byte) (i % 7);
+            }
+            for (byte[] input : Arrays.asList(new byte[] {-1, 0, 127}, large)) {
+                byte[] echoed = new byte[input.length];
+                byte[] reversed = service.ReverseCompressedByte(input, echoed);
+                byte[] expected = new byte[input.length];
+                for (int i = 0; i < input.length; ++i) {
+                    expected[input.length - (1 + i)] = input[i];
+                }
+                if (!Arrays.equals(input, echoed) ||
+                        !Arrays.equals(expected, reversed)) {
+                    mLog.logAndThrow("Failed to reverse compressed byte[] " +
+                                     "of length " + input.length);
+                }
+            }
+            StringBuilder builder = new StringBuilder();
+            for (int i = 0; i < 256; ++i) {
+                builder.append("Deliver us from evil. ");
+            }
+            for (String query : Arrays.asList("not empty", "",
+                                              builder.toString())) {
+                String response = service.RepeatCompressedString(query);
+                if (!query.equals(response)) {
+                    mLog.logAndThrow("Repeat compressed request of length " +
+                                     query.length() + " responded with '" +
+                                     response + "'");
+                }
+            }
+        } catch (RemoteException ex) {
+            mLog.log(ex.toString());
+            mLog.logAndThrow("Service failed to repeat a compressed value.");
+        }
+        mLog.log("...service can repeat compressed values.");
+    }
+
     private void checkBinderExchange(
                 ITestService service) throws TestFailException {
       mLog.log("Checking exchange of binders...");
@@ -713,6 +819,8 @@ public class TestServiceClient extends Activity {
           checkPrimitiveRepeat(service);
           checkNullHandling(service);
           checkArrayReversal(service);
+          checkPackedArrayReversal(service);
+          checkCompressedValues(service);
           checkBinderExchange(service);
           checkListReversal(service);
           checkSimpleParcelables(service);
@@ -17,6 +17,8 @@
 #ifndef AIDL_TESTS_TEST_DATA_H_
 #define AIDL_TESTS_TEST_DATA_H_
 
+#include <cstddef>
+
 namespace android {
 namespace aidl {
 namespace test_data {
@@ -56,6 +58,15 @@ extern const char kExpectedIHeaderOutput[];
 extern const char kExpectedBpHeaderOutput[];
 extern const char kExpectedBnHeaderOutput[];
 
+// The semantic hash of each revision of the expected outputs above, next to
+// a fingerprint of those outputs, oldest first.
+struct GeneratorVersionPin {
+  const char* semantic_hash;
+  const char* output_fingerprint;
+};
+extern const GeneratorVersionPin kGeneratorVersionPins[];
+extern const size_t kGeneratorVersionPinCount;
+
 }  // namespace ping_responder
 
 }  // namespace test_data
@@ -431,6 +431,31 @@ static final int TRANSACTION_registerBinder = (android.os.IBinder.FIRST_CALL_TRA
 static final int TRANSACTION_getRecursiveBinder = (android.os.IBinder.FIRST_CALL_TRANSACTION + 6);
 static final int TRANSACTION_takesAnInterface = (android.os.IBinder.FIRST_CALL_TRANSACTION + 7);
 static final int TRANSACTION_takesAParcelable = (android.os.IBinder.FIRST_CALL_TRANSACTION + 8);
+private static final java.lang.String[] _aidl_transactionNames = {
+"isEnabled",
+"getState",
+"getAddress",
+"getParcelables",
+"setScanMode",
+"registerBinder",
+"getRecursiveBinder",
+"takesAnInterface",
+"takesAParcelable",
+};
+/** Returns the name of the method a transaction code calls, or null. */
+public static java.lang.String getTransactionName(int code)
+{
+int index = (code-android.os.IBinder.FIRST_CALL_TRANSACTION);
+if (((index>=0)&&(index<_aidl_transactionNames.length))) {
+return _aidl_transactionNames[index];
+}
+return null;
+}
+/** Returns the largest transaction id used by this interface, or -1. */
+public static int getMaxTransactionId()
+{
+return 8;
+}
 }
 public static final int EXAMPLE_CONSTANT = 3;
 public boolean isEnabled() throws android.os.RemoteException;
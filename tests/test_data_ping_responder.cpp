@@ -69,13 +69,15 @@ android/os/IPingResponder.aidl :
 
 some/path/android/os/BpPingResponder.h \
     some/path/android/os/BnPingResponder.h \
-    some/path/android/os/IPingResponder.h : \
+    some/path/android/os/IPingResponder.h \
+    some/path/android/os/IPingResponderFwd.h : \
     android/os/IPingResponder.aidl \
     ./bar/Unused.aidl
 )";
 
 const char kExpectedCppOutput[] =
-R"(#include <android/os/IPingResponder.h>
+R"(// aidl semantic hash: 5db9363f1958c00d
+#include <android/os/IPingResponder.h>
 #include <android/os/BpPingResponder.h>
 
 namespace android {
@@ -103,6 +105,7 @@ BpPingResponder::BpPingResponder(const ::android::sp<::android::IBinder>& _aidl_
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(PING_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -136,6 +139,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(NULLABLEPING_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -169,6 +173,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(UTF8PING_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -202,6 +207,7 @@ return _aidl_status;
 ::android::Parcel _aidl_reply;
 ::android::status_t _aidl_ret_status = ::android::OK;
 ::android::binder::Status _aidl_status;
+_aidl_data.setDataCapacity(NULLABLEUTF8PING_REQUEST_MIN_SIZE);
 _aidl_ret_status = _aidl_data.writeInterfaceToken(getInterfaceDescriptor());
 if (((_aidl_ret_status) != (::android::OK))) {
 goto _aidl_error;
@@ -359,15 +365,36 @@ _aidl_ret_status = ::android::binder::Status::fromExceptionCode(::android::binde
 return _aidl_ret_status;
 }
 
+constexpr const char* _aidl_transaction_names[] = {
+"Ping",
+"NullablePing",
+"Utf8Ping",
+"NullableUtf8Ping",
+};
+
+const char* BnPingResponder::getTransactionName(uint32_t _aidl_code) {
+const uint32_t _aidl_index = _aidl_code - ::android::IBinder::FIRST_CALL_TRANSACTION;
+if (_aidl_index < 4) {
+return _aidl_transaction_names[_aidl_index];
+}
+return nullptr;
+}
+
+int32_t BnPingResponder::getMaxTransactionId() {
+return 3;
+}
+
 }  // namespace os
 
 }  // namespace android
 )";
 
 const char kExpectedIHeaderOutput[] =
-R"(#ifndef AIDL_GENERATED_ANDROID_OS_I_PING_RESPONDER_H_
+R"(// aidl semantic hash: 5db9363f1958c00d
+#ifndef AIDL_GENERATED_ANDROID_OS_I_PING_RESPONDER_H_
 #define AIDL_GENERATED_ANDROID_OS_I_PING_RESPONDER_H_
 
+#include <android/os/IPingResponderFwd.h>
 #include <binder/IBinder.h>
 #include <binder/IInterface.h>
 #include <binder/Status.h>
@@ -393,6 +420,14 @@ enum Call {
   UTF8PING = ::android::IBinder::FIRST_CALL_TRANSACTION + 2,
   NULLABLEUTF8PING = ::android::IBinder::FIRST_CALL_TRANSACTION + 3,
 };
+static constexpr size_t PING_REQUEST_MIN_SIZE = 64;
+static constexpr size_t PING_REPLY_MIN_SIZE = 8;
+static constexpr size_t NULLABLEPING_REQUEST_MIN_SIZE = 64;
+static constexpr size_t NULLABLEPING_REPLY_MIN_SIZE = 8;
+static constexpr size_t UTF8PING_REQUEST_MIN_SIZE = 64;
+static constexpr size_t UTF8PING_REPLY_MIN_SIZE = 8;
+static constexpr size_t NULLABLEUTF8PING_REQUEST_MIN_SIZE = 64;
+static constexpr size_t NULLABLEUTF8PING_REPLY_MIN_SIZE = 8;
 };  // class IPingResponder
 
 }  // namespace os
@@ -402,7 +437,8 @@ enum Call {
 #endif  // AIDL_GENERATED_ANDROID_OS_I_PING_RESPONDER_H_)";
 
 const char kExpectedBpHeaderOutput[] =
-R"(#ifndef AIDL_GENERATED_ANDROID_OS_BP_PING_RESPONDER_H_
+R"(// aidl semantic hash: 5db9363f1958c00d
+#ifndef AIDL_GENERATED_ANDROID_OS_BP_PING_RESPONDER_H_
 #define AIDL_GENERATED_ANDROID_OS_BP_PING_RESPONDER_H_
 
 #include <binder/IBinder.h>
@@ -431,7 +467,8 @@ virtual ~BpPingResponder() = default;
 #endif  // AIDL_GENERATED_ANDROID_OS_BP_PING_RESPONDER_H_)";
 
 const char kExpectedBnHeaderOutput[] =
-R"(#ifndef AIDL_GENERATED_ANDROID_OS_BN_PING_RESPONDER_H_
+R"(// aidl semantic hash: 5db9363f1958c00d
+#ifndef AIDL_GENERATED_ANDROID_OS_BN_PING_RESPONDER_H_
 #define AIDL_GENERATED_ANDROID_OS_BN_PING_RESPONDER_H_
 
 #include <binder/IInterface.h>
@@ -444,6 +481,8 @@ namespace os {
 class BnPingResponder : public ::android::BnInterface<IPingResponder> {
 public:
 ::android::status_t onTransact(uint32_t _aidl_code, const ::android::Parcel& _aidl_data, ::android::Parcel* _aidl_reply, uint32_t _aidl_flags = 0) override;
+static const char* getTransactionName(uint32_t _aidl_code);
+static int32_t getMaxTransactionId();
 };  // class BnPingResponder
 
 }  // namespace os
@@ -452,6 +491,15 @@ public:
 
 #endif  // AIDL_GENERATED_ANDROID_OS_BN_PING_RESPONDER_H_)";
 
+// When the expected outputs change, append a row for them rather than
+// editing the last one.  Rows must not share a semantic hash, so outputs
+// can only change along with kGeneratorVersion in semantic_hash.cpp.
+const GeneratorVersionPin kGeneratorVersionPins[] = {
+  {"5db9363f1958c00d", "75ea082e8d99600c"},
+};
+const size_t kGeneratorVersionPinCount =
+    sizeof(kGeneratorVersionPins) / sizeof(kGeneratorVersionPins[0]);
+
 }  // namespace ping_responder
 }  // namespace test_data
 }  // namespace aidl
@@ -24,6 +24,7 @@
 #include <android-base/strings.h>
 
 #include "logging.h"
+#include "wire_size.h"
 
 using std::cerr;
 using std::endl;
@@ -76,8 +77,77 @@ class VoidType : public Type {
   bool CanWriteToParcel() const override { return false; }
 };  // class VoidType
 
+// A @packed array, marshalled by the functions in aidl/packed_arrays.h named
+// for |function_name|, e.g. ReadPackedInt32Vector() for "Int32".
+class PackedArrayType : public ArrayType {
+ public:
+  PackedArrayType(const std::string& aidl_type,
+                  const std::string& header,
+                  const std::string& cpp_type,
+                  const std::string& function_name)
+      : PackedArrayType(aidl_type, header, "::std::vector<" + cpp_type + ">",
+                        function_name,
+                        new PackedArrayType(
+                            aidl_type, header,
+                            "::std::unique_ptr<::std::vector<" + cpp_type +
+                                ">>",
+                            function_name, kNoNullableType)) {}
+  virtual ~PackedArrayType() = default;
+
+  bool UsesParcelHelpers() const override { return true; }
+
+ private:
+  PackedArrayType(const std::string& aidl_type,
+                  const std::string& header,
+                  const std::string& cpp_type,
+                  const std::string& function_name,
+                  Type* nullable_type)
+      : ArrayType(ValidatableType::KIND_BUILT_IN, kNoPackage, aidl_type + "[]",
+                  {header, "vector", "memory", "aidl/packed_arrays.h"},
+                  cpp_type,
+                  "::android::aidl::ReadPacked" + function_name + "Vector",
+                  "::android::aidl::WritePacked" + function_name + "Vector",
+                  kNoArrayType, nullable_type) {}
+
+  DISALLOW_COPY_AND_ASSIGN(PackedArrayType);
+};  // class PackedArrayType
+
+// A @compressed byte[], String or parcelable, marshalled by the functions in
+// aidl/compressed_payload.h named for |function_name|, e.g.
+// ReadCompressedString16() for "String16".
+class CompressedValueType : public Type {
+ public:
+  CompressedValueType(int kind,  // from ValidatableType
+                      const std::string& package,
+                      const std::string& aidl_type,
+                      const std::string& header,
+                      const std::string& cpp_type,
+                      const std::string& function_name,
+                      bool can_be_out,
+                      Type* nullable_type = kNoNullableType,
+                      const std::string& src_file_name = "",
+                      int line = -1)
+      : Type(kind, package, aidl_type,
+             {header, "memory", "aidl/compressed_payload.h"}, cpp_type,
+             "::android::aidl::ReadCompressed" + function_name,
+             "::android::aidl::WriteCompressed" + function_name,
+             kNoArrayType, nullable_type, src_file_name, line),
+        can_be_out_(can_be_out) {}
+  virtual ~CompressedValueType() = default;
+
+  bool CanBeOutParameter() const override { return can_be_out_; }
+  bool UsesParcelHelpers() const override { return true; }
+
+ private:
+  const bool can_be_out_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedValueType);
+};  // class CompressedValueType
+
 class PrimitiveType : public Type {
  public:
+  // Arrays of the type can be @packed if |packed_function_name| is set; see
+  // PackedArrayType.
   PrimitiveType(int kind,  // from ValidatableType
                 const std::string& package,
                 const std::string& aidl_type,
@@ -86,33 +156,43 @@ class PrimitiveType : public Type {
                 const std::string& read_method,
                 const std::string& write_method,
                 const std::string& read_array_method,
-                const std::string& write_array_method)
+                const std::string& write_array_method,
+                const std::string& packed_function_name = "")
       : Type(kind, package, aidl_type, {header}, cpp_type, read_method,
              write_method, PrimitiveArrayType(kind, package, aidl_type,
                                               header, cpp_type,
                                               read_array_method,
-                                              write_array_method)) {}
+                                              write_array_method,
+                                              packed_function_name)) {}
 
   virtual ~PrimitiveType() = default;
   bool IsCppPrimitive() const override { return true; }
   bool CanBeOutParameter() const override { return is_array_; }
+  const Type* PackedType() const override { return packed_type_.get(); }
 
  protected:
-  static PrimitiveType* PrimitiveArrayType(int kind,  // from ValidatableType
-                                           const std::string& package,
-                                           const std::string& aidl_type,
-                                           const std::string& header,
-                                           const std::string& cpp_type,
-                                           const std::string& read_method,
-                                           const std::string& write_method) {
+  static PrimitiveType* PrimitiveArrayType(
+      int kind,  // from ValidatableType
+      const std::string& package,
+      const std::string& aidl_type,
+      const std::string& header,
+      const std::string& cpp_type,
+      const std::string& read_method,
+      const std::string& write_method,
+      const std::string& packed_function_name) {
     PrimitiveType* nullable =
         new PrimitiveType(kind, package, aidl_type + "[]", header,
                           "::std::unique_ptr<::std::vector<" + cpp_type + ">>",
                           read_method, write_method);
+    Type* packed = nullptr;
+    if (!packed_function_name.empty()) {
+      packed = new PackedArrayType(aidl_type, header, cpp_type,
+                                   packed_function_name);
+    }
 
     return new PrimitiveType(kind, package, aidl_type + "[]", header,
                              "::std::vector<" + cpp_type + ">",
-                             read_method, write_method, nullable);
+                             read_method, write_method, nullable, packed);
   }
 
   PrimitiveType(int kind,  // from ValidatableType
@@ -122,14 +202,17 @@ class PrimitiveType : public Type {
                 const std::string& cpp_type,
                 const std::string& read_method,
                 const std::string& write_method,
-                Type* nullable_type = nullptr)
+                Type* nullable_type = nullptr,
+                Type* packed_type = nullptr)
       : Type(kind, package, aidl_type, {header, "vector"}, cpp_type, read_method,
-             write_method, kNoArrayType, nullable_type) {
+             write_method, kNoArrayType, nullable_type),
+        packed_type_(packed_type) {
     is_array_ = true;
   }
 
  private:
   bool is_array_ = false;
+  const unique_ptr<Type> packed_type_;
 
   DISALLOW_COPY_AND_ASSIGN(PrimitiveType);
 };  // class PrimitiveType
@@ -142,11 +225,22 @@ class ByteType : public Type {
          new ByteType(true, "byte[]",
              "::std::unique_ptr<::std::vector<uint8_t>>",
              "readByteVector", "writeByteVector", kNoArrayType,
-             kNoNullableType)), kNoNullableType) {}
+             kNoNullableType),
+         new CompressedValueType(
+             ValidatableType::KIND_BUILT_IN, kNoPackage, "byte[]", "vector",
+             "::std::vector<uint8_t>", "ByteVector", true,
+             new CompressedValueType(
+                 ValidatableType::KIND_BUILT_IN, kNoPackage, "byte[]",
+                 "vector", "::std::unique_ptr<::std::vector<uint8_t>>",
+                 "ByteVector", true))),
+     kNoNullableType) {}
 
   virtual ~ByteType() = default;
   bool IsCppPrimitive() const override { return true; }
   bool CanBeOutParameter() const override { return is_array_; }
+  const Type* CompressedType() const override {
+    return compressed_type_.get();
+  }
 
  protected:
   ByteType(bool is_array,
@@ -155,13 +249,16 @@ class ByteType : public Type {
            const std::string& read_method,
            const std::string& write_method,
            Type* array_type,
-           Type* nullable_type)
+           Type* nullable_type,
+           Type* compressed_type = nullptr)
       : Type(ValidatableType::KIND_BUILT_IN, kNoPackage, name, {"cstdint"},
              cpp_type, read_method, write_method, array_type, nullable_type),
-        is_array_(is_array) {}
+        is_array_(is_array),
+        compressed_type_(compressed_type) {}
 
  private:
   bool is_array_ = false;
+  const unique_ptr<Type> compressed_type_;
 
   DISALLOW_COPY_AND_ASSIGN(ByteType);
 };  // class PrimitiveType
@@ -175,7 +272,10 @@ class BinderType : public Type {
              "readStrongBinder", "writeStrongBinder",
              kNoArrayType, kNoNullableType, src_file_name,
              interface.GetLine()),
-        write_cast_(GetRawCppName(interface) + "::asBinder") {}
+        write_cast_(GetRawCppName(interface) + "::asBinder") {
+    SetForwardDeclaration(interface.GetSplitPackage(), interface.GetName(),
+                          {"utils/StrongPointer.h"});
+  }
   virtual ~BinderType() = default;
 
   string WriteCast(const string& val) const override {
@@ -218,7 +318,10 @@ class NullableParcelableArrayType : public ArrayType {
                   {parcelable.GetCppHeader(), "vector"},
                   GetCppName(parcelable), "readParcelableVector",
                   "writeParcelableVector", kNoArrayType, kNoNullableType,
-                  src_file_name, parcelable.GetLine()) {}
+                  src_file_name, parcelable.GetLine()) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {"memory", "vector"});
+  }
   virtual ~NullableParcelableArrayType() = default;
 
  private:
@@ -239,7 +342,10 @@ class ParcelableArrayType : public ArrayType {
                   GetCppName(parcelable), "readParcelableVector",
                   "writeParcelableVector", kNoArrayType,
                   new NullableParcelableArrayType(parcelable, src_file_name),
-                  src_file_name, parcelable.GetLine()) {}
+                  src_file_name, parcelable.GetLine()) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {"vector"});
+  }
   virtual ~ParcelableArrayType() = default;
 
  private:
@@ -258,7 +364,10 @@ class NullableParcelableType : public Type {
              {parcelable.GetCppHeader()}, GetCppName(parcelable),
              "readParcelable", "writeNullableParcelable",
              kNoArrayType, kNoNullableType,
-             src_file_name, parcelable.GetLine()) {}
+             src_file_name, parcelable.GetLine()) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {"memory"});
+  }
   virtual ~NullableParcelableType() = default;
   bool CanBeOutParameter() const override { return true; }
 
@@ -269,6 +378,42 @@ class NullableParcelableType : public Type {
   }
 };
 
+// The functions marshalling @compressed parcelables are templates, so like
+// those of other parcelables, their declarations need only declare the class.
+class CompressedParcelableType : public CompressedValueType {
+ public:
+  CompressedParcelableType(const AidlParcelable& parcelable,
+                           const std::string& src_file_name)
+      : CompressedParcelableType(
+            parcelable, src_file_name, GetCppName(parcelable),
+            new CompressedParcelableType(
+                parcelable, src_file_name,
+                "::std::unique_ptr<" + GetCppName(parcelable) + ">",
+                kNoNullableType)) {}
+  virtual ~CompressedParcelableType() = default;
+
+ private:
+  CompressedParcelableType(const AidlParcelable& parcelable,
+                           const std::string& src_file_name,
+                           const std::string& cpp_type,
+                           Type* nullable_type)
+      : CompressedValueType(ValidatableType::KIND_PARCELABLE,
+                            parcelable.GetPackage(), parcelable.GetName(),
+                            parcelable.GetCppHeader(), cpp_type, "Parcelable",
+                            true, nullable_type, src_file_name,
+                            parcelable.GetLine()) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {"memory"});
+  }
+
+  static string GetCppName(const AidlParcelable& parcelable) {
+    return "::" + Join(parcelable.GetSplitPackage(), "::") +
+        "::" + parcelable.GetName();
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedParcelableType);
+};  // class CompressedParcelableType
+
 class ParcelableType : public Type {
  public:
   ParcelableType(const AidlParcelable& parcelable,
@@ -279,17 +424,110 @@ class ParcelableType : public Type {
              "readParcelable", "writeParcelable",
              new ParcelableArrayType(parcelable, src_file_name),
              new NullableParcelableType(parcelable, src_file_name),
-             src_file_name, parcelable.GetLine()) {}
+             src_file_name, parcelable.GetLine()),
+        compressed_type_(
+            new CompressedParcelableType(parcelable, src_file_name)) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {});
+  }
   virtual ~ParcelableType() = default;
   bool CanBeOutParameter() const override { return true; }
+  const Type* CompressedType() const override {
+    return compressed_type_.get();
+  }
+
+ private:
+  static string GetCppName(const AidlParcelable& parcelable) {
+    return "::" + Join(parcelable.GetSplitPackage(), "::") +
+        "::" + parcelable.GetName();
+  }
+
+  const unique_ptr<Type> compressed_type_;
+};
+
+// @FixedSize parcelables are trivially copyable structs rather than
+// android::Parcelables, and are marshalled by static helpers generated along
+// with them.  They cannot be null.
+class FixedSizeParcelableArrayType : public ArrayType {
+ public:
+  FixedSizeParcelableArrayType(const AidlParcelable& parcelable,
+                               const std::string& src_file_name)
+      : ArrayType(ValidatableType::KIND_PARCELABLE,
+                  parcelable.GetPackage(), parcelable.GetName(),
+                  {parcelable.GetCppHeader(), "vector"},
+                  "::std::vector<" + GetCppName(parcelable) + ">",
+                  GetCppName(parcelable) + "::readVectorFromParcel",
+                  GetCppName(parcelable) + "::writeVectorToParcel",
+                  kNoArrayType, kNoNullableType,
+                  src_file_name, parcelable.GetLine()) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {"vector"});
+  }
+  virtual ~FixedSizeParcelableArrayType() = default;
+  bool UsesParcelHelpers() const override { return true; }
+
+ private:
+  static string GetCppName(const AidlParcelable& parcelable) {
+    return "::" + Join(parcelable.GetSplitPackage(), "::") +
+        "::" + parcelable.GetName();
+  }
+};
+
+class FixedSizeParcelableType : public Type {
+ public:
+  FixedSizeParcelableType(const AidlStructuredParcelable& parcelable,
+                          const std::string& src_file_name)
+      : Type(ValidatableType::KIND_PARCELABLE,
+             parcelable.GetPackage(), parcelable.GetName(),
+             {parcelable.GetCppHeader()}, GetCppName(parcelable),
+             GetCppName(parcelable) + "::readFromParcel",
+             GetCppName(parcelable) + "::writeToParcel",
+             new FixedSizeParcelableArrayType(parcelable, src_file_name),
+             kNoNullableType, src_file_name, parcelable.GetLine()),
+        wire_size_(GetFixedWireSize(parcelable)) {
+    SetForwardDeclaration(parcelable.GetSplitPackage(), parcelable.GetName(),
+                          {});
+  }
+  virtual ~FixedSizeParcelableType() = default;
+  bool CanBeOutParameter() const override { return true; }
+  bool UsesParcelHelpers() const override { return true; }
+  size_t FixedWireSize() const override { return wire_size_; }
 
  private:
   static string GetCppName(const AidlParcelable& parcelable) {
     return "::" + Join(parcelable.GetSplitPackage(), "::") +
         "::" + parcelable.GetName();
   }
+
+  const size_t wire_size_;
 };
 
+// A String, in either of its C++ representations, which can be @compressed.
+class StringType : public Type {
+ public:
+  StringType(const std::string& package,
+             const std::string& aidl_type,
+             const std::vector<std::string>& headers,
+             const std::string& cpp_type,
+             const std::string& read_method,
+             const std::string& write_method,
+             Type* array_type,
+             Type* nullable_type,
+             Type* compressed_type)
+      : Type(ValidatableType::KIND_BUILT_IN, package, aidl_type, headers,
+             cpp_type, read_method, write_method, array_type, nullable_type),
+        compressed_type_(compressed_type) {}
+  virtual ~StringType() = default;
+  const Type* CompressedType() const override {
+    return compressed_type_.get();
+  }
+
+ private:
+  const unique_ptr<Type> compressed_type_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringType);
+};  // class StringType
+
 class NullableStringListType : public Type {
  public:
   NullableStringListType()
@@ -405,16 +643,36 @@ Type::Type(int kind,
 
 bool Type::CanWriteToParcel() const { return true; }
 
+void Type::GetDeclarationHeaders(set<string>* headers,
+                                 ForwardDeclarations* classes) const {
+  // Generated code declares classes inside the namespaces of their packages,
+  // so anything outside a package keeps its header.
+  if (forward_class_.empty() || forward_package_.empty()) {
+    GetHeaders(headers);
+    return;
+  }
+  headers->insert(forward_headers_.begin(), forward_headers_.end());
+  (*classes)[forward_package_].insert(forward_class_);
+}
+
+void Type::SetForwardDeclaration(const vector<string>& package,
+                                 const string& class_name,
+                                 const vector<string>& headers) {
+  forward_package_ = package;
+  forward_class_ = class_name;
+  forward_headers_ = headers;
+}
+
 void TypeNamespace::Init() {
   Add(new ByteType());
   Add(new PrimitiveType(
       ValidatableType::KIND_BUILT_IN, kNoPackage, "int",
       "cstdint", "int32_t", "readInt32", "writeInt32",
-      "readInt32Vector", "writeInt32Vector"));
+      "readInt32Vector", "writeInt32Vector", "Int32"));
   Add(new PrimitiveType(
       ValidatableType::KIND_BUILT_IN, kNoPackage, "long",
       "cstdint", "int64_t", "readInt64", "writeInt64",
-      "readInt64Vector", "writeInt64Vector"));
+      "readInt64Vector", "writeInt64Vector", "Int64"));
   Add(new PrimitiveType(
       ValidatableType::KIND_BUILT_IN, kNoPackage, "float",
       kNoHeader, "float", "readFloat", "writeFloat",
@@ -426,12 +684,12 @@ void TypeNamespace::Init() {
   Add(new PrimitiveType(
       ValidatableType::KIND_BUILT_IN, kNoPackage, "boolean",
       kNoHeader, "bool", "readBool", "writeBool",
-      "readBoolVector", "writeBoolVector"));
+      "readBoolVector", "writeBoolVector", "Bool"));
   // C++11 defines the char16_t type as a built in for Unicode characters.
   Add(new PrimitiveType(
       ValidatableType::KIND_BUILT_IN, kNoPackage, "char",
       kNoHeader, "char16_t", "readChar", "writeChar",
-      "readCharVector", "writeCharVector"));
+      "readCharVector", "writeCharVector", "Char"));
 
   Type* nullable_string_array_type =
       new ArrayType(ValidatableType::KIND_BUILT_IN, "java.lang", "String[]",
@@ -452,10 +710,19 @@ void TypeNamespace::Init() {
                {"memory", "utils/String16.h"}, "::std::unique_ptr<::android::String16>",
                "readString16", "writeString16");
 
-  string_type_ = new Type(ValidatableType::KIND_BUILT_IN, "java.lang", "String",
-                          {"utils/String16.h"}, "::android::String16",
-                          "readString16", "writeString16",
-                          string_array_type, nullable_string_type);
+  Type* compressed_string_type = new CompressedValueType(
+      ValidatableType::KIND_BUILT_IN, "java.lang", "String",
+      "utils/String16.h", "::android::String16", "String16", false,
+      new CompressedValueType(
+          ValidatableType::KIND_BUILT_IN, "java.lang", "String",
+          "utils/String16.h", "::std::unique_ptr<::android::String16>",
+          "String16", false));
+
+  string_type_ = new StringType("java.lang", "String",
+                                {"utils/String16.h"}, "::android::String16",
+                                "readString16", "writeString16",
+                                string_array_type, nullable_string_type,
+                                compressed_string_type);
   Add(string_type_);
 
   using ::android::aidl::kAidlReservedTypePackage;
@@ -481,11 +748,19 @@ void TypeNamespace::Init() {
       kAidlReservedTypePackage, kUtf8InCppStringClass,
       {"string", "memory"}, "::std::unique_ptr<::std::string>",
       "readUtf8FromUtf16", "writeUtf8AsUtf16");
-  Add(new Type(
+  Type* compressed_cpp_utf8_string_type = new CompressedValueType(
       ValidatableType::KIND_BUILT_IN,
+      kAidlReservedTypePackage, kUtf8InCppStringClass, "string",
+      "::std::string", "Utf8String", false,
+      new CompressedValueType(
+          ValidatableType::KIND_BUILT_IN,
+          kAidlReservedTypePackage, kUtf8InCppStringClass, "string",
+          "::std::unique_ptr<::std::string>", "Utf8String", false));
+  Add(new StringType(
       kAidlReservedTypePackage, kUtf8InCppStringClass,
       {"string"}, "::std::string", "readUtf8FromUtf16", "writeUtf8AsUtf16",
-      cpp_utf8_string_array, nullable_cpp_utf8_string_type));
+      cpp_utf8_string_array, nullable_cpp_utf8_string_type,
+      compressed_cpp_utf8_string_type));
 
   ibinder_type_ = new Type(ValidatableType::KIND_BUILT_IN, "android.os",
                            "IBinder", {"binder/IBinder.h"},
@@ -519,6 +794,11 @@ bool TypeNamespace::AddParcelableType(const AidlParcelable& p,
                << " has no C++ header defined.";
     return false;
   }
+  const AidlStructuredParcelable* structured = p.AsStructuredParcelable();
+  if (structured && structured->IsFixedSize()) {
+    Add(new FixedSizeParcelableType(*structured, filename));
+    return true;
+  }
   Add(new ParcelableType(p, filename));
   return true;
 }
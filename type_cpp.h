@@ -17,6 +17,7 @@
 #ifndef AIDL_TYPE_CPP_H_
 #define AIDL_TYPE_CPP_H_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <set>
@@ -30,6 +31,11 @@ namespace android {
 namespace aidl {
 namespace cpp {
 
+// Names of classes to declare ahead of their definitions, by the namespaces
+// they go in.
+using ForwardDeclarations =
+    std::map<std::vector<std::string>, std::set<std::string>>;
+
 class Type : public ValidatableType {
  public:
   Type(int kind,  // from ValidatableType
@@ -66,11 +72,28 @@ class Type : public ValidatableType {
       }
     }
   }
+  // Adds what a function declaration naming this type needs.  Parcelables
+  // and interfaces are only ever passed by reference, so rather than the
+  // header defining them, such declarations take a forward declaration of
+  // the class, added to |classes|.
+  void GetDeclarationHeaders(std::set<std::string>* headers,
+                             ForwardDeclarations* classes) const;
   virtual bool IsCppPrimitive() const { return false; }
+  // True if ReadFromParcelMethod() and WriteToParcelMethod() name generated
+  // functions that take a Parcel* as their first argument, rather than
+  // methods of Parcel.
+  virtual bool UsesParcelHelpers() const { return false; }
   virtual std::string WriteCast(const std::string& value) const {
     return value;
   }
 
+ protected:
+  // Lets function declarations make do with |class_name| declared in
+  // |package|, plus |headers| (e.g. "vector" for a vector of the class).
+  void SetForwardDeclaration(const std::vector<std::string>& package,
+                             const std::string& class_name,
+                             const std::vector<std::string>& headers);
+
  private:
   // |headers| are the headers we must include to use this type
   const std::vector<std::string> headers_;
@@ -80,6 +103,9 @@ class Type : public ValidatableType {
   const std::string cpp_type_;
   const std::string parcel_read_method_;
   const std::string parcel_write_method_;
+  std::vector<std::string> forward_package_;
+  std::string forward_class_;
+  std::vector<std::string> forward_headers_;
 
   const std::unique_ptr<Type> array_type_;
   const std::unique_ptr<Type> nullable_type_;
@@ -48,6 +48,57 @@ TEST_F(CppTypeNamespaceTest, SupportsListString) {
       types_.HasTypeByCanonicalName("java.util.List<java.lang.String>"));
 }
 
+TEST_F(CppTypeNamespaceTest, PacksOnlyBooleanCharIntAndLongArrays) {
+  for (const char* name : {"boolean", "char", "int", "long"}) {
+    const Type* array = types_.FindTypeByCanonicalName(name)->ArrayType();
+    ASSERT_NE(nullptr, array);
+    const Type* packed = static_cast<const Type*>(array->PackedType());
+    ASSERT_NE(nullptr, packed) << name;
+    EXPECT_TRUE(packed->UsesParcelHelpers());
+    EXPECT_EQ(array->CppType(), packed->CppType());
+    EXPECT_EQ(0u, packed->ReadFromParcelMethod().find(
+                      "::android::aidl::ReadPacked"));
+    ASSERT_NE(nullptr, packed->NullableType());
+    EXPECT_EQ(packed->ReadFromParcelMethod(),
+              static_cast<const Type*>(packed->NullableType())
+                  ->ReadFromParcelMethod());
+  }
+  for (const char* name : {"byte", "float", "double", "String"}) {
+    const Type* array = types_.FindTypeByCanonicalName(name)->ArrayType();
+    ASSERT_NE(nullptr, array);
+    EXPECT_EQ(nullptr, array->PackedType()) << name;
+  }
+}
+
+TEST_F(CppTypeNamespaceTest, CompressesOnlyByteArraysAndStrings) {
+  std::vector<const Type*> compressible = {
+      types_.FindTypeByCanonicalName("byte")->ArrayType(),
+      types_.FindTypeByCanonicalName(kStringCanonicalName),
+      types_.FindTypeByCanonicalName(kUtf8InCppStringCanonicalName)};
+  for (const Type* type : compressible) {
+    ASSERT_NE(nullptr, type);
+    const Type* compressed =
+        static_cast<const Type*>(type->CompressedType());
+    ASSERT_NE(nullptr, compressed) << type->CppType();
+    EXPECT_TRUE(compressed->UsesParcelHelpers());
+    EXPECT_EQ(type->CppType(), compressed->CppType());
+    EXPECT_EQ(0u, compressed->ReadFromParcelMethod().find(
+                      "::android::aidl::ReadCompressed"));
+    ASSERT_NE(nullptr, compressed->NullableType());
+    EXPECT_EQ(static_cast<const Type*>(type->NullableType())->CppType(),
+              static_cast<const Type*>(compressed->NullableType())
+                  ->CppType());
+  }
+  for (const char* name : {"int", "long", "boolean"}) {
+    const Type* type = types_.FindTypeByCanonicalName(name);
+    EXPECT_EQ(nullptr, type->CompressedType()) << name;
+    EXPECT_EQ(nullptr, type->ArrayType()->CompressedType()) << name;
+  }
+  EXPECT_EQ(nullptr, types_.FindTypeByCanonicalName(kStringCanonicalName)
+                         ->ArrayType()
+                         ->CompressedType());
+}
+
 }  // namespace cpp
 }  // namespace android
 }  // namespace aidl
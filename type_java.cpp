@@ -22,6 +22,7 @@
 
 #include "aidl_language.h"
 #include "logging.h"
+#include "wire_size.h"
 
 using std::string;
 using android::base::Split;
@@ -38,6 +39,8 @@ Expression* SUPER_VALUE;
 Expression* TRUE_VALUE;
 Expression* FALSE_VALUE;
 
+const char kWriteToParcelFlags[] = "_aidl_flag";
+
 // ================================================================
 
 Type::Type(const JavaTypeNamespace* types, const string& name, int kind,
@@ -62,35 +65,38 @@ void Type::WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
                          int flags) const {
   fprintf(stderr, "aidl:internal error %s:%d qualifiedName=%sn", __FILE__,
           __LINE__, m_javaType.c_str());
-  addTo->Add(new LiteralExpression("/* WriteToParcel error " + m_javaType +
-                                   " */"));
+  addTo->Add(New<LiteralExpression>("/* WriteToParcel error " + m_javaType +
+                                    " */"));
 }
 
 void Type::CreateFromParcel(StatementBlock* addTo, Variable* v,
                             Variable* parcel, Variable**) const {
   fprintf(stderr, "aidl:internal error %s:%d qualifiedName=%s\n", __FILE__,
           __LINE__, m_javaType.c_str());
-  addTo->Add(new LiteralExpression("/* CreateFromParcel error " +
-                                   m_javaType + " */"));
+  addTo->Add(New<LiteralExpression>("/* CreateFromParcel error " +
+                                    m_javaType + " */"));
 }
 
 void Type::ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
                           Variable**) const {
   fprintf(stderr, "aidl:internal error %s:%d qualifiedName=%s\n", __FILE__,
           __LINE__, m_javaType.c_str());
-  addTo->Add(new LiteralExpression("/* ReadFromParcel error " +
-                                   m_javaType + " */"));
+  addTo->Add(New<LiteralExpression>("/* ReadFromParcel error " +
+                                    m_javaType + " */"));
 }
 
 Expression* Type::BuildWriteToParcelFlags(int flags) const {
+  if ((flags & PARCELABLE_WRITE_CALLER_FLAGS) != 0) {
+    return New<LiteralExpression>(kWriteToParcelFlags);
+  }
   if (flags == 0) {
-    return new LiteralExpression("0");
+    return New<LiteralExpression>("0");
   }
   if ((flags & PARCELABLE_WRITE_RETURN_VALUE) != 0) {
-    return new FieldVariable(m_types->ParcelableInterfaceType(),
-                             "PARCELABLE_WRITE_RETURN_VALUE");
+    return New<FieldVariable>(m_types->ParcelableInterfaceType(),
+                              "PARCELABLE_WRITE_RETURN_VALUE");
   }
-  return new LiteralExpression("0");
+  return New<LiteralExpression>("0");
 }
 
 // ================================================================
@@ -110,12 +116,12 @@ BasicType::BasicType(const JavaTypeNamespace* types, const string& name,
 
 void BasicType::WriteToParcel(StatementBlock* addTo, Variable* v,
                               Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, m_marshallParcel, 1, v));
+  addTo->Add(New<MethodCall>(parcel, m_marshallParcel, 1, v));
 }
 
 void BasicType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                  Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, m_unmarshallParcel)));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, m_unmarshallParcel)));
 }
 
 BasicArrayType::BasicArrayType(const JavaTypeNamespace* types,
@@ -126,22 +132,162 @@ BasicArrayType::BasicArrayType(const JavaTypeNamespace* types,
     : Type(types, name, ValidatableType::KIND_BUILT_IN, true, true),
       m_writeArrayParcel(writeArrayParcel),
       m_createArrayParcel(createArrayParcel),
-      m_readArrayParcel(readArrayParcel) {}
+      m_readArrayParcel(readArrayParcel) {
+  if (name == "int" || name == "long") {
+    m_packed_type.reset(new PackedArrayType(types, name));
+  }
+  if (name == "byte") {
+    m_compressed_type.reset(new CompressedByteArrayType(types));
+  }
+}
 
 
 void BasicArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                    Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, m_writeArrayParcel, 1, v));
+  addTo->Add(New<MethodCall>(parcel, m_writeArrayParcel, 1, v));
 }
 
 void BasicArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                       Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, m_createArrayParcel)));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, m_createArrayParcel)));
 }
 
 void BasicArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                     Variable* parcel, Variable**) const {
-  addTo->Add(new MethodCall(parcel, m_readArrayParcel, 1, v));
+  addTo->Add(New<MethodCall>(parcel, m_readArrayParcel, 1, v));
+}
+
+// ================================================================
+
+PackedArrayType::PackedArrayType(const JavaTypeNamespace* types,
+                                 const string& name)
+    : Type(types, name, ValidatableType::KIND_BUILT_IN, true, true),
+      m_helperSuffix(string(1, toupper(name[0])) + name.substr(1)) {}
+
+void PackedArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
+                                    Variable* parcel, int flags) const {
+  addTo->Add(New<MethodCall>(PackedArrays(), "write" + m_helperSuffix + "Array",
+                             2, parcel, v));
+}
+
+void PackedArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
+                                       Variable* parcel, Variable**) const {
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(PackedArrays(), "create" + m_helperSuffix + "Array",
+                         1, parcel)));
+}
+
+void PackedArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
+                                     Variable* parcel, Variable**) const {
+  addTo->Add(New<MethodCall>(PackedArrays(), "read" + m_helperSuffix + "Array",
+                             2, parcel, v));
+}
+
+Expression* PackedArrayType::PackedArrays() const {
+  return New<LiteralExpression>("android.aidl.PackedArrays");
+}
+
+// ================================================================
+
+CompressedPayloadType::CompressedPayloadType(const JavaTypeNamespace* types,
+                                             const string& package,
+                                             const string& name, int kind,
+                                             bool canBeOut,
+                                             const string& declFile,
+                                             int declLine)
+    : Type(types, package, name, kind, true, canBeOut, declFile, declLine) {}
+
+Expression* CompressedPayloadType::CompressedPayload() const {
+  return New<LiteralExpression>("android.aidl.CompressedPayload");
+}
+
+CompressedByteArrayType::CompressedByteArrayType(
+    const JavaTypeNamespace* types)
+    : CompressedPayloadType(types, "", "byte", ValidatableType::KIND_BUILT_IN,
+                            true) {}
+
+void CompressedByteArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
+                                            Variable* parcel,
+                                            int flags) const {
+  addTo->Add(New<MethodCall>(CompressedPayload(), "writeByteArray", 2,
+                             parcel, v));
+}
+
+void CompressedByteArrayType::CreateFromParcel(StatementBlock* addTo,
+                                               Variable* v, Variable* parcel,
+                                               Variable**) const {
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(CompressedPayload(), "createByteArray", 1, parcel)));
+}
+
+void CompressedByteArrayType::ReadFromParcel(StatementBlock* addTo,
+                                             Variable* v, Variable* parcel,
+                                             Variable**) const {
+  addTo->Add(New<MethodCall>(CompressedPayload(), "readByteArray", 2, parcel,
+                             v));
+}
+
+CompressedStringType::CompressedStringType(const JavaTypeNamespace* types)
+    : CompressedPayloadType(types, "java.lang", "String",
+                            ValidatableType::KIND_BUILT_IN, false) {}
+
+void CompressedStringType::WriteToParcel(StatementBlock* addTo, Variable* v,
+                                         Variable* parcel, int flags) const {
+  addTo->Add(New<MethodCall>(CompressedPayload(), "writeString", 2, parcel,
+                             v));
+}
+
+void CompressedStringType::CreateFromParcel(StatementBlock* addTo, Variable* v,
+                                            Variable* parcel,
+                                            Variable**) const {
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(CompressedPayload(), "createString", 1, parcel)));
+}
+
+CompressedParcelableType::CompressedParcelableType(
+    const JavaTypeNamespace* types, const string& package, const string& name,
+    const string& declFile, int declLine)
+    : CompressedPayloadType(types, package, name,
+                            ValidatableType::KIND_PARCELABLE, true, declFile,
+                            declLine) {}
+
+string CompressedParcelableType::CreatorName() const {
+  return JavaType() + ".CREATOR";
+}
+
+void CompressedParcelableType::WriteToParcel(StatementBlock* addTo,
+                                             Variable* v, Variable* parcel,
+                                             int flags) const {
+  addTo->Add(New<MethodCall>(CompressedPayload(), "writeParcelable", 3, parcel,
+                             v, BuildWriteToParcelFlags(flags)));
+}
+
+void CompressedParcelableType::CreateFromParcel(StatementBlock* addTo,
+                                                Variable* v, Variable* parcel,
+                                                Variable**) const {
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(CompressedPayload(), "createParcelable", 2, parcel,
+                         New<LiteralExpression>(CreatorName()))));
+}
+
+void CompressedParcelableType::ReadFromParcel(StatementBlock* addTo,
+                                              Variable* v, Variable* parcel,
+                                              Variable**) const {
+  // android.os.Parcel v_flattened = CompressedPayload.unmarshall(parcel);
+  // if (v_flattened != null) {
+  //     v.readFromParcel(v_flattened);
+  //     v_flattened.recycle();
+  // }
+  Variable* flattened =
+      New<Variable>(m_types->ParcelType(), v->name + "_flattened");
+  addTo->Add(New<VariableDeclaration>(
+      flattened, New<MethodCall>(CompressedPayload(), "unmarshall", 1,
+                                 parcel)));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(flattened, "!=", NULL_VALUE);
+  ifpart->statements->Add(New<MethodCall>(v, "readFromParcel", 1, flattened));
+  ifpart->statements->Add(New<MethodCall>(flattened, "recycle"));
+  addTo->Add(ifpart);
 }
 
 // ================================================================
@@ -154,12 +300,12 @@ FileDescriptorType::FileDescriptorType(const JavaTypeNamespace* types)
 
 void FileDescriptorType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                        Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeRawFileDescriptor", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeRawFileDescriptor", 1, v));
 }
 
 void FileDescriptorType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                           Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "readRawFileDescriptor")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "readRawFileDescriptor")));
 }
 
 FileDescriptorArrayType::FileDescriptorArrayType(const JavaTypeNamespace* types)
@@ -168,17 +314,17 @@ FileDescriptorArrayType::FileDescriptorArrayType(const JavaTypeNamespace* types)
 
 void FileDescriptorArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                             Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeRawFileDescriptorArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeRawFileDescriptorArray", 1, v));
 }
 
 void FileDescriptorArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                                Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "createRawFileDescriptorArray")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "createRawFileDescriptorArray")));
 }
 
 void FileDescriptorArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                              Variable* parcel, Variable**) const {
-  addTo->Add(new MethodCall(parcel, "readRawFileDescriptorArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "readRawFileDescriptorArray", 1, v));
 }
 
 // ================================================================
@@ -190,34 +336,37 @@ BooleanType::BooleanType(const JavaTypeNamespace* types)
 
 void BooleanType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                 Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(
+  addTo->Add(New<MethodCall>(
       parcel, "writeInt", 1,
-      new Ternary(v, new LiteralExpression("1"), new LiteralExpression("0"))));
+      New<Ternary>(v, New<LiteralExpression>("1"),
+                   New<LiteralExpression>("0"))));
 }
 
 void BooleanType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                    Variable* parcel, Variable**) const {
   addTo->Add(
-      new Assignment(v, new Comparison(new LiteralExpression("0"), "!=",
-                                       new MethodCall(parcel, "readInt"))));
+      New<Assignment>(v, New<Comparison>(New<LiteralExpression>("0"), "!=",
+                                         New<MethodCall>(parcel, "readInt"))));
 }
 
 BooleanArrayType::BooleanArrayType(const JavaTypeNamespace* types)
-    : Type(types, "boolean", ValidatableType::KIND_BUILT_IN, true, true) {}
+    : Type(types, "boolean", ValidatableType::KIND_BUILT_IN, true, true) {
+  m_packed_type.reset(new PackedArrayType(types, "boolean"));
+}
 
 void BooleanArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                      Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeBooleanArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeBooleanArray", 1, v));
 }
 
 void BooleanArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                         Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "createBooleanArray")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "createBooleanArray")));
 }
 
 void BooleanArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                       Variable* parcel, Variable**) const {
-  addTo->Add(new MethodCall(parcel, "readBooleanArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "readBooleanArray", 1, v));
 }
 
 // ================================================================
@@ -230,30 +379,32 @@ CharType::CharType(const JavaTypeNamespace* types)
 void CharType::WriteToParcel(StatementBlock* addTo, Variable* v,
                              Variable* parcel, int flags) const {
   addTo->Add(
-      new MethodCall(parcel, "writeInt", 1, new Cast(m_types->IntType(), v)));
+      New<MethodCall>(parcel, "writeInt", 1, New<Cast>(m_types->IntType(), v)));
 }
 
 void CharType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                 Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "readInt"), this));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "readInt"), this));
 }
 
 CharArrayType::CharArrayType(const JavaTypeNamespace* types)
-    : Type(types, "char", ValidatableType::KIND_BUILT_IN, true, true) {}
+    : Type(types, "char", ValidatableType::KIND_BUILT_IN, true, true) {
+  m_packed_type.reset(new PackedArrayType(types, "char"));
+}
 
 void CharArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                   Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeCharArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeCharArray", 1, v));
 }
 
 void CharArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                      Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "createCharArray")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "createCharArray")));
 }
 
 void CharArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                    Variable* parcel, Variable**) const {
-  addTo->Add(new MethodCall(parcel, "readCharArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "readCharArray", 1, v));
 }
 
 // ================================================================
@@ -264,6 +415,7 @@ StringType::StringType(const JavaTypeNamespace* types,
     : Type(types, package, class_name,
            ValidatableType::KIND_BUILT_IN, true, false) {
   m_array_type.reset(new StringArrayType(types));
+  m_compressed_type.reset(new CompressedStringType(types));
 }
 
 string StringType::CreatorName() const {
@@ -272,12 +424,12 @@ string StringType::CreatorName() const {
 
 void StringType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeString", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeString", 1, v));
 }
 
 void StringType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                   Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "readString")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "readString")));
 }
 
 StringArrayType::StringArrayType(const JavaTypeNamespace* types)
@@ -290,17 +442,17 @@ string StringArrayType::CreatorName() const {
 
 void StringArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                     Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeStringArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeStringArray", 1, v));
 }
 
 void StringArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                        Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "createStringArray")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "createStringArray")));
 }
 
 void StringArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                      Variable* parcel, Variable**) const {
-  addTo->Add(new MethodCall(parcel, "readStringArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "readStringArray", 1, v));
 }
 
 // ================================================================
@@ -321,17 +473,17 @@ void CharSequenceType::WriteToParcel(StatementBlock* addTo, Variable* v,
   // } else {
   //     parcel.writeInt(0);
   // }
-  IfStatement* elsepart = new IfStatement();
+  IfStatement* elsepart = New<IfStatement>();
   elsepart->statements->Add(
-      new MethodCall(parcel, "writeInt", 1, new LiteralExpression("0")));
-  IfStatement* ifpart = new IfStatement;
-  ifpart->expression = new Comparison(v, "!=", NULL_VALUE);
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("0")));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(v, "!=", NULL_VALUE);
   ifpart->elseif = elsepart;
   ifpart->statements->Add(
-      new MethodCall(parcel, "writeInt", 1, new LiteralExpression("1")));
-  ifpart->statements->Add(new MethodCall(m_types->TextUtilsType(),
-                                         "writeToParcel", 3, v, parcel,
-                                         BuildWriteToParcelFlags(flags)));
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("1")));
+  ifpart->statements->Add(New<MethodCall>(m_types->TextUtilsType(),
+                                          "writeToParcel", 3, v, parcel,
+                                          BuildWriteToParcelFlags(flags)));
 
   addTo->Add(ifpart);
 }
@@ -343,16 +495,16 @@ void CharSequenceType::CreateFromParcel(StatementBlock* addTo, Variable* v,
   // } else {
   //     v = null;
   // }
-  IfStatement* elsepart = new IfStatement();
-  elsepart->statements->Add(new Assignment(v, NULL_VALUE));
+  IfStatement* elsepart = New<IfStatement>();
+  elsepart->statements->Add(New<Assignment>(v, NULL_VALUE));
 
-  IfStatement* ifpart = new IfStatement();
-  ifpart->expression = new Comparison(new LiteralExpression("0"), "!=",
-                                      new MethodCall(parcel, "readInt"));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(New<LiteralExpression>("0"), "!=",
+                                       New<MethodCall>(parcel, "readInt"));
   ifpart->elseif = elsepart;
-  ifpart->statements->Add(new Assignment(
-      v, new MethodCall(m_types->TextUtilsType(),
-                        "CHAR_SEQUENCE_CREATOR.createFromParcel", 1, parcel)));
+  ifpart->statements->Add(New<Assignment>(
+      v, New<MethodCall>(m_types->TextUtilsType(),
+                         "CHAR_SEQUENCE_CREATOR.createFromParcel", 1, parcel)));
 
   addTo->Add(ifpart);
 }
@@ -400,12 +552,12 @@ IBinderType::IBinderType(const JavaTypeNamespace* types)
 
 void IBinderType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                 Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeStrongBinder", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeStrongBinder", 1, v));
 }
 
 void IBinderType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                    Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "readStrongBinder")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "readStrongBinder")));
 }
 
 IBinderArrayType::IBinderArrayType(const JavaTypeNamespace* types)
@@ -414,17 +566,17 @@ IBinderArrayType::IBinderArrayType(const JavaTypeNamespace* types)
 
 void IBinderArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                      Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeBinderArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeBinderArray", 1, v));
 }
 
 void IBinderArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                         Variable* parcel, Variable**) const {
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "createBinderArray")));
+  addTo->Add(New<Assignment>(v, New<MethodCall>(parcel, "createBinderArray")));
 }
 
 void IBinderArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                       Variable* parcel, Variable**) const {
-  addTo->Add(new MethodCall(parcel, "readBinderArray", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "readBinderArray", 1, v));
 }
 
 // ================================================================
@@ -516,31 +668,29 @@ MapType::MapType(const JavaTypeNamespace* types)
 
 void MapType::WriteToParcel(StatementBlock* addTo, Variable* v,
                             Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeMap", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeMap", 1, v));
 }
 
-static void EnsureClassLoader(StatementBlock* addTo, Variable** cl,
-                              const JavaTypeNamespace* types) {
-  // We don't want to look up the class loader once for every
-  // collection argument, so ensure we do it at most once per method.
+static void EnsureClassLoader(Variable** cl, const JavaTypeNamespace* types) {
+  // Looking the class loader up is reflective, so the generated class does it
+  // once and caches it in a field.  We only create the variable here; the
+  // caller binds it to that field (see generate_java_binder.cpp).
   if (*cl == NULL) {
-    *cl = new Variable(types->ClassLoaderType(), "cl");
-    addTo->Add(new VariableDeclaration(
-        *cl, new LiteralExpression("this.getClass().getClassLoader()"),
-        types->ClassLoaderType()));
+    *cl = New<Variable>(types->ClassLoaderType(), "cl");
   }
 }
 
 void MapType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                Variable* parcel, Variable** cl) const {
-  EnsureClassLoader(addTo, cl, m_types);
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "readHashMap", 1, *cl)));
+  EnsureClassLoader(cl, m_types);
+  addTo->Add(
+      New<Assignment>(v, New<MethodCall>(parcel, "readHashMap", 1, *cl)));
 }
 
 void MapType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                              Variable* parcel, Variable** cl) const {
-  EnsureClassLoader(addTo, cl, m_types);
-  addTo->Add(new MethodCall(parcel, "readMap", 2, v, *cl));
+  EnsureClassLoader(cl, m_types);
+  addTo->Add(New<MethodCall>(parcel, "readMap", 2, v, *cl));
 }
 
 // ================================================================
@@ -553,20 +703,20 @@ string ListType::InstantiableName() const { return "java.util.ArrayList"; }
 
 void ListType::WriteToParcel(StatementBlock* addTo, Variable* v,
                              Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeList", 1, v));
+  addTo->Add(New<MethodCall>(parcel, "writeList", 1, v));
 }
 
 void ListType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                 Variable* parcel, Variable** cl) const {
-  EnsureClassLoader(addTo, cl, m_types);
+  EnsureClassLoader(cl, m_types);
   addTo->Add(
-      new Assignment(v, new MethodCall(parcel, "readArrayList", 1, *cl)));
+      New<Assignment>(v, New<MethodCall>(parcel, "readArrayList", 1, *cl)));
 }
 
 void ListType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                               Variable* parcel, Variable** cl) const {
-  EnsureClassLoader(addTo, cl, m_types);
-  addTo->Add(new MethodCall(parcel, "readList", 2, v, *cl));
+  EnsureClassLoader(cl, m_types);
+  addTo->Add(New<MethodCall>(parcel, "readList", 2, v, *cl));
 }
 
 // ================================================================
@@ -582,6 +732,10 @@ UserDataType::UserDataType(const JavaTypeNamespace* types,
   m_array_type.reset(new UserDataArrayType(types, package, name, builtIn,
                                            canWriteToParcel, declFile,
                                            declLine));
+  if (!builtIn) {
+    m_compressed_type.reset(new CompressedParcelableType(
+        types, package, name, declFile, declLine));
+  }
 }
 
 string UserDataType::CreatorName() const {
@@ -596,16 +750,16 @@ void UserDataType::WriteToParcel(StatementBlock* addTo, Variable* v,
   // } else {
   //     parcel.writeInt(0);
   // }
-  IfStatement* elsepart = new IfStatement();
+  IfStatement* elsepart = New<IfStatement>();
   elsepart->statements->Add(
-      new MethodCall(parcel, "writeInt", 1, new LiteralExpression("0")));
-  IfStatement* ifpart = new IfStatement;
-  ifpart->expression = new Comparison(v, "!=", NULL_VALUE);
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("0")));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(v, "!=", NULL_VALUE);
   ifpart->elseif = elsepart;
   ifpart->statements->Add(
-      new MethodCall(parcel, "writeInt", 1, new LiteralExpression("1")));
-  ifpart->statements->Add(new MethodCall(v, "writeToParcel", 2, parcel,
-                                         BuildWriteToParcelFlags(flags)));
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("1")));
+  ifpart->statements->Add(New<MethodCall>(v, "writeToParcel", 2, parcel,
+                                          BuildWriteToParcelFlags(flags)));
 
   addTo->Add(ifpart);
 }
@@ -617,15 +771,15 @@ void UserDataType::CreateFromParcel(StatementBlock* addTo, Variable* v,
   // } else {
   //     v = null;
   // }
-  IfStatement* elsepart = new IfStatement();
-  elsepart->statements->Add(new Assignment(v, NULL_VALUE));
+  IfStatement* elsepart = New<IfStatement>();
+  elsepart->statements->Add(New<Assignment>(v, NULL_VALUE));
 
-  IfStatement* ifpart = new IfStatement();
-  ifpart->expression = new Comparison(new LiteralExpression("0"), "!=",
-                                      new MethodCall(parcel, "readInt"));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(New<LiteralExpression>("0"), "!=",
+                                       New<MethodCall>(parcel, "readInt"));
   ifpart->elseif = elsepart;
-  ifpart->statements->Add(new Assignment(
-      v, new MethodCall(v->type, "CREATOR.createFromParcel", 1, parcel)));
+  ifpart->statements->Add(New<Assignment>(
+      v, New<MethodCall>(v->type, "CREATOR.createFromParcel", 1, parcel)));
 
   addTo->Add(ifpart);
 }
@@ -637,10 +791,10 @@ void UserDataType::ReadFromParcel(StatementBlock* addTo, Variable* v,
   // if (0 != parcel.readInt()) {
   //     v.readFromParcel(parcel)
   // }
-  IfStatement* ifpart = new IfStatement();
-  ifpart->expression = new Comparison(new LiteralExpression("0"), "!=",
-                                      new MethodCall(parcel, "readInt"));
-  ifpart->statements->Add(new MethodCall(v, "readFromParcel", 1, parcel));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(New<LiteralExpression>("0"), "!=",
+                                       New<MethodCall>(parcel, "readInt"));
+  ifpart->statements->Add(New<MethodCall>(v, "readFromParcel", 1, parcel));
   addTo->Add(ifpart);
 }
 
@@ -659,22 +813,153 @@ string UserDataArrayType::CreatorName() const {
 
 void UserDataArrayType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                       Variable* parcel, int flags) const {
-  addTo->Add(new MethodCall(parcel, "writeTypedArray", 2, v,
-                            BuildWriteToParcelFlags(flags)));
+  addTo->Add(New<MethodCall>(parcel, "writeTypedArray", 2, v,
+                             BuildWriteToParcelFlags(flags)));
 }
 
 void UserDataArrayType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                          Variable* parcel, Variable**) const {
   string creator = v->type->JavaType() + ".CREATOR";
-  addTo->Add(new Assignment(v, new MethodCall(parcel, "createTypedArray", 1,
-                                              new LiteralExpression(creator))));
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(parcel, "createTypedArray", 1,
+                         New<LiteralExpression>(creator))));
 }
 
 void UserDataArrayType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                        Variable* parcel, Variable**) const {
   string creator = v->type->JavaType() + ".CREATOR";
-  addTo->Add(new MethodCall(parcel, "readTypedArray", 2, v,
-                            new LiteralExpression(creator)));
+  addTo->Add(New<MethodCall>(parcel, "readTypedArray", 2, v,
+                             New<LiteralExpression>(creator)));
+}
+
+// ================================================================
+
+FixedSizeParcelableType::FixedSizeParcelableType(
+    const JavaTypeNamespace* types, const string& package, const string& name,
+    size_t wire_size, const string& declFile, int declLine)
+    : Type(types, package, name, ValidatableType::KIND_PARCELABLE, true, true,
+           declFile, declLine),
+      m_wire_size(wire_size) {
+  m_array_type.reset(new FixedSizeParcelableArrayType(types, package, name,
+                                                      declFile, declLine));
+}
+
+string FixedSizeParcelableType::CreatorName() const {
+  return JavaType() + ".CREATOR";
+}
+
+void FixedSizeParcelableType::WriteToParcel(StatementBlock* addTo,
+                                            Variable* v, Variable* parcel,
+                                            int flags) const {
+  // v.writeToParcel(parcel, flags);
+  addTo->Add(New<MethodCall>(v, "writeToParcel", 2, parcel,
+                             BuildWriteToParcelFlags(flags)));
+}
+
+void FixedSizeParcelableType::CreateFromParcel(StatementBlock* addTo,
+                                               Variable* v, Variable* parcel,
+                                               Variable**) const {
+  // v = CLASS.CREATOR.createFromParcel(parcel);
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(v->type, "CREATOR.createFromParcel", 1, parcel)));
+}
+
+void FixedSizeParcelableType::ReadFromParcel(StatementBlock* addTo,
+                                             Variable* v, Variable* parcel,
+                                             Variable**) const {
+  // v.readFromParcel(parcel);
+  addTo->Add(New<MethodCall>(v, "readFromParcel", 1, parcel));
+}
+
+FixedSizeParcelableArrayType::FixedSizeParcelableArrayType(
+    const JavaTypeNamespace* types, const string& package, const string& name,
+    const string& declFile, int declLine)
+    : Type(types, package, name, ValidatableType::KIND_PARCELABLE, true, true,
+           declFile, declLine) {}
+
+string FixedSizeParcelableArrayType::CreatorName() const {
+  return JavaType() + ".CREATOR";
+}
+
+void FixedSizeParcelableArrayType::WriteToParcel(StatementBlock* addTo,
+                                                 Variable* v,
+                                                 Variable* parcel,
+                                                 int flags) const {
+  // if (v == null) {
+  //   parcel.writeInt(-1);
+  // } else {
+  //   parcel.writeInt(v.length);
+  //   for (CLASS v_item : v) {
+  //     v_item.writeToParcel(parcel, flags);
+  //   }
+  // }
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(v, "==", NULL_VALUE);
+  ifpart->statements->Add(
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("-1")));
+  IfStatement* elsepart = New<IfStatement>();
+  elsepart->statements->Add(New<MethodCall>(
+      parcel, "writeInt", 1, New<FieldVariable>(v, "length")));
+  ifpart->elseif = elsepart;
+  Variable* item = New<Variable>(this, v->name + "_item");
+  ForEachStatement* loop = New<ForEachStatement>(item, v);
+  loop->statements->Add(New<MethodCall>(item, "writeToParcel", 2, parcel,
+                                        BuildWriteToParcelFlags(flags)));
+  elsepart->statements->Add(loop);
+  addTo->Add(ifpart);
+}
+
+void FixedSizeParcelableArrayType::CreateFromParcel(StatementBlock* addTo,
+                                                    Variable* v,
+                                                    Variable* parcel,
+                                                    Variable**) const {
+  // int v_size = parcel.readInt();
+  // if (v_size < 0) {
+  //   v = null;
+  // } else {
+  //   v = new CLASS[v_size];
+  //   for (int v_i = 0; v_i < v_size; v_i++) {
+  //     v[v_i] = CLASS.CREATOR.createFromParcel(parcel);
+  //   }
+  // }
+  Variable* size = New<Variable>(m_types->IntType(), v->name + "_size");
+  addTo->Add(
+      New<VariableDeclaration>(size, New<MethodCall>(parcel, "readInt")));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(size, "<", New<LiteralExpression>("0"));
+  ifpart->statements->Add(New<Assignment>(v, NULL_VALUE));
+  IfStatement* elsepart = New<IfStatement>();
+  elsepart->statements->Add(
+      New<Assignment>(v, New<NewArrayExpression>(this, size)));
+  Variable* index = New<Variable>(m_types->IntType(), v->name + "_i");
+  ForStatement* loop = New<ForStatement>(index, size);
+  Variable* element =
+      New<Variable>(this, v->name + "[" + index->name + "]");
+  loop->statements->Add(New<Assignment>(
+      element, New<MethodCall>(this, "CREATOR.createFromParcel", 1, parcel)));
+  elsepart->statements->Add(loop);
+  ifpart->elseif = elsepart;
+  addTo->Add(ifpart);
+}
+
+void FixedSizeParcelableArrayType::ReadFromParcel(StatementBlock* addTo,
+                                                  Variable* v,
+                                                  Variable* parcel,
+                                                  Variable**) const {
+  // int v_size = parcel.readInt();
+  // for (int v_i = 0; v_i < v_size; v_i++) {
+  //   v[v_i] = CLASS.CREATOR.createFromParcel(parcel);
+  // }
+  Variable* size = New<Variable>(m_types->IntType(), v->name + "_size");
+  addTo->Add(
+      New<VariableDeclaration>(size, New<MethodCall>(parcel, "readInt")));
+  Variable* index = New<Variable>(m_types->IntType(), v->name + "_i");
+  ForStatement* loop = New<ForStatement>(index, size);
+  Variable* element =
+      New<Variable>(this, v->name + "[" + index->name + "]");
+  loop->statements->Add(New<Assignment>(
+      element, New<MethodCall>(this, "CREATOR.createFromParcel", 1, parcel)));
+  addTo->Add(loop);
 }
 
 // ================================================================
@@ -698,17 +983,18 @@ void InterfaceType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                   Variable* parcel, int flags) const {
   // parcel.writeStrongBinder(v != null ? v.asBinder() : null);
   addTo->Add(
-      new MethodCall(parcel, "writeStrongBinder", 1,
-                     new Ternary(new Comparison(v, "!=", NULL_VALUE),
-                                 new MethodCall(v, "asBinder"), NULL_VALUE)));
+      New<MethodCall>(parcel, "writeStrongBinder", 1,
+                      New<Ternary>(New<Comparison>(v, "!=", NULL_VALUE),
+                                   New<MethodCall>(v, "asBinder"),
+                                   NULL_VALUE)));
 }
 
 void InterfaceType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                      Variable* parcel, Variable**) const {
   // v = Interface.asInterface(parcel.readStrongBinder());
-  addTo->Add(new Assignment(
-      v, new MethodCall(stub_, "asInterface", 1,
-                        new MethodCall(parcel, "readStrongBinder"))));
+  addTo->Add(New<Assignment>(
+      v, New<MethodCall>(stub_, "asInterface", 1,
+                         New<MethodCall>(parcel, "readStrongBinder"))));
 }
 
 // ================================================================
@@ -718,57 +1004,276 @@ GenericListType::GenericListType(const JavaTypeNamespace* types,
     : Type(types, "java.util", "List<" + contained_type->CanonicalName() + ">",
            ValidatableType::KIND_BUILT_IN, true, true),
       m_contained_type(contained_type),
-      m_creator(contained_type->CreatorName()) {}
+      m_creator(contained_type->CreatorName()) {
+  const string boxed = BoxedJavaType(contained_type);
+  if (!boxed.empty()) {
+    m_boxed_type.reset(new Type(types, boxed, ValidatableType::KIND_BUILT_IN,
+                                false, false));
+  }
+}
+
+string GenericListType::BoxedJavaType(const Type* type) {
+  // byte is left out on purpose: byte[] is written packed, so a List<Byte>
+  // couldn't share its wire format.
+  static const char* const kBoxedTypes[][2] = {
+      {"boolean", "java.lang.Boolean"}, {"char", "java.lang.Character"},
+      {"int", "java.lang.Integer"},     {"long", "java.lang.Long"},
+      {"float", "java.lang.Float"},     {"double", "java.lang.Double"},
+  };
+  for (const auto& boxed : kBoxedTypes) {
+    if (type->Kind() == ValidatableType::KIND_BUILT_IN &&
+        type->CanonicalName() == boxed[0]) {
+      return boxed[1];
+    }
+  }
+  return "";
+}
 
 string GenericListType::CreatorName() const {
   return "android.os.Parcel.arrayListCreator";
 }
 
 string GenericListType::InstantiableName() const {
-  return "java.util.ArrayList<" + m_contained_type->JavaType() + ">";
+  return "java.util.ArrayList<" + ElementJavaType() + ">";
+}
+
+string GenericListType::ElementJavaType() const {
+  return m_boxed_type ? m_boxed_type->JavaType()
+                      : m_contained_type->JavaType();
 }
 
 void GenericListType::WriteToParcel(StatementBlock* addTo, Variable* v,
                                     Variable* parcel, int flags) const {
-  if (m_creator == m_types->StringType()->CreatorName()) {
-    addTo->Add(new MethodCall(parcel, "writeStringList", 1, v));
+  if (m_boxed_type) {
+    // if (v == null) {
+    //   parcel.writeInt(-1);
+    // } else {
+    //   parcel.writeInt(v.size());
+    //   for (Integer v_item : v) {
+    //     parcel.writeInt(v_item);
+    //   }
+    // }
+    IfStatement* ifpart = New<IfStatement>();
+    ifpart->expression = New<Comparison>(v, "==", NULL_VALUE);
+    ifpart->statements->Add(
+        New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("-1")));
+    IfStatement* elsepart = New<IfStatement>();
+    elsepart->statements->Add(
+        New<MethodCall>(parcel, "writeInt", 1, New<MethodCall>(v, "size")));
+    ifpart->elseif = elsepart;
+    Variable* item = New<Variable>(m_boxed_type.get(), v->name + "_item");
+    ForEachStatement* loop = New<ForEachStatement>(item, v);
+    m_contained_type->WriteToParcel(loop->statements, item, parcel, flags);
+    elsepart->statements->Add(loop);
+    addTo->Add(ifpart);
+  } else if (m_creator == m_types->StringType()->CreatorName()) {
+    addTo->Add(New<MethodCall>(parcel, "writeStringList", 1, v));
   } else if (m_creator == m_types->IBinderType()->CreatorName()) {
-    addTo->Add(new MethodCall(parcel, "writeBinderList", 1, v));
+    addTo->Add(New<MethodCall>(parcel, "writeBinderList", 1, v));
   } else {
     // parcel.writeTypedListXX(arg);
-    addTo->Add(new MethodCall(parcel, "writeTypedList", 1, v));
+    addTo->Add(New<MethodCall>(parcel, "writeTypedList", 1, v));
   }
 }
 
 void GenericListType::CreateFromParcel(StatementBlock* addTo, Variable* v,
                                        Variable* parcel, Variable**) const {
-  if (m_creator == m_types->StringType()->CreatorName()) {
+  if (m_boxed_type) {
+    // int v_size = parcel.readInt();
+    // if (v_size < 0) {
+    //   v = null;
+    // } else {
+    //   v = new ArrayList<Integer>(v_size);
+    //   ...read v_size elements into v...
+    // }
+    Variable* size = New<Variable>(m_types->IntType(), v->name + "_size");
+    addTo->Add(
+        New<VariableDeclaration>(size, New<MethodCall>(parcel, "readInt")));
+    IfStatement* ifpart = New<IfStatement>();
+    ifpart->expression =
+        New<Comparison>(size, "<", New<LiteralExpression>("0"));
+    ifpart->statements->Add(New<Assignment>(v, NULL_VALUE));
+    IfStatement* elsepart = New<IfStatement>();
+    elsepart->statements->Add(
+        New<Assignment>(v, New<NewExpression>(this, 1, size)));
+    ReadElements(elsepart->statements, v, parcel, size);
+    ifpart->elseif = elsepart;
+    addTo->Add(ifpart);
+  } else if (m_creator == m_types->StringType()->CreatorName()) {
     addTo->Add(
-        new Assignment(v, new MethodCall(parcel, "createStringArrayList", 0)));
+        New<Assignment>(v,
+                        New<MethodCall>(parcel, "createStringArrayList", 0)));
   } else if (m_creator == m_types->IBinderType()->CreatorName()) {
     addTo->Add(
-        new Assignment(v, new MethodCall(parcel, "createBinderArrayList", 0)));
+        New<Assignment>(v,
+                        New<MethodCall>(parcel, "createBinderArrayList", 0)));
   } else {
     // v = _data.readTypedArrayList(XXX.creator);
     addTo->Add(
-        new Assignment(v, new MethodCall(parcel, "createTypedArrayList", 1,
-                                         new LiteralExpression(m_creator))));
+        New<Assignment>(v, New<MethodCall>(parcel, "createTypedArrayList", 1,
+                                           New<LiteralExpression>(m_creator))));
   }
 }
 
 void GenericListType::ReadFromParcel(StatementBlock* addTo, Variable* v,
                                      Variable* parcel, Variable**) const {
-  if (m_creator == m_types->StringType()->CreatorName()) {
-    addTo->Add(new MethodCall(parcel, "readStringList", 1, v));
+  if (m_boxed_type) {
+    // v.clear();
+    // int v_size = parcel.readInt();
+    // ...read v_size elements into v...
+    addTo->Add(New<MethodCall>(v, "clear"));
+    Variable* size = New<Variable>(m_types->IntType(), v->name + "_size");
+    addTo->Add(
+        New<VariableDeclaration>(size, New<MethodCall>(parcel, "readInt")));
+    ReadElements(addTo, v, parcel, size);
+  } else if (m_creator == m_types->StringType()->CreatorName()) {
+    addTo->Add(New<MethodCall>(parcel, "readStringList", 1, v));
   } else if (m_creator == m_types->IBinderType()->CreatorName()) {
-    addTo->Add(new MethodCall(parcel, "readBinderList", 1, v));
+    addTo->Add(New<MethodCall>(parcel, "readBinderList", 1, v));
   } else {
     // v = _data.readTypedList(v, XXX.creator);
-    addTo->Add(new MethodCall(parcel, "readTypedList", 2, v,
-                              new LiteralExpression(m_creator)));
+    addTo->Add(New<MethodCall>(parcel, "readTypedList", 2, v,
+                               New<LiteralExpression>(m_creator)));
   }
 }
 
+void GenericListType::ReadElements(StatementBlock* addTo, Variable* v,
+                                   Variable* parcel, Variable* size) const {
+  // for (int v_i = 0; v_i < v_size; v_i++) {
+  //   Integer v_item;
+  //   v_item = parcel.readInt();
+  //   v.add(v_item);
+  // }
+  Variable* index = New<Variable>(m_types->IntType(), v->name + "_i");
+  ForStatement* loop = New<ForStatement>(index, size);
+  Variable* item = New<Variable>(m_boxed_type.get(), v->name + "_item");
+  loop->statements->Add(New<VariableDeclaration>(item));
+  m_contained_type->CreateFromParcel(loop->statements, item, parcel, nullptr);
+  loop->statements->Add(New<MethodCall>(v, "add", 1, item));
+  addTo->Add(loop);
+}
+
+// ================================================================
+
+GenericMapType::GenericMapType(const JavaTypeNamespace* types,
+                               const Type* key_type, const Type* value_type)
+    : Type(types, "java.util",
+           "Map<" + key_type->CanonicalName() + "," +
+               value_type->CanonicalName() + ">",
+           ValidatableType::KIND_BUILT_IN, true, true),
+      m_key_type(key_type),
+      m_value_type(value_type),
+      m_entry_type(new Type(types, "java.util.Map.Entry<" +
+                                       key_type->JavaType() + ", " +
+                                       value_type->JavaType() + ">",
+                            ValidatableType::KIND_BUILT_IN, false, false)) {}
+
+string GenericMapType::InstantiableName() const {
+  return "java.util.HashMap<" + m_key_type->JavaType() + ", " +
+         m_value_type->JavaType() + ">";
+}
+
+string GenericMapType::JavaType() const {
+  return "java.util.Map<" + m_key_type->JavaType() + ", " +
+         m_value_type->JavaType() + ">";
+}
+
+void GenericMapType::WriteToParcel(StatementBlock* addTo, Variable* v,
+                                   Variable* parcel, int flags) const {
+  // if (v == null) {
+  //   parcel.writeInt(-1);
+  // } else {
+  //   parcel.writeInt(v.size());
+  //   for (Map.Entry<K, V> v_entry : v.entrySet()) {
+  //     K v_key = v_entry.getKey();
+  //     ...write v_key...
+  //     V v_value = v_entry.getValue();
+  //     ...write v_value...
+  //   }
+  // }
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression = New<Comparison>(v, "==", NULL_VALUE);
+  ifpart->statements->Add(
+      New<MethodCall>(parcel, "writeInt", 1, New<LiteralExpression>("-1")));
+  IfStatement* elsepart = New<IfStatement>();
+  elsepart->statements->Add(
+      New<MethodCall>(parcel, "writeInt", 1, New<MethodCall>(v, "size")));
+  ifpart->elseif = elsepart;
+
+  Variable* entry = New<Variable>(m_entry_type.get(), v->name + "_entry");
+  ForEachStatement* loop =
+      New<ForEachStatement>(entry, New<MethodCall>(v, "entrySet"));
+  Variable* key = New<Variable>(m_key_type, v->name + "_key");
+  loop->statements->Add(
+      New<VariableDeclaration>(key, New<MethodCall>(entry, "getKey")));
+  m_key_type->WriteToParcel(loop->statements, key, parcel, flags);
+  Variable* value = New<Variable>(m_value_type, v->name + "_value");
+  loop->statements->Add(
+      New<VariableDeclaration>(value, New<MethodCall>(entry, "getValue")));
+  m_value_type->WriteToParcel(loop->statements, value, parcel, flags);
+  elsepart->statements->Add(loop);
+
+  addTo->Add(ifpart);
+}
+
+void GenericMapType::CreateFromParcel(StatementBlock* addTo, Variable* v,
+                                      Variable* parcel, Variable** cl) const {
+  // int v_size = parcel.readInt();
+  // if (v_size < 0) {
+  //   v = null;
+  // } else {
+  //   v = new HashMap<K, V>(v_size);
+  //   ...read v_size entries into v...
+  // }
+  Variable* size = New<Variable>(m_types->IntType(), v->name + "_size");
+  addTo->Add(
+      New<VariableDeclaration>(size, New<MethodCall>(parcel, "readInt")));
+  IfStatement* ifpart = New<IfStatement>();
+  ifpart->expression =
+      New<Comparison>(size, "<", New<LiteralExpression>("0"));
+  ifpart->statements->Add(New<Assignment>(v, NULL_VALUE));
+  IfStatement* elsepart = New<IfStatement>();
+  elsepart->statements->Add(New<Assignment>(v, New<NewExpression>(this, 1,
+                                                                   size)));
+  ReadEntries(elsepart->statements, v, parcel, size, cl);
+  ifpart->elseif = elsepart;
+  addTo->Add(ifpart);
+}
+
+void GenericMapType::ReadFromParcel(StatementBlock* addTo, Variable* v,
+                                    Variable* parcel, Variable** cl) const {
+  // v.clear();
+  // int v_size = parcel.readInt();
+  // ...read v_size entries into v...
+  addTo->Add(New<MethodCall>(v, "clear"));
+  Variable* size = New<Variable>(m_types->IntType(), v->name + "_size");
+  addTo->Add(
+      New<VariableDeclaration>(size, New<MethodCall>(parcel, "readInt")));
+  ReadEntries(addTo, v, parcel, size, cl);
+}
+
+void GenericMapType::ReadEntries(StatementBlock* addTo, Variable* v,
+                                 Variable* parcel, Variable* size,
+                                 Variable** cl) const {
+  // for (int v_i = 0; v_i < v_size; v_i++) {
+  //   K v_key;
+  //   ...read v_key...
+  //   V v_value;
+  //   ...read v_value...
+  //   v.put(v_key, v_value);
+  // }
+  Variable* index = New<Variable>(m_types->IntType(), v->name + "_i");
+  ForStatement* loop = New<ForStatement>(index, size);
+  Variable* key = New<Variable>(m_key_type, v->name + "_key");
+  loop->statements->Add(New<VariableDeclaration>(key));
+  m_key_type->CreateFromParcel(loop->statements, key, parcel, cl);
+  Variable* value = New<Variable>(m_value_type, v->name + "_value");
+  loop->statements->Add(New<VariableDeclaration>(value));
+  m_value_type->CreateFromParcel(loop->statements, value, parcel, cl);
+  loop->statements->Add(New<MethodCall>(v, "put", 2, key, value));
+  addTo->Add(loop);
+}
+
 // ================================================================
 
 ClassLoaderType::ClassLoaderType(const JavaTypeNamespace* types)
@@ -778,7 +1283,8 @@ ClassLoaderType::ClassLoaderType(const JavaTypeNamespace* types)
 // ================================================================
 
 void JavaTypeNamespace::Init() {
-  Add(new BasicType(this, "void", "XXX", "XXX", "XXX", "XXX", "XXX"));
+  m_void_type = new BasicType(this, "void", "XXX", "XXX", "XXX", "XXX", "XXX");
+  Add(m_void_type);
 
   m_bool_type = new BooleanType(this);
   Add(m_bool_type);
@@ -807,8 +1313,9 @@ void JavaTypeNamespace::Init() {
   Add(new class StringType(this, ::android::aidl::kAidlReservedTypePackage,
                            ::android::aidl::kUtf8InCppStringClass));
 
-  Add(new Type(this, "java.lang", "Object", ValidatableType::KIND_BUILT_IN,
-               false, false));
+  m_object_type = new Type(this, "java.lang", "Object",
+                           ValidatableType::KIND_BUILT_IN, false, false);
+  Add(m_object_type);
 
   Add(new FileDescriptorType(this));
 
@@ -847,6 +1354,11 @@ void JavaTypeNamespace::Init() {
   m_parcelable_interface_type = new class ParcelableInterfaceType(this);
   Add(m_parcelable_interface_type);
 
+  m_parcelable_creator_type =
+      new class Type(this, "android.os", "Parcelable.Creator",
+                     ValidatableType::KIND_BUILT_IN, false, false);
+  Add(m_parcelable_creator_type);
+
   m_context_type = new class Type(this, "android.content", "Context",
                                   ValidatableType::KIND_BUILT_IN, false, false);
   Add(m_context_type);
@@ -854,15 +1366,25 @@ void JavaTypeNamespace::Init() {
   m_classloader_type = new class ClassLoaderType(this);
   Add(m_classloader_type);
 
-  NULL_VALUE = new LiteralExpression("null");
-  THIS_VALUE = new LiteralExpression("this");
-  SUPER_VALUE = new LiteralExpression("super");
-  TRUE_VALUE = new LiteralExpression("true");
-  FALSE_VALUE = new LiteralExpression("false");
+  // These are shared by every generated document, so they live outside of
+  // any AstArena and are only created once.
+  if (NULL_VALUE == nullptr) {
+    NULL_VALUE = new LiteralExpression("null");
+    THIS_VALUE = new LiteralExpression("this");
+    SUPER_VALUE = new LiteralExpression("super");
+    TRUE_VALUE = new LiteralExpression("true");
+    FALSE_VALUE = new LiteralExpression("false");
+  }
 }
 
 bool JavaTypeNamespace::AddParcelableType(const AidlParcelable& p,
                                           const std::string& filename) {
+  const AidlStructuredParcelable* structured = p.AsStructuredParcelable();
+  if (structured && structured->IsFixedSize()) {
+    return Add(new FixedSizeParcelableType(this, p.GetPackage(), p.GetName(),
+                                           GetFixedWireSize(*structured),
+                                           filename, p.GetLine()));
+  }
   Type* type =
       new UserDataType(this, p.GetPackage(), p.GetName(), false,
                        true, filename, p.GetLine());
@@ -901,14 +1423,39 @@ bool JavaTypeNamespace::AddListType(const std::string& contained_type_name) {
   if (!contained_type) {
     return false;
   }
+  // Java generics can't hold primitives, so those are boxed; see
+  // GenericListType::BoxedJavaType.
+  bool is_primitive =
+      contained_type->Kind() == ValidatableType::KIND_BUILT_IN &&
+      contained_type->ShortName() == contained_type->CanonicalName();
+  if (is_primitive && GenericListType::BoxedJavaType(contained_type).empty()) {
+    LOG(ERROR) << "List<T> cannot contain " << contained_type->CanonicalName();
+    return false;
+  }
   Add(new GenericListType(this, contained_type));
   return true;
 }
 
 bool JavaTypeNamespace::AddMapType(const string& key_type_name,
                                    const string& value_type_name) {
-  LOG(ERROR) << "Don't know how to create a Map<K,V> container.";
-  return false;
+  const Type* key_type = FindTypeByCanonicalName(key_type_name);
+  const Type* value_type = FindTypeByCanonicalName(value_type_name);
+  if (!key_type || !value_type) {
+    return false;
+  }
+  // Java generics can't hold primitives (the only built in types without a
+  // package), and we need to be able to marshal each entry.
+  const Type* contained_types[] = {key_type, value_type};
+  for (const Type* type : contained_types) {
+    bool is_primitive = type->Kind() == ValidatableType::KIND_BUILT_IN &&
+                        type->ShortName() == type->CanonicalName();
+    if (is_primitive || !type->CanWriteToParcel()) {
+      LOG(ERROR) << "Map<K,V> cannot contain " << type->CanonicalName();
+      return false;
+    }
+  }
+  Add(new GenericMapType(this, key_type, value_type));
+  return true;
 }
 
 }  // namespace java
@@ -31,8 +31,12 @@ class JavaTypeNamespace;
 
 class Type : public ValidatableType {
  public:
-  // WriteToParcel flags
-  enum { PARCELABLE_WRITE_RETURN_VALUE = 0x0001 };
+  // WriteToParcel flags.  PARCELABLE_WRITE_CALLER_FLAGS passes on the flags
+  // of the writeToParcel() being generated, named kWriteToParcelFlags.
+  enum {
+    PARCELABLE_WRITE_RETURN_VALUE = 0x0001,
+    PARCELABLE_WRITE_CALLER_FLAGS = 0x0002,
+  };
 
   Type(const JavaTypeNamespace* types, const std::string& name, int kind,
        bool canWriteToParcel, bool canBeOut);
@@ -46,6 +50,12 @@ class Type : public ValidatableType {
 
   const ValidatableType* ArrayType() const override { return m_array_type.get(); }
   const ValidatableType* NullableType() const override { return nullptr; }
+  const ValidatableType* PackedType() const override {
+    return m_packed_type.get();
+  }
+  const ValidatableType* CompressedType() const override {
+    return m_compressed_type.get();
+  }
 
   virtual std::string JavaType() const { return m_javaType; }
   virtual std::string CreatorName() const;
@@ -64,6 +74,8 @@ class Type : public ValidatableType {
   const JavaTypeNamespace* m_types;
 
   std::unique_ptr<Type> m_array_type;
+  std::unique_ptr<Type> m_packed_type;
+  std::unique_ptr<Type> m_compressed_type;
 
  private:
   Type();
@@ -96,6 +108,87 @@ class BasicArrayType : public Type {
   std::string m_readArrayParcel;
 };
 
+// A @packed boolean[], char[], int[] or long[].  The element count is
+// followed by a byte array of bits or varints, in the format described in
+// include/aidl/packed_arrays.h.  Generated code calls the runtime class
+// java/android/aidl/PackedArrays.java to marshal them.
+class PackedArrayType : public Type {
+ public:
+  PackedArrayType(const JavaTypeNamespace* types, const std::string& name);
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+  void ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                      Variable** cl) const override;
+  const ValidatableType* NullableType() const override { return this; }
+
+ private:
+  // android.aidl.PackedArrays, on which the marshalling methods are called.
+  Expression* PackedArrays() const;
+
+  // e.g. "Int" in PackedArrays.writeIntArray().
+  std::string m_helperSuffix;
+};
+
+// A @compressed byte[], String or parcelable, in the format described in
+// include/aidl/compressed_payload.h.  Marshalled by
+// android.aidl.CompressedPayload, in java/.
+class CompressedPayloadType : public Type {
+ public:
+  CompressedPayloadType(const JavaTypeNamespace* types,
+                        const std::string& package, const std::string& name,
+                        int kind, bool canBeOut,
+                        const std::string& declFile = "", int declLine = -1);
+
+  const ValidatableType* NullableType() const override { return this; }
+
+ protected:
+  // android.aidl.CompressedPayload, on which the marshalling methods are
+  // called.
+  Expression* CompressedPayload() const;
+};
+
+class CompressedByteArrayType : public CompressedPayloadType {
+ public:
+  explicit CompressedByteArrayType(const JavaTypeNamespace* types);
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+  void ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                      Variable** cl) const override;
+};
+
+class CompressedStringType : public CompressedPayloadType {
+ public:
+  explicit CompressedStringType(const JavaTypeNamespace* types);
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+};
+
+class CompressedParcelableType : public CompressedPayloadType {
+ public:
+  CompressedParcelableType(const JavaTypeNamespace* types,
+                           const std::string& package,
+                           const std::string& name,
+                           const std::string& declFile, int declLine);
+
+  std::string CreatorName() const override;
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+  void ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                      Variable** cl) const override;
+};
+
 class BasicType : public Type {
  public:
   BasicType(const JavaTypeNamespace* types, const std::string& name,
@@ -383,6 +476,48 @@ class UserDataType : public Type {
   const ValidatableType* NullableType() const override { return this; }
 };
 
+// @FixedSize parcelables are never null, so unlike UserDataType they are
+// written without a null marker, and arrays of them are a count followed by
+// the elements back to back.  This matches the memory layout the C++ side
+// copies in and out of the parcel in one piece.
+class FixedSizeParcelableArrayType : public Type {
+ public:
+  FixedSizeParcelableArrayType(const JavaTypeNamespace* types,
+                               const std::string& package,
+                               const std::string& name,
+                               const std::string& declFile, int declLine);
+
+  std::string CreatorName() const override;
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+  void ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                      Variable** cl) const override;
+};
+
+class FixedSizeParcelableType : public Type {
+ public:
+  FixedSizeParcelableType(const JavaTypeNamespace* types,
+                          const std::string& package, const std::string& name,
+                          size_t wire_size, const std::string& declFile,
+                          int declLine);
+
+  std::string CreatorName() const override;
+  size_t FixedWireSize() const override { return m_wire_size; }
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+  void ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                      Variable** cl) const override;
+
+ private:
+  size_t m_wire_size;
+};
+
 class InterfaceType : public Type {
  public:
   InterfaceType(const JavaTypeNamespace* types, const std::string& package,
@@ -412,14 +547,21 @@ class ClassLoaderType : public Type {
   ClassLoaderType(const JavaTypeNamespace* types);
 };
 
+// List<T>.  Lists of primitives hold the boxed type in Java, but are
+// marshalled as a count followed by the unboxed values: the same format as
+// the matching primitive array (and the C++ readInt32Vector family).
 class GenericListType : public Type {
  public:
   GenericListType(const JavaTypeNamespace* types, const Type* arg);
 
+  // Returns the boxed Java class for a primitive |type| that can be held in
+  // a List, or the empty string if there is none.
+  static std::string BoxedJavaType(const Type* type);
+
   std::string CreatorName() const override;
   std::string InstantiableName() const override;
   std::string JavaType() const override {
-    return "java.util.List<" + m_contained_type->JavaType() + ">";
+    return "java.util.List<" + ElementJavaType() + ">";
   }
 
   void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
@@ -431,8 +573,43 @@ class GenericListType : public Type {
   const ValidatableType* NullableType() const override { return this; }
 
  private:
+  std::string ElementJavaType() const;
+  void ReadElements(StatementBlock* addTo, Variable* v, Variable* parcel,
+                    Variable* size) const;
+
   const Type* m_contained_type;
   const std::string m_creator;
+  // The boxed element type, only set for lists of primitives.
+  std::unique_ptr<Type> m_boxed_type;
+};
+
+// Map<K,V> with concrete key and value types.  Entries are marshalled as a
+// count followed by typed key/value pairs, so unlike MapType no ClassLoader
+// or per-entry type tags are involved.
+class GenericMapType : public Type {
+ public:
+  GenericMapType(const JavaTypeNamespace* types, const Type* key_type,
+                 const Type* value_type);
+
+  std::string InstantiableName() const override;
+  std::string JavaType() const override;
+
+  void WriteToParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                     int flags) const override;
+  void CreateFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                        Variable** cl) const override;
+  void ReadFromParcel(StatementBlock* addTo, Variable* v, Variable* parcel,
+                      Variable** cl) const override;
+  const ValidatableType* NullableType() const override { return this; }
+
+ private:
+  void ReadEntries(StatementBlock* addTo, Variable* v, Variable* parcel,
+                   Variable* size, Variable** cl) const;
+
+  const Type* m_key_type;
+  const Type* m_value_type;
+  // java.util.Map.Entry<K,V>, used to iterate over the map when writing.
+  std::unique_ptr<Type> m_entry_type;
 };
 
 class JavaTypeNamespace : public LanguageTypeNamespace<Type> {
@@ -449,9 +626,11 @@ class JavaTypeNamespace : public LanguageTypeNamespace<Type> {
   bool AddMapType(const std::string& key_type_name,
                   const std::string& value_type_name) override;
 
+  const Type* VoidType() const { return m_void_type; }
   const Type* BoolType() const { return m_bool_type; }
   const Type* IntType() const { return m_int_type; }
   const Type* StringType() const { return m_string_type; }
+  const Type* ObjectType() const { return m_object_type; }
   const Type* TextUtilsType() const { return m_text_utils_type; }
   const Type* RemoteExceptionType() const { return m_remote_exception_type; }
   const Type* RuntimeExceptionType() const { return m_runtime_exception_type; }
@@ -463,13 +642,18 @@ class JavaTypeNamespace : public LanguageTypeNamespace<Type> {
   const Type* ParcelableInterfaceType() const {
     return m_parcelable_interface_type;
   }
+  const Type* ParcelableCreatorType() const {
+    return m_parcelable_creator_type;
+  }
   const Type* ContextType() const { return m_context_type; }
   const Type* ClassLoaderType() const { return m_classloader_type; }
 
  private:
+  const Type* m_void_type{nullptr};
   const Type* m_bool_type{nullptr};
   const Type* m_int_type{nullptr};
   const Type* m_string_type{nullptr};
+  const Type* m_object_type{nullptr};
   const Type* m_text_utils_type{nullptr};
   const Type* m_remote_exception_type{nullptr};
   const Type* m_runtime_exception_type{nullptr};
@@ -479,6 +663,7 @@ class JavaTypeNamespace : public LanguageTypeNamespace<Type> {
   const Type* m_binder_proxy_type{nullptr};
   const Type* m_parcel_type{nullptr};
   const Type* m_parcelable_interface_type{nullptr};
+  const Type* m_parcelable_creator_type{nullptr};
   const Type* m_context_type{nullptr};
   const Type* m_classloader_type{nullptr};
 
@@ -491,6 +676,9 @@ extern Expression* SUPER_VALUE;
 extern Expression* TRUE_VALUE;
 extern Expression* FALSE_VALUE;
 
+// The flags parameter of a generated writeToParcel().
+extern const char kWriteToParcelFlags[];
+
 }  // namespace java
 }  // namespace aidl
 }  // namespace android
@@ -15,17 +15,91 @@
  */
 
 #include <memory>
+#include <string>
 
 #include <gtest/gtest.h>
 
 #include "aidl_language.h"
+#include "ast_java.h"
+#include "code_writer.h"
 #include "type_java.h"
 
+using std::string;
 using std::unique_ptr;
 
 namespace android {
 namespace aidl {
 namespace java {
+namespace {
+
+const char kExpectedMapWriteOutput[] =
+R"({
+if ((m==null)) {
+_data.writeInt(-1);
+}
+else {
+_data.writeInt(m.size());
+for (java.util.Map.Entry<java.lang.String, android.os.IBinder> m_entry : m.entrySet()) {
+java.lang.String m_key = m_entry.getKey();
+_data.writeString(m_key);
+android.os.IBinder m_value = m_entry.getValue();
+_data.writeStrongBinder(m_value);
+}
+}
+}
+)";
+
+const char kExpectedMapCreateOutput[] =
+R"({
+int m_size = _data.readInt();
+if ((m_size<0)) {
+m = null;
+}
+else {
+m = new java.util.HashMap<java.lang.String, android.os.IBinder>(m_size);
+for (int m_i = 0; m_i < m_size; m_i++) {
+java.lang.String m_key;
+m_key = _data.readString();
+android.os.IBinder m_value;
+m_value = _data.readStrongBinder();
+m.put(m_key, m_value);
+}
+}
+}
+)";
+
+const char kExpectedLongListWriteOutput[] =
+R"({
+if ((l==null)) {
+_data.writeInt(-1);
+}
+else {
+_data.writeInt(l.size());
+for (java.lang.Long l_item : l) {
+_data.writeLong(l_item);
+}
+}
+}
+)";
+
+const char kExpectedLongListCreateOutput[] =
+R"({
+int l_size = _data.readInt();
+if ((l_size<0)) {
+l = null;
+}
+else {
+l = new java.util.ArrayList<java.lang.Long>(l_size);
+for (int l_i = 0; l_i < l_size; l_i++) {
+java.lang.Long l_item;
+l_item = _data.readLong();
+l.add(l_item);
+}
+}
+}
+)";
+
+}  // namespace
 
 class JavaTypeNamespaceTest : public ::testing::Test {
  protected:
@@ -45,8 +119,9 @@ TEST_F(JavaTypeNamespaceTest, ContainerTypeCreation) {
   // We start with no knowledge of parcelables or lists of them.
   EXPECT_FALSE(types_.HasTypeByCanonicalName("Foo"));
   EXPECT_FALSE(types_.HasTypeByCanonicalName("java.util.List<a.goog.Foo>"));
-  unique_ptr<AidlParcelable> parcelable(
-      new AidlParcelable(new AidlQualifiedName("Foo", ""), 0, {"a", "goog"}));
+  AidlArena arena;
+  unique_ptr<AidlParcelable> parcelable(new AidlParcelable(
+      arena.New<AidlQualifiedName>("Foo", ""), 0, {"a", "goog"}));
   // Add the parcelable type we care about.
   EXPECT_TRUE(types_.AddParcelableType(*parcelable.get(), __FILE__));
   // Now we can find the parcelable type, but not the List of them.
@@ -59,6 +134,73 @@ TEST_F(JavaTypeNamespaceTest, ContainerTypeCreation) {
   EXPECT_TRUE(types_.HasTypeByCanonicalName("java.util.List<a.goog.Foo>"));
 }
 
+TEST_F(JavaTypeNamespaceTest, TypedMapMarshallsEntriesWithoutClassLoader) {
+  AidlType container_type("Map<String,IBinder>", 0, "", false /* not array */);
+  EXPECT_TRUE(types_.MaybeAddContainerType(container_type));
+  const Type* map_type = types_.FindTypeByCanonicalName(
+      "java.util.Map<java.lang.String,android.os.IBinder>");
+  ASSERT_NE(nullptr, map_type);
+  EXPECT_EQ("java.util.Map<java.lang.String, android.os.IBinder>",
+            map_type->JavaType());
+
+  AstArena arena;
+  Variable* m = New<Variable>(map_type, "m");
+  Variable* data = New<Variable>(types_.ParcelType(), "_data");
+  Variable* cl = nullptr;
+  StatementBlock* write = New<StatementBlock>();
+  map_type->WriteToParcel(write, m, data, 0);
+  StatementBlock* create = New<StatementBlock>();
+  map_type->CreateFromParcel(create, m, data, &cl);
+  EXPECT_EQ(nullptr, cl);
+
+  string actual_output;
+  CodeWriterPtr writer = GetStringWriter(&actual_output);
+  write->Write(writer.get());
+  EXPECT_EQ(string(kExpectedMapWriteOutput), actual_output);
+  actual_output.clear();
+  writer = GetStringWriter(&actual_output);
+  create->Write(writer.get());
+  EXPECT_EQ(string(kExpectedMapCreateOutput), actual_output);
+}
+
+TEST_F(JavaTypeNamespaceTest, TypedMapRejectsPrimitives) {
+  AidlType container_type("Map<String,int>", 0, "", false /* not array */);
+  EXPECT_FALSE(types_.MaybeAddContainerType(container_type));
+}
+
+TEST_F(JavaTypeNamespaceTest, TypedPrimitiveListMarshallsUnboxedValues) {
+  AidlType container_type("List<long>", 0, "", false /* not array */);
+  EXPECT_TRUE(types_.MaybeAddContainerType(container_type));
+  const Type* list_type =
+      types_.FindTypeByCanonicalName("java.util.List<long>");
+  ASSERT_NE(nullptr, list_type);
+  EXPECT_EQ("java.util.List<java.lang.Long>", list_type->JavaType());
+
+  AstArena arena;
+  Variable* l = New<Variable>(list_type, "l");
+  Variable* data = New<Variable>(types_.ParcelType(), "_data");
+  Variable* cl = nullptr;
+  StatementBlock* write = New<StatementBlock>();
+  list_type->WriteToParcel(write, l, data, 0);
+  StatementBlock* create = New<StatementBlock>();
+  list_type->CreateFromParcel(create, l, data, &cl);
+  EXPECT_EQ(nullptr, cl);
+
+  string actual_output;
+  CodeWriterPtr writer = GetStringWriter(&actual_output);
+  write->Write(writer.get());
+  EXPECT_EQ(string(kExpectedLongListWriteOutput), actual_output);
+  actual_output.clear();
+  writer = GetStringWriter(&actual_output);
+  create->Write(writer.get());
+  EXPECT_EQ(string(kExpectedLongListCreateOutput), actual_output);
+}
+
+TEST_F(JavaTypeNamespaceTest, TypedListRejectsBytes) {
+  AidlType container_type("List<byte>", 0, "", false /* not array */);
+  EXPECT_FALSE(types_.MaybeAddContainerType(container_type));
+}
+
 }  // namespace java
 }  // namespace android
 }  // namespace aidl
@@ -46,6 +46,8 @@ const char kStringCanonicalName[] = "java.lang.String";
 
 const char kUtf8Annotation[] = "@utf8";
 const char kUtf8InCppAnnotation[] = "@utfInCpp";
+const char kPackedAnnotation[] = "@packed";
+const char kCompressedAnnotation[] = "@compressed";
 
 namespace {
 
@@ -157,5 +159,37 @@ const ValidatableType* TypeNamespace::GetArgType(
   return t;
 }
 
+const ValidatableType* TypeNamespace::GetFieldType(
+    const AidlVariableDeclaration& field, const string& filename) const {
+  string error_prefix = StringPrintf(
+      "In file %s line %d field %s:\n    ",
+      filename.c_str(), field.GetLine(), field.GetName().c_str());
+
+  if (field.GetType().GetName() == "void") {
+    LOG(ERROR) << error_prefix << "Fields cannot be void";
+    return nullptr;
+  }
+
+  string error_msg;
+  const ValidatableType* t = GetValidatableType(field.GetType(), &error_msg);
+  if (t == nullptr) {
+    LOG(ERROR) << error_prefix << error_msg;
+    return nullptr;
+  }
+
+  if (is_java_keyword(field.GetName().c_str())) {
+    LOG(ERROR) << error_prefix << "Field name is a Java or aidl keyword";
+    return nullptr;
+  }
+
+  // Reserve a namespace for internal use
+  if (field.GetName().substr(0, 5) == "_aidl") {
+    LOG(ERROR) << error_prefix << "Field name cannot begin with '_aidl'";
+    return nullptr;
+  }
+
+  return t;
+}
+
 }  // namespace aidl
 }  // namespace android
@@ -46,6 +46,8 @@ extern const char kStringCanonicalName[];
 // here for the sake of logging a common string constant.
 extern const char kUtf8Annotation[];
 extern const char kUtf8InCppAnnotation[];
+extern const char kPackedAnnotation[];
+extern const char kCompressedAnnotation[];
 
 class ValidatableType {
  public:
@@ -67,6 +69,17 @@ class ValidatableType {
 
   virtual const ValidatableType* ArrayType() const = 0;
   virtual const ValidatableType* NullableType() const = 0;
+  // The variable length encoding of an array type, or nullptr if it has
+  // none.  Only arrays of boolean, char, int and long can be @packed.
+  virtual const ValidatableType* PackedType() const { return nullptr; }
+  // The type that compresses large values of this type on the wire, or
+  // nullptr if it has none.  Only byte[], String and parcelables can be
+  // @compressed.
+  virtual const ValidatableType* CompressedType() const { return nullptr; }
+
+  // The number of bytes every value of this type takes up in a parcel, or 0
+  // if that is not known from the type alone.
+  virtual size_t FixedWireSize() const { return 0; }
 
   // ShortName() is the class name without a package.
   std::string ShortName() const { return type_name_; }
@@ -121,6 +134,12 @@ class TypeNamespace {
                                             int arg_index,
                                             const std::string& filename) const;
 
+  // Returns a pointer to a type corresponding to |field| or nullptr if
+  // |field| has an invalid type for a structured parcelable field.
+  virtual const ValidatableType* GetFieldType(
+      const AidlVariableDeclaration& field,
+      const std::string& filename) const;
+
   // Returns a pointer to a type corresponding to |interface|.
   virtual const ValidatableType* GetInterfaceType(
       const AidlInterface& interface) const = 0;
@@ -395,7 +414,8 @@ const ValidatableType* LanguageTypeNamespace<T>::GetValidatableType(
       return nullptr;
     }
     if (aidl_type.IsNullable() || aidl_type.IsUtf8() ||
-        aidl_type.IsUtf8InCpp()) {
+        aidl_type.IsUtf8InCpp() || aidl_type.IsPacked() ||
+        aidl_type.IsCompressed()) {
       *error_msg = "void type cannot be annotated";
       return nullptr;
     }
@@ -454,6 +474,28 @@ const ValidatableType* LanguageTypeNamespace<T>::GetValidatableType(
     }
   }
 
+  if (aidl_type.IsPacked()) {
+    type = (aidl_type.IsArray()) ? type->PackedType() : nullptr;
+    if (!type) {
+      *error_msg = StringPrintf("type '%s%s' may not be annotated as %s.",
+                                aidl_type.GetName().c_str(),
+                                (aidl_type.IsArray()) ? "[]" : "",
+                                kPackedAnnotation);
+      return nullptr;
+    }
+  }
+
+  if (aidl_type.IsCompressed()) {
+    type = type->CompressedType();
+    if (!type) {
+      *error_msg = StringPrintf("type '%s%s' may not be annotated as %s.",
+                                aidl_type.GetName().c_str(),
+                                (aidl_type.IsArray()) ? "[]" : "",
+                                kCompressedAnnotation);
+      return nullptr;
+    }
+  }
+
   if (aidl_type.IsNullable()) {
     type = type->NullableType();
     if (!type) {
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "wire_size.h"
+
+#include <memory>
+
+#include "code_writer.h"
+#include "type_namespace.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace android {
+namespace aidl {
+
+// BINDER_VM_SIZE in libbinder's ProcessState.
+const size_t kBinderTransactionBufferSize = (1 * 1024 * 1024) - (4096 * 2);
+
+namespace {
+
+// Parcels pad everything they hold to 4 bytes.
+const size_t kParcelAlignment = 4;
+// A flat_binder_object, which carries binders and file descriptors.
+const size_t kFlatBinderObjectSize = 24;
+// A length, or -1 for null, ahead of strings, arrays, lists and maps, and
+// the null marker ahead of parcelables.
+const size_t kHeaderSize = 4;
+
+size_t PadSize(size_t size) {
+  return (size + kParcelAlignment - 1) & ~(kParcelAlignment - 1);
+}
+
+WireSize Exactly(size_t size) {
+  WireSize ret;
+  ret.min = ret.max = size;
+  return ret;
+}
+
+WireSize AtLeast(size_t size) {
+  WireSize ret;
+  ret.min = size;
+  ret.max = WireSize::kUnbounded;
+  return ret;
+}
+
+// The strict mode policy followed by the interface descriptor as a String16
+// (a length, then the UTF-16 characters and a terminator).
+size_t InterfaceTokenSize(const AidlInterface& interface) {
+  const size_t descriptor_length = interface.GetCanonicalName().size();
+  return 4 + kHeaderSize + PadSize((descriptor_length + 1) * 2);
+}
+
+void WriteWireSize(CodeWriter* writer, const char* name, const WireSize& size) {
+  writer->Write("\"%s\": {\"min\": %zu, \"max\": ", name, size.min);
+  if (size.IsBounded()) {
+    writer->Write("%zu}", size.max);
+  } else {
+    writer->Write("null}");
+  }
+}
+
+}  // namespace
+
+void WireSize::Add(const WireSize& other) {
+  min += other.min;
+  if (!IsBounded() || !other.IsBounded()) {
+    max = kUnbounded;
+  } else {
+    max += other.max;
+  }
+}
+
+size_t PrimitiveWireSize(const string& aidl_type) {
+  for (const char* name : {"boolean", "byte", "char", "int", "float"}) {
+    if (aidl_type == name) {
+      return 4;
+    }
+  }
+  for (const char* name : {"long", "double"}) {
+    if (aidl_type == name) {
+      return 8;
+    }
+  }
+  return 0;
+}
+
+WireSize GetWireSize(const AidlType& type) {
+  if (type.IsArray()) {
+    return AtLeast(kHeaderSize);
+  }
+  if (type.GetName() == "void") {
+    return Exactly(0);
+  }
+  const size_t primitive = PrimitiveWireSize(type.GetName());
+  if (primitive != 0) {
+    return Exactly(primitive);
+  }
+
+  const ValidatableType* language_type =
+      type.GetLanguageType<ValidatableType>();
+  if (language_type->FixedWireSize() != 0) {
+    return Exactly(language_type->FixedWireSize());
+  }
+  // Interfaces are KIND_INTERFACE in Java but KIND_GENERATED in C++.
+  if (language_type->Kind() == ValidatableType::KIND_INTERFACE ||
+      language_type->Kind() == ValidatableType::KIND_GENERATED ||
+      (language_type->Kind() == ValidatableType::KIND_BUILT_IN &&
+       (language_type->ShortName() == "IBinder" ||
+        language_type->ShortName() == "FileDescriptor"))) {
+    return Exactly(kFlatBinderObjectSize);
+  }
+  return AtLeast(kHeaderSize);
+}
+
+size_t GetFixedWireSize(const AidlStructuredParcelable& parcelable) {
+  size_t size = 0;
+  for (const AidlVariableDeclaration* field : parcelable.GetFields()) {
+    size += PrimitiveWireSize(field->GetType().GetName());
+  }
+  return size;
+}
+
+MethodWireSize GetMethodWireSize(const AidlInterface& interface,
+                                 const AidlMethod& method) {
+  MethodWireSize ret;
+  ret.request = Exactly(InterfaceTokenSize(interface));
+  for (const AidlArgument* a : method.GetInArguments()) {
+    ret.request.Add(GetWireSize(a->GetType()));
+  }
+
+  if (interface.IsOneway() || method.IsOneway()) {
+    return ret;
+  }
+  // A successful call replies with an exception code of 0.
+  ret.reply = Exactly(4);
+  ret.reply.Add(GetWireSize(method.GetType()));
+  for (const AidlArgument* a : method.GetOutArguments()) {
+    ret.reply.Add(GetWireSize(a->GetType()));
+  }
+  return ret;
+}
+
+bool WriteSizeReport(const AidlInterface& interface, const string& path,
+                     const IoDelegate& io_delegate) {
+  unique_ptr<CodeWriter> writer = io_delegate.GetCodeWriter(path);
+  if (!writer) {
+    LOG(ERROR) << "Failed to open " << path << " for writing.";
+    return false;
+  }
+
+  writer->Write("{\n");
+  writer->Write("  \"interface\": \"%s\",\n",
+                interface.GetCanonicalName().c_str());
+  writer->Write("  \"methods\": [");
+  const char* separator = "\n";
+  for (AidlMethod* method : interface.GetMethods()) {
+    const MethodWireSize size = GetMethodWireSize(interface, *method);
+    const bool oneway = interface.IsOneway() || method->IsOneway();
+    writer->Write("%s    {\"name\": \"%s\", \"id\": %d, \"oneway\": %s, ",
+                  separator, method->GetName().c_str(), method->GetId(),
+                  (oneway) ? "true" : "false");
+    WriteWireSize(writer.get(), "request", size.request);
+    if (!oneway) {
+      writer->Write(", ");
+      WriteWireSize(writer.get(), "reply", size.reply);
+    }
+    writer->Write("}");
+    separator = ",\n";
+  }
+  writer->Write("\n  ]\n}\n");
+
+  if (!writer->Close()) {
+    io_delegate.RemovePath(path);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace aidl
+}  // namespace android
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AIDL_WIRE_SIZE_H_
+#define AIDL_WIRE_SIZE_H_
+
+#include <cstddef>
+#include <limits>
+#include <string>
+
+#include "aidl_language.h"
+#include "io_delegate.h"
+
+namespace android {
+namespace aidl {
+
+// The space binder maps into each process for transactions in flight.  No
+// single transaction can be larger, and oneway transactions share half of it.
+extern const size_t kBinderTransactionBufferSize;
+
+// Bounds, in bytes, on how much of a parcel something takes up.
+struct WireSize {
+  static constexpr size_t kUnbounded = std::numeric_limits<size_t>::max();
+
+  size_t min = 0;
+  size_t max = 0;  // kUnbounded if the size depends on the value.
+
+  bool IsBounded() const { return max != kUnbounded; }
+  void Add(const WireSize& other);
+};
+
+// Sizes of the parcels exchanged by one call of a method.  Replies are sized
+// for calls that succeed, and oneway methods have none.
+struct MethodWireSize {
+  WireSize request;
+  WireSize reply;
+};
+
+// Returns the size of a primitive type named |aidl_type| (e.g. "long"), or 0
+// if it is not a primitive.
+size_t PrimitiveWireSize(const std::string& aidl_type);
+
+// Returns the size of a value of |type|, which must have had its language
+// type set by type checking.
+WireSize GetWireSize(const AidlType& type);
+
+// Returns the exact size of a @FixedSize |parcelable|.
+size_t GetFixedWireSize(const AidlStructuredParcelable& parcelable);
+
+MethodWireSize GetMethodWireSize(const AidlInterface& interface,
+                                 const AidlMethod& method);
+
+// Writes the sizes of every method of |interface| to |path| as JSON.
+bool WriteSizeReport(const AidlInterface& interface, const std::string& path,
+                     const IoDelegate& io_delegate);
+
+}  // namespace aidl
+}  // namespace android
+
+#endif  // AIDL_WIRE_SIZE_H_